@@ -1242,7 +1242,7 @@ static void ethernet_discover(char *network, bool cam_found) {
 		snprintf(device->name, INDIGO_NAME_SIZE, "Apogee %s #%d", model.c_str(), id);
 		for (int j = 0; j < MAXCAMERAS; j++) {
 			if (devices[j] == NULL) {
-				indigo_async((void *(*)(void *))indigo_attach_device, devices[j] = device);
+				indigo_async_serial((void *(*)(void *))indigo_attach_device, devices[j] = device, DRIVER_NAME);
 				break;
 			}
 		}
@@ -1369,7 +1369,7 @@ static void process_plug_event() {
 		snprintf(device->name, INDIGO_NAME_SIZE, "Apogee %s #%d", model.c_str(), id);
 		for (int j = 0; j < MAXCAMERAS; j++) {
 			if (devices[j] == NULL) {
-				indigo_async((void *(*)(void *))indigo_attach_device, devices[j] = device);
+				indigo_async_serial((void *(*)(void *))indigo_attach_device, devices[j] = device, DRIVER_NAME);
 				break;
 			}
 		}
@@ -1486,6 +1486,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 #ifdef ___LIBUSBFIX__
 			pthread_t unplug_thread;
 			if (pthread_create(&unplug_thread, NULL, unplug_thread_func, NULL)) {
@@ -1563,6 +1564,7 @@ indigo_result indigo_ccd_apogee(indigo_driver_action action, indigo_driver_info
 				last_action = action;
 				libusb_hotplug_deregister_callback(NULL, callback_handle);
 				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+				indigo_async_wait(DRIVER_NAME);
 				remove_all_devices();
 				indigo_detach_device(apogee_ethernet);
 				free(apogee_ethernet);
@@ -1559,7 +1559,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 				private_data->dev_id = id;
 				memcpy(&(private_data->info), &info, sizeof(ASI_CAMERA_INFO));
 				device->private_data = private_data;
-				indigo_async((void *)(void *)indigo_attach_device, device);
+				indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 				devices[slot]=device;
 
 				if (info.ST4Port) {
@@ -1576,13 +1576,14 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 					sprintf(device->name, "%s Guider #%d", info.Name, id);
 					INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 					device->private_data = private_data;
-					indigo_async((void *)(void *)indigo_attach_device, device);
+					indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 					devices[slot]=device;
 				}
 			}
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			int id, slot;
 			bool removed = false;
 			asi_private_data *private_data = NULL;
@@ -1685,6 +1686,7 @@ indigo_result indigo_ccd_asi(indigo_driver_action action, indigo_driver_info *in
 			last_action = action;
 			libusb_hotplug_deregister_callback(NULL, callback_handle);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+			indigo_async_wait(DRIVER_NAME);
 			remove_all_devices();
 			break;
 
@@ -626,7 +626,7 @@ static void process_plug_event() {
 	memset(private_data, 0, sizeof(dsi_private_data));
 	sprintf(private_data->dev_sid, "%s", sid);
 	device->private_data = private_data;
-	indigo_async((void *(*)(void *))indigo_attach_device, device);
+	indigo_async_serial((void *(*)(void *))indigo_attach_device, device, DRIVER_NAME);
 	devices[slot]=device;
 }
 
@@ -714,6 +714,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			#ifdef __APPLE__
 				pthread_t unplug_thread;
 				/* This is ugly hack but otherwise does not work!!!
@@ -770,6 +771,7 @@ indigo_result indigo_ccd_dsi(indigo_driver_action action, indigo_driver_info *in
 		last_action = action;
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+		indigo_async_wait(DRIVER_NAME);
 		remove_all_devices();
 		break;
 
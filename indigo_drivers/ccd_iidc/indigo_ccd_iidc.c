@@ -674,7 +674,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 						device->private_data = private_data;
 						for (int j = 0; j < MAX_DEVICES; j++) {
 							if (devices[j] == NULL) {
-								indigo_async((void *)(void *)indigo_attach_device, devices[j] = device);
+								indigo_async_serial((void *)(void *)indigo_attach_device, devices[j] = device, DRIVER_NAME);
 								break;
 							}
 						}
@@ -685,6 +685,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			for (int j = 0; j < MAX_DEVICES; j++) {
 				indigo_device *device = devices[j];
 				if (device != NULL)
@@ -852,6 +853,7 @@ indigo_result indigo_ccd_iidc(indigo_driver_action action, indigo_driver_info *i
 		last_action = action;
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+		indigo_async_wait(DRIVER_NAME);
 //#ifdef INDIGO_MACOS
 //			CFRunLoopStop(runloop);
 //#endif
@@ -627,7 +627,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 					device->private_data = private_data;
 					for (int j = 0; j < MAX_DEVICES; j++) {
 						if (devices[j] == NULL) {
-							indigo_async((void *)(void *)indigo_attach_device, devices[j] = device);
+							indigo_async_serial((void *)(void *)indigo_attach_device, devices[j] = device, DRIVER_NAME);
 							break;
 						}
 					}
@@ -640,7 +640,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 						device->private_data = private_data;
 						for (int j = 0; j < MAX_DEVICES; j++) {
 							if (devices[j] == NULL) {
-								indigo_async((void *)(void *)indigo_attach_device, devices[j] = device);
+								indigo_async_serial((void *)(void *)indigo_attach_device, devices[j] = device, DRIVER_NAME);
 								break;
 							}
 						}
@@ -654,7 +654,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 						device->private_data = private_data;
 						for (int j = 0; j < MAX_DEVICES; j++) {
 							if (devices[j] == NULL) {
-								indigo_async((void *)(void *)indigo_attach_device, devices[j] = device);
+								indigo_async_serial((void *)(void *)indigo_attach_device, devices[j] = device, DRIVER_NAME);
 								break;
 							}
 						}
@@ -664,6 +664,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			for (int i = 0; i < MAX_DEVICES; i++) {
 				indigo_device *device = devices[i];
 				if (device)
@@ -716,6 +717,7 @@ indigo_result indigo_ccd_mi(indigo_driver_action action, indigo_driver_info *inf
 			last_action = action;
 			libusb_hotplug_deregister_callback(NULL, callback_handle);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+			indigo_async_wait(DRIVER_NAME);
 
 			for (int i = MAX_DEVICES - 1; i >=0; i--) {
 				indigo_device *device = devices[i];
@@ -1569,7 +1569,7 @@ static void process_plug_event() {
 	memset(private_data, 0, sizeof(qhy_private_data));
 	sprintf(private_data->dev_sid, "%s", sid);
 	device->private_data = private_data;
-	indigo_async((void *(*)(void *))indigo_attach_device, device);
+	indigo_async_serial((void *(*)(void *))indigo_attach_device, device, DRIVER_NAME);
 	devices[slot]=device;
 
 	if(check_st4 == QHYCCD_SUCCESS) {
@@ -1587,7 +1587,7 @@ static void process_plug_event() {
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		private_data->fw_count = 5; /* No way to get it from SDK but all QHY FWs have 5 slots */
 		device->private_data = private_data;
-		indigo_async((void *(*)(void *))indigo_attach_device, device);
+		indigo_async_serial((void *(*)(void *))indigo_attach_device, device, DRIVER_NAME);
 		devices[slot]=device;
 	}
 
@@ -1605,7 +1605,7 @@ static void process_plug_event() {
 		sprintf(device->name, "%s Wheel #%s", dev_name, dev_usbpath);
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		device->private_data = private_data;
-		indigo_async((void *(*)(void *))indigo_attach_device, device);
+		indigo_async_serial((void *(*)(void *))indigo_attach_device, device, DRIVER_NAME);
 		devices[slot]=device;
 	}
 
@@ -1696,6 +1696,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			#ifdef __APPLE__
 				pthread_t unplug_thread;
 				/* This is ugly hack but otherwise QHY5IIL does not work!!!
@@ -1774,6 +1775,7 @@ indigo_result indigo_ccd_qhy(indigo_driver_action action, indigo_driver_info *in
 			last_action = action;
 			libusb_hotplug_deregister_callback(NULL, callback_handle);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+			indigo_async_wait(DRIVER_NAME);
 			remove_all_devices();
 			ReleaseQHYCCDResource();
 			break;
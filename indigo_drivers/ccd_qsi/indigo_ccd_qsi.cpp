@@ -516,7 +516,7 @@ static void hotplug(void *param) {
 		device->private_data = private_data;
 		for (int j = 0; j < QSICamera::MAXCAMERAS; j++) {
 			if (devices[j] == NULL) {
-				indigo_async((void *(*)(void *))indigo_attach_device, devices[j] = device);
+				indigo_attach_device(devices[j] = device);
 				break;
 			}
 		}
@@ -576,12 +576,12 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 		switch (event) {
 			case LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED: {
 				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Hot-plug: vid=%x pid=%x", descriptor.idVendor, descriptor.idProduct);
-				indigo_async((void *(*)(void *))hotplug, NULL);
+				indigo_async_serial((void *(*)(void *))hotplug, NULL, DRIVER_NAME);
 				break;
 			}
 			case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
 				INDIGO_DRIVER_DEBUG(DRIVER_NAME, "Hot-unplug: vid=%x pid=%x", descriptor.idVendor, descriptor.idProduct);
-				indigo_async((void *(*)(void *))hotunplug, NULL);
+				indigo_async_serial((void *(*)(void *))hotunplug, NULL, DRIVER_NAME);
 				break;
 			}
 		}
@@ -630,7 +630,7 @@ indigo_result indigo_ccd_qsi(indigo_driver_action action, indigo_driver_info *in
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "QSIAPI version: %s", info.c_str());
 			last_action = action;
 #ifdef INDIGO_MACOS
-			indigo_async((void *(*)(void *))hotplug, NULL);
+			indigo_async_serial((void *(*)(void *))hotplug, NULL, DRIVER_NAME);
 			return INDIGO_OK;
 #else
 			indigo_start_usb_event_handler();
@@ -646,6 +646,7 @@ indigo_result indigo_ccd_qsi(indigo_driver_action action, indigo_driver_info *in
 			libusb_hotplug_deregister_callback(NULL, callback_handle);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
 #endif
+			indigo_async_wait(DRIVER_NAME);
 			remove_all_devices();
 			break;
 		}
@@ -2082,7 +2082,7 @@ static bool plug_device(char *cam_name, unsigned short device_type, unsigned lon
 	set_primary_ccd_flag(device);
 	strncpy(private_data->dev_name, cam_name, MAX_PATH);
 	device->private_data = private_data;
-	indigo_async((void *)(void *)indigo_attach_device, device);
+	indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 	devices[slot]=device;
 
 	/* Creating guider device */
@@ -2098,7 +2098,7 @@ static bool plug_device(char *cam_name, unsigned short device_type, unsigned lon
 	sprintf(device->name, "SBIG %s Guider Port #%s", cam_name, device_index_str);
 	INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 	device->private_data = private_data;
-	indigo_async((void *)(void *)indigo_attach_device, device);
+	indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 	devices[slot]=device;
 
 	/* Check if there is secondary CCD and create device */
@@ -2121,7 +2121,7 @@ static bool plug_device(char *cam_name, unsigned short device_type, unsigned lon
 		INDIGO_DEVICE_ATTACH_LOG(DRIVER_NAME, device->name);
 		device->private_data = private_data;
 		clear_primary_ccd_flag(device);
-		indigo_async((void *)(void *)indigo_attach_device, device);
+		indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 		devices[slot]=device;
 	}
 
@@ -2172,7 +2172,7 @@ static bool plug_device(char *cam_name, unsigned short device_type, unsigned lon
 				private_data->fw_device = cfwr.cfwModel;
 				private_data->fw_count = cfwr.cfwResult2;
 				device->private_data = private_data;
-				indigo_async((void *)(void *)indigo_attach_device, device);
+				indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 				devices[slot]=device;
 			}
 		}
@@ -2276,6 +2276,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			int slot, usb_index;
 			char cam_name[MAX_PATH];
 			bool removed = false;
@@ -2454,6 +2455,7 @@ indigo_result indigo_ccd_sbig(indigo_driver_action action, indigo_driver_info *i
 		last_action = action;
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+		indigo_async_wait(DRIVER_NAME);
 		remove_usb_devices();
 		remove_eth_devices();
 		indigo_detach_device(sbig_eth);
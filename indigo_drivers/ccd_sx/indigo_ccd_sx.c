@@ -1084,7 +1084,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 				device->private_data = private_data;
 				for (int j = 0; j < MAX_DEVICES; j++) {
 					if (devices[j] == NULL) {
-						indigo_async((void *)(void *)indigo_attach_device, devices[j] = device);
+						indigo_async_serial((void *)(void *)indigo_attach_device, devices[j] = device, DRIVER_NAME);
 						break;
 					}
 				}
@@ -1096,7 +1096,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 				device->private_data = private_data;
 				for (int j = 0; j < MAX_DEVICES; j++) {
 					if (devices[j] == NULL) {
-						indigo_async((void *)(void *)indigo_attach_device, devices[j] = device);
+						indigo_async_serial((void *)(void *)indigo_attach_device, devices[j] = device, DRIVER_NAME);
 						break;
 					}
 				}
@@ -1106,6 +1106,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 		break;
 	}
 	case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+		indigo_async_wait(DRIVER_NAME);
 		sx_private_data *private_data = NULL;
 		for (int j = 0; j < MAX_DEVICES; j++) {
 			if (devices[j] != NULL) {
@@ -1157,6 +1158,7 @@ indigo_result indigo_ccd_sx(indigo_driver_action action, indigo_driver_info *inf
 		last_action = action;
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+		indigo_async_wait(DRIVER_NAME);
 		for (int j = 0; j < MAX_DEVICES; j++) {
 			if (devices[j] != NULL) {
 				indigo_device *device = devices[j];
@@ -545,7 +545,7 @@ static void process_plug_event() {
 	strncpy(private_data->dev_file_name, fli_file_names[idx], MAX_PATH);
 	strncpy(private_data->dev_name, fli_dev_names[idx], MAX_PATH);
 	device->private_data = private_data;
-	indigo_async((void *)(void *)indigo_attach_device, device);
+	indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 	devices[slot]=device;
 	pthread_mutex_unlock(&device_mutex);
 }
@@ -610,6 +610,7 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 #ifdef ___LIBUSBFIX__
 			pthread_t unplug_thread;
 			if (pthread_create(&unplug_thread, NULL, unplug_thread_func, NULL)) {
@@ -669,6 +670,7 @@ indigo_result indigo_focuser_fli(indigo_driver_action action, indigo_driver_info
 		last_action = action;
 		libusb_hotplug_deregister_callback(NULL, callback_handle);
 		INDIGO_DEBUG_DRIVER(indigo_debug("libusb_hotplug_deregister_callback"));
+		indigo_async_wait(DRIVER_NAME);
 		remove_all_devices();
 		break;
 
@@ -403,12 +403,13 @@ static int hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotp
 				memset(private_data, 0, sizeof(asi_private_data));
 				private_data->dev_id = id;
 				device->private_data = private_data;
-				indigo_async((void *)(void *)indigo_attach_device, device);
+				indigo_async_serial((void *)(void *)indigo_attach_device, device, DRIVER_NAME);
 				devices[slot]=device;
 			}
 			break;
 		}
 		case LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT: {
+			indigo_async_wait(DRIVER_NAME);
 			int id, slot;
 			bool removed = false;
 			asi_private_data *private_data = NULL;
@@ -496,6 +497,7 @@ indigo_result indigo_guider_asi(indigo_driver_action action, indigo_driver_info
 			last_action = action;
 			libusb_hotplug_deregister_callback(NULL, callback_handle);
 			INDIGO_DRIVER_DEBUG(DRIVER_NAME, "libusb_hotplug_deregister_callback");
+			indigo_async_wait(DRIVER_NAME);
 			remove_all_devices();
 			break;
 
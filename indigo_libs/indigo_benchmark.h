@@ -0,0 +1,55 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO benchmark and load tool helpers
+ \file indigo_benchmark.h
+ */
+
+#ifndef indigo_benchmark_h
+#define indigo_benchmark_h
+
+#include <time.h>
+
+/** Wire protocol used by benchmark clients.
+ */
+typedef enum {
+	INDIGO_BENCHMARK_XML,
+	INDIGO_BENCHMARK_JSON,
+	INDIGO_BENCHMARK_WEBSOCKET
+} indigo_benchmark_protocol;
+
+/** Protocol names indexed by indigo_benchmark_protocol.
+ */
+static const char * const indigo_benchmark_protocol_name[] = { "xml", "json", "websocket" };
+
+/** Monotonic time in seconds.
+ */
+static inline double indigo_benchmark_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** qsort() comparator for doubles.
+ */
+static inline int indigo_benchmark_compare_double(const void *a, const void *b) {
+	double d = *(const double *)a - *(const double *)b;
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+#endif /* indigo_benchmark_h */
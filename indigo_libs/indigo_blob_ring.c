@@ -0,0 +1,169 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO shared memory BLOB ring
+ \file indigo_blob_ring.c
+ */
+
+#ifdef INDIGO_LINUX
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "indigo_blob_ring.h"
+#include "indigo_metrics.h"
+
+#define HEADER_SIZE		4096
+#define ALIGN(size)		(((size) + 63) & ~63)
+
+typedef struct {
+	char magic[8];
+	uint64_t capacity;
+	atomic_uint_least64_t head;	/* written by producer */
+	char padding[40];						/* keep head and tail in separate cache lines */
+	atomic_uint_least64_t tail;	/* written by consumer */
+} ring_header;
+
+struct indigo_blob_ring {
+	ring_header *header;
+	unsigned char *data;
+	uint64_t capacity;
+	size_t length;
+};
+
+static indigo_blob_ring *map_ring(int handle, size_t length) {
+	void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+	indigo_blob_ring *ring = malloc(sizeof(indigo_blob_ring));
+	ring->header = base;
+	ring->data = (unsigned char *)base + HEADER_SIZE;
+	ring->capacity = length - HEADER_SIZE;
+	ring->length = length;
+	return ring;
+}
+
+indigo_blob_ring *indigo_blob_ring_create(long capacity, int *handle) {
+	capacity = ALIGN(capacity);
+#ifdef INDIGO_LINUX
+	int fd = memfd_create("indigo_blob_ring", MFD_CLOEXEC);
+#else
+	static atomic_int serial = 0;
+	char name[64];
+	snprintf(name, sizeof(name), "/indigo_blob_ring.%d.%d", getpid(), atomic_fetch_add(&serial, 1));
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0)
+		shm_unlink(name);
+#endif
+	if (fd < 0) {
+		INDIGO_ERROR(indigo_error("Can't create BLOB ring"));
+		return NULL;
+	}
+	if (ftruncate(fd, HEADER_SIZE + capacity) < 0) {
+		INDIGO_ERROR(indigo_error("Can't allocate %ld bytes for BLOB ring", capacity));
+		close(fd);
+		return NULL;
+	}
+	indigo_blob_ring *ring = map_ring(fd, HEADER_SIZE + capacity);
+	if (ring == NULL) {
+		close(fd);
+		return NULL;
+	}
+	memcpy(ring->header->magic, INDIGO_BLOB_RING_MAGIC, 8);
+	ring->header->capacity = capacity;
+	atomic_store(&ring->header->head, 0);
+	atomic_store(&ring->header->tail, 0);
+	*handle = fd;
+	return ring;
+}
+
+indigo_blob_ring *indigo_blob_ring_attach(void) {
+	char *offer = getenv(INDIGO_BLOB_RING_ENV);
+	if (offer == NULL)
+		return NULL;
+	int fd = atoi(offer);
+	unsetenv(INDIGO_BLOB_RING_ENV); /* not to be inherited by processes started by driver */
+	struct stat st;
+	if (fd <= 2 || fstat(fd, &st) < 0 || st.st_size <= HEADER_SIZE)
+		return NULL;
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	indigo_blob_ring *ring = map_ring(fd, st.st_size);
+	close(fd);
+	if (ring == NULL)
+		return NULL;
+	if (memcmp(ring->header->magic, INDIGO_BLOB_RING_MAGIC, 8) || ring->header->capacity != ring->capacity) {
+		indigo_blob_ring_close(ring);
+		return NULL;
+	}
+	INDIGO_DEBUG(indigo_debug("BLOB ring with %lu bytes attached", (unsigned long)ring->capacity));
+	return ring;
+}
+
+bool indigo_blob_ring_put(indigo_blob_ring *ring, const void *data, long size, uint64_t *position) {
+	uint64_t capacity = ring->capacity;
+	if (size <= 0 || ALIGN(size) > capacity)
+		return false;
+	uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_relaxed);
+	uint64_t offset = head % capacity;
+	/* BLOB is always contiguous, skip the rest of ring if it doesn't fit before the end */
+	uint64_t start = offset + size > capacity ? head + capacity - offset : head;
+	uint64_t end = start + ALIGN(size);
+	double deadline = 0;
+	while (end - atomic_load_explicit(&ring->header->tail, memory_order_acquire) > capacity) {
+		double now = indigo_metric_time();
+		if (deadline == 0)
+			deadline = now + INDIGO_BLOB_RING_TIMEOUT;
+		else if (now > deadline)
+			return false;
+		usleep(1000);
+	}
+	memcpy(ring->data + start % capacity, data, size);
+	atomic_store_explicit(&ring->header->head, end, memory_order_release);
+	*position = start;
+	return true;
+}
+
+void *indigo_blob_ring_get(indigo_blob_ring *ring, uint64_t position, long size) {
+	uint64_t capacity = ring->capacity;
+	uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_acquire);
+	uint64_t tail = atomic_load_explicit(&ring->header->tail, memory_order_relaxed);
+	if (size <= 0 || position < tail || position + size > head || position % capacity + size > capacity)
+		return NULL;
+	return ring->data + position % capacity;
+}
+
+void indigo_blob_ring_release(indigo_blob_ring *ring, uint64_t position, long size) {
+	uint64_t end = position + ALIGN(size);
+	if (end > atomic_load_explicit(&ring->header->tail, memory_order_relaxed))
+		atomic_store_explicit(&ring->header->tail, end, memory_order_release);
+}
+
+void indigo_blob_ring_close(indigo_blob_ring *ring) {
+	if (ring == NULL)
+		return;
+	munmap(ring->header, ring->length);
+	free(ring);
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO shared memory BLOB ring
+ \file indigo_blob_ring.h
+ */
+
+#ifndef indigo_blob_ring_h
+#define indigo_blob_ring_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Ring signature.
+ */
+#define INDIGO_BLOB_RING_MAGIC			"INDIRNG1"
+
+/** Environment variable used to offer ring to subprocess driver (value is inherited file descriptor).
+ */
+#define INDIGO_BLOB_RING_ENV				"INDIGO_BLOB_RING"
+
+/** Default ring capacity.
+ */
+#define INDIGO_BLOB_RING_SIZE				(64 * 1024 * 1024)
+
+/** How long producer waits for free space before BLOB is sent inline (in seconds).
+ */
+#define INDIGO_BLOB_RING_TIMEOUT		2.0
+
+/** Shared memory ring, single producer (subprocess driver) and single consumer (XML parser in parent).
+ */
+typedef struct indigo_blob_ring indigo_blob_ring;
+
+/** Create ring in anonymous shared memory, descriptor to be inherited by subprocess (close-on-exec flag set) is returned in handle.
+ */
+extern indigo_blob_ring *indigo_blob_ring_create(long capacity, int *handle);
+
+/** Attach ring offered by parent process in INDIGO_BLOB_RING_ENV, returns NULL if there is no offer.
+ */
+extern indigo_blob_ring *indigo_blob_ring_attach(void);
+
+/** Copy BLOB to ring, position to be sent to consumer is returned. Returns false if BLOB doesn't fit into ring in time.
+ */
+extern bool indigo_blob_ring_put(indigo_blob_ring *ring, const void *data, long size, uint64_t *position);
+
+/** Get pointer to BLOB at position, returns NULL if position is not valid.
+ */
+extern void *indigo_blob_ring_get(indigo_blob_ring *ring, uint64_t position, long size);
+
+/** Release all BLOBs up to position + size.
+ */
+extern void indigo_blob_ring_release(indigo_blob_ring *ring, uint64_t position, long size);
+
+/** Unmap ring.
+ */
+extern void indigo_blob_ring_close(indigo_blob_ring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_blob_ring_h */
@@ -26,9 +26,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
 #include <assert.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <sys/time.h>
 #include <syslog.h>
 #include <unistd.h>
@@ -37,20 +42,114 @@
 #include "indigo_bus.h"
 #include "indigo_names.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
+#include "indigo_flight_recorder.h"
 
 #define MAX_DEVICES 32
-#define MAX_CLIENTS 8
+#define MAX_CLIENTS INDIGO_MAX_CLIENTS
 #define MAX_BLOBS	32
+#define MAX_PRIORITY_PROPERTIES 8
 
 #define BUFFER_SIZE	1024
 
+#define TRACKER_HASH_SIZE	256
+#define THROTTLE_HASH_SIZE	64	/* must be power of 2 */
+#define STORE_HASH_SIZE		1024	/* must be power of 2 */
+#define STORE_INLINE_TEXT	40		/* fits in number item fields */
+
+#define HTTP_MAX_CONNECTIONS	8
+#define HTTP_BUFFER_SIZE			16384
+#define HTTP_CONNECT_TIMEOUT	2000
+#define HTTP_HOST_SIZE				256		/* matches %255 in URL parser */
+
+#define LOG_QUEUE_SIZE				1024	/* must be power of 2 */
+#define LOG_SLOT_SIZE					512
+#define LOG_BUFFER_SIZE				1024	/* longer messages are formatted again into heap */
+#define LOG_DRAIN_TIMEOUT			100		/* ms */
+#define LOG_FULL_RETRIES			1000
+
 static indigo_device *devices[MAX_DEVICES];
 static indigo_client *clients[MAX_CLIENTS];
+static indigo_metric *device_metrics[MAX_DEVICES];
+static indigo_metric *client_metrics[MAX_CLIENTS];
 static indigo_property *blobs[MAX_BLOBS];
 static pthread_mutex_t device_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t client_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t http_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t store_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool is_started = false;
 
+/* property store keeps copies of definitions in order they were made, refreshed by updates and indexed by device and property name,
+   driver property is used only as identity and never dereferenced, driver can free it without deleting it first */
+
+/* copies are kept in compact form, names, labels and formats are interned and shared, short text values are stored inline
+   and longer ones in exactly sized heap buffer, full indigo_property is rebuilt only when it is needed */
+
+typedef struct stored_string {
+	struct stored_string *next;
+	unsigned long long hash;
+	int references;
+	char string[];
+} stored_string;
+
+typedef struct {
+	const char *name;
+	const char *label;
+	union {
+		struct {
+			char *heap;										/* NULL if value fits inline */
+			char value[STORE_INLINE_TEXT];
+		} text;
+		struct {
+			const char *format;
+			double min, max, step, value, target;
+		} number;
+		bool sw;
+		indigo_property_state light;
+		struct {
+			const char *format;
+			char *url;										/* NULL if empty */
+			long size;
+		} blob;
+	};
+} stored_item;
+
+typedef struct {
+	const char *device;
+	const char *name;
+	const char *group;
+	const char *label;
+	indigo_property_state state;
+	indigo_property_type type;
+	indigo_property_perm perm;
+	indigo_rule rule;
+	short version;
+	bool hidden;
+	bool priority;
+	int count;
+	stored_item items[];
+} stored_property;
+
+typedef struct store_entry {
+	indigo_device *device;
+	indigo_property *source;						/* driver property, identity only */
+	stored_property *property;					/* copy as last defined or updated */
+	unsigned long long hash;
+	struct store_entry *hash_next;
+	struct store_entry *prev, *next;
+} store_entry;
+
+typedef struct {
+	indigo_device *device;
+	indigo_property *property;
+} store_snapshot_entry;
+
+static store_entry *store_buckets[STORE_HASH_SIZE];
+static stored_string *string_buckets[STORE_HASH_SIZE];
+static store_entry *store_head = NULL;
+static store_entry *store_tail = NULL;
+static int store_count = 0;
+
 char *indigo_property_type_text[] = {
 	"UNDEFINED",
 	"TEXT",
@@ -84,12 +183,14 @@ char *indigo_switch_rule_text[] = {
 indigo_property INDIGO_ALL_PROPERTIES;
 
 static indigo_log_levels indigo_log_level = INDIGO_LOG_ERROR;
+indigo_log_levels indigo_log_subsystem_level[INDIGO_LOG_SUBSYSTEM_COUNT] = { INDIGO_LOG_ERROR, INDIGO_LOG_ERROR, INDIGO_LOG_ERROR };
 bool indigo_use_syslog = false;
 
 void (*indigo_log_message_handler)(const char *message) = NULL;
 
 char indigo_local_service_name[INDIGO_NAME_SIZE] = "";
 bool indigo_reshare_remote_devices = false;
+bool indigo_use_property_store = true;
 bool indigo_use_host_suffix = true;
 bool indigo_is_sandboxed = false;
 
@@ -97,26 +198,60 @@ const char **indigo_main_argv = NULL;
 int indigo_main_argc = 0;
 
 char indigo_last_message[128 * 1024];
+static pthread_mutex_t last_message_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread char log_buffer[LOG_BUFFER_SIZE];
+__thread unsigned long indigo_update_serial = 0;
+static atomic_ulong update_serial_counter = 0;
 char indigo_log_name[255] = {0};
 
-void indigo_log_message(const char *format, va_list args) {
-	static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
-	pthread_mutex_lock(&log_mutex);
-	vsnprintf(indigo_last_message, sizeof(indigo_last_message), format, args);
-	char *line = indigo_last_message;
+/* bounded MPSC queue (D. Vyukov), producers format into a claimed slot and drain thread does the I/O */
+
+typedef struct {
+	atomic_uint sequence;
+	struct timeval timestamp;
+	char *long_message;
+	char message[LOG_SLOT_SIZE];
+} log_slot;
+
+static log_slot log_queue[LOG_QUEUE_SIZE];
+static atomic_uint log_enqueue_pos;
+static unsigned log_dequeue_pos;
+static atomic_uint log_dropped;
+static atomic_uint log_dropped_total;
+static atomic_bool log_drain_running;
+static atomic_bool log_drain_sleeping;
+static pthread_mutex_t log_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t log_consumer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_drain_cond = PTHREAD_COND_INITIALIZER;
+
+static void log_queue_init(void) {
+	for (unsigned i = 0; i < LOG_QUEUE_SIZE; i++) {
+		atomic_init(&log_queue[i].sequence, i);
+		log_queue[i].long_message = NULL;
+	}
+	atomic_init(&log_enqueue_pos, 0);
+	log_dequeue_pos = 0;
+	atomic_init(&log_dropped, 0);
+	atomic_init(&log_drain_running, false);
+	atomic_init(&log_drain_sleeping, false);
+}
+
+static void log_write(struct timeval *tmnow, char *message) {
+	char *line = message;
 	if (indigo_log_message_handler != NULL) {
-		indigo_log_message_handler(indigo_last_message);
+		indigo_log_message_handler(message);
 	} else if (indigo_use_syslog) {
 		static bool initialize = true;
-		if (initialize)
+		if (initialize) {
 			openlog("INDIGO", LOG_NDELAY, LOG_USER | LOG_PERROR);
+			initialize = false;
+		}
 		while (line) {
 			char *eol = strchr(line, '\n');
 			if (eol)
 				*eol = 0;
-			if (eol > line)
-				syslog (LOG_NOTICE, "%s", indigo_last_message);
-			syslog (LOG_NOTICE, "%s", line);
+			if (*line)
+				syslog (LOG_NOTICE, "%s", line);
 			if (eol)
 				line = eol + 1;
 			else
@@ -124,13 +259,11 @@ void indigo_log_message(const char *format, va_list args) {
 		}
 	} else {
 		char timestamp[16];
-		struct timeval tmnow;
-		gettimeofday(&tmnow, NULL);
-		strftime (timestamp, 9, "%H:%M:%S", localtime(&tmnow.tv_sec));
+		strftime (timestamp, 9, "%H:%M:%S", localtime(&tmnow->tv_sec));
 #ifdef INDIGO_MACOS
-		snprintf(timestamp + 8, sizeof(timestamp) - 8, ".%06d", tmnow.tv_usec);
+		snprintf(timestamp + 8, sizeof(timestamp) - 8, ".%06d", tmnow->tv_usec);
 #else
-		snprintf(timestamp + 8, sizeof(timestamp) - 8, ".%06ld", tmnow.tv_usec);
+		snprintf(timestamp + 8, sizeof(timestamp) - 8, ".%06ld", tmnow->tv_usec);
 #endif
 		if (indigo_log_name[0] == '\0') {
 			if (indigo_main_argc == 0) {
@@ -157,7 +290,162 @@ void indigo_log_message(const char *format, va_list args) {
 				line = NULL;
 		}
 	}
-	pthread_mutex_unlock(&log_mutex);
+}
+
+static bool log_drain(void) {
+	/* caller holds log_consumer_mutex, so there is just one consumer at any time */
+	bool drained = false;
+	while (true) {
+		log_slot *slot = &log_queue[log_dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+		if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != log_dequeue_pos + 1)
+			break;
+		if (slot->long_message != NULL) {
+			log_write(&slot->timestamp, slot->long_message);
+			free(slot->long_message);
+			slot->long_message = NULL;
+		} else {
+			log_write(&slot->timestamp, slot->message);
+		}
+		atomic_store_explicit(&slot->sequence, log_dequeue_pos + LOG_QUEUE_SIZE, memory_order_release);
+		log_dequeue_pos++;
+		drained = true;
+	}
+	unsigned dropped = atomic_exchange(&log_dropped, 0);
+	if (dropped > 0) {
+		char message[64];
+		struct timeval tmnow;
+		gettimeofday(&tmnow, NULL);
+		snprintf(message, sizeof(message), "%u log messages dropped", dropped);
+		log_write(&tmnow, message);
+	}
+	if (indigo_log_message_handler == NULL && !indigo_use_syslog && drained)
+		fflush(stderr);
+	return drained;
+}
+
+static void *log_drain_thread(void *data) {
+	while (true) {
+		pthread_mutex_lock(&log_consumer_mutex);
+		bool drained = log_drain();
+		pthread_mutex_unlock(&log_consumer_mutex);
+		if (!drained) {
+			pthread_mutex_lock(&log_drain_mutex);
+			atomic_store(&log_drain_sleeping, true);
+			log_slot *slot = &log_queue[log_dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+			if (atomic_load(&slot->sequence) != log_dequeue_pos + 1) {
+				struct timeval now;
+				gettimeofday(&now, NULL);
+				struct timespec timeout = { now.tv_sec, now.tv_usec * 1000L + LOG_DRAIN_TIMEOUT * 1000000L };
+				if (timeout.tv_nsec >= 1000000000L) {
+					timeout.tv_sec++;
+					timeout.tv_nsec -= 1000000000L;
+				}
+				pthread_cond_timedwait(&log_drain_cond, &log_drain_mutex, &timeout);
+			}
+			atomic_store(&log_drain_sleeping, false);
+			pthread_mutex_unlock(&log_drain_mutex);
+		}
+	}
+	return NULL;
+}
+
+static void log_at_fork_prepare(void) {
+	/* don't fork while drain thread holds stdio or syslog locks */
+	pthread_mutex_lock(&log_consumer_mutex);
+}
+
+static void log_at_fork_parent(void) {
+	pthread_mutex_unlock(&log_consumer_mutex);
+}
+
+static void log_at_fork_child(void) {
+	/* drain thread doesn't survive fork() and slots claimed by other threads would never be published */
+	log_queue_init();
+	pthread_mutex_init(&log_drain_mutex, NULL);
+	pthread_mutex_init(&log_consumer_mutex, NULL);
+	pthread_mutex_init(&last_message_mutex, NULL);
+	pthread_cond_init(&log_drain_cond, NULL);
+}
+
+static void log_start_drain(void) {
+	static bool registered = false;
+	if (!registered) {
+		registered = true;
+		pthread_atfork(log_at_fork_prepare, log_at_fork_parent, log_at_fork_child);
+		atexit(indigo_flush_log);
+	}
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, log_drain_thread, NULL) == 0)
+		pthread_detach(thread);
+	else
+		atomic_store(&log_drain_running, false);
+}
+
+void indigo_flush_log(void) {
+	pthread_mutex_lock(&log_consumer_mutex);
+	log_drain();
+	pthread_mutex_unlock(&log_consumer_mutex);
+}
+
+void indigo_log_message(const char *format, va_list args) {
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, log_queue_init);
+	if (!atomic_load(&log_drain_running) && !atomic_exchange(&log_drain_running, true))
+		log_start_drain();
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int length = vsnprintf(log_buffer, sizeof(log_buffer), format, args_copy);
+	va_end(args_copy);
+	/* if other thread is just updating last message, its message is as recent as this one */
+	if (pthread_mutex_trylock(&last_message_mutex) == 0) {
+		memcpy(indigo_last_message, log_buffer, length < (int)sizeof(log_buffer) ? length + 1 : sizeof(log_buffer));
+		pthread_mutex_unlock(&last_message_mutex);
+	}
+	unsigned pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+	log_slot *slot;
+	int retry = 0;
+	while (true) {
+		slot = &log_queue[pos & (LOG_QUEUE_SIZE - 1)];
+		int diff = (int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&log_enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			/* queue is full, help drain thread or give it a chance before the message is dropped */
+			if (++retry > LOG_FULL_RETRIES) {
+				atomic_fetch_add(&log_dropped, 1);
+				atomic_fetch_add(&log_dropped_total, 1);
+				return;
+			}
+			if (pthread_mutex_trylock(&log_consumer_mutex) == 0) {
+				log_drain();
+				pthread_mutex_unlock(&log_consumer_mutex);
+			} else {
+				sched_yield();
+			}
+			pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+		} else {
+			pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+		}
+	}
+	gettimeofday(&slot->timestamp, NULL);
+	if (length < (int)sizeof(log_buffer)) {
+		memcpy(slot->message, log_buffer, length < LOG_SLOT_SIZE ? length + 1 : LOG_SLOT_SIZE);
+		if (length >= LOG_SLOT_SIZE) {
+			slot->long_message = strdup(log_buffer);
+		}
+	} else if ((slot->long_message = malloc(length + 1)) != NULL) {
+		vsnprintf(slot->long_message, length + 1, format, args);
+	} else {
+		memcpy(slot->message, log_buffer, LOG_SLOT_SIZE);
+	}
+	slot->message[LOG_SLOT_SIZE - 1] = 0;
+	atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+	if (atomic_load(&log_drain_sleeping)) {
+		pthread_mutex_lock(&log_drain_mutex);
+		pthread_cond_signal(&log_drain_cond);
+		pthread_mutex_unlock(&log_drain_mutex);
+	}
 }
 
 void indigo_error(const char *format, ...) {
@@ -194,10 +482,27 @@ void indigo_debug(const char *format, ...) {
 	}
 }
 
-void indigo_set_log_level(indigo_log_levels level) {
+static void update_log_level(void) {
+	indigo_log_levels level = INDIGO_LOG_ERROR;
+	for (int i = 0; i < INDIGO_LOG_SUBSYSTEM_COUNT; i++)
+		if (indigo_log_subsystem_level[i] > level)
+			level = indigo_log_subsystem_level[i];
 	indigo_log_level = level;
 }
 
+void indigo_set_log_level(indigo_log_levels level) {
+	for (int i = 0; i < INDIGO_LOG_SUBSYSTEM_COUNT; i++)
+		indigo_log_subsystem_level[i] = level;
+	update_log_level();
+}
+
+void indigo_set_log_subsystem_level(indigo_log_subsystem subsystem, indigo_log_levels level) {
+	if (subsystem < INDIGO_LOG_SUBSYSTEM_COUNT) {
+		indigo_log_subsystem_level[subsystem] = level;
+		update_log_level();
+	}
+}
+
 indigo_log_levels indigo_get_log_level() {
 	return indigo_log_level;
 }
@@ -254,22 +559,938 @@ void indigo_trace_property(const char *message, indigo_property *property, bool
 	}
 }
 
+unsigned long long indigo_hash(unsigned long long hash, const char *string, int size) {
+	for (const char *end = string + size; string < end && *string; string++)
+		hash = (hash ^ (unsigned char)*string) * 1099511628211ULL;
+	return hash;
+}
+
+unsigned long long indigo_property_hash(const char *device, const char *name) {
+	return indigo_hash(indigo_hash(INDIGO_HASH_INIT, device, INDIGO_NAME_SIZE) * 1099511628211ULL, name, INDIGO_NAME_SIZE);
+}
+
+/* interned strings are reference counted and accessed only with store_mutex locked */
+
+static const char *store_intern(const char *string, int size) {
+	size_t length = strnlen(string, size - 1);
+	if (length == 0)
+		return "";
+	unsigned long long hash = indigo_hash(INDIGO_HASH_INIT, string, (int)length);
+	stored_string **bucket = string_buckets + (hash & (STORE_HASH_SIZE - 1));
+	for (stored_string *interned = *bucket; interned != NULL; interned = interned->next) {
+		if (interned->hash == hash && !strncmp(interned->string, string, length) && interned->string[length] == 0) {
+			interned->references++;
+			return interned->string;
+		}
+	}
+	stored_string *interned = malloc(sizeof(stored_string) + length + 1);
+	if (interned == NULL)
+		return "";
+	memcpy(interned->string, string, length);
+	interned->string[length] = 0;
+	interned->hash = hash;
+	interned->references = 1;
+	interned->next = *bucket;
+	*bucket = interned;
+	return interned->string;
+}
+
+static void store_unintern(const char *string) {
+	if (string == NULL || *string == 0)
+		return;
+	stored_string *interned = (stored_string *)(string - offsetof(stored_string, string));
+	if (--interned->references > 0)
+		return;
+	stored_string **link = string_buckets + (interned->hash & (STORE_HASH_SIZE - 1));
+	while (*link != interned)
+		link = &(*link)->next;
+	*link = interned->next;
+	free(interned);
+}
+
+static void store_set_string(const char **field, const char *string, int size) {
+	if (*field != NULL && !strncmp(*field, string, size - 1))
+		return;
+	const char *interned = store_intern(string, size);
+	store_unintern(*field);
+	*field = interned;
+}
+
+static void store_set_text(stored_item *item, const char *value) {
+	size_t length = strnlen(value, INDIGO_VALUE_SIZE - 1);
+	char *heap = NULL;
+	if (length >= STORE_INLINE_TEXT && (heap = realloc(item->text.heap, length + 1)) != NULL) {
+		memcpy(heap, value, length);
+		heap[length] = 0;
+		item->text.heap = heap;
+		return;
+	}
+	/* short value or failed allocation, the latter is truncated */
+	free(item->text.heap);
+	item->text.heap = NULL;
+	length = length < STORE_INLINE_TEXT ? length : STORE_INLINE_TEXT - 1;
+	memcpy(item->text.value, value, length);
+	item->text.value[length] = 0;
+}
+
+static void store_set_url(stored_item *item, const char *url) {
+	size_t length = strnlen(url, INDIGO_VALUE_SIZE - 1);
+	char *heap = length > 0 ? realloc(item->blob.url, length + 1) : NULL;
+	if (heap == NULL) {
+		free(item->blob.url);
+	} else {
+		memcpy(heap, url, length);
+		heap[length] = 0;
+	}
+	item->blob.url = heap;
+}
+
+static void store_release_item(stored_item *item, indigo_property_type type) {
+	store_unintern(item->name);
+	store_unintern(item->label);
+	switch (type) {
+		case INDIGO_TEXT_VECTOR:
+			free(item->text.heap);
+			break;
+		case INDIGO_NUMBER_VECTOR:
+			store_unintern(item->number.format);
+			break;
+		case INDIGO_BLOB_VECTOR:
+			store_unintern(item->blob.format);
+			free(item->blob.url);
+			break;
+		default:
+			break;
+	}
+	memset(item, 0, sizeof(stored_item));
+}
+
+static void store_release_copy(stored_property *copy) {
+	if (copy == NULL)
+		return;
+	for (int i = 0; i < copy->count; i++)
+		store_release_item(copy->items + i, copy->type);
+	store_unintern(copy->device);
+	store_unintern(copy->name);
+	store_unintern(copy->group);
+	store_unintern(copy->label);
+	free(copy);
+}
+
+/* previous copy is updated in place and reallocated only if item count changes, NULL is returned and previous copy is kept if allocation fails */
+
+static stored_property *store_pack(stored_property *copy, indigo_property *property) {
+	int count = property->count;
+	if (copy != NULL && copy->type != property->type) {
+		for (int i = 0; i < copy->count; i++)
+			store_release_item(copy->items + i, copy->type);
+	}
+	int previous_count = copy != NULL ? copy->count : 0;
+	if (copy == NULL || count != previous_count) {
+		for (int i = count; i < previous_count; i++)
+			store_release_item(copy->items + i, copy->type);
+		if (copy != NULL && count < previous_count)
+			copy->count = count;
+		stored_property *resized = realloc(copy, sizeof(stored_property) + count * sizeof(stored_item));
+		if (resized == NULL)
+			return NULL;
+		if (copy == NULL)
+			memset(resized, 0, sizeof(stored_property));
+		if (count > previous_count)
+			memset(resized->items + previous_count, 0, (count - previous_count) * sizeof(stored_item));
+		copy = resized;
+	}
+	store_set_string(&copy->device, property->device, INDIGO_NAME_SIZE);
+	store_set_string(&copy->name, property->name, INDIGO_NAME_SIZE);
+	store_set_string(&copy->group, property->group, INDIGO_NAME_SIZE);
+	store_set_string(&copy->label, property->label, INDIGO_VALUE_SIZE);
+	copy->state = property->state;
+	copy->type = property->type;
+	copy->perm = property->perm;
+	copy->rule = property->rule;
+	copy->version = property->version;
+	copy->hidden = property->hidden;
+	copy->priority = property->priority;
+	copy->count = count;
+	for (int i = 0; i < count; i++) {
+		stored_item *item = copy->items + i;
+		indigo_item *source = property->items + i;
+		store_set_string(&item->name, source->name, INDIGO_NAME_SIZE);
+		store_set_string(&item->label, source->label, INDIGO_VALUE_SIZE);
+		switch (property->type) {
+			case INDIGO_TEXT_VECTOR:
+				store_set_text(item, source->text.value);
+				break;
+			case INDIGO_NUMBER_VECTOR:
+				store_set_string(&item->number.format, source->number.format, INDIGO_VALUE_SIZE);
+				item->number.min = source->number.min;
+				item->number.max = source->number.max;
+				item->number.step = source->number.step;
+				item->number.value = source->number.value;
+				item->number.target = source->number.target;
+				break;
+			case INDIGO_SWITCH_VECTOR:
+				item->sw = source->sw.value;
+				break;
+			case INDIGO_LIGHT_VECTOR:
+				item->light = source->light.value;
+				break;
+			case INDIGO_BLOB_VECTOR:
+				store_set_string(&item->blob.format, source->blob.format, INDIGO_NAME_SIZE);
+				store_set_url(item, source->blob.url);
+				item->blob.size = source->blob.size;
+				break;
+		}
+	}
+	return copy;
+}
+
+/* full property rebuilt from compact copy, BLOB values are not kept */
+
+static indigo_property *store_unpack(stored_property *copy) {
+	indigo_property *property = calloc(1, sizeof(indigo_property) + copy->count * sizeof(indigo_item));
+	if (property == NULL)
+		return NULL;
+	strcpy(property->device, copy->device);
+	strcpy(property->name, copy->name);
+	strcpy(property->group, copy->group);
+	strcpy(property->label, copy->label);
+	property->state = copy->state;
+	property->type = copy->type;
+	property->perm = copy->perm;
+	property->rule = copy->rule;
+	property->version = copy->version;
+	property->hidden = copy->hidden;
+	property->priority = copy->priority;
+	property->count = copy->count;
+	for (int i = 0; i < copy->count; i++) {
+		stored_item *source = copy->items + i;
+		indigo_item *item = property->items + i;
+		strcpy(item->name, source->name);
+		strcpy(item->label, source->label);
+		switch (copy->type) {
+			case INDIGO_TEXT_VECTOR:
+				strcpy(item->text.value, source->text.heap != NULL ? source->text.heap : source->text.value);
+				break;
+			case INDIGO_NUMBER_VECTOR:
+				strcpy(item->number.format, source->number.format);
+				item->number.min = source->number.min;
+				item->number.max = source->number.max;
+				item->number.step = source->number.step;
+				item->number.value = source->number.value;
+				item->number.target = source->number.target;
+				break;
+			case INDIGO_SWITCH_VECTOR:
+				item->sw.value = source->sw;
+				break;
+			case INDIGO_LIGHT_VECTOR:
+				item->light.value = source->light;
+				break;
+			case INDIGO_BLOB_VECTOR:
+				strcpy(item->blob.format, source->blob.format);
+				if (source->blob.url != NULL)
+					strcpy(item->blob.url, source->blob.url);
+				item->blob.size = source->blob.size;
+				break;
+		}
+	}
+	return property;
+}
+
+static bool store_match(stored_property *copy, indigo_property *filter) {
+	return (filter->type == 0 || copy->type == filter->type) && (*filter->name == 0 || !strcmp(copy->name, filter->name)) && (*filter->device == 0 || !strcmp(copy->device, filter->device));
+}
+
+static store_entry *store_find(unsigned long long hash, const char *device, const char *name) {
+	for (store_entry *entry = store_buckets[hash & (STORE_HASH_SIZE - 1)]; entry != NULL; entry = entry->hash_next) {
+		if (entry->hash == hash && !strcmp(entry->property->name, name) && !strcmp(entry->property->device, device))
+			return entry;
+	}
+	return NULL;
+}
+
+static store_entry *store_find_pointer(unsigned long long hash, indigo_property *property) {
+	/* property itself is not dereferenced, it may be already released */
+	for (store_entry *entry = store_buckets[hash & (STORE_HASH_SIZE - 1)]; entry != NULL; entry = entry->hash_next) {
+		if (entry->source == property)
+			return entry;
+	}
+	for (store_entry *entry = store_head; entry != NULL; entry = entry->next) {
+		/* renamed after definition */
+		if (entry->source == property)
+			return entry;
+	}
+	return NULL;
+}
+
+static void store_unlink(store_entry *entry) {
+	store_entry **link = store_buckets + (entry->hash & (STORE_HASH_SIZE - 1));
+	while (*link != entry)
+		link = &(*link)->hash_next;
+	*link = entry->hash_next;
+	if (entry->prev != NULL)
+		entry->prev->next = entry->next;
+	else
+		store_head = entry->next;
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+	else
+		store_tail = entry->prev;
+	store_count--;
+	store_release_copy(entry->property);
+	free(entry);
+}
+
+static void store_define(indigo_device *device, indigo_property *property) {
+	unsigned long long hash = indigo_property_hash(property->device, property->name);
+	pthread_mutex_lock(&store_mutex);
+	store_entry *entry = store_find(hash, property->device, property->name);
+	if (entry != NULL) {
+		stored_property *copy = store_pack(entry->property, property);
+		if (copy == NULL) {
+			store_unlink(entry);
+		} else {
+			entry->device = device;
+			entry->source = property;
+			entry->property = copy;
+		}
+		pthread_mutex_unlock(&store_mutex);
+		return;
+	}
+	entry = malloc(sizeof(store_entry));
+	stored_property *copy = entry != NULL ? store_pack(NULL, property) : NULL;
+	if (copy == NULL) {
+		free(entry);
+		pthread_mutex_unlock(&store_mutex);
+		return;
+	}
+	entry->device = device;
+	entry->source = property;
+	entry->property = copy;
+	entry->hash = hash;
+	entry->hash_next = store_buckets[hash & (STORE_HASH_SIZE - 1)];
+	store_buckets[hash & (STORE_HASH_SIZE - 1)] = entry;
+	entry->prev = store_tail;
+	entry->next = NULL;
+	if (store_tail != NULL)
+		store_tail->next = entry;
+	else
+		store_head = entry;
+	store_tail = entry;
+	store_count++;
+	pthread_mutex_unlock(&store_mutex);
+}
+
+static void store_update(indigo_property *property) {
+	/* only the bucket is searched, updates of undefined properties are common and must be cheap */
+	unsigned long long hash = indigo_property_hash(property->device, property->name);
+	pthread_mutex_lock(&store_mutex);
+	for (store_entry *entry = store_buckets[hash & (STORE_HASH_SIZE - 1)]; entry != NULL; entry = entry->hash_next) {
+		if (entry->source == property) {
+			stored_property *copy = store_pack(entry->property, property);
+			if (copy == NULL)
+				store_unlink(entry);
+			else
+				entry->property = copy;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&store_mutex);
+}
+
+static void store_remove(indigo_device *device, indigo_property *property, bool by_name) {
+	pthread_mutex_lock(&store_mutex);
+	if (by_name && *property->name) {
+		store_entry *entry = store_find(indigo_property_hash(property->device, property->name), property->device, property->name);
+		if (entry != NULL)
+			store_unlink(entry);
+	} else if (by_name) {
+		for (store_entry *entry = store_head, *next; entry != NULL; entry = next) {
+			next = entry->next;
+			if (!strcmp(entry->property->device, property->device))
+				store_unlink(entry);
+		}
+	} else if (property != NULL) {
+		store_entry *entry = store_find_pointer(indigo_property_hash(property->device, property->name), property);
+		if (entry != NULL)
+			store_unlink(entry);
+	} else {
+		for (store_entry *entry = store_head, *next; entry != NULL; entry = next) {
+			next = entry->next;
+			if (entry->device == device)
+				store_unlink(entry);
+		}
+	}
+	pthread_mutex_unlock(&store_mutex);
+}
+
+/* copies of matching stored properties, so they can be used without store_mutex,
+   properties of remote servers are skipped, their protocol adapters answer the request themselves */
+
+static store_snapshot_entry *store_snapshot(indigo_property *filter, int *count) {
+	pthread_mutex_lock(&store_mutex);
+	store_snapshot_entry *snapshot = malloc((store_count ? store_count : 1) * sizeof(store_snapshot_entry));
+	*count = 0;
+	for (store_entry *entry = store_head; snapshot != NULL && entry != NULL; entry = entry->next) {
+		if (entry->property->hidden || *entry->device->name == '@' || (filter != NULL && !store_match(entry->property, filter)))
+			continue;
+		indigo_property *copy = store_unpack(entry->property);
+		if (copy == NULL)
+			continue;
+		snapshot[*count].device = entry->device;
+		snapshot[(*count)++].property = copy;
+	}
+	pthread_mutex_unlock(&store_mutex);
+	return snapshot;
+}
+
+static void store_release_snapshot(store_snapshot_entry *snapshot, int count) {
+	for (int i = 0; i < count; i++)
+		free(snapshot[i].property);
+	free(snapshot);
+}
+
+static void store_replace(indigo_property *old_property, indigo_property *new_property) {
+	/* called with store_mutex locked, old property is already reallocated, copy is refreshed by next definition or update */
+	store_entry *entry = store_find_pointer(indigo_property_hash(new_property->device, new_property->name), old_property);
+	if (entry != NULL)
+		entry->source = new_property;
+}
+
+/* update rate limiting, the live property is kept for delayed delivery so the client always gets the latest value */
+
+typedef struct throttle_entry {
+	struct throttle_entry *next;
+	indigo_device *device;
+	indigo_property *property;
+	indigo_property_state state;
+	double last_sent;
+	bool pending;
+	bool has_message;
+	char message[INDIGO_VALUE_SIZE];
+} throttle_entry;
+
+typedef struct {
+	throttle_entry **buckets;						/* indexed by property pointer, allocated with first entry */
+	int count;
+} throttle_list;
+
+/* flush thread delivers copies, so device can be detached and property released while update is delivered */
+
+typedef struct {
+	int index;
+	indigo_client *client;
+	indigo_device device;
+	indigo_property *property;
+	bool has_message;
+	char message[INDIGO_VALUE_SIZE];
+} throttle_due;
+
+static throttle_list throttled[MAX_CLIENTS];
+static pthread_mutex_t throttle_mutex;
+static pthread_cond_t throttle_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t throttle_idle_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t throttle_once = PTHREAD_ONCE_INIT;
+static pthread_t throttle_thread;
+static bool throttle_thread_started = false;
+static bool throttle_flushing = false;
+static indigo_metric *coalesced_metric = NULL;
+
+double indigo_remote_update_interval = 0;
+
+static void throttle_init(void) {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&throttle_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static void deliver_update(int index, indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	double start = indigo_metric_time();
+	client->last_result = client->update_property(client, device, property, message);
+	indigo_metric_observe(client_metrics[index], indigo_metric_time() - start);
+}
+
+static inline throttle_entry **throttle_bucket(throttle_list *list, indigo_property *property) {
+	uintptr_t key = (uintptr_t)property;
+	return list->buckets + ((key >> 4) ^ (key >> 12)) % THROTTLE_HASH_SIZE;
+}
+
+static void *throttle_flush(void *arg) {
+	throttle_due *due = NULL;
+	int due_size = 0;
+	pthread_mutex_lock(&throttle_mutex);
+	while (true) {
+		double now = indigo_metric_time(), next = 0;
+		int due_count = 0;
+		for (int i = 0; i < MAX_CLIENTS; i++) {
+			indigo_client *client = clients[i];
+			throttle_list *list = throttled + i;
+			if (client == NULL || client->update_property == NULL || list->count == 0)
+				continue;
+			for (int j = 0; j < THROTTLE_HASH_SIZE; j++) {
+				for (throttle_entry *entry = list->buckets[j]; entry != NULL; entry = entry->next) {
+					if (!entry->pending)
+						continue;
+					double time = entry->last_sent + client->update_interval;
+					if (time <= now && due_count == due_size) {
+						int size = due_size ? 2 * due_size : 64;
+						throttle_due *tmp = realloc(due, size * sizeof(throttle_due));
+						if (tmp != NULL) {
+							due = tmp;
+							due_size = size;
+						}
+					}
+					indigo_property *copy = NULL;
+					if (time <= now && due_count < due_size && (copy = indigo_copy_property(NULL, entry->property)) != NULL) {
+						entry->pending = false;
+						entry->last_sent = now;
+						entry->state = entry->property->state;
+						throttle_due *item = due + due_count++;
+						item->index = i;
+						item->client = client;
+						item->device = *entry->device;
+						item->property = copy;
+						if ((item->has_message = entry->has_message))
+							strcpy(item->message, entry->message);
+					} else if (next == 0 || time < next) {
+						next = time;
+					}
+				}
+			}
+		}
+		if (due_count > 0) {
+			/* deliver without lock, throttle_remove() of client waits until it is finished, so clients are still valid */
+			throttle_flushing = true;
+			pthread_mutex_unlock(&throttle_mutex);
+			for (int i = 0; i < due_count; i++) {
+				deliver_update(due[i].index, due[i].client, &due[i].device, due[i].property, due[i].has_message ? due[i].message : NULL);
+				free(due[i].property);
+			}
+			pthread_mutex_lock(&throttle_mutex);
+			throttle_flushing = false;
+			pthread_cond_broadcast(&throttle_idle_cond);
+			continue;
+		}
+		if (next == 0) {
+			pthread_cond_wait(&throttle_cond, &throttle_mutex);
+		} else {
+			struct timeval tv;
+			struct timespec ts;
+			gettimeofday(&tv, NULL);
+			double wait = next - indigo_metric_time();
+			if (wait < 0)
+				wait = 0;
+			ts.tv_sec = tv.tv_sec + (time_t)wait;
+			ts.tv_nsec = tv.tv_usec * 1000 + (long)((wait - (time_t)wait) * 1e9);
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&throttle_cond, &throttle_mutex, &ts);
+		}
+	}
+	return NULL;
+}
+
+/* returns true if update should be delivered now, otherwise it is postponed to flush thread */
+
+static bool throttle_update(int index, indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (client->update_interval <= 0 || property->type == INDIGO_BLOB_VECTOR || property->priority)
+		return true;
+	bool deliver = true;
+	pthread_mutex_lock(&throttle_mutex);
+	throttle_list *list = throttled + index;
+	if (list->buckets == NULL && (list->buckets = calloc(THROTTLE_HASH_SIZE, sizeof(throttle_entry *))) == NULL) {
+		pthread_mutex_unlock(&throttle_mutex);
+		return true;
+	}
+	throttle_entry **bucket = throttle_bucket(list, property);
+	throttle_entry *entry = *bucket;
+	while (entry != NULL && (entry->property != property || entry->device != device))
+		entry = entry->next;
+	double now = indigo_metric_time();
+	if (entry == NULL) {
+		if ((entry = malloc(sizeof(throttle_entry))) == NULL) {
+			pthread_mutex_unlock(&throttle_mutex);
+			return true;
+		}
+		entry->device = device;
+		entry->property = property;
+		entry->next = *bucket;
+		*bucket = entry;
+		list->count++;
+	} else if (entry->state == property->state && now - entry->last_sent < client->update_interval) {
+		deliver = false;
+	}
+	if (deliver) {
+		entry->state = property->state;
+		entry->last_sent = now;
+		entry->pending = false;
+		entry->has_message = false;
+	} else {
+		if (message != NULL) {
+			strncpy(entry->message, message, INDIGO_VALUE_SIZE - 1);
+			entry->message[INDIGO_VALUE_SIZE - 1] = 0;
+			entry->has_message = true;
+		}
+		if (!entry->pending) {
+			entry->pending = true;
+			if (!throttle_thread_started) {
+				pthread_t thread;
+				if (pthread_create(&thread, NULL, throttle_flush, NULL) == 0) {
+					pthread_detach(thread);
+					throttle_thread = thread;
+					throttle_thread_started = true;
+				}
+			}
+			pthread_cond_signal(&throttle_cond);
+		}
+		indigo_metric_add(coalesced_metric, 1);
+	}
+	pthread_mutex_unlock(&throttle_mutex);
+	return deliver;
+}
+
+/* forget tracked updates of client (if not NULL), of property (if not NULL) or of all properties of device,
+   only removal of client waits for flush thread, so it can be called with device_mutex locked for device or property */
+
+static void throttle_remove(indigo_client *client, indigo_device *device, indigo_property *property) {
+	pthread_once(&throttle_once, throttle_init);
+	pthread_mutex_lock(&throttle_mutex);
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		throttle_list *list = throttled + i;
+		if (list->count == 0 || (client != NULL && clients[i] != client && clients[i] != NULL))
+			continue;
+		for (int j = property != NULL && client == NULL ? (int)(throttle_bucket(list, property) - list->buckets) : 0; j < THROTTLE_HASH_SIZE; j++) {
+			for (throttle_entry **link = list->buckets + j; *link != NULL;) {
+				throttle_entry *entry = *link;
+				if (client != NULL || ((device == NULL || entry->device == device) && (property == NULL || entry->property == property))) {
+					*link = entry->next;
+					list->count--;
+					free(entry);
+				} else {
+					link = &entry->next;
+				}
+			}
+			if (property != NULL && client == NULL)
+				break;
+		}
+	}
+	/* updates collected by flush thread may be delivered to removed client */
+	while (client != NULL && throttle_flushing && !pthread_equal(throttle_thread, pthread_self()))
+		pthread_cond_wait(&throttle_idle_cond, &throttle_mutex);
+	pthread_mutex_unlock(&throttle_mutex);
+}
+
+typedef struct executor_request {
+	struct executor_request *next;
+	indigo_client *client;
+	indigo_property *property;
+} executor_request;
+
+#define REGULAR_LANE	0
+#define PRIORITY_LANE	1
+
+struct device_executor;
+
+typedef struct {
+	struct device_executor *executor;
+	pthread_t thread;
+	pthread_cond_t cond;
+	executor_request *head;
+	executor_request *tail;
+	indigo_client *running_client;
+} executor_lane;
+
+/* priority requests (abort and guide) have own lane, so they don't wait for regular request in progress */
+typedef struct device_executor {
+	indigo_device *device;
+	indigo_metric *metric;
+	indigo_metric *queue_metric;
+	executor_lane lanes[2];
+	char priority[MAX_PRIORITY_PROPERTIES][INDIGO_NAME_SIZE];
+	int priority_count;
+	indigo_client *rejected_client;
+	int queued;
+	bool stopping;
+	executor_lane *detached_lane;
+} device_executor;
+
+static device_executor *executors[MAX_DEVICES];
+static pthread_mutex_t executor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t executor_idle_cond = PTHREAD_COND_INITIALIZER;
+
+bool indigo_use_device_executors = false;
+
+static indigo_property *executor_copy_property(indigo_property *property) {
+	size_t size = sizeof(indigo_property) + property->count * sizeof(indigo_item);
+	indigo_property *copy = malloc(size);
+	if (copy == NULL)
+		return NULL;
+	memcpy(copy, property, size);
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		/* BLOB data are owned by protocol parser and released as soon as change request returns */
+		for (int i = 0; i < property->count; i++) {
+			indigo_item *item = copy->items + i;
+			if (item->blob.value != NULL && item->blob.size > 0) {
+				void *value = malloc(item->blob.size);
+				if (value != NULL)
+					memcpy(value, property->items[i].blob.value, item->blob.size);
+				else
+					item->blob.size = 0;
+				item->blob.value = value;
+			}
+		}
+	}
+	return copy;
+}
+
+static void executor_free_request(executor_request *request) {
+	indigo_property *property = request->property;
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		for (int i = 0; i < property->count; i++) {
+			if (property->items[i].blob.size > 0)
+				free(property->items[i].blob.value);
+		}
+	}
+	free(property);
+	free(request);
+}
+
+static executor_lane *executor_own_lane(device_executor *executor) {
+	for (int i = REGULAR_LANE; i <= PRIORITY_LANE; i++) {
+		if (pthread_equal(executor->lanes[i].thread, pthread_self()))
+			return executor->lanes + i;
+	}
+	return NULL;
+}
+
+static void executor_destroy(device_executor *executor) {
+	for (int i = REGULAR_LANE; i <= PRIORITY_LANE; i++)
+		pthread_cond_destroy(&executor->lanes[i].cond);
+	free(executor);
+}
+
+static void *executor_worker(executor_lane *lane) {
+	device_executor *executor = lane->executor;
+	pthread_mutex_lock(&executor_mutex);
+	while (true) {
+		while (lane->head == NULL && !executor->stopping)
+			pthread_cond_wait(&lane->cond, &executor_mutex);
+		if (executor->stopping)
+			break;
+		executor_request *request = lane->head;
+		lane->head = request->next;
+		if (lane->head == NULL)
+			lane->tail = NULL;
+		lane->running_client = request->client;
+		pthread_mutex_unlock(&executor_mutex);
+		indigo_device *device = executor->device;
+		double start = indigo_metric_time();
+		device->last_result = device->change_property(device, request->client, request->property);
+		double duration = indigo_metric_time() - start;
+		pthread_mutex_lock(&executor_mutex);
+		lane->running_client = NULL;
+		executor->queued--;
+		if (executor->detached_lane == NULL) {
+			indigo_metric_observe(executor->metric, duration);
+			indigo_metric_set(executor->queue_metric, executor->queued);
+		}
+		pthread_cond_broadcast(&executor_idle_cond);
+		executor_free_request(request);
+	}
+	bool detached = executor->detached_lane == lane;
+	pthread_mutex_unlock(&executor_mutex);
+	if (detached) {
+		/* device was detached from its own change_property callback, nobody is waiting for this thread */
+		executor_destroy(executor);
+	}
+	return NULL;
+}
+
+static device_executor *executor_start(indigo_device *device, indigo_metric *metric) {
+	device_executor *executor = calloc(1, sizeof(device_executor));
+	if (executor == NULL)
+		return NULL;
+	executor->device = device;
+	executor->metric = metric;
+	for (int i = REGULAR_LANE; i <= PRIORITY_LANE; i++) {
+		executor->lanes[i].executor = executor;
+		pthread_cond_init(&executor->lanes[i].cond, NULL);
+	}
+	if (pthread_create(&executor->lanes[REGULAR_LANE].thread, NULL, (void * (*)(void*))executor_worker, executor->lanes + REGULAR_LANE)) {
+		executor_destroy(executor);
+		return NULL;
+	}
+	if (pthread_create(&executor->lanes[PRIORITY_LANE].thread, NULL, (void * (*)(void*))executor_worker, executor->lanes + PRIORITY_LANE)) {
+		pthread_mutex_lock(&executor_mutex);
+		executor->stopping = true;
+		pthread_cond_signal(&executor->lanes[REGULAR_LANE].cond);
+		pthread_mutex_unlock(&executor_mutex);
+		pthread_join(executor->lanes[REGULAR_LANE].thread, NULL);
+		executor_destroy(executor);
+		return NULL;
+	}
+	executor->queue_metric = indigo_register_metric(INDIGO_METRIC_GAUGE, "indigo_device_queue_length", "Change requests waiting in device executor queue", "device", device->name);
+	return executor;
+}
+
+static void executor_stop(int index) {
+	/* pending requests are rejected with alert state, requests in progress are finished before device is detached */
+	pthread_mutex_lock(&executor_mutex);
+	device_executor *executor = executors[index];
+	if (executor == NULL) {
+		pthread_mutex_unlock(&executor_mutex);
+		return;
+	}
+	executor->stopping = true;
+	for (int i = REGULAR_LANE; i <= PRIORITY_LANE; i++) {
+		executor_lane *lane = executor->lanes + i;
+		pthread_cond_signal(&lane->cond);
+		while (lane->head != NULL) {
+			executor_request *request = lane->head;
+			lane->head = request->next;
+			executor->queued--;
+			/* executor stays registered, so executor_forget_client() waits until requesting client is answered */
+			executor->rejected_client = request->client;
+			pthread_mutex_unlock(&executor_mutex);
+			indigo_client *client = request->client;
+			if (client != NULL && client->update_property != NULL) {
+				request->property->state = INDIGO_ALERT_STATE;
+				client->last_result = client->update_property(client, executor->device, request->property, "Device detached, change request not processed");
+			}
+			executor_free_request(request);
+			pthread_mutex_lock(&executor_mutex);
+			executor->rejected_client = NULL;
+			pthread_cond_broadcast(&executor_idle_cond);
+		}
+		lane->tail = NULL;
+	}
+	executors[index] = NULL;
+	executor_lane *own_lane = executor_own_lane(executor);
+	executor->detached_lane = own_lane;
+	pthread_mutex_unlock(&executor_mutex);
+	for (int i = REGULAR_LANE; i <= PRIORITY_LANE; i++) {
+		executor_lane *lane = executor->lanes + i;
+		if (lane == own_lane)
+			pthread_detach(lane->thread);
+		else
+			pthread_join(lane->thread, NULL);
+	}
+	indigo_release_metric(executor->queue_metric);
+	if (own_lane == NULL)
+		executor_destroy(executor);
+}
+
+static bool executor_enqueue(int index, indigo_client *client, indigo_property *property) {
+	pthread_mutex_lock(&executor_mutex);
+	device_executor *executor = executors[index];
+	if (executor == NULL || executor_own_lane(executor) != NULL) {
+		/* no executor or nested request from device itself, execute synchronously */
+		pthread_mutex_unlock(&executor_mutex);
+		return false;
+	}
+	bool priority = false;
+	for (int i = 0; i < executor->priority_count && !priority; i++)
+		priority = !strcmp(executor->priority[i], property->name);
+	executor_request *request = malloc(sizeof(executor_request));
+	if (request != NULL && (request->property = executor_copy_property(property)) != NULL) {
+		/* abort and guide requests are executed in order on priority lane, concurrently with regular request in progress */
+		executor_lane *lane = executor->lanes + (priority ? PRIORITY_LANE : REGULAR_LANE);
+		request->client = client;
+		request->next = NULL;
+		if (lane->tail != NULL)
+			lane->tail->next = request;
+		else
+			lane->head = request;
+		lane->tail = request;
+		executor->queued++;
+		indigo_metric_set(executor->queue_metric, executor->queued);
+		pthread_cond_signal(&lane->cond);
+	} else {
+		free(request);
+		indigo_error("INDIGO Bus: can't queue '%s'.'%s' change request", property->device, property->name);
+	}
+	pthread_mutex_unlock(&executor_mutex);
+	return true;
+}
+
+static void executor_add_priority(indigo_device *device, indigo_property *property) {
+	pthread_mutex_lock(&executor_mutex);
+	for (int i = 0; i < MAX_DEVICES; i++) {
+		device_executor *executor = executors[i];
+		if (executor == NULL || executor->device != device)
+			continue;
+		bool known = false;
+		for (int j = 0; j < executor->priority_count && !known; j++)
+			known = !strcmp(executor->priority[j], property->name);
+		if (!known && executor->priority_count < MAX_PRIORITY_PROPERTIES)
+			strcpy(executor->priority[executor->priority_count++], property->name);
+		break;
+	}
+	pthread_mutex_unlock(&executor_mutex);
+}
+
+static void executor_forget_client(indigo_client *client) {
+	/* client is about to be released, queued requests are executed without it and running ones are waited for */
+	pthread_mutex_lock(&executor_mutex);
+	for (int i = 0; i < MAX_DEVICES; i++) {
+		device_executor *executor = executors[i];
+		if (executor == NULL)
+			continue;
+		for (int j = REGULAR_LANE; j <= PRIORITY_LANE; j++) {
+			for (executor_request *request = executor->lanes[j].head; request != NULL; request = request->next) {
+				if (request->client == client)
+					request->client = NULL;
+			}
+		}
+		if (executor_own_lane(executor) != NULL)
+			continue;
+		while (executors[i] == executor && (executor->lanes[REGULAR_LANE].running_client == client || executor->lanes[PRIORITY_LANE].running_client == client || executor->rejected_client == client))
+			pthread_cond_wait(&executor_idle_cond, &executor_mutex);
+	}
+	pthread_mutex_unlock(&executor_mutex);
+}
+
+static double stored_properties_metric(void *data) {
+	return store_count;
+}
+
+static double log_queue_depth_metric(void *data) {
+	return (unsigned)(atomic_load(&log_enqueue_pos) - log_dequeue_pos);
+}
+
+static double log_dropped_metric(void *data) {
+	return atomic_load(&log_dropped_total);
+}
+
 indigo_result indigo_start() {
 	for (int i = 1; i < indigo_main_argc; i++) {
 		if (!strcmp(indigo_main_argv[i], "-v") || !strcmp(indigo_main_argv[i], "--enable-info")) {
-			indigo_log_level = INDIGO_LOG_INFO;
+			indigo_set_log_level(INDIGO_LOG_INFO);
 		} else if (!strcmp(indigo_main_argv[i], "-vv") || !strcmp(indigo_main_argv[i], "--enable-debug")) {
-			indigo_log_level = INDIGO_LOG_DEBUG;
+			indigo_set_log_level(INDIGO_LOG_DEBUG);
 		} else if (!strcmp(indigo_main_argv[i], "-vvv") || !strcmp(indigo_main_argv[i], "--enable-trace")) {
-			indigo_log_level = INDIGO_LOG_TRACE;
+			indigo_set_log_level(INDIGO_LOG_TRACE);
 		}
 	}
+	pthread_once(&throttle_once, throttle_init);
 	pthread_mutex_lock(&client_mutex);
 	if (!is_started) {
 		memset(devices, 0, MAX_DEVICES * sizeof(indigo_device *));
 		memset(clients, 0, MAX_CLIENTS * sizeof(indigo_client *));
 		memset(blobs, 0, MAX_BLOBS * sizeof(indigo_property *));
 		memset(&INDIGO_ALL_PROPERTIES, 0, sizeof(INDIGO_ALL_PROPERTIES));
+		static bool metrics_registered = false;
+		if (!metrics_registered) {
+			indigo_register_metric_provider(INDIGO_METRIC_GAUGE, "indigo_bus_stored_properties", "Properties in bus property store", NULL, NULL, stored_properties_metric, NULL);
+			indigo_register_metric_provider(INDIGO_METRIC_GAUGE, "indigo_log_queue_depth", "Messages waiting in log queue", NULL, NULL, log_queue_depth_metric, NULL);
+			indigo_register_metric_provider(INDIGO_METRIC_COUNTER, "indigo_log_dropped_total", "Log messages dropped on full queue", NULL, NULL, log_dropped_metric, NULL);
+			coalesced_metric = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_bus_coalesced_updates_total", "Property updates postponed by client update rate limit", NULL, NULL);
+			metrics_registered = true;
+		}
 		is_started = true;
 	}
 	pthread_mutex_unlock(&client_mutex);
@@ -283,6 +1504,13 @@ indigo_result indigo_attach_device(indigo_device *device) {
 	pthread_mutex_lock(&device_mutex);
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		if (devices[i] == NULL) {
+			device_metrics[i] = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_driver_change_property_seconds", "Time spent in device change_property() callback", "device", device->name);
+			if (indigo_use_device_executors) {
+				device_executor *executor = executor_start(device, device_metrics[i]);
+				pthread_mutex_lock(&executor_mutex);
+				executors[i] = executor;
+				pthread_mutex_unlock(&executor_mutex);
+			}
 			devices[i] = device;
 			pthread_mutex_unlock(&device_mutex);
 			if (device->attach != NULL)
@@ -301,6 +1529,14 @@ indigo_result indigo_attach_client(indigo_client *client) {
 	pthread_mutex_lock(&client_mutex);
 	for (int i = 0; i < MAX_CLIENTS; i++) {
 		if (clients[i] == NULL) {
+			char label[INDIGO_NAME_SIZE];
+			if (*client->name)
+				strncpy(label, client->name, INDIGO_NAME_SIZE);
+			else
+				snprintf(label, INDIGO_NAME_SIZE, "#%d", i);
+			client_metrics[i] = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_bus_client_seconds", "Time spent in client callbacks of bus broadcast", "client", label);
+			if (client->is_remote && client->update_interval == 0)
+				client->update_interval = indigo_remote_update_interval;
 			clients[i] = client;
 			pthread_mutex_unlock(&client_mutex);
 			if (client->attach != NULL)
@@ -316,12 +1552,29 @@ indigo_result indigo_detach_device(indigo_device *device) {
 	if ((!is_started) || (device == NULL))
 		return INDIGO_FAILED;
 
+	int index = -1;
+	pthread_mutex_lock(&device_mutex);
+	for (int i = 0; i < MAX_DEVICES; i++) {
+		if (devices[i] == device) {
+			index = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&device_mutex);
+	/* executor is stopped without device_mutex, running change_property may attach or detach other devices */
+	if (index >= 0)
+		executor_stop(index);
 	pthread_mutex_lock(&device_mutex);
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		if (devices[i] == device) {
+			/* detach releases properties, so they must not be referenced by store or pending updates anymore */
+			store_remove(device, NULL, false);
+			throttle_remove(NULL, device, NULL);
 			if (device->detach != NULL)
 				device->last_result = device->detach(device);
 			devices[i] = NULL;
+			indigo_release_metric(device_metrics[i]);
+			device_metrics[i] = NULL;
 			pthread_mutex_unlock(&device_mutex);
 			return INDIGO_OK;
 		}
@@ -338,7 +1591,11 @@ indigo_result indigo_detach_client(indigo_client *client) {
 	for (int i = 0; i < MAX_CLIENTS; i++) {
 		if (clients[i] == client) {
 			clients[i] = NULL;
+			indigo_release_metric(client_metrics[i]);
+			client_metrics[i] = NULL;
 			pthread_mutex_unlock(&client_mutex);
+			throttle_remove(client, NULL, NULL);
+			executor_forget_client(client);
 			if (client->detach != NULL)
 				client->last_result = client->detach(client);
 			return INDIGO_OK;
@@ -351,9 +1608,28 @@ indigo_result indigo_detach_client(indigo_client *client) {
 indigo_result indigo_enumerate_properties(indigo_client *client, indigo_property *property) {
 	if (!is_started)
 		return INDIGO_FAILED;
-	INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property enumeration request", property, false, true));
+	INDIGO_TRACE(INDIGO_CHECKED_TRACE_PROPERTY("INDIGO Bus: property enumeration request", property, false, true));
+	bool answered = false;
+	if (indigo_use_property_store && client != NULL) {
+		/* local properties are answered from the store to the requesting client only */
+		if (client->define_property == NULL) {
+			answered = true;
+		} else {
+			int count;
+			store_snapshot_entry *snapshot = store_snapshot(property, &count);
+			if (snapshot != NULL) {
+				for (int i = 0; i < count; i++)
+					client->last_result = client->define_property(client, snapshot[i].device, snapshot[i].property, NULL);
+				store_release_snapshot(snapshot, count);
+				answered = true;
+			}
+		}
+	}
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		indigo_device *device = devices[i];
+		/* protocol adapters of remote servers and chained devices forward the request */
+		if (answered && (device == NULL || *device->name != '@'))
+			continue;
 		if (device != NULL && device->enumerate_properties != NULL) {
 			bool route = *property->device == 0;
 			route = route || !strcmp(property->device, device->name);
@@ -366,10 +1642,30 @@ indigo_result indigo_enumerate_properties(indigo_client *client, indigo_property
 	return INDIGO_OK;
 }
 
+void indigo_enumerate_defined_properties(void (*callback)(indigo_device *device, indigo_property *property, void *data), void *data) {
+	/* devices are copied as well, device can be detached before callback is called */
+	pthread_mutex_lock(&store_mutex);
+	int count = 0;
+	indigo_device *devices_copy = malloc((store_count ? store_count : 1) * sizeof(indigo_device));
+	indigo_property **properties_copy = malloc((store_count ? store_count : 1) * sizeof(indigo_property *));
+	for (store_entry *entry = store_head; devices_copy != NULL && properties_copy != NULL && entry != NULL; entry = entry->next) {
+		if ((properties_copy[count] = store_unpack(entry->property)) != NULL)
+			devices_copy[count++] = *entry->device;
+	}
+	pthread_mutex_unlock(&store_mutex);
+	for (int i = 0; i < count; i++) {
+		callback(devices_copy + i, properties_copy[i], data);
+		free(properties_copy[i]);
+	}
+	free(properties_copy);
+	free(devices_copy);
+}
+
 indigo_result indigo_change_property(indigo_client *client, indigo_property *property) {
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
-	INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property change request", property, false, true));
+	INDIGO_TRACE(INDIGO_CHECKED_TRACE_PROPERTY("INDIGO Bus: property change request", property, false, true));
+	indigo_flight_record_property(INDIGO_FLIGHT_CHANGE, property);
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		indigo_device *device = devices[i];
 		if (device != NULL && device->enumerate_properties != NULL) {
@@ -377,8 +1673,11 @@ indigo_result indigo_change_property(indigo_client *client, indigo_property *pro
 			route = route || !strcmp(property->device, device->name);
 			route = route || (indigo_use_host_suffix && *device->name == '@' && strstr(property->device, device->name));
 			route = route || (!indigo_use_host_suffix && *device->name == '@');
-			if (route)
+			if (route && !executor_enqueue(i, client, property)) {
+				double start = indigo_metric_time();
 				device->last_result = device->change_property(device, client, property);
+				indigo_metric_observe(device_metrics[i], indigo_metric_time() - start);
+			}
 		}
 	}
 	return INDIGO_OK;
@@ -387,7 +1686,7 @@ indigo_result indigo_change_property(indigo_client *client, indigo_property *pro
 indigo_result indigo_enable_blob(indigo_client *client, indigo_property *property, indigo_enable_blob_mode mode) {
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
-	INDIGO_TRACE(indigo_trace_property("INDIGO Bus: enable BLOB mode change request", property, false, true));
+	INDIGO_TRACE(INDIGO_CHECKED_TRACE_PROPERTY("INDIGO Bus: enable BLOB mode change request", property, false, true));
 	for (int i = 0; i < MAX_DEVICES; i++) {
 		indigo_device *device = devices[i];
 		if (device != NULL && device->enable_blob != NULL) {
@@ -407,7 +1706,12 @@ indigo_result indigo_define_property(indigo_device *device, indigo_property *pro
 		return INDIGO_FAILED;
 
 	if (!property->hidden) {
-		INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property definition", property, true, true));
+		INDIGO_TRACE(INDIGO_CHECKED_TRACE_PROPERTY("INDIGO Bus: property definition", property, true, true));
+		indigo_flight_record_property(INDIGO_FLIGHT_DEFINE, property);
+		store_define(device, property);
+		throttle_remove(NULL, device, property);
+		if (property->priority && indigo_use_device_executors)
+			executor_add_priority(device, property);
 		char message[INDIGO_VALUE_SIZE];
 		if (format != NULL) {
 			va_list args;
@@ -417,31 +1721,48 @@ indigo_result indigo_define_property(indigo_device *device, indigo_property *pro
 		}
 		for (int i = 0; i < MAX_CLIENTS; i++) {
 			indigo_client *client = clients[i];
-			if (client != NULL && client->define_property != NULL)
+			if (client != NULL && client->define_property != NULL) {
+				double start = indigo_metric_time();
 				client->last_result = client->define_property(client, device, property, format != NULL ? message : NULL);
+				indigo_metric_observe(client_metrics[i], indigo_metric_time() - start);
+			}
 		}
 	}
 	return INDIGO_OK;
 }
 
+indigo_result indigo_store_property(indigo_device *device, indigo_property *property) {
+	if ((!is_started) || (property == NULL))
+		return INDIGO_FAILED;
+	if (!property->hidden)
+		store_define(device, property);
+	return INDIGO_OK;
+}
+
 indigo_result indigo_update_property(indigo_device *device, indigo_property *property, const char *format, ...) {
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
 
 	if (!property->hidden) {
 		char message[INDIGO_VALUE_SIZE];
-		INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property update", property, false, true));
+		INDIGO_TRACE(INDIGO_CHECKED_TRACE_PROPERTY("INDIGO Bus: property update", property, false, true));
+		indigo_flight_record_property(INDIGO_FLIGHT_UPDATE, property);
+		store_update(property);
 		if (format != NULL) {
 			va_list args;
 			va_start(args, format);
 			vsnprintf(message, INDIGO_VALUE_SIZE, format, args);
 			va_end(args);
 		}
+		/* client callbacks may update other properties */
+		unsigned long serial = indigo_update_serial;
+		indigo_update_serial = atomic_fetch_add(&update_serial_counter, 1) + 1;
 		for (int i = 0; i < MAX_CLIENTS; i++) {
 			indigo_client *client = clients[i];
-			if (client != NULL && client->update_property != NULL)
-				client->last_result = client->update_property(client, device, property, format != NULL ? message : NULL);
+			if (client != NULL && client->update_property != NULL && throttle_update(i, client, device, property, format != NULL ? message : NULL))
+				deliver_update(i, client, device, property, format != NULL ? message : NULL);
 		}
+		indigo_update_serial = serial;
 	}
 	return INDIGO_OK;
 }
@@ -450,9 +1771,12 @@ indigo_result indigo_delete_property(indigo_device *device, indigo_property *pro
 	if ((!is_started) || (property == NULL))
 		return INDIGO_FAILED;
 
+	store_remove(device, property, true);
+	throttle_remove(NULL, device, property);
 	if (!property->hidden) {
 		char message[INDIGO_VALUE_SIZE];
-		INDIGO_TRACE(indigo_trace_property("INDIGO Bus: property removal", property, false, false));
+		INDIGO_TRACE(INDIGO_CHECKED_TRACE_PROPERTY("INDIGO Bus: property removal", property, false, false));
+		indigo_flight_record_property(INDIGO_FLIGHT_DELETE, property);
 		if (format != NULL) {
 			va_list args;
 			va_start(args, format);
@@ -461,8 +1785,11 @@ indigo_result indigo_delete_property(indigo_device *device, indigo_property *pro
 		}
 		for (int i = 0; i < MAX_CLIENTS; i++) {
 			indigo_client *client = clients[i];
-			if (client != NULL && client->delete_property != NULL)
+			if (client != NULL && client->delete_property != NULL) {
+				double start = indigo_metric_time();
 				client->last_result = client->delete_property(client, device, property, format != NULL ? message : NULL);
+				indigo_metric_observe(client_metrics[i], indigo_metric_time() - start);
+			}
 		}
 	}
 	return INDIGO_OK;
@@ -481,8 +1808,11 @@ indigo_result indigo_send_message(indigo_device *device, const char *format, ...
 	}
 	for (int i = 0; i < MAX_CLIENTS; i++) {
 		indigo_client *client = clients[i];
-		if (client != NULL && client->send_message != NULL)
+		if (client != NULL && client->send_message != NULL) {
+			double start = indigo_metric_time();
 			client->last_result = client->send_message(client, device, format != NULL ? message : NULL);
+			indigo_metric_observe(client_metrics[i], indigo_metric_time() - start);
+		}
 	}
 	return INDIGO_OK;
 }
@@ -491,6 +1821,8 @@ indigo_result indigo_stop() {
 	pthread_mutex_lock(&client_mutex);
 	if (is_started) {
 		is_started = false;
+		for (int i = 0; i < MAX_DEVICES; i++)
+			executor_stop(i);
 		for (int i = 0; i < MAX_DEVICES; i++) {
 			indigo_device *device = devices[i];
 			if (device != NULL && device->detach != NULL)
@@ -619,16 +1951,44 @@ indigo_property *indigo_init_blob_property(indigo_property *property, const char
 
 indigo_property *indigo_resize_property(indigo_property *property, int count) {
 	assert(property != NULL);
+	indigo_property *old_property = property;
+	/* store must not hand out old pointer between realloc() and replace */
+	pthread_mutex_lock(&store_mutex);
 	property = realloc(property, sizeof(indigo_property) + count * sizeof(indigo_item));
 	assert(property != NULL);
+	if (property != old_property)
+		store_replace(old_property, property);
+	pthread_mutex_unlock(&store_mutex);
 	if (count > property->count)
 		memset(property->items+property->count, 0, (count - property->count) * sizeof(indigo_item));
 	property->count = count;
 	return property;
 }
 
+void indigo_copy_name(char *target, const char *source, int size) {
+	size_t length = strnlen(source, size - 1);
+	memcpy(target, source, length);
+	target[length] = 0;
+}
+
+indigo_property *indigo_copy_property(indigo_property *copy, indigo_property *property) {
+	assert(property != NULL);
+	int size = sizeof(indigo_property) + property->count * sizeof(indigo_item);
+	copy = realloc(copy, size);
+	if (copy == NULL)
+		return NULL;
+	memcpy(copy, property, size);
+	if (copy->type == INDIGO_BLOB_VECTOR) {
+		for (int i = 0; i < copy->count; i++)
+			copy->items[i].blob.value = NULL;
+	}
+	return copy;
+}
+
 void indigo_release_property(indigo_property *property) {
 	if (property == NULL) return;
+	store_remove(NULL, property, false);
+	throttle_remove(NULL, NULL, property);
 	for (int i = 0; i < MAX_BLOBS; i++)
 		if (blobs[i] == property) {
 			blobs[i] = NULL;
@@ -710,92 +2070,351 @@ void *indigo_alloc_blob_buffer(long size) {
 	return malloc(size);
 }
 
-bool indigo_populate_http_blob_item(indigo_item *blob_item) {
-	char host[BUFFER_SIZE] = {0};
-	int port = 80;
-	char file[BUFFER_SIZE] = {0};
+typedef struct {
+	bool used;
+	char host[HTTP_HOST_SIZE];
+	int port;
+	int socket;
+} http_connection;
+
+typedef struct {
+	int socket;
+	int start, end;
+	char buffer[HTTP_BUFFER_SIZE];
+} http_reader;
+
+static http_connection http_connections[HTTP_MAX_CONNECTIONS];
+
+static int http_acquire_connection(const char *host, int port, bool *reused) {
+	pthread_mutex_lock(&http_mutex);
+	for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+		http_connection *connection = http_connections + i;
+		if (connection->used && connection->port == port && !strcmp(connection->host, host)) {
+			connection->used = false;
+			pthread_mutex_unlock(&http_mutex);
+			*reused = true;
+			return connection->socket;
+		}
+	}
+	pthread_mutex_unlock(&http_mutex);
+	*reused = false;
+	return indigo_open_tcp_with_timeout(host, port, HTTP_CONNECT_TIMEOUT);
+}
+
+/* at most one idle connection is kept per host, connection of parallel fetch from the same host is closed */
+
+static void http_release_connection(const char *host, int port, int socket, bool keep_alive) {
+	if (keep_alive) {
+		pthread_mutex_lock(&http_mutex);
+		http_connection *free_connection = NULL;
+		for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+			http_connection *connection = http_connections + i;
+			if (!connection->used) {
+				if (free_connection == NULL)
+					free_connection = connection;
+			} else if (connection->port == port && !strcmp(connection->host, host)) {
+				free_connection = NULL;
+				break;
+			}
+		}
+		if (free_connection != NULL) {
+			http_connection *connection = free_connection;
+			strncpy(connection->host, host, HTTP_HOST_SIZE - 1);
+			connection->host[HTTP_HOST_SIZE - 1] = 0;
+			connection->port = port;
+			connection->socket = socket;
+			connection->used = true;
+			pthread_mutex_unlock(&http_mutex);
+			return;
+		}
+		pthread_mutex_unlock(&http_mutex);
+	}
+	shutdown(socket, SHUT_RDWR);
+	close(socket);
+}
+
+static int http_read_line(http_reader *reader, char *line, int length) {
+	int total_bytes = 0;
+	while (true) {
+		if (reader->start == reader->end) {
+			long bytes_read = read(reader->socket, reader->buffer, HTTP_BUFFER_SIZE);
+			if (bytes_read <= 0)
+				return -1;
+			reader->start = 0;
+			reader->end = (int)bytes_read;
+		}
+		char *begin = reader->buffer + reader->start;
+		char *eol = memchr(begin, '\n', reader->end - reader->start);
+		int count = eol ? (int)(eol - begin) : reader->end - reader->start;
+		int copy = count < length - 1 - total_bytes ? count : length - 1 - total_bytes;
+		memcpy(line + total_bytes, begin, copy);
+		total_bytes += copy;
+		reader->start += count;
+		if (eol) {
+			reader->start++;
+			break;
+		}
+	}
+	if (total_bytes > 0 && line[total_bytes - 1] == '\r')
+		total_bytes--;
+	line[total_bytes] = 0;
+	return total_bytes;
+}
+
+static int http_get(http_reader *reader, const char *host, const char *file, indigo_item *blob_item, bool *keep_alive) {
 	char request[BUFFER_SIZE];
 	char http_line[BUFFER_SIZE];
 	char http_response[BUFFER_SIZE];
-	long content_len = 0;;
+	long content_len = -1;
+	int http_minor = 1;
 	int http_result = 0;
-	char *image_type;
-	int socket;
+	snprintf(request, BUFFER_SIZE, "GET /%s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n", file, host);
+	if (!indigo_write(reader->socket, request, strlen(request)))
+		return -1;
+	if (http_read_line(reader, http_line, BUFFER_SIZE) < 0)
+		return -1;
+	if (sscanf(http_line, "HTTP/1.%d %d %255[^\n]", &http_minor, &http_result, http_response) != 3 || http_result != 200) {
+		INDIGO_DEBUG(indigo_debug("%s(): http_line = \"%s\"", __FUNCTION__, http_line));
+		return 0;
+	}
+	INDIGO_DEBUG(indigo_debug("%s(): http_result = %d, response = \"%s\"", __FUNCTION__, http_result, http_response));
+	*keep_alive = http_minor > 0;
+	while (true) {
+		if (http_read_line(reader, http_line, BUFFER_SIZE) < 0)
+			return 0;
+		if (http_line[0] == '\0')
+			break;
+		INDIGO_DEBUG(indigo_debug("%s(): http_line = \"%s\"", __FUNCTION__, http_line));
+		if (!strncasecmp(http_line, "Content-Length:", 15))
+			content_len = atol(http_line + 15);
+		else if (!strcasecmp(http_line, "Connection: close"))
+			*keep_alive = false;
+		else if (!strcasecmp(http_line, "Connection: keep-alive"))
+			*keep_alive = true;
+	}
+	INDIGO_DEBUG(indigo_debug("%s(): content_len = %ld", __FUNCTION__, content_len));
+	if (content_len <= 0) {
+		*keep_alive = *keep_alive && content_len == 0;
+		return 0;
+	}
+	char *image_type = strrchr(file, '.');
+	if (image_type)
+		strncpy(blob_item->blob.format, image_type, INDIGO_NAME_SIZE);
+	/* buffer never shrinks below current size, so size stays valid if the read fails */
+	void *value = realloc(blob_item->blob.value, content_len > blob_item->blob.size ? content_len : blob_item->blob.size);
+	if (value == NULL) {
+		*keep_alive = false;
+		return 0;
+	}
+	blob_item->blob.value = value;
+	long buffered = reader->end - reader->start;
+	if (buffered > content_len)
+		buffered = content_len;
+	memcpy(value, reader->buffer + reader->start, buffered);
+	reader->start += buffered;
+	if (buffered < content_len && indigo_read(reader->socket, (char *)value + buffered, content_len - buffered) != content_len - buffered) {
+		*keep_alive = false;
+		return 0;
+	}
+	blob_item->blob.size = content_len;
+	/* anything left in the buffer would desynchronize the next request */
+	if (reader->start != reader->end)
+		*keep_alive = false;
+	return 1;
+}
+
+bool indigo_populate_http_blob_item(indigo_item *blob_item) {
+	char host[HTTP_HOST_SIZE] = {0};
+	int port = 80;
+	char file[BUFFER_SIZE] = {0};
+	bool reused = false;
+	bool keep_alive = false;
 	int res;
-	int count;
 
 	if ((blob_item->blob.url[0] == '\0') || strcmp(blob_item->name, CCD_IMAGE_ITEM_NAME)) {
 		INDIGO_DEBUG(indigo_debug("%s(): url == \"\" or item != \"%s\"", __FUNCTION__, CCD_IMAGE_ITEM_NAME));
 		return false;
 	}
-	sscanf(blob_item->blob.url, "http://%255[^:]:%5d/%1024[^\n]", host, &port, file);
-	socket = indigo_open_tcp(host, port);
-	if (socket < 0) {
+	sscanf(blob_item->blob.url, "http://%255[^:]:%5d/%1000[^\n]", host, &port, file);
+	http_reader *reader = malloc(sizeof(http_reader));
+	if (reader == NULL)
 		return false;
+	while (true) {
+		reader->start = reader->end = 0;
+		reader->socket = http_acquire_connection(host, port, &reused);
+		if (reader->socket < 0) {
+			res = 0;
+			break;
+		}
+		keep_alive = false;
+		res = http_get(reader, host, file, blob_item, &keep_alive);
+		if (res < 0 && reused) {
+			/* cached connection was closed by the server meanwhile, retry with a fresh one */
+			INDIGO_DEBUG(indigo_debug("%s(): stale connection to %s:%d", __FUNCTION__, host, port));
+			http_release_connection(host, port, reader->socket, false);
+			continue;
+		}
+		http_release_connection(host, port, reader->socket, res > 0 && keep_alive);
+		break;
 	}
+	free(reader);
+	INDIGO_DEBUG(indigo_debug("%s() = %d", __FUNCTION__, res > 0));
+	return res > 0;
+}
 
-	snprintf(request, BUFFER_SIZE, "GET /%s HTTP/1.1\r\n\r\n", file);
-	res = indigo_write(socket, request, strlen(request));
-	if (res == false)
-		goto clean_return;
-
-	res = indigo_read_line(socket, http_line, BUFFER_SIZE);
-	if (res < 0)
-		goto clean_return;
-
-	count = sscanf(http_line, "HTTP/1.1 %d %255[^\n]", &http_result, http_response);
-	if ((count != 2) || (http_result != 200)){
-		INDIGO_DEBUG(indigo_debug("%s(): http_line = \"%s\"", __FUNCTION__, http_line));
-		shutdown(socket, SHUT_RDWR);
-		close(socket);
-		return false;
+typedef struct {
+	unsigned long long text;
+	double value;
+	double target;
+	int sw_light;
+} tracked_item;
+
+typedef struct tracked_property {
+	struct tracked_property *next;
+	unsigned hash;
+	char device[INDIGO_NAME_SIZE];
+	char name[INDIGO_NAME_SIZE];
+	int count;
+	tracked_item items[];
+} tracked_property;
+
+typedef struct {
+	tracked_property *buckets[TRACKER_HASH_SIZE];
+} property_tracker;
+
+static void track_item(tracked_item *tracked, indigo_property *property, indigo_item *item) {
+	memset(tracked, 0, sizeof(tracked_item));
+	switch (property->type) {
+		case INDIGO_TEXT_VECTOR:
+			tracked->text = indigo_hash(INDIGO_HASH_INIT, item->text.value, INDIGO_VALUE_SIZE);
+			break;
+		case INDIGO_NUMBER_VECTOR:
+			tracked->value = item->number.value;
+			tracked->target = item->number.target;
+			break;
+		case INDIGO_SWITCH_VECTOR:
+			tracked->sw_light = item->sw.value;
+			break;
+		case INDIGO_LIGHT_VECTOR:
+			tracked->sw_light = item->light.value;
+			break;
+		default:
+			break;
 	}
-	INDIGO_DEBUG(indigo_debug("%s(): http_result = %d, response = \"%s\"", __FUNCTION__, http_result, http_response));
-
-	do {
-		res = indigo_read_line(socket, http_line, BUFFER_SIZE);
-		if (res < 0)
-			goto clean_return;
-		INDIGO_DEBUG(indigo_debug("%s(): http_line = \"%s\"", __FUNCTION__, http_line));
-		count = sscanf(http_line, "Content-Length: %20ld[^\n]", &content_len);
-	} while (http_line[0] != '\0');
+}
 
-	INDIGO_DEBUG(indigo_debug("%s(): content_len = %ld", __FUNCTION__, content_len));
+int indigo_property_dirty_items(void **tracker, indigo_property *property, bool *dirty) {
+	if (*tracker == NULL && (*tracker = calloc(1, sizeof(property_tracker))) == NULL) {
+		for (int i = 0; i < property->count; i++)
+			dirty[i] = true;
+		return property->count;
+	}
+	property_tracker *buckets = *tracker;
+	unsigned hash = (unsigned)indigo_property_hash(property->device, property->name);
+	tracked_property **link = buckets->buckets + hash % TRACKER_HASH_SIZE;
+	tracked_property *tracked = *link;
+	while (tracked != NULL && (tracked->hash != hash || strcmp(tracked->name, property->name) || strcmp(tracked->device, property->device)))
+		tracked = tracked->next;
+	if (tracked == NULL || tracked->count != property->count) {
+		if (tracked == NULL) {
+			tracked = malloc(sizeof(tracked_property) + property->count * sizeof(tracked_item));
+			if (tracked == NULL)
+				goto all_dirty;
+			tracked->hash = hash;
+			strncpy(tracked->device, property->device, INDIGO_NAME_SIZE);
+			strncpy(tracked->name, property->name, INDIGO_NAME_SIZE);
+			tracked->next = *link;
+			*link = tracked;
+		} else {
+			/* item count changed, replace the record in place */
+			while (*link != tracked)
+				link = &(*link)->next;
+			tracked_property *tmp = realloc(tracked, sizeof(tracked_property) + property->count * sizeof(tracked_item));
+			if (tmp == NULL) {
+				*link = tracked->next;
+				free(tracked);
+				goto all_dirty;
+			}
+			*link = tracked = tmp;
+		}
+		tracked->count = property->count;
+		for (int i = 0; i < property->count; i++) {
+			track_item(tracked->items + i, property, property->items + i);
+			dirty[i] = true;
+		}
+		return property->count;
+	}
+	int count = 0;
+	for (int i = 0; i < property->count; i++) {
+		tracked_item current;
+		track_item(&current, property, property->items + i);
+		if ((dirty[i] = memcmp(&current, tracked->items + i, sizeof(tracked_item)) != 0)) {
+			tracked->items[i] = current;
+			count++;
+		}
+	}
+	return count;
+all_dirty:
+	for (int i = 0; i < property->count; i++)
+		dirty[i] = true;
+	return property->count;
+}
 
-	if (content_len) {
-		image_type = strrchr(file, '.');
-		if (image_type) strncpy(blob_item->blob.format, image_type, INDIGO_NAME_SIZE);
-		blob_item->blob.size = content_len;
-		blob_item->blob.value = realloc(blob_item->blob.value, blob_item->blob.size);
-		res = (indigo_read(socket, blob_item->blob.value, blob_item->blob.size) >= 0) ? true : false;
-	} else {
-		res = false;
+void indigo_forget_property_items(void **tracker, indigo_property *property) {
+	property_tracker *buckets = *tracker;
+	if (buckets == NULL)
+		return;
+	for (int i = 0; i < TRACKER_HASH_SIZE; i++) {
+		tracked_property **link = buckets->buckets + i;
+		while (*link != NULL) {
+			tracked_property *tracked = *link;
+			if (!strcmp(tracked->device, property->device) && (*property->name == 0 || !strcmp(tracked->name, property->name))) {
+				*link = tracked->next;
+				free(tracked);
+			} else {
+				link = &tracked->next;
+			}
+		}
 	}
+}
 
-	clean_return:
-	INDIGO_DEBUG(indigo_debug("%s() = %d", __FUNCTION__, res));
-	shutdown(socket, SHUT_RDWR);
-	close(socket);
-	return res;
+void indigo_release_property_tracker(void **tracker) {
+	property_tracker *buckets = *tracker;
+	if (buckets == NULL)
+		return;
+	for (int i = 0; i < TRACKER_HASH_SIZE; i++) {
+		tracked_property *tracked = buckets->buckets[i];
+		while (tracked != NULL) {
+			tracked_property *next = tracked->next;
+			free(tracked);
+			tracked = next;
+		}
+	}
+	free(buckets);
+	*tracker = NULL;
 }
 
+int indigo_find_item(indigo_property *property, const char *name, int hint) {
+	/* O(1) if items come in definition order, linear scan otherwise, items are not indexed because of fixed indigo_property layout */
+	if (hint >= 0 && hint < property->count && !strcmp(property->items[hint].name, name))
+		return hint;
+	for (int i = 0; i < property->count; i++)
+		if (!strcmp(property->items[i].name, name))
+			return i;
+	return -1;
+}
 
 bool indigo_property_match(indigo_property *property, indigo_property *other) {
 	if (property == NULL) return false;
-	return other == NULL || ((other->type == 0 || property->type == other->type) && (*other->device == 0 || !strcmp(property->device, other->device)) && (*other->name == 0 || !strcmp(property->name, other->name)));
+	return other == NULL || ((other->type == 0 || property->type == other->type) && (*other->name == 0 || !strcmp(property->name, other->name)) && (*other->device == 0 || !strcmp(property->device, other->device)));
 }
 
 bool indigo_switch_match(indigo_item *item, indigo_property *other) {
 	assert(item != NULL);
 	assert(other != NULL);
 	assert(other->type == INDIGO_SWITCH_VECTOR);
-	for (int i = 0; i < other->count; i++) {
-		indigo_item *other_item = other->items+i;
-		if (!strcmp(item->name, other_item->name)) {
-			return other_item->sw.value;
-		}
-	}
-	return false;
+	int i = indigo_find_item(other, item->name, -1);
+	return i >= 0 && other->items[i].sw.value;
 }
 
 void indigo_set_switch(indigo_property *property, indigo_item *item, bool value) {
@@ -812,20 +2431,16 @@ void indigo_set_switch(indigo_property *property, indigo_item *item, bool value)
 indigo_item *indigo_get_item(indigo_property *property, char *item_name) {
 	assert(property != NULL);
 	assert(item_name != NULL);
-	for (int i = 0; i < property->count; i++)
-		if (!strcmp(property->items[i].name, item_name))
-			return property->items + i;
-	return NULL;
+	int i = indigo_find_item(property, item_name, -1);
+	return i >= 0 ? property->items + i : NULL;
 }
 
 bool indigo_get_switch(indigo_property *property, char *item_name) {
 	assert(property != NULL);
 	assert(property->type == INDIGO_SWITCH_VECTOR);
 	assert(item_name != NULL);
-	for (int i = 0; i < property->count; i++)
-		if (!strcmp(property->items[i].name, item_name))
-			return property->items[i].sw.value;
-	return false;
+	int i = indigo_find_item(property, item_name, -1);
+	return i >= 0 && property->items[i].sw.value;
 }
 
 void indigo_property_copy_values(indigo_property *property, indigo_property *other, bool with_state) {
@@ -842,33 +2457,31 @@ void indigo_property_copy_values(indigo_property *property, indigo_property *oth
 			}
 			for (int i = 0; i < other->count; i++) {
 				indigo_item *other_item = &other->items[i];
-				for (int j = 0; j < property->count; j++) {
+				int j = indigo_find_item(property, other_item->name, i);
+				if (j >= 0) {
 					indigo_item *property_item = &property->items[j];
-					if (!strcmp(property_item->name, other_item->name)) {
-						switch (property->type) {
-						case INDIGO_TEXT_VECTOR:
-							strncpy(property_item->text.value, other_item->text.value, INDIGO_VALUE_SIZE);
-							break;
-						case INDIGO_NUMBER_VECTOR:
-							property_item->number.target = property_item->number.value = other_item->number.value;
-							if (property_item->number.value < property_item->number.min)
-								property_item->number.target = property_item->number.value = property_item->number.min;
-							if (property_item->number.value > property_item->number.max)
-								property_item->number.target = property_item->number.value = property_item->number.max;
-							break;
-						case INDIGO_SWITCH_VECTOR:
-							property_item->sw.value = other_item->sw.value;
-							break;
-						case INDIGO_LIGHT_VECTOR:
-							property_item->light.value = other_item->light.value;
-							break;
-						case INDIGO_BLOB_VECTOR:
-							strncpy(property_item->blob.format, other_item->blob.format, INDIGO_NAME_SIZE);
-							strncpy(property_item->blob.url, other_item->blob.url, INDIGO_NAME_SIZE);
-							property_item->blob.size = other_item->blob.size;
-							property_item->blob.value = other_item->blob.value;
-							break;
-						}
+					switch (property->type) {
+					case INDIGO_TEXT_VECTOR:
+						strncpy(property_item->text.value, other_item->text.value, INDIGO_VALUE_SIZE);
+						break;
+					case INDIGO_NUMBER_VECTOR:
+						property_item->number.target = property_item->number.value = other_item->number.value;
+						if (property_item->number.value < property_item->number.min)
+							property_item->number.target = property_item->number.value = property_item->number.min;
+						if (property_item->number.value > property_item->number.max)
+							property_item->number.target = property_item->number.value = property_item->number.max;
+						break;
+					case INDIGO_SWITCH_VECTOR:
+						property_item->sw.value = other_item->sw.value;
+						break;
+					case INDIGO_LIGHT_VECTOR:
+						property_item->light.value = other_item->light.value;
+						break;
+					case INDIGO_BLOB_VECTOR:
+						strncpy(property_item->blob.format, other_item->blob.format, INDIGO_NAME_SIZE);
+						strncpy(property_item->blob.url, other_item->blob.url, INDIGO_NAME_SIZE);
+						property_item->blob.size = other_item->blob.size;
+						property_item->blob.value = other_item->blob.value;
 						break;
 					}
 				}
@@ -48,6 +48,10 @@ extern "C" {
  */
 #define INDIGO_MAX_ITEMS      128
 
+/** Max number of clients attached to the bus (each remote connection is one client).
+ */
+#define INDIGO_MAX_CLIENTS    128
+
 // forward definitions
 
 typedef int indigo_glock;
@@ -133,6 +137,15 @@ typedef enum {
 	INDIGO_ENABLE_BLOB_URL
 } indigo_enable_blob_mode;
 
+/** BLOB delivery policy used when client can't keep up with BLOB updates.
+ */
+typedef enum {
+	INDIGO_BLOB_DELIVERY_DEFAULT,				///< server default policy (all frames unless changed by server option)
+	INDIGO_BLOB_DELIVERY_ALL,						///< all frames are delivered, device waits if client queue is full
+	INDIGO_BLOB_DELIVERY_LATEST,				///< frame waiting for delivery is replaced by newer one
+	INDIGO_BLOB_DELIVERY_NTH						///< every n-th frame is delivered, waiting frame is replaced by newer one
+} indigo_blob_delivery_policy;
+
 /** Enable BLOB mode record
  */
 
@@ -140,6 +153,8 @@ typedef struct indigo_enable_blob_mode_record {
 	char device[INDIGO_NAME_SIZE];				///< device name
 	char name[INDIGO_NAME_SIZE];					///< property name
 	indigo_enable_blob_mode mode;					///< mode
+	indigo_blob_delivery_policy policy;		///< delivery policy
+	int nth;															///< n for INDIGO_BLOB_DELIVERY_NTH policy
 	struct indigo_enable_blob_mode_record *next; ///< next record
 } indigo_enable_blob_mode_record;
 
@@ -150,6 +165,15 @@ typedef enum {
 	INDIGO_LOG_TRACE
 } indigo_log_levels;
 
+/** Subsystems with separate log level.
+ */
+typedef enum {
+	INDIGO_LOG_CORE,            ///< bus, client and server core
+	INDIGO_LOG_PROTOCOL,        ///< wire protocol adapters and parsers
+	INDIGO_LOG_DRIVER,          ///< drivers
+	INDIGO_LOG_SUBSYSTEM_COUNT
+} indigo_log_subsystem;
+
 /** Property item definition.
  */
 typedef struct {/* there is no .name =  because of g++ C99 bug affectinf string initialier */
@@ -205,6 +229,7 @@ typedef struct {
 	indigo_rule rule;                   ///< switch behaviour rule (for switch properties)
 	short version;                      ///< property version INDIGO_VERSION_NONE, INDIGO_VERSION_LEGACY or INDIGO_VERSION_2_0
 	bool hidden;                        ///< property is hidden/unused by  driver (for optional properties)
+	bool priority;                      ///< change requests are executed on separate priority thread of device executor and updates bypass rate limit (abort and guide properties)
 	int count;                          ///< number of property items
 	indigo_item items[];                ///< property items
 } indigo_property;
@@ -284,6 +309,7 @@ typedef struct indigo_client {
 	/** callback called when client is detached from the bus
 	 */
 	indigo_result (*detach)(indigo_client *client);
+	double update_interval;																		///< min interval between updates of the same property in seconds, intermediate updates are coalesced (0 = no limit)
 } indigo_client;
 
 /** Wire protocol adapter private data structure.
@@ -293,6 +319,12 @@ typedef struct {
 	int output;													///< output handle
 	bool web_socket;										///< connection over WebSocket (RFC6455)
 	char url_prefix[INDIGO_NAME_SIZE];	///< server url prefix (for BLOB download)
+	void *tracker;											///< item values last sent to client (for delta updates)
+	bool delta_updates;									///< client asked for changed items only (getProperties delta attribute)
+	void *metric;												///< bytes sent metric
+	void *blob_ring;										///< shared memory BLOB ring (subprocess channel)
+	void *output_queue;									///< BLOB delivery queue and writer thread (remote clients)
+	void *pending_elements;							///< number of partially written elements (atomic_int shared with parent process for warm restart) or NULL
 } indigo_adapter_context;
 
 
@@ -300,18 +332,31 @@ typedef struct {
  */
 extern char indigo_last_message[];
 
+/** Serial number of property update being broadcasted by calling thread (0 if none), lets protocol adapters share work done for one update among clients.
+ */
+extern __thread unsigned long indigo_update_serial;
+
 /** Name to be used in log (if not changed ot will be filled with executable name).
  */
 extern char indigo_log_name[];
 
 /** If set, handler is used to print message instead of stderr/syslog output.
+ Handler is called on log drain thread (or in indigo_flush_log() caller), not on the thread that logged the message, so it must not rely on caller's state and should return quickly.
  */
 extern void (*indigo_log_message_handler)(const char *message);
 
-/** Print diagnostic messages.
+/** Log levels by subsystem, use INDIGO_LOG_ENABLED() macro to test it.
+ */
+extern indigo_log_levels indigo_log_subsystem_level[];
+
+/** Queue diagnostic messages for log thread.
  */
 extern void indigo_log_message(const char *format, va_list args);
-	
+
+/** Write all queued diagnostic messages.
+ */
+extern void indigo_flush_log(void);
+
 /** Print diagnostic messages on trace level, wrap calls to INDIGO_TRACE() macro.
  */
 extern void indigo_trace(const char *format, ...);
@@ -329,6 +374,28 @@ extern void indigo_log(const char *format, ...);
  */
 extern void indigo_trace_property(const char *message, indigo_property *property, bool defs, bool items);
 
+/** Subsystem used for log level checks in the current source file, define it before including indigo_bus.h to override.
+ */
+#ifndef INDIGO_LOG_SUBSYSTEM
+#define INDIGO_LOG_SUBSYSTEM INDIGO_LOG_CORE
+#endif
+
+/** Test log level of subsystem at call site.
+ */
+#define INDIGO_LOG_ENABLED(subsystem, level) (indigo_log_subsystem_level[subsystem] >= (level))
+
+/** Print diagnostic messages on trace, debug or log level, if the level is enabled for INDIGO_LOG_SUBSYSTEM, arguments are not evaluated otherwise.
+ */
+#ifdef INDIGO_RELEASE
+#define INDIGO_CHECKED_TRACE(...) ((void)0)
+#define INDIGO_CHECKED_TRACE_PROPERTY(...) ((void)0)
+#else
+#define INDIGO_CHECKED_TRACE(...) (INDIGO_LOG_ENABLED(INDIGO_LOG_SUBSYSTEM, INDIGO_LOG_TRACE) ? indigo_trace(__VA_ARGS__) : (void)0)
+#define INDIGO_CHECKED_TRACE_PROPERTY(...) (INDIGO_LOG_ENABLED(INDIGO_LOG_SUBSYSTEM, INDIGO_LOG_TRACE) ? indigo_trace_property(__VA_ARGS__) : (void)0)
+#endif
+#define INDIGO_CHECKED_DEBUG(...) (INDIGO_LOG_ENABLED(INDIGO_LOG_SUBSYSTEM, INDIGO_LOG_DEBUG) ? indigo_debug(__VA_ARGS__) : (void)0)
+#define INDIGO_CHECKED_LOG(...) (INDIGO_LOG_ENABLED(INDIGO_LOG_SUBSYSTEM, INDIGO_LOG_INFO) ? indigo_log(__VA_ARGS__) : (void)0)
+
 /** Start bus operation.
  Call has no effect, if bus is already started.
  */
@@ -338,7 +405,11 @@ extern indigo_result indigo_start(void);
 */
 extern void indigo_set_log_level(indigo_log_levels level);
 
-/** Get log level; see enum indigo_log_levels
+/** Set log level of subsystem; see enum indigo_log_levels and indigo_log_subsystem
+ */
+extern void indigo_set_log_subsystem_level(indigo_log_subsystem subsystem, indigo_log_levels level);
+
+/** Get log level (highest level of all subsystems); see enum indigo_log_levels
  */
 extern indigo_log_levels indigo_get_log_level(void);
 
@@ -366,6 +437,10 @@ extern indigo_result indigo_detach_client(indigo_client *client);
  */
 extern indigo_result indigo_define_property(indigo_device *device, indigo_property *property, const char *format, ...);
 
+/** Put property to bus property store without broadcasting definition (e.g. unchanged property retained over reconnect).
+ */
+extern indigo_result indigo_store_property(indigo_device *device, indigo_property *property);
+
 /** Broadcast property value change.
  */
 extern indigo_result indigo_update_property(indigo_device *device, indigo_property *property, const char *format, ...);
@@ -382,6 +457,10 @@ extern indigo_result indigo_send_message(indigo_device *device, const char *form
  */
 extern indigo_result indigo_enumerate_properties(indigo_client *client, indigo_property *property);
 
+/** Call callback for each defined property (callback gets copies of device and property taken under property store lock).
+ */
+extern void indigo_enumerate_defined_properties(void (*callback)(indigo_device *device, indigo_property *property, void *data), void *data);
+
 /** Broadcast property change request.
  */
 extern indigo_result indigo_change_property(indigo_client *client, indigo_property *property);
@@ -416,6 +495,13 @@ extern indigo_property *indigo_resize_property(indigo_property *property, int co
 /** Allocate blob buffer (rounded up to 2880 bytes).
  */
 extern void *indigo_alloc_blob_buffer(long size);
+/** Copy name into buffer of given size, name is truncated if needed and target is always terminated (unused part is not cleared).
+ */
+extern void indigo_copy_name(char *target, const char *source, int size);
+
+/** Copy property with all items into exactly sized buffer (copy is reallocated, may be NULL), BLOB data are not copied.
+ */
+extern indigo_property *indigo_copy_property(indigo_property *copy, indigo_property *property);
 /** Resize property.
  */
 extern void indigo_release_property(indigo_property *property);
@@ -443,6 +529,35 @@ extern void indigo_init_blob_item(indigo_item *item, const char *name, const cha
  */
 extern bool indigo_populate_http_blob_item(indigo_item *blob_item);
 
+/** Compare items with values last sent to the same client, set dirty flags for changed items and remember current values.
+ Returns number of changed items (all of them if property was not sent yet).
+ */
+extern int indigo_property_dirty_items(void **tracker, indigo_property *property, bool *dirty);
+
+/** Forget values last sent for property (or all device properties if name is empty).
+ */
+extern void indigo_forget_property_items(void **tracker, indigo_property *property);
+
+/** Release all values last sent to client.
+ */
+extern void indigo_release_property_tracker(void **tracker);
+
+/** Initial value for indigo_hash().
+ */
+#define INDIGO_HASH_INIT	14695981039346656037ULL
+
+/** FNV-1a hash of string (at most size characters) continuing from given hash.
+ */
+extern unsigned long long indigo_hash(unsigned long long hash, const char *string, int size);
+
+/** Hash of device and property name, used by all property indexes.
+ */
+extern unsigned long long indigo_property_hash(const char *device, const char *name);
+
+/** Get item index, item at hint index is tried first because items are usually sent in definition order (-1 if not found).
+ */
+extern int indigo_find_item(indigo_property *property, const char *name, int hint);
+
 /** Test, if property matches other property.
  */
 extern bool indigo_property_match(indigo_property *property, indigo_property *other);
@@ -515,6 +630,18 @@ extern char indigo_local_service_name[INDIGO_NAME_SIZE];
  */
 extern bool indigo_reshare_remote_devices;
 
+/** Answer client property enumeration from the bus store of defined properties (only requesting client gets definitions).
+ */
+extern bool indigo_use_property_store;
+
+/** Execute device change_property() callbacks on per-device worker thread, requests to the same device are executed in order and caller returns immediately (priority properties have own worker thread).
+ */
+extern bool indigo_use_device_executors;
+
+/** Default update_interval of remote clients (0 = no limit). State changes and BLOBs are never delayed.
+ */
+extern double indigo_remote_update_interval;
+
 /** Do not add @ host:port suffix to remote devices - for case with single remote server and no local devices only.
  */
 extern bool indigo_use_host_suffix;
@@ -38,6 +38,8 @@
 
 #include "indigo_ccd_driver.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
+#include "indigo_flight_recorder.h"
 
 static void countdown_timer_callback(indigo_device *device) {
 	if (CCD_CONTEXT->countdown_enabled && CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE && CCD_EXPOSURE_ITEM->number.value >= 1) {
@@ -73,6 +75,9 @@ indigo_result indigo_ccd_attach(indigo_device *device, unsigned version) {
 	}
 	if (CCD_CONTEXT != NULL) {
 		if (indigo_device_attach(device, version, INDIGO_INTERFACE_CCD) == INDIGO_OK) {
+			CCD_CONTEXT->frames_metric = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_ccd_frames_total", "Number of processed frames", "device", device->name);
+			CCD_CONTEXT->fps_metric = indigo_register_metric(INDIGO_METRIC_GAUGE, "indigo_ccd_fps", "Frame rate computed from last two frames", "device", device->name);
+			CCD_CONTEXT->processing_metric = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_ccd_processing_seconds", "Time spent in image processing and delivery", "device", device->name);
 			// -------------------------------------------------------------------------------- CCD_INFO
 			CCD_INFO_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_INFO_PROPERTY_NAME, CCD_MAIN_GROUP, "Info", INDIGO_IDLE_STATE, INDIGO_RO_PERM, 8);
 			if (CCD_INFO_PROPERTY == NULL)
@@ -131,6 +136,7 @@ indigo_result indigo_ccd_attach(indigo_device *device, unsigned version) {
 			CCD_ABORT_EXPOSURE_PROPERTY = indigo_init_switch_property(NULL, device->name, CCD_ABORT_EXPOSURE_PROPERTY_NAME, CCD_MAIN_GROUP, "Abort exposure", INDIGO_IDLE_STATE, INDIGO_RW_PERM, INDIGO_ONE_OF_MANY_RULE, 1);
 			if (CCD_ABORT_EXPOSURE_PROPERTY == NULL)
 				return INDIGO_FAILED;
+			CCD_ABORT_EXPOSURE_PROPERTY->priority = true;
 			indigo_init_switch_item(CCD_ABORT_EXPOSURE_ITEM, CCD_ABORT_EXPOSURE_ITEM_NAME, "Abort exposure", false);
 			// -------------------------------------------------------------------------------- CCD_FRAME
 			CCD_FRAME_PROPERTY = indigo_init_number_property(NULL, device->name, CCD_FRAME_PROPERTY_NAME, CCD_IMAGE_GROUP, "Frame size", INDIGO_IDLE_STATE, INDIGO_RW_PERM, 5);
@@ -348,6 +354,7 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 	} else if (indigo_property_match(CCD_EXPOSURE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_EXPOSURE
 		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
+			indigo_flight_record(INDIGO_FLIGHT_EXPOSURE_START, device->name, CCD_EXPOSURE_PROPERTY->name, CCD_EXPOSURE_ITEM->number.value, 0);
 			if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value) {
 				if (CCD_IMAGE_FILE_PROPERTY->state != INDIGO_BUSY_STATE) {
 					CCD_IMAGE_FILE_PROPERTY->state = INDIGO_BUSY_STATE;
@@ -367,6 +374,7 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 	} else if (indigo_property_match(CCD_ABORT_EXPOSURE_PROPERTY, property)) {
 		// -------------------------------------------------------------------------------- CCD_ABORT_EXPOSURE
 		if (CCD_EXPOSURE_PROPERTY->state == INDIGO_BUSY_STATE) {
+			indigo_flight_record(INDIGO_FLIGHT_EXPOSURE_ABORT, device->name, CCD_EXPOSURE_PROPERTY->name, 0, 0);
 			CCD_EXPOSURE_PROPERTY->state = INDIGO_ALERT_STATE;
 			CCD_EXPOSURE_ITEM->number.value = 0;
 			indigo_update_property(device, CCD_EXPOSURE_PROPERTY, NULL);
@@ -552,6 +560,15 @@ indigo_result indigo_ccd_change_property(indigo_device *device, indigo_client *c
 	return indigo_device_change_property(device, client, property);
 }
 
+static double count_frame(indigo_device *device) {
+	double now = indigo_metric_time();
+	if (CCD_CONTEXT->last_frame_time > 0 && now > CCD_CONTEXT->last_frame_time)
+		indigo_metric_set(CCD_CONTEXT->fps_metric, 1 / (now - CCD_CONTEXT->last_frame_time));
+	CCD_CONTEXT->last_frame_time = now;
+	indigo_metric_add(CCD_CONTEXT->frames_metric, 1);
+	return now;
+}
+
 indigo_result indigo_ccd_detach(indigo_device *device) {
 	assert(device != NULL);
 	indigo_release_property(CCD_INFO_PROPERTY);
@@ -575,6 +592,9 @@ indigo_result indigo_ccd_detach(indigo_device *device) {
 	indigo_release_property(CCD_COOLER_PROPERTY);
 	indigo_release_property(CCD_COOLER_POWER_PROPERTY);
 	indigo_release_property(CCD_FITS_HEADERS_PROPERTY);
+	indigo_release_metric(CCD_CONTEXT->frames_metric);
+	indigo_release_metric(CCD_CONTEXT->fps_metric);
+	indigo_release_metric(CCD_CONTEXT->processing_metric);
 	return indigo_device_detach(device);
 }
 
@@ -582,6 +602,8 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 	assert(device != NULL);
 	assert(data != NULL);
 	INDIGO_DEBUG(clock_t start = clock());
+	double process_start = count_frame(device);
+	indigo_flight_record(INDIGO_FLIGHT_EXPOSURE_END, device->name, CCD_EXPOSURE_PROPERTY->name, frame_width * frame_height, 0);
 
 	int horizontal_bin = CCD_BIN_HORIZONTAL_ITEM->number.value;
 	int vertical_bin = CCD_BIN_VERTICAL_ITEM->number.value;
@@ -951,15 +973,20 @@ void indigo_process_image(indigo_device *device, void *data, int frame_width, in
 			strncpy(CCD_IMAGE_ITEM->blob.format, ".jpeg", INDIGO_NAME_SIZE);
 		}
 		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
+		double upload_start = indigo_metric_time();
 		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
+		indigo_flight_record(INDIGO_FLIGHT_BLOB, device->name, CCD_IMAGE_PROPERTY->name, CCD_IMAGE_ITEM->blob.size, indigo_metric_time() - upload_start);
 		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
+	indigo_metric_observe(CCD_CONTEXT->processing_metric, indigo_metric_time() - process_start);
 }
 
 void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize, const char *suffix) {
 	assert(device != NULL);
 	assert(data != NULL);
 	INDIGO_DEBUG(clock_t start = clock());
+	double process_start = count_frame(device);
+	indigo_flight_record(INDIGO_FLIGHT_EXPOSURE_END, device->name, CCD_EXPOSURE_PROPERTY->name, 0, 0);
 
 	if (CCD_UPLOAD_MODE_LOCAL_ITEM->sw.value || CCD_UPLOAD_MODE_BOTH_ITEM->sw.value) {
 		char *dir = CCD_LOCAL_MODE_DIR_ITEM->text.value;
@@ -1016,7 +1043,10 @@ void indigo_process_dslr_image(indigo_device *device, void *data, int blobsize,
 		CCD_IMAGE_ITEM->blob.size = blobsize;
 		strncpy(CCD_IMAGE_ITEM->blob.format, suffix, INDIGO_NAME_SIZE);
 		CCD_IMAGE_PROPERTY->state = INDIGO_OK_STATE;
+		double upload_start = indigo_metric_time();
 		indigo_update_property(device, CCD_IMAGE_PROPERTY, NULL);
+		indigo_flight_record(INDIGO_FLIGHT_BLOB, device->name, CCD_IMAGE_PROPERTY->name, CCD_IMAGE_ITEM->blob.size, indigo_metric_time() - upload_start);
 		INDIGO_DEBUG(indigo_debug("Client upload in %gs", (clock() - start) / (double)CLOCKS_PER_SEC));
 	}
+	indigo_metric_observe(CCD_CONTEXT->processing_metric, indigo_metric_time() - process_start);
 }
@@ -28,6 +28,7 @@
 
 #include "indigo_bus.h"
 #include "indigo_driver.h"
+#include "indigo_metrics.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -351,6 +352,10 @@ typedef struct {
 	indigo_property *ccd_cooler_property;         ///< CCD_COOLER property pointer
 	indigo_property *ccd_cooler_power_property;   ///< CCD_COOLER_POWER property pointer
 	indigo_property *ccd_fits_headers;						///< CCD_FITS_HEADERS property pointer
+	indigo_metric *frames_metric;									///< processed frames counter
+	indigo_metric *fps_metric;										///< frame rate gauge
+	indigo_metric *processing_metric;							///< image processing time histogram
+	double last_frame_time;												///< time of last processed frame
 } indigo_ccd_context;
 
 /** Suspend countdown.
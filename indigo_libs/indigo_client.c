@@ -30,20 +30,47 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/time.h>
+#include <net/if.h>
+#if defined(INDIGO_LINUX)
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#elif defined(INDIGO_MACOS) || defined(INDIGO_FREEBSD)
+#include <net/route.h>
+#endif
 
 #include "indigo_client_xml.h"
 #include "indigo_client.h"
+#include "indigo_io.h"
+#include "indigo_metrics.h"
+#include "indigo_blob_ring.h"
+
+#define SERVER_CONNECT_TIMEOUT		3000	/* ms */
+#define SERVER_RECONNECT_MIN			250		/* ms */
+#define SERVER_RECONNECT_MAX			30000	/* ms */
+#define SERVER_CACHE_TIMEOUT			10		/* s, how long are properties of disconnected server retained */
+#define SERVER_STABLE_TIME				5			/* s, connection shorter than this is followed by backoff */
+#define SERVER_RESOLVE_TIMEOUT		3000	/* ms, how long connect waits for name resolution if no address is known yet */
+#define SERVER_MAX_ADDRESSES			4
+#define SUBPROCESS_BUFFER_SIZE		(4 * 1024 * 1024)
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t reconnect_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reconnect_cond = PTHREAD_COND_INITIALIZER;
+static unsigned reconnect_generation = 0;
+static pthread_once_t link_monitor_once = PTHREAD_ONCE_INIT;
 
 indigo_driver_entry indigo_available_drivers[INDIGO_MAX_DRIVERS];
 indigo_server_entry indigo_available_servers[INDIGO_MAX_SERVERS];
@@ -53,6 +80,8 @@ static int used_driver_slots = 0;
 static int used_server_slots = 0;
 static int used_subprocess_slots = 0;
 
+bool indigo_use_blob_ring = true;
+
 static indigo_result add_driver(driver_entry_point entry_point, void *dl_handle, bool init, indigo_driver_entry **driver) {
 	int empty_slot = used_driver_slots; /* the first slot after the last used is a good candidate */
 	pthread_mutex_lock(&mutex);
@@ -92,18 +121,46 @@ static indigo_result add_driver(driver_entry_point entry_point, void *dl_handle,
 	if (driver != NULL)
 		*driver = &indigo_available_drivers[empty_slot];
 
-	if (init) {
-		int result = entry_point(INDIGO_DRIVER_INIT, NULL);
-		indigo_available_drivers[empty_slot].initialized = result == INDIGO_OK;
-		return result;
-	}
+	if (init)
+		return indigo_init_driver(&indigo_available_drivers[empty_slot]);
 	return INDIGO_OK;
 }
 
+indigo_result indigo_init_driver(indigo_driver_entry *driver) {
+	assert(driver != NULL);
+	double start = indigo_metric_time();
+	indigo_result result = driver->driver(INDIGO_DRIVER_INIT, NULL);
+	driver->init_time = indigo_metric_time() - start;
+	driver->initialized = result == INDIGO_OK;
+	if (driver->init_metric == NULL)
+		driver->init_metric = indigo_register_metric(INDIGO_METRIC_GAUGE, "indigo_driver_init_seconds", "Duration of last driver initialization", "driver", driver->name);
+	indigo_metric_set(driver->init_metric, driver->init_time);
+	if (driver->initialized)
+		INDIGO_LOG(indigo_log("Driver %s initialized in %.1fms", driver->name, driver->init_time * 1000));
+	else
+		INDIGO_ERROR(indigo_error("Driver %s initialization failed in %.1fms", driver->name, driver->init_time * 1000));
+	return result;
+}
+
+indigo_result indigo_shutdown_driver(indigo_driver_entry *driver) {
+	assert(driver != NULL);
+	indigo_result result = INDIGO_OK;
+	if (driver->initialized) {
+		result = driver->driver(INDIGO_DRIVER_SHUTDOWN, NULL);
+		driver->initialized = false;
+	}
+	indigo_release_metric(driver->init_metric);
+	driver->init_metric = NULL;
+	return result;
+}
+
 indigo_result indigo_remove_driver(indigo_driver_entry *driver) {
 	assert(driver != NULL);
 	pthread_mutex_lock(&mutex);
 	driver->driver(INDIGO_DRIVER_SHUTDOWN, NULL); /* deregister */
+	driver->initialized = false;
+	indigo_release_metric(driver->init_metric);
+	driver->init_metric = NULL;
 	if (driver->dl_handle) {
 		dlclose(driver->dl_handle);
 	}
@@ -172,50 +229,301 @@ void indigo_service_name(const char *host, int port, char *name) {
 	}
 }
 
+static void server_keepalive(int sock) {
+	int value = 1;
+	struct timeval timeout = { 0, 0 };
+	/* parser blocks until next message, dead peer is detected by keepalive */
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+	setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value));
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+#if defined(TCP_KEEPIDLE)
+	value = 10;
+	setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &value, sizeof(value));
+#elif defined(TCP_KEEPALIVE)
+	value = 10;
+	setsockopt(sock, IPPROTO_TCP, TCP_KEEPALIVE, &value, sizeof(value));
+#endif
+#if defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+	value = 3;
+	setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &value, sizeof(value));
+	setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &value, sizeof(value));
+#endif
+}
+
+static void deadline(int delay, struct timespec *until) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	long nsec = now.tv_usec * 1000L + (delay % 1000) * 1000000L;
+	until->tv_sec = now.tv_sec + delay / 1000 + nsec / 1000000000L;
+	until->tv_nsec = nsec % 1000000000L;
+}
+
+/* returns true if woken by indigo_reconnect_servers(), indigo_disconnect_server() wakes it without restarting backoff */
+
+static bool server_wait(indigo_server_entry *server, int delay) {
+	struct timespec until;
+	deadline(delay, &until);
+	pthread_mutex_lock(&reconnect_mutex);
+	unsigned generation = reconnect_generation;
+	int result = 0;
+	while (generation == reconnect_generation && server->socket >= 0 && result != ETIMEDOUT)
+		result = pthread_cond_timedwait(&reconnect_cond, &reconnect_mutex, &until);
+	bool woken = generation != reconnect_generation;
+	pthread_mutex_unlock(&reconnect_mutex);
+	return woken;
+}
+
+/* name is resolved by separate thread and connect uses last known addresses, so slow or unreachable DNS server doesn't delay reconnect */
+
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int references;											/* server thread and running resolver */
+	bool pending;
+	char host[INDIGO_NAME_SIZE];
+	int port;
+	int count;
+	struct sockaddr_storage addresses[SERVER_MAX_ADDRESSES];
+	socklen_t lengths[SERVER_MAX_ADDRESSES];
+} server_addresses;
+
+static server_addresses *server_addresses_create(indigo_server_entry *server) {
+	server_addresses *resolved = calloc(1, sizeof(server_addresses));
+	assert(resolved != NULL);
+	pthread_mutex_init(&resolved->mutex, NULL);
+	pthread_cond_init(&resolved->cond, NULL);
+	resolved->references = 1;
+	memcpy(resolved->host, server->host, INDIGO_NAME_SIZE);
+	resolved->host[INDIGO_NAME_SIZE - 1] = 0;
+	resolved->port = server->port;
+	return resolved;
+}
+
+static void server_addresses_release(server_addresses *resolved) {
+	pthread_mutex_lock(&resolved->mutex);
+	bool last = --resolved->references == 0;
+	pthread_mutex_unlock(&resolved->mutex);
+	if (last) {
+		pthread_cond_destroy(&resolved->cond);
+		pthread_mutex_destroy(&resolved->mutex);
+		free(resolved);
+	}
+}
+
+static void *resolver_thread(server_addresses *resolved) {
+	struct addrinfo hints, *addresses, *address;
+	char service[16];
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", resolved->port);
+	int result = getaddrinfo(resolved->host, service, &hints, &addresses);
+	pthread_mutex_lock(&resolved->mutex);
+	if (result == 0) {
+		resolved->count = 0;
+		for (address = addresses; address != NULL && resolved->count < SERVER_MAX_ADDRESSES; address = address->ai_next) {
+			if (address->ai_addrlen > sizeof(struct sockaddr_storage))
+				continue;
+			memcpy(resolved->addresses + resolved->count, address->ai_addr, address->ai_addrlen);
+			resolved->lengths[resolved->count++] = address->ai_addrlen;
+		}
+		freeaddrinfo(addresses);
+	} else {
+		INDIGO_DEBUG(indigo_debug("Can't resolve %s (%s)", resolved->host, gai_strerror(result)));
+	}
+	resolved->pending = false;
+	pthread_cond_broadcast(&resolved->cond);
+	pthread_mutex_unlock(&resolved->mutex);
+	server_addresses_release(resolved);
+	return NULL;
+}
+
+static int server_open(server_addresses *resolved) {
+	struct sockaddr_storage addresses[SERVER_MAX_ADDRESSES];
+	socklen_t lengths[SERVER_MAX_ADDRESSES];
+	pthread_mutex_lock(&resolved->mutex);
+	/* refresh addresses for the next attempt, at most one resolver is running */
+	if (!resolved->pending) {
+		pthread_t thread;
+		resolved->references++;
+		resolved->pending = true;
+		if (pthread_create(&thread, NULL, (void *)(void *)resolver_thread, resolved) == 0) {
+			pthread_detach(thread);
+		} else {
+			resolved->references--;
+			resolved->pending = false;
+		}
+	}
+	if (resolved->count == 0 && resolved->pending) {
+		struct timespec until;
+		deadline(SERVER_RESOLVE_TIMEOUT, &until);
+		int result = 0;
+		while (resolved->count == 0 && resolved->pending && result != ETIMEDOUT)
+			result = pthread_cond_timedwait(&resolved->cond, &resolved->mutex, &until);
+	}
+	int count = resolved->count;
+	memcpy(addresses, resolved->addresses, count * sizeof(struct sockaddr_storage));
+	memcpy(lengths, resolved->lengths, count * sizeof(socklen_t));
+	pthread_mutex_unlock(&resolved->mutex);
+	if (count == 0)
+		errno = EHOSTUNREACH;
+	for (int i = 0; i < count; i++) {
+		int sock = indigo_open_tcp_address((struct sockaddr *)(addresses + i), lengths[i], SERVER_CONNECT_TIMEOUT);
+		if (sock >= 0)
+			return sock;
+	}
+	return -1;
+}
+
+/* new address or interface going up means link is up, waiting server threads retry immediately */
+
+static void *link_monitor_thread(void *arg) {
+#if defined(INDIGO_LINUX)
+	int handle = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	struct sockaddr_nl address;
+	memset(&address, 0, sizeof(address));
+	address.nl_family = AF_NETLINK;
+	address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+	if (handle < 0 || bind(handle, (struct sockaddr *)&address, sizeof(address)) < 0) {
+		INDIGO_DEBUG(indigo_debug("Can't monitor network links (%s)", strerror(errno)));
+		if (handle >= 0)
+			close(handle);
+		return NULL;
+	}
+	char buffer[8192] __attribute__((aligned(__alignof__(struct nlmsghdr))));
+	while (true) {
+		long length = recv(handle, buffer, sizeof(buffer), 0);
+		if (length < 0) {
+			/* ENOBUFS means lost notifications, reconnect anyway */
+			if (errno == ENOBUFS)
+				indigo_reconnect_servers();
+			if (errno == EINTR || errno == ENOBUFS)
+				continue;
+			break;
+		}
+		bool link_up = false;
+		for (struct nlmsghdr *header = (struct nlmsghdr *)buffer; NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+			if (header->nlmsg_type == RTM_NEWADDR)
+				link_up = true;
+			else if (header->nlmsg_type == RTM_NEWLINK && (((struct ifinfomsg *)NLMSG_DATA(header))->ifi_flags & IFF_RUNNING))
+				link_up = true;
+		}
+		if (link_up) {
+			INDIGO_DEBUG(indigo_debug("Network link up"));
+			indigo_reconnect_servers();
+		}
+	}
+	close(handle);
+#elif defined(INDIGO_MACOS) || defined(INDIGO_FREEBSD)
+	int handle = socket(PF_ROUTE, SOCK_RAW, AF_UNSPEC);
+	if (handle < 0) {
+		INDIGO_DEBUG(indigo_debug("Can't monitor network links (%s)", strerror(errno)));
+		return NULL;
+	}
+	char buffer[2048];
+	while (true) {
+		long length = read(handle, buffer, sizeof(buffer));
+		if (length < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		struct rt_msghdr *header = (struct rt_msghdr *)buffer;
+		if (length >= sizeof(struct if_msghdr) && header->rtm_type == RTM_IFINFO && (((struct if_msghdr *)buffer)->ifm_flags & IFF_RUNNING))
+			indigo_reconnect_servers();
+		else if (length >= sizeof(struct ifa_msghdr) && header->rtm_type == RTM_NEWADDR)
+			indigo_reconnect_servers();
+	}
+	close(handle);
+#endif
+	return NULL;
+}
+
+static void start_link_monitor(void) {
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, link_monitor_thread, NULL) == 0)
+		pthread_detach(thread);
+}
+
 static void *server_thread(indigo_server_entry *server) {
 	INDIGO_LOG(indigo_log("Server %s:%d thread started", server->host, server->port));
+	indigo_xml_property_cache cache = { NULL, 0 };
+	unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)(long)server;
+	time_t disconnected = 0;
+	int delay = 0;
+	server_addresses *resolved = server_addresses_create(server);
 	while (server->socket >= 0) {
-		server->socket = 0;
-		struct hostent *host_entry = gethostbyname(server->host);
-		if (host_entry == NULL) {
-			INDIGO_ERROR(indigo_error("Can't resolve host name %s (%s)", server->host, strerror(errno)));
-		} else if ((server->socket = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-			INDIGO_ERROR(indigo_error("Can't create socket (%s)", strerror(errno)));
-		} else {
-			struct sockaddr_in serv_addr;
-			memcpy(&serv_addr.sin_addr, host_entry->h_addr_list[0], host_entry->h_length);
-			serv_addr.sin_family = AF_INET;
-			serv_addr.sin_port = htons(server->port);
-			if (connect(server->socket, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-				close(server->socket);
-				server->socket = 0;
-			}
+		int sock = server_open(resolved);
+		pthread_mutex_lock(&mutex);
+		if (server->socket < 0) {
+			if (sock >= 0)
+				close(sock);
+			pthread_mutex_unlock(&mutex);
+			break;
 		}
-		if (server->socket > 0) {
+		server->socket = sock > 0 ? sock : 0;
+		pthread_mutex_unlock(&mutex);
+		if (sock > 0) {
+			/* indigo_disconnect_server() resets server->socket, keep own copy to close it */
+			server_keepalive(sock);
 			if (*server->name == 0) {
 				indigo_service_name(server->host, server->port, server->name);
 			}
 			char  url[INDIGO_NAME_SIZE];
 			snprintf(url, sizeof(url), "http://%s:%d", server->host, server->port);
 			INDIGO_LOG(indigo_log("Server %s:%d (%s, %s) connected", server->host, server->port, server->name, url));
-			server->protocol_adapter = indigo_xml_client_adapter(server->name, url, server->socket, server->socket);
+			time_t connected = time(NULL);
+			server->protocol_adapter = indigo_xml_client_adapter(server->name, url, sock, sock);
 			indigo_attach_device(server->protocol_adapter);
-			indigo_xml_parse(server->protocol_adapter, NULL);
+			indigo_xml_parse_with_cache(server->protocol_adapter, NULL, &cache);
 			indigo_detach_device(server->protocol_adapter);
 			free(server->protocol_adapter->device_context);
 			free(server->protocol_adapter);
-			close(server->socket);
+			pthread_mutex_lock(&mutex);
+			if (server->socket > 0)
+				server->socket = 0;
+			close(sock);
+			pthread_mutex_unlock(&mutex);
 			INDIGO_LOG(indigo_log("Server %s:%d disconnected", server->host, server->port));
+			disconnected = time(NULL);
+			if (disconnected - connected >= SERVER_STABLE_TIME) {
+				/* try to reconnect immediately, flapping link is common case */
+				delay = 0;
+				continue;
+			}
+			/* server accepting and dropping connections is handled as failed connect */
+		} else {
+			INDIGO_DEBUG(indigo_debug("Can't connect to server %s:%d (%s)", server->host, server->port, strerror(errno)));
 		}
-		sleep(5);
+		if (server->socket < 0)
+			break;
+		if (cache.properties != NULL && time(NULL) - disconnected >= SERVER_CACHE_TIMEOUT)
+			indigo_xml_release_cache(&cache);
+		if (delay < SERVER_RECONNECT_MIN)
+			delay = SERVER_RECONNECT_MIN;
+		else if ((delay *= 2) > SERVER_RECONNECT_MAX)
+			delay = SERVER_RECONNECT_MAX;
+		/* full jitter in <delay/2, delay> to avoid synchronized reconnects, link-up restarts backoff */
+		if (server_wait(server, delay / 2 + rand_r(&seed) % (delay / 2 + 1)))
+			delay = 0;
 	}
+	server_addresses_release(resolved);
+	indigo_xml_release_cache(&cache);
 	server->thread_started = false;
 	INDIGO_LOG(indigo_log("Server %s:%d thread stopped", server->host, server->port));
 	return NULL;
 }
 
+void indigo_reconnect_servers() {
+	pthread_mutex_lock(&reconnect_mutex);
+	reconnect_generation++;
+	pthread_cond_broadcast(&reconnect_cond);
+	pthread_mutex_unlock(&reconnect_mutex);
+}
+
 indigo_result indigo_connect_server(const char *name, const char *host, int port, indigo_server_entry **server) {
 	int empty_slot = used_server_slots;
+	pthread_once(&link_monitor_once, start_link_monitor);
 	pthread_mutex_lock(&mutex);
 	for (int dc = 0; dc < used_server_slots;  dc++) {
 		if (indigo_available_servers[dc].socket > 0 && !strcmp(indigo_available_servers[dc].host, host) && indigo_available_servers[dc].port == port) {
@@ -257,9 +565,12 @@ indigo_result indigo_disconnect_server(indigo_server_entry *server) {
 	assert(server != NULL);
 	pthread_mutex_lock(&mutex);
 	if (server->socket > 0)
-		close(server->socket);
+		shutdown(server->socket, SHUT_RDWR);
 	server->socket = -1;
 	pthread_mutex_unlock(&mutex);
+	pthread_mutex_lock(&reconnect_mutex);
+	pthread_cond_broadcast(&reconnect_cond);
+	pthread_mutex_unlock(&reconnect_mutex);
 	return INDIGO_OK;
 }
 
@@ -267,31 +578,49 @@ static void *subprocess_thread(indigo_subprocess_entry *subprocess) {
 	INDIGO_LOG(indigo_log("Subprocess %s thread started", subprocess->executable));
 	int sleep_interval = 5;
 	while (subprocess->pid >= 0) {
-		int input[2], output[2];
-		if (pipe(input) < 0 || pipe(output) < 0) {
-			INDIGO_ERROR(indigo_error("Can't create local pipe for subprocess %s (%s)", subprocess->executable, strerror(errno)));
+		int channel[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0) {
+			INDIGO_ERROR(indigo_error("Can't create local socket pair for subprocess %s (%s)", subprocess->executable, strerror(errno)));
 			return NULL;
 		}
+		int size = SUBPROCESS_BUFFER_SIZE;
+		for (int i = 0; i < 2; i++) {
+			setsockopt(channel[i], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+			setsockopt(channel[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+		}
+		/* INDIGO drivers can pass BLOBs in shared memory ring, INDI drivers ignore the offer */
+		int ring_handle = -1;
+		indigo_blob_ring *ring = indigo_use_blob_ring ? indigo_blob_ring_create(INDIGO_BLOB_RING_SIZE, &ring_handle) : NULL;
 		subprocess->pid = fork();
 		if (subprocess->pid == -1) {
 			INDIGO_ERROR(indigo_error("Can't create subprocess %s (%s)", subprocess->executable, strerror(errno)));
 			exit(0);
 		} else if (subprocess->pid == 0) {
-			close(0);
-			dup2(output[0], 0);
-			close(1);
-			dup2(input[1], 1);
+			close(channel[0]);
+			dup2(channel[1], 0);
+			dup2(channel[1], 1);
+			close(channel[1]);
+			if (ring_handle >= 0) {
+				char offer[16];
+				snprintf(offer, sizeof(offer), "%d", ring_handle);
+				fcntl(ring_handle, F_SETFD, 0);
+				setenv(INDIGO_BLOB_RING_ENV, offer, 1);
+			}
 			execlp(subprocess->executable, subprocess->executable, NULL);
 			INDIGO_ERROR(indigo_error("Can't execute driver %s (%s)", subprocess->executable, strerror(errno)));
 			exit(0);
 		} else {
-			close(input[1]);
-			close(output[0]);
+			close(channel[1]);
+			if (ring_handle >= 0)
+				close(ring_handle);
 			char *slash = strrchr(subprocess->executable, '/');
-			subprocess->protocol_adapter = indigo_xml_client_adapter(slash ? slash + 1 : subprocess->executable, "", input[0], output[1]);
+			/* separate output handle, adapter is treated as local device (see indigo_xml_client_adapter()) */
+			subprocess->protocol_adapter = indigo_xml_client_adapter(slash ? slash + 1 : subprocess->executable, "", channel[0], dup(channel[0]));
+			((indigo_adapter_context *)subprocess->protocol_adapter->device_context)->blob_ring = ring;
 			indigo_attach_device(subprocess->protocol_adapter);
 			indigo_xml_parse(subprocess->protocol_adapter, NULL);
 			indigo_detach_device(subprocess->protocol_adapter);
+			indigo_blob_ring_close(ring);
 			free(subprocess->protocol_adapter->device_context);
 			free(subprocess->protocol_adapter);
 		}
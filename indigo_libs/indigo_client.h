@@ -31,6 +31,7 @@
 
 #include "indigo_bus.h"
 #include "indigo_driver.h"
+#include "indigo_metrics.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,6 +48,8 @@ typedef struct {
 	driver_entry_point driver;              ///< driver entry point
 	void *dl_handle;                        ///< dynamic library handle (NULL for statically linked driver)
 	bool initialized;												///< driver is initialized
+	double init_time;                       ///< duration of last driver initialization in seconds
+	indigo_metric *init_metric;             ///< initialization time gauge, registered on first initialization
 } indigo_driver_entry;
 
 /** Remote server entry type.
@@ -83,10 +86,22 @@ extern indigo_server_entry indigo_available_servers[INDIGO_MAX_SERVERS];
  */
 extern indigo_subprocess_entry indigo_available_subprocesses[INDIGO_MAX_SERVERS];
 
+/** Offer shared memory ring for BLOBs to subprocess drivers.
+ */
+extern bool indigo_use_blob_ring;
+
 /** Add statically linked driver.
  */
 extern indigo_result indigo_add_driver(driver_entry_point entry_point, bool init, indigo_driver_entry **driver);
 
+/** Initialize driver, measure and report initialization time.
+ */
+extern indigo_result indigo_init_driver(indigo_driver_entry *driver);
+
+/** Shutdown initialized driver and release its initialization time gauge.
+ */
+extern indigo_result indigo_shutdown_driver(indigo_driver_entry *driver);
+
 /** Remove statically linked driver or remove & unload dynamically linked driver
  */
 extern indigo_result indigo_remove_driver(indigo_driver_entry *driver);
@@ -107,6 +122,10 @@ extern indigo_result indigo_connect_server(const char *name, const char *host, i
  */
 extern indigo_result indigo_disconnect_server(indigo_server_entry *server);
 
+/** Wake up reconnecting server threads and retry immediately. Called on network link-up by the library itself (netlink on Linux, routing socket on macOS/FreeBSD).
+ */
+extern void indigo_reconnect_servers(void);
+
 /** Start thread for subprocess.
  */
 extern indigo_result indigo_start_subprocess(const char *executable, indigo_subprocess_entry **subprocess);
@@ -23,6 +23,8 @@
  \file indigo_client_xml.c
  */
 
+#define INDIGO_LOG_SUBSYSTEM INDIGO_LOG_PROTOCOL
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -185,6 +187,9 @@ indigo_device *indigo_xml_client_adapter(char *name, char *url_prefix, int input
 	device_context->input = input;
 	device_context->output = output;
 	strncpy(device_context->url_prefix, url_prefix, INDIGO_NAME_SIZE);
+	device_context->blob_ring = NULL;
+	device_context->output_queue = NULL;
+	device_context->pending_elements = NULL;
 	device->device_context = device_context;
 	return device;
 }
@@ -31,8 +31,13 @@
 #define INDIGO_BUILD 73
 
 /** Conditional compilation wrapper for TRACE log level
+ Trace sites are compiled out if INDIGO_RELEASE is defined.
  */
+#ifdef INDIGO_RELEASE
+#define INDIGO_TRACE(c)
+#else
 #define INDIGO_TRACE(c) c
+#endif
 
 /** Conditional compilation wrapper for DEBUG log level
  */
@@ -48,7 +53,11 @@
 
 /** Conditional compilation wrapper for TRACE log level (for wire protocol adapters)
  */
+#ifdef INDIGO_RELEASE
+#define INDIGO_TRACE_PROTOCOL(c)
+#else
 #define INDIGO_TRACE_PROTOCOL(c) c
+#endif
 
 /** Conditional compilation wrapper for TRACE log level (for wire protocol parsers)
  */
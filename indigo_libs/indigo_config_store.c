@@ -0,0 +1,437 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO binary config store
+ \file indigo_config_store.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "indigo_config_store.h"
+#include "indigo_metrics.h"
+
+#define MAX_SESSIONS		256
+#define HANDLE_BASE			0x10000	/* out of range of file descriptors, so handle is never mistaken for open file */
+#define HANDLE_GENERATIONS	0x8000
+#define SESSION_TIMEOUT		60			/* s, session not used for this time is considered abandoned (e.g. handle closed by close()) and reclaimed */
+
+#define ALIGN(size)			(((size) + 7) & ~7)
+
+typedef struct config_session {
+	struct config_session *next;
+	char path[PATH_MAX];
+	int handle;
+	double last_used;
+	char *buffer;
+	size_t size;
+	size_t capacity;
+	double deadline;
+} config_session;
+
+static config_session *sessions[MAX_SESSIONS];
+static int generation = 0;
+static config_session *pending = NULL;
+static pthread_mutex_t session_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t writer_once = PTHREAD_ONCE_INIT;
+static indigo_metric *write_metric = NULL;
+static indigo_metric *coalesced_metric = NULL;
+
+static void *reserve(config_session *session, size_t size) {
+	if (session->size + size > session->capacity) {
+		size_t capacity = session->capacity ? session->capacity : 4096;
+		while (capacity < session->size + size)
+			capacity *= 2;
+		char *buffer = realloc(session->buffer, capacity);
+		if (buffer == NULL)
+			return NULL;
+		session->buffer = buffer;
+		session->capacity = capacity;
+	}
+	void *record = session->buffer + session->size;
+	memset(record, 0, size);
+	session->size += size;
+	return record;
+}
+
+static bool write_file(config_session *session) {
+	char tmp_path[PATH_MAX + 8];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", session->path);
+	double start = indigo_metric_time();
+	int handle = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (handle < 0) {
+		indigo_error("Can't create %s (%s)", tmp_path, strerror(errno));
+		return false;
+	}
+	char *data = session->buffer;
+	size_t remaining = session->size;
+	while (remaining > 0) {
+		ssize_t written = write(handle, data, remaining);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			indigo_error("Can't write %s (%s)", tmp_path, strerror(errno));
+			close(handle);
+			unlink(tmp_path);
+			return false;
+		}
+		data += written;
+		remaining -= written;
+	}
+	if (fsync(handle) < 0) {
+		indigo_error("Can't sync %s (%s)", tmp_path, strerror(errno));
+		close(handle);
+		unlink(tmp_path);
+		return false;
+	}
+	if (close(handle) < 0) {
+		indigo_error("Can't close %s (%s)", tmp_path, strerror(errno));
+		unlink(tmp_path);
+		return false;
+	}
+	if (rename(tmp_path, session->path) < 0) {
+		indigo_error("Can't rename %s (%s)", tmp_path, strerror(errno));
+		unlink(tmp_path);
+		return false;
+	}
+	/* make rename itself durable */
+	char dir_path[PATH_MAX];
+	strncpy(dir_path, session->path, sizeof(dir_path) - 1);
+	dir_path[sizeof(dir_path) - 1] = 0;
+	handle = open(dirname(dir_path), O_RDONLY);
+	if (handle >= 0) {
+		int result = fsync(handle);
+		close(handle);
+		if (result < 0) {
+			indigo_error("Can't sync directory of %s (%s)", session->path, strerror(errno));
+			return false;
+		}
+	}
+	indigo_metric_observe(write_metric, indigo_metric_time() - start);
+	INDIGO_DEBUG(indigo_debug("Config %s saved (%zu bytes)", session->path, session->size));
+	return true;
+}
+
+static void free_session(config_session *session) {
+	free(session->buffer);
+	free(session);
+}
+
+/* caller holds write_mutex, sessions are detached from pending list before they are written */
+static void write_pending(const char *path, double now) {
+	config_session *due = NULL, **tail = &due;
+	pthread_mutex_lock(&session_mutex);
+	config_session **link = &pending;
+	while (*link) {
+		config_session *session = *link;
+		if ((path == NULL && session->deadline <= now) || (path != NULL && !strcmp(session->path, path))) {
+			*link = session->next;
+			session->next = NULL;
+			*tail = session;
+			tail = &session->next;
+		} else {
+			link = &session->next;
+		}
+	}
+	pthread_mutex_unlock(&session_mutex);
+	while (due) {
+		config_session *session = due;
+		due = session->next;
+		write_file(session);
+		free_session(session);
+	}
+}
+
+static void *writer(void *arg) {
+	while (true) {
+		pthread_mutex_lock(&session_mutex);
+		while (true) {
+			double deadline = 0;
+			for (config_session *session = pending; session; session = session->next)
+				if (deadline == 0 || session->deadline < deadline)
+					deadline = session->deadline;
+			double now = indigo_metric_time();
+			if (deadline != 0 && deadline <= now)
+				break;
+			if (deadline == 0) {
+				pthread_cond_wait(&pending_cond, &session_mutex);
+			} else {
+				struct timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				double wait = deadline - now;
+				ts.tv_sec += (time_t)wait;
+				ts.tv_nsec += (long)((wait - (time_t)wait) * 1e9);
+				if (ts.tv_nsec >= 1000000000) {
+					ts.tv_sec++;
+					ts.tv_nsec -= 1000000000;
+				}
+				pthread_cond_timedwait(&pending_cond, &session_mutex, &ts);
+			}
+		}
+		pthread_mutex_unlock(&session_mutex);
+		pthread_mutex_lock(&write_mutex);
+		write_pending(NULL, indigo_metric_time());
+		pthread_mutex_unlock(&write_mutex);
+	}
+	return NULL;
+}
+
+static void flush_at_exit(void) {
+	indigo_config_flush(NULL);
+}
+
+static void start_writer(void) {
+	write_metric = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_config_write_seconds", "Time to write and sync config file", NULL, NULL);
+	coalesced_metric = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_config_coalesced_total", "Config saves replaced by later save within save delay", NULL, NULL);
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, writer, NULL) == 0)
+		pthread_detach(thread);
+	atexit(flush_at_exit);
+}
+
+int indigo_config_begin(const char *path) {
+	config_session *session = calloc(1, sizeof(config_session));
+	if (session == NULL)
+		return 0;
+	strncpy(session->path, path, sizeof(session->path) - 1);
+	if (reserve(session, 8) == NULL) {
+		free(session);
+		return 0;
+	}
+	memcpy(session->buffer, INDIGO_CONFIG_MAGIC, 8);
+	double now = indigo_metric_time();
+	session->last_used = now;
+	pthread_mutex_lock(&session_mutex);
+	for (int i = 0; i < MAX_SESSIONS; i++) {
+		if (sessions[i] != NULL && sessions[i]->last_used + SESSION_TIMEOUT < now) {
+			indigo_error("Config save session for %s abandoned", sessions[i]->path);
+			free_session(sessions[i]);
+			sessions[i] = NULL;
+		}
+	}
+	for (int i = 0; i < MAX_SESSIONS; i++) {
+		if (sessions[i] == NULL) {
+			/* generation makes handle of reclaimed session invalid even if its slot is reused */
+			generation = (generation + 1) % HANDLE_GENERATIONS;
+			session->handle = HANDLE_BASE + generation * MAX_SESSIONS + i;
+			sessions[i] = session;
+			pthread_mutex_unlock(&session_mutex);
+			return session->handle;
+		}
+	}
+	pthread_mutex_unlock(&session_mutex);
+	free_session(session);
+	indigo_error("Too many config save sessions");
+	return 0;
+}
+
+static config_session *get_session(int handle) {
+	if (handle < HANDLE_BASE)
+		return NULL;
+	config_session *session = sessions[(handle - HANDLE_BASE) % MAX_SESSIONS];
+	if (session == NULL || session->handle != handle)
+		return NULL;
+	session->last_used = indigo_metric_time();
+	return session;
+}
+
+indigo_result indigo_config_add(int handle, indigo_property *property) {
+	if (property == NULL)
+		return INDIGO_FAILED;
+	if (property->type != INDIGO_TEXT_VECTOR && property->type != INDIGO_NUMBER_VECTOR && property->type != INDIGO_SWITCH_VECTOR)
+		return INDIGO_OK;
+	pthread_mutex_lock(&session_mutex);
+	config_session *session = get_session(handle);
+	if (session == NULL) {
+		pthread_mutex_unlock(&session_mutex);
+		return INDIGO_FAILED;
+	}
+	size_t offset = session->size;
+	indigo_config_record *record = reserve(session, sizeof(indigo_config_record));
+	if (record == NULL) {
+		pthread_mutex_unlock(&session_mutex);
+		return INDIGO_FAILED;
+	}
+	record->type = property->type;
+	record->count = property->count;
+	indigo_copy_name(record->device, property->device, INDIGO_NAME_SIZE);
+	indigo_copy_name(record->name, property->name, INDIGO_NAME_SIZE);
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = property->items + i;
+		uint32_t length = property->type == INDIGO_TEXT_VECTOR ? (uint32_t)strnlen(item->text.value, INDIGO_VALUE_SIZE - 1) + 1 : 0;
+		uint32_t size = ALIGN(sizeof(indigo_config_item) + length);
+		indigo_config_item *config_item = reserve(session, size);
+		if (config_item == NULL) {
+			session->size = offset;
+			pthread_mutex_unlock(&session_mutex);
+			return INDIGO_FAILED;
+		}
+		config_item->size = size;
+		config_item->length = length;
+		indigo_copy_name(config_item->name, item->name, INDIGO_NAME_SIZE);
+		if (property->type == INDIGO_TEXT_VECTOR)
+			memcpy((char *)(config_item + 1), item->text.value, length - 1);
+		else if (property->type == INDIGO_NUMBER_VECTOR)
+			config_item->number = item->number.value;
+		else
+			config_item->sw = item->sw.value;
+	}
+	/* buffer may be reallocated while items are added */
+	((indigo_config_record *)(session->buffer + offset))->size = (uint32_t)(session->size - offset);
+	pthread_mutex_unlock(&session_mutex);
+	return INDIGO_OK;
+}
+
+indigo_result indigo_config_commit(int handle) {
+	pthread_once(&writer_once, start_writer);
+	pthread_mutex_lock(&session_mutex);
+	config_session *session = get_session(handle);
+	if (session == NULL) {
+		pthread_mutex_unlock(&session_mutex);
+		return INDIGO_FAILED;
+	}
+	sessions[(handle - HANDLE_BASE) % MAX_SESSIONS] = NULL;
+	session->deadline = indigo_metric_time() + INDIGO_CONFIG_SAVE_DELAY;
+	config_session **link = &pending;
+	while (*link && strcmp((*link)->path, session->path))
+		link = &(*link)->next;
+	if (*link) {
+		/* whole file is always rewritten, so earlier pending save of the same file is obsolete */
+		config_session *obsolete = *link;
+		session->next = obsolete->next;
+		session->deadline = obsolete->deadline;
+		*link = session;
+		free_session(obsolete);
+		indigo_metric_add(coalesced_metric, 1);
+	} else {
+		session->next = pending;
+		pending = session;
+	}
+	pthread_cond_signal(&pending_cond);
+	pthread_mutex_unlock(&session_mutex);
+	return INDIGO_OK;
+}
+
+indigo_result indigo_config_close(int handle) {
+	pthread_mutex_lock(&session_mutex);
+	config_session *session = get_session(handle);
+	if (session == NULL) {
+		pthread_mutex_unlock(&session_mutex);
+		return INDIGO_FAILED;
+	}
+	sessions[(handle - HANDLE_BASE) % MAX_SESSIONS] = NULL;
+	pthread_mutex_unlock(&session_mutex);
+	free_session(session);
+	return INDIGO_OK;
+}
+
+void indigo_config_flush(const char *path) {
+	pthread_mutex_lock(&write_mutex);
+	write_pending(path, 1e300);
+	pthread_mutex_unlock(&write_mutex);
+}
+
+indigo_result indigo_config_load(const char *path, indigo_client *client) {
+	indigo_config_flush(path);
+	int handle = open(path, O_RDONLY);
+	if (handle < 0)
+		return INDIGO_NOT_FOUND;
+	struct stat st;
+	if (fstat(handle, &st) < 0 || st.st_size < 8) {
+		close(handle);
+		return INDIGO_NOT_FOUND;
+	}
+	size_t size = st.st_size;
+	char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, handle, 0);
+	close(handle);
+	if (data == MAP_FAILED)
+		return INDIGO_NOT_FOUND;
+	if (memcmp(data, INDIGO_CONFIG_MAGIC, 8)) {
+		munmap(data, size);
+		indigo_error("Invalid config file %s", path);
+		return INDIGO_NOT_FOUND;
+	}
+	indigo_property *property = NULL;
+	int capacity = 0;
+	size_t offset = 8;
+	while (offset + sizeof(indigo_config_record) <= size) {
+		indigo_config_record *record = (indigo_config_record *)(data + offset);
+		if (record->size < sizeof(indigo_config_record) || offset + record->size > size || record->count > INDIGO_MAX_ITEMS)
+			break;
+		if (record->count == 0) {
+			/* nothing to change, property buffer may not be allocated yet */
+			offset += record->size;
+			continue;
+		}
+		if (record->count > capacity) {
+			indigo_property *resized = realloc(property, sizeof(indigo_property) + record->count * sizeof(indigo_item));
+			if (resized == NULL)
+				break;
+			property = resized;
+			capacity = record->count;
+		}
+		memset(property, 0, sizeof(indigo_property) + record->count * sizeof(indigo_item));
+		indigo_copy_name(property->device, record->device, INDIGO_NAME_SIZE);
+		indigo_copy_name(property->name, record->name, INDIGO_NAME_SIZE);
+		property->type = record->type;
+		property->version = INDIGO_VERSION_CURRENT;
+		property->count = record->count;
+		size_t item_offset = offset + sizeof(indigo_config_record);
+		bool valid = true;
+		for (int i = 0; i < record->count; i++) {
+			indigo_config_item *config_item = (indigo_config_item *)(data + item_offset);
+			if (item_offset + sizeof(indigo_config_item) > offset + record->size || config_item->size < sizeof(indigo_config_item) || item_offset + config_item->size > offset + record->size || config_item->length > config_item->size - sizeof(indigo_config_item)) {
+				valid = false;
+				break;
+			}
+			indigo_item *item = property->items + i;
+			indigo_copy_name(item->name, config_item->name, INDIGO_NAME_SIZE);
+			if (record->type == INDIGO_TEXT_VECTOR) {
+				size_t length = strnlen((char *)(config_item + 1), config_item->length < INDIGO_VALUE_SIZE ? config_item->length : INDIGO_VALUE_SIZE - 1);
+				memcpy(item->text.value, (char *)(config_item + 1), length);
+				item->text.value[length] = 0;
+			}
+			else if (record->type == INDIGO_NUMBER_VECTOR)
+				item->number.value = config_item->number;
+			else
+				item->sw.value = config_item->sw != 0;
+			item_offset += config_item->size;
+		}
+		if (!valid)
+			break;
+		indigo_change_property(client, property);
+		offset += record->size;
+	}
+	if (offset != size)
+		indigo_error("Config file %s is truncated or corrupted", path);
+	free(property);
+	munmap(data, size);
+	return INDIGO_OK;
+}
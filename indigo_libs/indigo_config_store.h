@@ -0,0 +1,96 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO binary config store
+ \file indigo_config_store.h
+ */
+
+#ifndef indigo_config_store_h
+#define indigo_config_store_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Config file signature.
+ */
+#define INDIGO_CONFIG_MAGIC					"INDICFG1"
+
+/** Config file suffix appended to XML config file name.
+ */
+#define INDIGO_CONFIG_SUFFIX				".bin"
+
+/** Delay before committed config is written, later commits of the same file within this window replace earlier ones.
+ */
+#define INDIGO_CONFIG_SAVE_DELAY		0.2
+
+/** Property record, followed by count item records. All records are 8 byte aligned.
+ */
+typedef struct {
+	uint32_t size;							///< record size including items
+	uint16_t type;							///< indigo_property_type
+	uint16_t count;							///< item count
+	char device[INDIGO_NAME_SIZE];	///< device name
+	char name[INDIGO_NAME_SIZE];		///< property name
+} indigo_config_record;
+
+/** Item record, followed by length bytes of zero terminated text value (for text properties).
+ */
+typedef struct {
+	uint32_t size;							///< record size including text value
+	uint32_t length;						///< text value length including terminating zero
+	double number;							///< number value
+	uint32_t sw;								///< switch value
+	uint32_t reserved;
+	char name[INDIGO_NAME_SIZE];		///< item name
+} indigo_config_item;
+
+/** Start new save session for config file, returns handle or 0 on failure. Handle is not file descriptor, session must be finished by indigo_config_commit() or indigo_config_close(), otherwise it is reclaimed only after a minute of inactivity.
+ */
+extern int indigo_config_begin(const char *path);
+
+/** Add property values to save session.
+ */
+extern indigo_result indigo_config_add(int handle, indigo_property *property);
+
+/** Close save session, file is written asynchronously after INDIGO_CONFIG_SAVE_DELAY (to temporary file, synced and renamed).
+ */
+extern indigo_result indigo_config_commit(int handle);
+
+/** Discard save session without writing the file.
+ */
+extern indigo_result indigo_config_close(int handle);
+
+/** Write pending config file immediately (all pending files if path is NULL).
+ */
+extern void indigo_config_flush(const char *path);
+
+/** Map config file and send its values as change requests on behalf of client, returns INDIGO_NOT_FOUND if file doesn't exist or is invalid.
+ */
+extern indigo_result indigo_config_load(const char *path, indigo_client *client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_config_store_h */
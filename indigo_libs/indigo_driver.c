@@ -34,6 +34,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <poll.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -66,6 +67,7 @@
 #include "indigo_xml.h"
 #include "indigo_names.h"
 #include "indigo_io.h"
+#include "indigo_config_store.h"
 
 indigo_result indigo_try_global_lock(indigo_device *device) {
 	if (indigo_is_sandboxed)
@@ -296,13 +298,10 @@ indigo_result indigo_device_change_property(indigo_device *device, indigo_client
 		} else if (indigo_switch_match(CONFIG_SAVE_ITEM, property)) {
 			indigo_save_property(device, NULL, SIMULATION_PROPERTY);
 			indigo_save_property(device, NULL, DEVICE_PORT_PROPERTY);
-			if (DEVICE_CONTEXT->property_save_file_handle) {
+			if (indigo_commit_properties(device, NULL) == INDIGO_OK)
 				CONFIG_PROPERTY->state = INDIGO_OK_STATE;
-				close(DEVICE_CONTEXT->property_save_file_handle);
-				DEVICE_CONTEXT->property_save_file_handle = 0;
-			} else {
+			else
 				CONFIG_PROPERTY->state = INDIGO_ALERT_STATE;
-			}
 			CONFIG_SAVE_ITEM->sw.value = false;
 		} else if (indigo_switch_match(CONFIG_DEFAULT_ITEM, property)) {
 			if (indigo_load_properties(device, true) == INDIGO_OK)
@@ -377,60 +376,84 @@ indigo_result indigo_device_detach(indigo_device *device) {
 extern int indigo_server_tcp_port;
 extern bool indigo_is_ephemeral_port;
 
-int indigo_open_config_file(char *device_name, int profile, int mode, const char *suffix) {
-	static char path[128];
-	int path_end = snprintf(path, sizeof(path), "%s/.indigo", getenv("HOME"));
-	int handle = mkdir(path, 0777);
-	if (handle == 0 || errno == EEXIST) {
-		if (indigo_server_tcp_port == 7624 || indigo_is_ephemeral_port) {
-			if (profile)
-				snprintf(path + path_end, sizeof(path) - path_end, "/%s#%d%s", device_name, profile, suffix);
-			else
-				snprintf(path + path_end, sizeof(path) - path_end, "/%s%s", device_name, suffix);
-		} else {
-			if (profile)
-				snprintf(path + path_end, sizeof(path) - path_end, "/%s#%d_%d%s", device_name, profile, indigo_server_tcp_port, suffix);
-			else
-				snprintf(path + path_end, sizeof(path) - path_end, "/%s_%d%s", device_name, indigo_server_tcp_port, suffix);
-		}
-		char *space = strchr(path, ' ');
-		while (space != NULL) {
-			*space = '_';
-			space = strchr(space+1, ' ');
-		}
-		handle = open(path, mode, 0644);
-		if (handle < 0)
-			INDIGO_DEBUG(indigo_debug("Can't %s %s (%s)", mode == O_RDONLY ? "open" : "create", path, strerror(errno)));
-	} else {
+static bool config_path(char *device_name, int profile, const char *suffix, char *path, int size) {
+	int path_end = snprintf(path, size, "%s/.indigo", getenv("HOME"));
+	if (mkdir(path, 0777) != 0 && errno != EEXIST) {
 		INDIGO_DEBUG(indigo_debug("Can't create %s (%s)", path, strerror(errno)));
+		return false;
+	}
+	if (indigo_server_tcp_port == 7624 || indigo_is_ephemeral_port) {
+		if (profile)
+			snprintf(path + path_end, size - path_end, "/%s#%d%s", device_name, profile, suffix);
+		else
+			snprintf(path + path_end, size - path_end, "/%s%s", device_name, suffix);
+	} else {
+		if (profile)
+			snprintf(path + path_end, size - path_end, "/%s#%d_%d%s", device_name, profile, indigo_server_tcp_port, suffix);
+		else
+			snprintf(path + path_end, size - path_end, "/%s_%d%s", device_name, indigo_server_tcp_port, suffix);
+	}
+	char *space = strchr(path, ' ');
+	while (space != NULL) {
+		*space = '_';
+		space = strchr(space+1, ' ');
+	}
+	return true;
+}
+
+static int config_profile(indigo_device *device) {
+	if (DEVICE_CONTEXT) {
+		for (int i = 0; i < PROFILE_COUNT; i++)
+			if (PROFILE_PROPERTY->items[i].sw.value)
+				return i;
 	}
+	return 0;
+}
+
+int indigo_open_config_file(char *device_name, int profile, int mode, const char *suffix) {
+	char path[PATH_MAX];
+	if (!config_path(device_name, profile, suffix, path, sizeof(path)))
+		return -1;
+	int handle = open(path, mode, 0644);
+	if (handle < 0)
+		INDIGO_DEBUG(indigo_debug("Can't %s %s (%s)", mode == O_RDONLY ? "open" : "create", path, strerror(errno)));
 	return handle;
 }
 
 indigo_result indigo_load_properties(indigo_device *device, bool default_properties) {
 	assert(device != NULL);
-	int profile = 0;
-	if (DEVICE_CONTEXT) {
-		for (int i = 0; i < PROFILE_COUNT; i++)
-			if (PROFILE_PROPERTY->items[i].sw.value) {
-				profile = i;
-				break;
-			}
+	const char *suffix = default_properties ? ".default" : ".config";
+	char path[PATH_MAX], binary_path[PATH_MAX + 8];
+	if (!config_path(device->name, config_profile(device), suffix, path, sizeof(path)))
+		return INDIGO_FAILED;
+	snprintf(binary_path, sizeof(binary_path), "%s%s", path, INDIGO_CONFIG_SUFFIX);
+	indigo_config_flush(binary_path);
+	/* binary config is used unless XML config is newer (legacy or edited by hand), it is replaced by binary one on next save */
+	struct stat xml_stat, binary_stat;
+	bool has_xml = stat(path, &xml_stat) == 0;
+	bool has_binary = stat(binary_path, &binary_stat) == 0;
+	indigo_client *client = malloc(sizeof(indigo_client));
+	memset(client, 0, sizeof(indigo_client));
+	client->version = INDIGO_VERSION_CURRENT;
+	indigo_result result = INDIGO_FAILED;
+	if (has_binary && (!has_xml || binary_stat.st_mtime >= xml_stat.st_mtime)) {
+		result = indigo_config_load(binary_path, client) == INDIGO_OK ? INDIGO_OK : INDIGO_FAILED;
 	}
-	int handle = indigo_open_config_file(device->name, profile, O_RDONLY, default_properties ? ".default" : ".config");
-	if (handle > 0) {
-		indigo_client *client = malloc(sizeof(indigo_client));
-		memset(client, 0, sizeof(indigo_client));
-		indigo_adapter_context *context = malloc(sizeof(indigo_adapter_context));
-		context->input = handle;
-		client->client_context = context;
-		client->version = INDIGO_VERSION_CURRENT;
-		indigo_xml_parse(NULL, client);
-		close(handle);
-		free(context);
-		free(client);
+	if (result != INDIGO_OK && has_xml) {
+		int handle = open(path, O_RDONLY);
+		if (handle >= 0) {
+			indigo_adapter_context *context = malloc(sizeof(indigo_adapter_context));
+			context->input = handle;
+			client->client_context = context;
+			indigo_xml_parse(NULL, client);
+			close(handle);
+			free(context);
+			result = INDIGO_OK;
+			INDIGO_DEBUG(indigo_debug("XML config %s loaded", path));
+		}
 	}
-	return handle > 0 ? INDIGO_OK : INDIGO_FAILED;
+	free(client);
+	return result;
 }
 
 indigo_result indigo_save_property(indigo_device*device, int *file_handle, indigo_property *property) {
@@ -441,50 +464,27 @@ indigo_result indigo_save_property(indigo_device*device, int *file_handle, indig
 			file_handle = &DEVICE_CONTEXT->property_save_file_handle;
 		int handle = *file_handle;
 		if (handle == 0) {
-			int profile = 0;
-			if (DEVICE_CONTEXT) {
-				for (int i = 0; i < PROFILE_COUNT; i++)
-					if (PROFILE_PROPERTY->items[i].sw.value) {
-						profile = i;
-						break;
-					}
-			}
-			*file_handle = handle = indigo_open_config_file(property->device, profile, O_WRONLY | O_CREAT | O_TRUNC, ".config");
+			char path[PATH_MAX];
+			if (config_path(property->device, config_profile(device), ".config" INDIGO_CONFIG_SUFFIX, path, sizeof(path)))
+				*file_handle = handle = indigo_config_begin(path);
 			if (handle == 0)
 				return INDIGO_FAILED;
 		}
-		switch (property->type) {
-		case INDIGO_TEXT_VECTOR:
-			indigo_printf(handle, "<newTextVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneText name='%s'>%s</oneText>\n", item->name, indigo_xml_escape(item->text.value));
-			}
-			indigo_printf(handle, "</newTextVector>\n");
-			break;
-		case INDIGO_NUMBER_VECTOR:
-			indigo_printf(handle, "<newNumberVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneNumber name='%s'>%g</oneNumber>\n", item->name, item->number.value);
-			}
-			indigo_printf(handle, "</newNumberVector>\n");
-			break;
-		case INDIGO_SWITCH_VECTOR:
-			indigo_printf(handle, "<newSwitchVector device='%s' name='%s'>\n", indigo_xml_escape(property->device), property->name, indigo_property_state_text[property->state]);
-			for (int i = 0; i < property->count; i++) {
-				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneSwitch name='%s'>%s</oneSwitch>\n", item->name, item->sw.value ? "On" : "Off");
-			}
-			indigo_printf(handle, "</newSwitchVector>\n");
-			break;
-		default:
-			break;
-		}
+		return indigo_config_add(handle, property);
 	}
 	return INDIGO_OK;
 }
 
+indigo_result indigo_commit_properties(indigo_device *device, int *file_handle) {
+	if (file_handle == NULL)
+		file_handle = &DEVICE_CONTEXT->property_save_file_handle;
+	if (*file_handle == 0)
+		return INDIGO_FAILED;
+	indigo_result result = indigo_config_commit(*file_handle);
+	*file_handle = 0;
+	return result;
+}
+
 static void *hotplug_thread(void *arg) {
 	while (true) {
 		libusb_handle_events(NULL);
@@ -492,19 +492,148 @@ static void *hotplug_thread(void *arg) {
 	return NULL;
 }
 
+static void start_usb_event_handler(void) {
+	libusb_init(NULL);
+	pthread_t hotplug_thread_handle;
+	pthread_create(&hotplug_thread_handle, NULL, hotplug_thread, NULL);
+}
+
 void indigo_start_usb_event_handler() {
-	static bool thread_started = false;
-	if (!thread_started) {
-		libusb_init(NULL);
-		pthread_t hotplug_thread_handle;
-		pthread_create(&hotplug_thread_handle, NULL, hotplug_thread, NULL);
-		thread_started = true;
+	/* drivers can be initialized in parallel */
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, start_usb_event_handler);
+}
+
+/* shared bounded thread pool, jobs with the same key are executed in order and never concurrently */
+
+#define ASYNC_MAX_THREADS		8
+#define ASYNC_IDLE_TIMEOUT	10		/* s */
+
+typedef struct async_job {
+	struct async_job *next;
+	void *(*fun)(void *data);
+	void *data;
+	const char *key;
+} async_job;
+
+static async_job *async_head = NULL;
+static async_job *async_tail = NULL;
+static const char *async_running_keys[ASYNC_MAX_THREADS];
+static int async_threads = 0;
+static int async_idle = 0;
+static pthread_mutex_t async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t async_done_cond = PTHREAD_COND_INITIALIZER;
+static __thread const char *async_current_key = NULL;
+
+static bool async_key_running(const char *key) {
+	for (int i = 0; i < ASYNC_MAX_THREADS; i++) {
+		if (async_running_keys[i] != NULL && !strcmp(async_running_keys[i], key))
+			return true;
+	}
+	return false;
+}
+
+static async_job *async_next_job(void) {
+	async_job *previous = NULL;
+	for (async_job *job = async_head; job != NULL; previous = job, job = job->next) {
+		if (job->key == NULL || !async_key_running(job->key)) {
+			if (previous == NULL)
+				async_head = job->next;
+			else
+				previous->next = job->next;
+			if (async_tail == job)
+				async_tail = previous;
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static void *async_worker(void *arg) {
+	pthread_mutex_lock(&async_mutex);
+	while (true) {
+		async_job *job = async_next_job();
+		if (job == NULL) {
+			struct timespec timeout;
+			clock_gettime(CLOCK_REALTIME, &timeout);
+			timeout.tv_sec += ASYNC_IDLE_TIMEOUT;
+			async_idle++;
+			int result = pthread_cond_timedwait(&async_cond, &async_mutex, &timeout);
+			async_idle--;
+			if (result == ETIMEDOUT && async_head == NULL)
+				break;
+			continue;
+		}
+		int slot = -1;
+		if (job->key != NULL) {
+			for (slot = 0; async_running_keys[slot] != NULL; slot++)
+				;
+			async_running_keys[slot] = job->key;
+		}
+		pthread_mutex_unlock(&async_mutex);
+		async_current_key = job->key;
+		job->fun(job->data);
+		async_current_key = NULL;
+		pthread_mutex_lock(&async_mutex);
+		if (slot >= 0) {
+			async_running_keys[slot] = NULL;
+			/* jobs waiting for this key can be picked up by idle workers */
+			pthread_cond_broadcast(&async_cond);
+		}
+		pthread_cond_broadcast(&async_done_cond);
+		free(job);
 	}
+	async_threads--;
+	pthread_mutex_unlock(&async_mutex);
+	return NULL;
+}
+
+void indigo_async_serial(void *fun(void *data), void *data, const char *key) {
+	async_job *job = malloc(sizeof(async_job));
+	assert(job != NULL);
+	job->next = NULL;
+	job->fun = fun;
+	job->data = data;
+	job->key = key;
+	pthread_mutex_lock(&async_mutex);
+	if (async_tail != NULL)
+		async_tail->next = job;
+	else
+		async_head = job;
+	async_tail = job;
+	if (async_idle == 0 && async_threads < ASYNC_MAX_THREADS) {
+		pthread_t thread;
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		if (pthread_create(&thread, &attr, async_worker, NULL) == 0)
+			async_threads++;
+		else
+			INDIGO_ERROR(indigo_error("Can't create async worker thread (%s)", strerror(errno)));
+		pthread_attr_destroy(&attr);
+	}
+	pthread_cond_signal(&async_cond);
+	pthread_mutex_unlock(&async_mutex);
 }
 
 void indigo_async(void *fun(void *data), void *data) {
-	pthread_t async_thread;
-	pthread_create(&async_thread, NULL, fun, data);
+	indigo_async_serial(fun, data, NULL);
+}
+
+void indigo_async_wait(const char *key) {
+	if (async_current_key != NULL && !strcmp(key, async_current_key))
+		return;
+	pthread_mutex_lock(&async_mutex);
+	while (true) {
+		bool pending = async_key_running(key);
+		for (async_job *job = async_head; !pending && job != NULL; job = job->next)
+			pending = job->key != NULL && !strcmp(job->key, key);
+		if (!pending)
+			break;
+		pthread_cond_wait(&async_done_cond, &async_mutex);
+	}
+	pthread_mutex_unlock(&async_mutex);
 }
 
 double indigo_stod(char *string) {
@@ -219,10 +219,10 @@ typedef struct {
 /** log macros
 */
 
-#define INDIGO_DRIVER_LOG(driver_name, fmt, ...) INDIGO_LOG(indigo_log("%s: " fmt, driver_name, ##__VA_ARGS__))
+#define INDIGO_DRIVER_LOG(driver_name, fmt, ...) INDIGO_LOG(INDIGO_LOG_ENABLED(INDIGO_LOG_DRIVER, INDIGO_LOG_INFO) ? indigo_log("%s: " fmt, driver_name, ##__VA_ARGS__) : (void)0)
 #define INDIGO_DRIVER_ERROR(driver_name, fmt, ...) INDIGO_ERROR(indigo_error("%s[%d]: " fmt, driver_name, __LINE__, ##__VA_ARGS__))
-#define INDIGO_DRIVER_DEBUG(driver_name, fmt, ...) INDIGO_DEBUG_DRIVER(indigo_debug("%s[%d, %s]: " fmt, driver_name, __LINE__, __FUNCTION__, ##__VA_ARGS__))
-#define INDIGO_DRIVER_TRACE(driver_name, fmt, ...) INDIGO_TRACE_DRIVER(indigo_trace("%s[%d, %s]: " fmt, driver_name, __LINE__, __FUNCTION__, ##__VA_ARGS__))
+#define INDIGO_DRIVER_DEBUG(driver_name, fmt, ...) INDIGO_DEBUG_DRIVER(INDIGO_LOG_ENABLED(INDIGO_LOG_DRIVER, INDIGO_LOG_DEBUG) ? indigo_debug("%s[%d, %s]: " fmt, driver_name, __LINE__, __FUNCTION__, ##__VA_ARGS__) : (void)0)
+#define INDIGO_DRIVER_TRACE(driver_name, fmt, ...) INDIGO_TRACE_DRIVER(INDIGO_LOG_ENABLED(INDIGO_LOG_DRIVER, INDIGO_LOG_TRACE) ? indigo_trace("%s[%d, %s]: " fmt, driver_name, __LINE__, __FUNCTION__, ##__VA_ARGS__) : (void)0)
 
 #define INDIGO_DEVICE_ATTACH_LOG(driver_name, device_name) INDIGO_DRIVER_LOG(driver_name, "'%s' attached", device_name)
 #define INDIGO_DEVICE_DETACH_LOG(driver_name, device_name) INDIGO_DRIVER_LOG(driver_name, "'%s' detached", device_name)
@@ -283,14 +283,26 @@ extern indigo_result indigo_load_properties(indigo_device *device, bool default_
  */
 extern indigo_result indigo_save_property(indigo_device*device, int *file_handle, indigo_property *property);
 
+/** Finish save started by indigo_save_property() (file_handle NULL means device context handle), config file is written in background.
+ */
+extern indigo_result indigo_commit_properties(indigo_device *device, int *file_handle);
+
 /** Start USB event handler thread.
  */
 extern void indigo_start_usb_event_handler(void);
 
-/** Asynchronous execution in thread.
+/** Asynchronous execution on shared worker thread pool.
  */
 extern void indigo_async(void *fun(void *data), void *data);
 
+/** Asynchronous execution on shared worker thread pool, functions with the same key (e.g. driver name) are executed in order and never concurrently.
+ */
+extern void indigo_async_serial(void *fun(void *data), void *data, const char *key);
+
+/** Wait until all functions queued with the key are finished (returns immediately if called from function with the same key).
+ */
+extern void indigo_async_wait(const char *key);
+
 /** Convert sexagesimal string to double.
  */
 extern double indigo_stod(char *string);
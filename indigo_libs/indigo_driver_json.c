@@ -23,6 +23,8 @@
  \file indigo_driver_json.c
  */
 
+#define INDIGO_LOG_SUBSYSTEM INDIGO_LOG_PROTOCOL
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -32,11 +34,13 @@
 #include <pthread.h>
 #include <assert.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include <arpa/inet.h>
 
 
 #include "indigo_json.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
 
 //#undef INDIGO_TRACE_PROTOCOL
 //#define INDIGO_TRACE_PROTOCOL(c) c
@@ -92,7 +96,12 @@ static indigo_result json_define_property(indigo_client *client, struct indigo_d
 	pthread_mutex_lock(&json_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
+	indigo_element_begin(client_context);
 	int handle = client_context->output;
+	if (client_context->delta_updates && client->version >= INDIGO_VERSION_2_0 && property->type != INDIGO_BLOB_VECTOR) {
+		bool dirty[property->count];
+		indigo_property_dirty_items(&client_context->tracker, property, dirty);
+	}
 	char output_buffer[JSON_BUFFER_SIZE];
 	char *pnt = output_buffer;
 	int size;
@@ -195,7 +204,8 @@ static indigo_result json_define_property(indigo_client *client, struct indigo_d
 		ws_write(handle, output_buffer, size);
 	else
 		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
+	INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d ← %s\n", handle, output_buffer));
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&json_mutex);
 	return INDIGO_OK;
 }
@@ -211,10 +221,17 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 	pthread_mutex_lock(&json_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
+	indigo_element_begin(client_context);
 	int handle = client_context->output;
 	char output_buffer[JSON_BUFFER_SIZE];
 	char *pnt = output_buffer;
 	int size;
+	/* changed items only, see indigo_property_dirty_items() */
+	bool delta = client_context->delta_updates && client->version >= INDIGO_VERSION_2_0 && property->type != INDIGO_BLOB_VECTOR;
+	bool dirty[property->count];
+	int sent = 0;
+	if (delta)
+		indigo_property_dirty_items(&client_context->tracker, property, dirty);
 	switch (property->type) {
 		case INDIGO_TEXT_VECTOR:
 			size = sprintf(pnt, "{ \"setTextVector\": { \"device\": \"%s\", \"name\": \"%s\", \"state\": \"%s\"", property->device, property->name, indigo_property_state_text[property->state]);
@@ -227,8 +244,10 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 				pnt += size;
 			}
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i])
+					continue;
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"%s\" }",  i > 0 ? "," : "", item->name, item->text.value);
+				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"%s\" }",  sent++ > 0 ? "," : "", item->name, item->text.value);
 				pnt += size;
 			}
 			size = sprintf(pnt, " ] } }");
@@ -245,11 +264,13 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 				pnt += size;
 			}
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i])
+					continue;
 				indigo_item *item = &property->items[i];
 				if (property->perm != INDIGO_RO_PERM)
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"target\": %g, \"value\": %g }",  i > 0 ? "," : "", item->name, item->number.target, item->number.value);
+					size = sprintf(pnt, "%s { \"name\": \"%s\", \"target\": %g, \"value\": %g }",  sent++ > 0 ? "," : "", item->name, item->number.target, item->number.value);
 				else
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": %g }",  i > 0 ? "," : "", item->name, item->number.value);
+					size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": %g }",  sent++ > 0 ? "," : "", item->name, item->number.value);
 				pnt += size;
 			}
 			size = sprintf(pnt, " ] } }");
@@ -266,8 +287,10 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 				pnt += size;
 			}
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i] && !property->items[i].sw.value)
+					continue;
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": %s }",  i > 0 ? "," : "", item->name, item->sw.value ? "true" : "false");
+				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": %s }",  sent++ > 0 ? "," : "", item->name, item->sw.value ? "true" : "false");
 				pnt += size;
 			}
 			size = sprintf(pnt, " ] } }");
@@ -284,8 +307,10 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 				pnt += size;
 			}
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i])
+					continue;
 				indigo_item *item = &property->items[i];
-				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"%s\" }",  i > 0 ? "," : "", item->name, indigo_property_state_text[item->light.value]);
+				size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"%s\" }",  sent++ > 0 ? "," : "", item->name, indigo_property_state_text[item->light.value]);
 				pnt += size;
 			}
 			size = sprintf(pnt, " ] } }");
@@ -304,9 +329,9 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 			for (int i = 0; i < property->count; i++) {
 				indigo_item *item = &property->items[i];
 				if (property->state == INDIGO_OK_STATE)
-					size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"/blob/%p%s\" }", i > 0 ? "," : "", item->name, item, item->blob.format);
+					size = sprintf(pnt, "%s { \"name\": \"%s\", \"value\": \"/blob/%p%s\" }", sent++ > 0 ? "," : "", item->name, item, item->blob.format);
 				else
-					size = sprintf(pnt, "%s { \"name\": \"%s\" }", i > 0 ? "," : "", item->name);
+					size = sprintf(pnt, "%s { \"name\": \"%s\" }", sent++ > 0 ? "," : "", item->name);
 				pnt += size;
 			}
 			size = sprintf(pnt, " ] } }");
@@ -317,7 +342,8 @@ static indigo_result json_update_property(indigo_client *client, struct indigo_d
 		ws_write(handle, output_buffer, size);
 	else
 		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
+	INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d ← %s\n", handle, output_buffer));
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&json_mutex);
 	return INDIGO_OK;
 }
@@ -333,7 +359,9 @@ static indigo_result json_delete_property(indigo_client *client, struct indigo_d
 	pthread_mutex_lock(&json_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
+	indigo_element_begin(client_context);
 	int handle = client_context->output;
+	indigo_forget_property_items(&client_context->tracker, property);
 	char output_buffer[JSON_BUFFER_SIZE];
 	char *pnt = output_buffer;
 	int size;
@@ -352,7 +380,8 @@ static indigo_result json_delete_property(indigo_client *client, struct indigo_d
 		ws_write(handle, output_buffer, size);
 	else
 		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
+	INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d ← %s\n", handle, output_buffer));
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&json_mutex);
 	return INDIGO_OK;
 }
@@ -365,6 +394,7 @@ static indigo_result json_message_property(indigo_client *client, struct indigo_
 	pthread_mutex_lock(&json_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
+	indigo_element_begin(client_context);
 	int handle = client_context->output;
 	char output_buffer[JSON_BUFFER_SIZE];
 	char *pnt = output_buffer;
@@ -373,7 +403,8 @@ static indigo_result json_message_property(indigo_client *client, struct indigo_
 		ws_write(handle, output_buffer, size);
 	else
 		indigo_write(handle, output_buffer, size);
-	INDIGO_TRACE_PROTOCOL(indigo_trace("%d ← %s\n", handle, output_buffer));
+	INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d ← %s\n", handle, output_buffer));
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&json_mutex);
 	return INDIGO_OK;
 }
@@ -386,6 +417,10 @@ static indigo_result json_detach(indigo_client *client) {
 	return INDIGO_OK;
 }
 
+static double bytes_written_metric(void *data) {
+	return indigo_bytes_written(((indigo_adapter_context *)data)->output);
+}
+
 indigo_client *indigo_json_device_adapter(int input, int ouput, bool web_socket) {
 	static indigo_client client_template = {
 		"", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
@@ -405,6 +440,18 @@ indigo_client *indigo_json_device_adapter(int input, int ouput, bool web_socket)
 	client_context->input = input;
 	client_context->output = ouput;
 	client_context->web_socket = web_socket;
+	client_context->tracker = NULL;
+	client_context->delta_updates = false;
+	client_context->metric = NULL;
+	client_context->blob_ring = NULL;
+	client_context->output_queue = NULL;
+	client_context->pending_elements = NULL;
+	if (input == ouput) {
+		char label[INDIGO_NAME_SIZE];
+		snprintf(label, INDIGO_NAME_SIZE, "JSON #%d", ouput);
+		indigo_reset_bytes_written(ouput);
+		client_context->metric = indigo_register_metric_provider(INDIGO_METRIC_COUNTER, "indigo_client_sent_bytes_total", "Bytes sent to client", "client", label, bytes_written_metric, client_context);
+	}
 	client->client_context = client_context;
 	client->is_remote = input == ouput;
 	indigo_enable_blob_mode_record *record = malloc(sizeof(indigo_enable_blob_mode_record));
@@ -423,6 +470,8 @@ void indigo_release_json_device_adapter(indigo_client *client) {
 		record = record->next;
 		free(tmp);
 	}
+	indigo_release_property_tracker(&((indigo_adapter_context *)client->client_context)->tracker);
+	indigo_release_metric(((indigo_adapter_context *)client->client_context)->metric);
 	free(client->client_context);
 	free(client);
 }
@@ -36,6 +36,8 @@
  \file indigo_driver_xml.c
  */
 
+#define INDIGO_LOG_SUBSYSTEM INDIGO_LOG_PROTOCOL
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -43,19 +45,89 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <assert.h>
+#include <sys/socket.h>
 
 #include "indigo_xml.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
+#include "indigo_recorder.h"
 #include "indigo_base64.h"
+#include "indigo_blob_ring.h"
 #include "indigo_version.h"
 #include "indigo_driver_xml.h"
 
 #define RAW_BUF_SIZE 98304
 #define BASE64_BUF_SIZE 131072  /* BASE64_BUF_SIZE >= (RAW_BUF_SIZE + 2) / 3 * 4 */
 
+#define BLOB_QUEUE_SIZE		4		/* max frames waiting for delivery to one client with INDIGO_BLOB_DELIVERY_ALL policy */
+#define FRAME_COUNTERS		16	/* max BLOB properties with INDIGO_BLOB_DELIVERY_NTH policy per client */
+#define TEXT_QUEUE_LIMIT	(4 * 1024 * 1024)	/* max bytes of text waiting behind BLOB for one client, client is disconnected when exceeded */
+
+indigo_blob_delivery_policy indigo_blob_delivery = INDIGO_BLOB_DELIVERY_ALL;
+int indigo_blob_delivery_nth = 1;
+
+/* write_mutex guards static buffers used for formatting and keeps elements written by different threads in one piece,
+   BLOB payload for remote clients is written by per client writer thread out of it */
+
 static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* BLOB vector snapshot, one copy is shared by queues of all clients getting the same update */
+
+typedef struct {
+	int references;											/* guarded by frame_mutex */
+	unsigned long serial;								/* indigo_update_serial of update it was taken for */
+	indigo_property *source;
+	indigo_property *property;					/* copy with own BLOB data */
+} shared_frame;
+
+static shared_frame *last_frame = NULL;
+static pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct output_entry {
+	struct output_entry *next;
+	char *text;													/* text or opening tag of BLOB vector */
+	long length;
+	long size;
+	shared_frame *frame;								/* BLOB vector snapshot, NULL for text entry */
+	char **prologues;										/* opening tags of BLOB items */
+} output_entry;
+
+typedef struct {
+	atomic_int references;							/* adapter and producers waiting for space */
+	indigo_client *client;
+	int handle;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_cond_t space_cond;
+	output_entry *head;
+	output_entry *tail;
+	int frames;
+	long text_length;
+	bool busy;
+	bool stop;
+	bool overflow;
+	struct {
+		char device[INDIGO_NAME_SIZE];
+		char name[INDIGO_NAME_SIZE];
+		unsigned count;
+		unsigned long used;
+	} counters[FRAME_COUNTERS];
+	unsigned long counters_clock;
+	indigo_metric *dropped_metric;
+	indigo_metric *delivered_metric;
+	indigo_metric *text_dropped_metric;
+} output_queue;
+
+static indigo_metric *base64_metric = NULL;
+static pthread_once_t metrics_once = PTHREAD_ONCE_INIT;
+
+static void register_metrics(void) {
+	base64_metric = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_base64_seconds", "Time spent in base64 encoding or decoding of BLOB", "operation", "encode");
+}
+
 static const char *message_attribute(const char *message) {
 	if (message) {
 		static char buffer[INDIGO_VALUE_SIZE];
@@ -65,6 +137,404 @@ static const char *message_attribute(const char *message) {
 	return "";
 }
 
+/* called with write_mutex locked, snapshot of the same update is reused */
+
+static shared_frame *acquire_frame(indigo_property *property) {
+	pthread_mutex_lock(&frame_mutex);
+	shared_frame *frame = last_frame;
+	if (frame != NULL && indigo_update_serial != 0 && frame->serial == indigo_update_serial && frame->source == property) {
+		frame->references++;
+		pthread_mutex_unlock(&frame_mutex);
+		return frame;
+	}
+	pthread_mutex_unlock(&frame_mutex);
+	frame = malloc(sizeof(shared_frame));
+	assert(frame != NULL);
+	frame->references = 1;
+	frame->serial = indigo_update_serial;
+	frame->source = property;
+	frame->property = malloc(sizeof(indigo_property) + property->count * sizeof(indigo_item));
+	assert(frame->property != NULL);
+	memcpy(frame->property, property, sizeof(indigo_property) + property->count * sizeof(indigo_item));
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = frame->property->items + i;
+		if (item->blob.value != NULL && item->blob.size > 0) {
+			item->blob.value = malloc(item->blob.size);
+			assert(item->blob.value != NULL);
+			memcpy(item->blob.value, property->items[i].blob.value, item->blob.size);
+		} else {
+			item->blob.value = NULL;
+			item->blob.size = 0;
+		}
+	}
+	pthread_mutex_lock(&frame_mutex);
+	last_frame = frame;
+	pthread_mutex_unlock(&frame_mutex);
+	return frame;
+}
+
+static void release_frame(shared_frame *frame) {
+	pthread_mutex_lock(&frame_mutex);
+	if (--frame->references > 0) {
+		pthread_mutex_unlock(&frame_mutex);
+		return;
+	}
+	if (last_frame == frame)
+		last_frame = NULL;
+	pthread_mutex_unlock(&frame_mutex);
+	for (int i = 0; i < frame->property->count; i++)
+		free(frame->property->items[i].blob.value);
+	free(frame->property);
+	free(frame);
+}
+
+static void release_entry(output_entry *entry) {
+	if (entry->frame != NULL) {
+		for (int i = 0; i < entry->frame->property->count; i++)
+			free(entry->prologues[i]);
+		free(entry->prologues);
+		release_frame(entry->frame);
+	}
+	free(entry->text);
+	free(entry);
+}
+
+static bool write_data(int handle, const char *data, long length) {
+	/* BLOB payload is not recorded, indigo_record_blob_reference() is used instead */
+	while (length > 0) {
+		long written = write(handle, data, length);
+		if (written <= 0)
+			return false;
+		indigo_count_bytes_written(handle, written);
+		data += written;
+		length -= written;
+	}
+	return true;
+}
+
+static bool write_blob_data(int handle, indigo_version version, unsigned char *data, long input_length) {
+	double start, encode_time = 0;
+	bool result = true;
+	if (version >= INDIGO_VERSION_2_0) {
+		char *encoded_data = malloc(BASE64_BUF_SIZE + 1);
+		while (result && input_length) {
+			long len = (RAW_BUF_SIZE < input_length) ?  RAW_BUF_SIZE : input_length;
+			start = indigo_metric_time();
+			long enclen = base64_encode((unsigned char*)encoded_data, (unsigned char*)data, len);
+			encode_time += indigo_metric_time() - start;
+			result = write_data(handle, encoded_data, enclen);
+			input_length -= len;
+			data += len;
+		}
+		free(encoded_data);
+	} else {
+		/* 54 raw = 72 encoded + new line, lines are collected to buffer of RAW_BUF_SIZE raw bytes */
+		char *encoded_data = malloc(RAW_BUF_SIZE / 54 * 73 + 73);
+		while (result && input_length) {
+			long enclen = 0;
+			start = indigo_metric_time();
+			for (int i = 0; i < RAW_BUF_SIZE / 54 && input_length; i++) {
+				long len = (54 < input_length) ?  54 : input_length;
+				enclen += base64_encode((unsigned char*)encoded_data + enclen, (unsigned char*)data, len);
+				encoded_data[enclen++] = '\n';
+				input_length -= len;
+				data += len;
+			}
+			encode_time += indigo_metric_time() - start;
+			result = write_data(handle, encoded_data, enclen);
+		}
+		free(encoded_data);
+	}
+	indigo_metric_observe(base64_metric, encode_time);
+	return result;
+}
+
+static void *output_writer(output_queue *queue) {
+	pthread_mutex_lock(&queue->mutex);
+	while (true) {
+		while (queue->head == NULL && !queue->stop)
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+		if (queue->head == NULL)
+			break;
+		output_entry *entry = queue->head;
+		if ((queue->head = entry->next) == NULL)
+			queue->tail = NULL;
+		if (entry->frame != NULL) {
+			queue->frames--;
+			pthread_cond_broadcast(&queue->space_cond);
+		} else {
+			queue->text_length -= entry->length;
+		}
+		queue->busy = true;
+		pthread_mutex_unlock(&queue->mutex);
+		if (!queue->stop) {
+			indigo_element_begin(queue->client->client_context);
+			if (entry->frame == NULL) {
+				indigo_write(queue->handle, entry->text, entry->length);
+			} else {
+				indigo_property *frame = entry->frame->property;
+				bool result = indigo_write(queue->handle, entry->text, entry->length);
+				for (int i = 0; result && i < frame->count; i++) {
+					indigo_item *item = frame->items + i;
+					result = indigo_write(queue->handle, entry->prologues[i], strlen(entry->prologues[i]));
+					indigo_record_blob_reference(queue->handle, item);
+					result = result && write_blob_data(queue->handle, queue->client->version, item->blob.value, item->blob.size);
+					result = result && indigo_write(queue->handle, "</oneBLOB>\n", 11);
+				}
+				if (result && indigo_write(queue->handle, "</setBLOBVector>\n", 17))
+					indigo_metric_add(queue->delivered_metric, 1);
+			}
+			indigo_element_end(queue->client->client_context);
+		}
+		release_entry(entry);
+		pthread_mutex_lock(&queue->mutex);
+		queue->busy = false;
+	}
+	pthread_mutex_unlock(&queue->mutex);
+	return NULL;
+}
+
+static output_queue *output_queue_start(indigo_client *client, int handle) {
+	output_queue *queue = calloc(1, sizeof(output_queue));
+	assert(queue != NULL);
+	atomic_init(&queue->references, 1);
+	queue->client = client;
+	queue->handle = handle;
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->cond, NULL);
+	pthread_cond_init(&queue->space_cond, NULL);
+	char label[INDIGO_NAME_SIZE];
+	snprintf(label, INDIGO_NAME_SIZE, "XML #%d", handle);
+	queue->dropped_metric = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_blob_dropped_total", "BLOB updates skipped because client can't keep up", "client", label);
+	queue->delivered_metric = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_blob_delivered_total", "BLOB updates delivered to client", "client", label);
+	queue->text_dropped_metric = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_text_dropped_total", "Protocol messages dropped because client output queue is full", "client", label);
+	if (pthread_create(&queue->thread, NULL, (void * (*)(void*))output_writer, queue)) {
+		indigo_error("Can't create BLOB writer thread, BLOBs are written synchronously");
+		indigo_release_metric(queue->dropped_metric);
+		indigo_release_metric(queue->delivered_metric);
+		indigo_release_metric(queue->text_dropped_metric);
+		free(queue);
+		return NULL;
+	}
+	return queue;
+}
+
+static void output_queue_release(output_queue *queue) {
+	if (atomic_fetch_sub(&queue->references, 1) > 1)
+		return;
+	pthread_cond_destroy(&queue->space_cond);
+	pthread_cond_destroy(&queue->cond);
+	pthread_mutex_destroy(&queue->mutex);
+	free(queue);
+}
+
+static void output_queue_stop(output_queue *queue) {
+	if (queue == NULL)
+		return;
+	/* stop is set under write_mutex, producer holding it and seeing stop == false can still use client context */
+	pthread_mutex_lock(&write_mutex);
+	pthread_mutex_lock(&queue->mutex);
+	queue->stop = true;
+	pthread_cond_broadcast(&queue->cond);
+	pthread_cond_broadcast(&queue->space_cond);
+	pthread_mutex_unlock(&queue->mutex);
+	pthread_mutex_unlock(&write_mutex);
+	/* client is gone, unblock writer stuck in write() */
+	shutdown(queue->handle, SHUT_WR);
+	pthread_join(queue->thread, NULL);
+	while (queue->head != NULL) {
+		output_entry *entry = queue->head;
+		queue->head = entry->next;
+		release_entry(entry);
+	}
+	indigo_release_metric(queue->dropped_metric);
+	indigo_release_metric(queue->delivered_metric);
+	indigo_release_metric(queue->text_dropped_metric);
+	output_queue_release(queue);
+}
+
+/* called before write_mutex is locked, producer of INDIGO_BLOB_DELIVERY_ALL frames doesn't block other clients while waiting,
+   returns false if client is being released, otherwise queue reference is kept until stop flag is checked under write_mutex */
+
+static bool output_queue_wait(output_queue *queue) {
+	pthread_mutex_lock(&queue->mutex);
+	atomic_fetch_add(&queue->references, 1);
+	while (queue->frames >= BLOB_QUEUE_SIZE && !queue->stop)
+		pthread_cond_wait(&queue->space_cond, &queue->mutex);
+	bool stop = queue->stop;
+	pthread_mutex_unlock(&queue->mutex);
+	if (stop) {
+		output_queue_release(queue);
+		return false;
+	}
+	return true;
+}
+
+static void forget_counters(output_queue *queue, indigo_property *property) {
+	pthread_mutex_lock(&queue->mutex);
+	for (int i = 0; i < FRAME_COUNTERS; i++) {
+		if (!strcmp(queue->counters[i].device, property->device) && (*property->name == 0 || !strcmp(queue->counters[i].name, property->name))) {
+			*queue->counters[i].device = *queue->counters[i].name = 0;
+			queue->counters[i].used = 0;
+		}
+	}
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+static void output_queue_append(output_queue *queue, output_entry *entry) {
+	entry->next = NULL;
+	if (queue->tail != NULL)
+		queue->tail->next = entry;
+	else
+		queue->head = entry;
+	queue->tail = entry;
+	pthread_cond_signal(&queue->cond);
+}
+
+/* called with write_mutex locked, text is queued if writer is busy or queue is not empty to keep order of messages,
+   producer can't wait for space under write_mutex, so client with too much text queued is disconnected and further text is dropped */
+
+static bool adapter_printf(indigo_adapter_context *context, const char *format, ...) {
+	char buffer[1024];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(buffer, 1024, format, args);
+	va_end(args);
+	if (length >= 1024)
+		length = 1023;
+	output_queue *queue = context->output_queue;
+	if (queue != NULL) {
+		pthread_mutex_lock(&queue->mutex);
+		if (queue->head != NULL || queue->busy) {
+			if (!queue->overflow && queue->text_length + length > TEXT_QUEUE_LIMIT) {
+				indigo_error("Client %d can't keep up, %ld bytes waiting for delivery, disconnecting", context->output, queue->text_length);
+				queue->overflow = true;
+				/* reader gets EOF and releases client, writer stuck in write() is unblocked */
+				shutdown(queue->handle, SHUT_RDWR);
+			}
+			output_entry *entry = queue->tail;
+			if (!queue->overflow && (entry == NULL || entry->frame != NULL)) {
+				entry = calloc(1, sizeof(output_entry));
+				if (entry != NULL)
+					output_queue_append(queue, entry);
+			}
+			if (!queue->overflow && entry != NULL && entry->length + length > entry->size) {
+				long size = (entry->length + length) * 2;
+				char *text = realloc(entry->text, size);
+				if (text != NULL) {
+					entry->text = text;
+					entry->size = size;
+				} else {
+					entry = NULL;
+				}
+			}
+			if (queue->overflow || entry == NULL) {
+				indigo_metric_add(queue->text_dropped_metric, 1);
+				pthread_mutex_unlock(&queue->mutex);
+				return false;
+			}
+			INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d ← %s (queued)", context->output, buffer));
+			memcpy(entry->text + entry->length, buffer, length);
+			entry->length += length;
+			queue->text_length += length;
+			pthread_mutex_unlock(&queue->mutex);
+			return true;
+		}
+		pthread_mutex_unlock(&queue->mutex);
+	}
+	INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d ← %s", context->output, buffer));
+	return indigo_write(context->output, buffer, length);
+}
+
+static indigo_enable_blob_mode_record *blob_mode_record(indigo_client *client, indigo_property *property) {
+	for (indigo_enable_blob_mode_record *record = client->enable_blob_mode_records; record != NULL; record = record->next) {
+		if ((*record->device == 0 || !strcmp(property->device, record->device)) && (*record->name == 0 || !strcmp(property->name, record->name)))
+			return record;
+	}
+	return NULL;
+}
+
+static indigo_blob_delivery_policy blob_delivery_policy(indigo_enable_blob_mode_record *record, int *nth) {
+	if (record->policy != INDIGO_BLOB_DELIVERY_DEFAULT) {
+		*nth = record->nth;
+		return record->policy;
+	}
+	*nth = indigo_blob_delivery_nth;
+	return indigo_blob_delivery;
+}
+
+/* called with write_mutex locked, BLOB vector snapshot is delivered by writer thread according to policy,
+   producer of INDIGO_BLOB_DELIVERY_ALL frames already waited for space in output_queue_wait() */
+
+static void queue_blob(indigo_client *client, output_queue *queue, indigo_enable_blob_mode_record *record, indigo_property *property, const char *message) {
+	int nth;
+	indigo_blob_delivery_policy policy = blob_delivery_policy(record, &nth);
+	pthread_mutex_lock(&queue->mutex);
+	if (policy == INDIGO_BLOB_DELIVERY_NTH && nth > 1) {
+		/* counter of the same property or least recently used one */
+		int index = 0;
+		for (int i = 0; i < FRAME_COUNTERS; i++) {
+			if (!strcmp(queue->counters[i].device, property->device) && !strcmp(queue->counters[i].name, property->name)) {
+				index = i;
+				break;
+			}
+			if (queue->counters[i].used < queue->counters[index].used)
+				index = i;
+		}
+		if (strcmp(queue->counters[index].device, property->device) || strcmp(queue->counters[index].name, property->name)) {
+			strcpy(queue->counters[index].device, property->device);
+			strcpy(queue->counters[index].name, property->name);
+			queue->counters[index].count = 0;
+		}
+		queue->counters[index].used = ++queue->counters_clock;
+		if (queue->counters[index].count++ % nth) {
+			pthread_mutex_unlock(&queue->mutex);
+			indigo_metric_add(queue->dropped_metric, 1);
+			return;
+		}
+	}
+	if (policy != INDIGO_BLOB_DELIVERY_ALL) {
+		/* frame not yet picked by writer is stale */
+		output_entry *previous = NULL;
+		for (output_entry *entry = queue->head; entry != NULL;) {
+			if (entry->frame != NULL && !strcmp(entry->frame->property->device, property->device) && !strcmp(entry->frame->property->name, property->name)) {
+				output_entry *next = entry->next;
+				if (previous != NULL)
+					previous->next = next;
+				else
+					queue->head = next;
+				if (queue->tail == entry)
+					queue->tail = previous;
+				queue->frames--;
+				release_entry(entry);
+				indigo_metric_add(queue->dropped_metric, 1);
+				entry = next;
+			} else {
+				previous = entry;
+				entry = entry->next;
+			}
+		}
+	}
+	pthread_mutex_unlock(&queue->mutex);
+	output_entry *entry = calloc(1, sizeof(output_entry));
+	assert(entry != NULL);
+	entry->frame = acquire_frame(property);
+	entry->prologues = malloc(property->count * sizeof(char *));
+	char buffer[1024];
+	int length = snprintf(buffer, sizeof(buffer), "<setBLOBVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+	entry->text = strdup(buffer);
+	entry->length = length < sizeof(buffer) ? length : sizeof(buffer) - 1;
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = entry->frame->property->items + i;
+		snprintf(buffer, sizeof(buffer), "<oneBLOB name='%s' format='%s' size='%ld'>\n", indigo_item_name(client->version, property, property->items + i), item->blob.format, item->blob.size);
+		entry->prologues[i] = strdup(buffer);
+	}
+	pthread_mutex_lock(&queue->mutex);
+	queue->frames++;
+	output_queue_append(queue, entry);
+	pthread_mutex_unlock(&queue->mutex);
+}
+
 static indigo_result xml_device_adapter_define_property(indigo_client *client, struct indigo_device *device, indigo_property *property, const char *message) {
 	assert(device != NULL);
 	assert(client != NULL);
@@ -76,59 +546,62 @@ static indigo_result xml_device_adapter_define_property(indigo_client *client, s
 	pthread_mutex_lock(&write_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
-	int handle = client_context->output;
+	indigo_element_begin(client_context);
+	if (client_context->delta_updates && client->version >= INDIGO_VERSION_2_0 && property->type != INDIGO_BLOB_VECTOR) {
+		bool dirty[property->count];
+		indigo_property_dirty_items(&client_context->tracker, property, dirty);
+	}
 	switch (property->type) {
 	case INDIGO_TEXT_VECTOR:
-		indigo_printf(handle, "<defTextVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		adapter_printf(client_context, "<defTextVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, "<defText name='%s' label='%s'>%s</defText>\n", indigo_item_name(client->version, property, item), item->label, item->text.value);
+			adapter_printf(client_context, "<defText name='%s' label='%s'>%s</defText>\n", indigo_item_name(client->version, property, item), item->label, item->text.value);
 		}
-		indigo_printf(handle, "</defTextVector>\n");
+		adapter_printf(client_context, "</defTextVector>\n");
 		break;
 	case INDIGO_NUMBER_VECTOR:
-		indigo_printf(handle, "<defNumberVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		adapter_printf(client_context, "<defNumberVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
 			if (client->version >= INDIGO_VERSION_2_0 && property->perm != INDIGO_RO_PERM)
-				indigo_printf(handle, "<defNumber name='%s' label='%s' format='%s' min='%g' max='%g' step='%g' target='%g'>%g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.target, item->number.value);
+				adapter_printf(client_context, "<defNumber name='%s' label='%s' format='%s' min='%g' max='%g' step='%g' target='%g'>%g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.target, item->number.value);
 			else
-				indigo_printf(handle, "<defNumber name='%s' label='%s' format='%s' min='%g' max='%g' step='%g'>%g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.value);
+				adapter_printf(client_context, "<defNumber name='%s' label='%s' format='%s' min='%g' max='%g' step='%g'>%g</defNumber>\n", indigo_item_name(client->version, property, item), item->label, item->number.format, item->number.min, item->number.max, item->number.step, item->number.value);
 		}
-		indigo_printf(handle, "</defNumberVector>\n");
+		adapter_printf(client_context, "</defNumberVector>\n");
 		break;
 	case INDIGO_SWITCH_VECTOR:
-		indigo_printf(handle, "<defSwitchVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s' rule='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], indigo_switch_rule_text[property->rule], message_attribute(message));
+		adapter_printf(client_context, "<defSwitchVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s' rule='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], indigo_switch_rule_text[property->rule], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, "<defSwitch name='%s' label='%s'>%s</defSwitch>\n", indigo_item_name(client->version, property, item), item->label, item->sw.value ? "On" : "Off");
+			adapter_printf(client_context, "<defSwitch name='%s' label='%s'>%s</defSwitch>\n", indigo_item_name(client->version, property, item), item->label, item->sw.value ? "On" : "Off");
 		}
-		indigo_printf(handle, "</defSwitchVector>\n");
+		adapter_printf(client_context, "</defSwitchVector>\n");
 		break;
 	case INDIGO_LIGHT_VECTOR:
-		indigo_printf(handle, "<defLightVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		adapter_printf(client_context, "<defLightVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, " <defLight name='%s' label='%s'>%s</defLight>\n", indigo_item_name(client->version, property, item), item->label, indigo_property_state_text[item->light.value]);
+			adapter_printf(client_context, " <defLight name='%s' label='%s'>%s</defLight>\n", indigo_item_name(client->version, property, item), item->label, indigo_property_state_text[item->light.value]);
 		}
-		indigo_printf(handle, "</defLightVector>\n");
+		adapter_printf(client_context, "</defLightVector>\n");
 		break;
 	case INDIGO_BLOB_VECTOR:
-		indigo_printf(handle, "<defBLOBVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
+		adapter_printf(client_context, "<defBLOBVector device='%s' name='%s' group='%s' label='%s' perm='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_xml_escape(property->group), indigo_xml_escape(property->label), indigo_property_perm_text[property->perm], indigo_property_state_text[property->state], message_attribute(message));
 		for (int i = 0; i < property->count; i++) {
 			indigo_item *item = &property->items[i];
-			indigo_printf(handle, "<defBLOB name='%s' label='%s'/>\n", indigo_item_name(client->version, property, item), item->label);
+			adapter_printf(client_context, "<defBLOB name='%s' label='%s'/>\n", indigo_item_name(client->version, property, item), item->label);
 		}
-		indigo_printf(handle, "</defBLOBVector>\n");
+		adapter_printf(client_context, "</defBLOBVector>\n");
 		break;
 	}
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&write_mutex);
 	return INDIGO_OK;
 }
 
 static indigo_result xml_device_adapter_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
-	FILE* fh;
-	int handle2;
 	assert(device != NULL);
 	assert(client != NULL);
 	assert(property != NULL);
@@ -136,104 +609,116 @@ static indigo_result xml_device_adapter_update_property(indigo_client *client, i
 		return INDIGO_OK;
 	if (client->version == INDIGO_VERSION_NONE)
 		return INDIGO_OK;
+	output_queue *waited = NULL;
+	if (property->type == INDIGO_BLOB_VECTOR && property->state == INDIGO_OK_STATE) {
+		output_queue *queue = ((indigo_adapter_context *)client->client_context)->output_queue;
+		indigo_enable_blob_mode_record *record = blob_mode_record(client, property);
+		int nth;
+		if (queue != NULL && record != NULL && record->mode == INDIGO_ENABLE_BLOB_ALSO && blob_delivery_policy(record, &nth) == INDIGO_BLOB_DELIVERY_ALL) {
+			if (!output_queue_wait(queue))
+				return INDIGO_OK;
+			waited = queue;
+		}
+	}
 	pthread_mutex_lock(&write_mutex);
+	if (waited != NULL) {
+		/* client released while waiting, its context is gone and frame is dropped */
+		bool stop = waited->stop;
+		output_queue_release(waited);
+		if (stop) {
+			pthread_mutex_unlock(&write_mutex);
+			return INDIGO_OK;
+		}
+	}
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
+	indigo_element_begin(client_context);
 	int handle = client_context->output;
+	/* INDIGO 2.x clients get changed items only */
+	bool delta = client_context->delta_updates && client->version >= INDIGO_VERSION_2_0 && property->type != INDIGO_BLOB_VECTOR;
+	bool dirty[property->count];
+	if (delta)
+		indigo_property_dirty_items(&client_context->tracker, property, dirty);
 	switch (property->type) {
 		case INDIGO_TEXT_VECTOR:
-			indigo_printf(handle, "<setTextVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			adapter_printf(client_context, "<setTextVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i])
+					continue;
 				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneText name='%s'>%s</oneText>\n", indigo_item_name(client->version, property, item), indigo_xml_escape(item->text.value));
+				adapter_printf(client_context, "<oneText name='%s'>%s</oneText>\n", indigo_item_name(client->version, property, item), indigo_xml_escape(item->text.value));
 			}
-			indigo_printf(handle, "</setTextVector>\n");
+			adapter_printf(client_context, "</setTextVector>\n");
 			break;
 		case INDIGO_NUMBER_VECTOR:
-			indigo_printf(handle, "<setNumberVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			adapter_printf(client_context, "<setNumberVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i])
+					continue;
 				indigo_item *item = &property->items[i];
 				if (client->version >= INDIGO_VERSION_2_0 && property->perm != INDIGO_RO_PERM)
-					indigo_printf(handle, "<oneNumber name='%s' target='%g'>%g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.target, item->number.value);
+					adapter_printf(client_context, "<oneNumber name='%s' target='%g'>%g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.target, item->number.value);
 				else
-					indigo_printf(handle, "<oneNumber name='%s'>%g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.value);
+					adapter_printf(client_context, "<oneNumber name='%s'>%g</oneNumber>\n", indigo_item_name(client->version, property, item), item->number.value);
 			}
-			indigo_printf(handle, "</setNumberVector>\n");
+			adapter_printf(client_context, "</setNumberVector>\n");
 			break;
 		case INDIGO_SWITCH_VECTOR:
-			indigo_printf(handle, "<setSwitchVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			adapter_printf(client_context, "<setSwitchVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
+				/* switches which are on are always sent, receiver resets one-of-many and at-most-one vectors */
+				if (delta && !dirty[i] && !property->items[i].sw.value)
+					continue;
 				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneSwitch name='%s'>%s</oneSwitch>\n", indigo_item_name(client->version, property, item), item->sw.value ? "On" : "Off");
+				adapter_printf(client_context, "<oneSwitch name='%s'>%s</oneSwitch>\n", indigo_item_name(client->version, property, item), item->sw.value ? "On" : "Off");
 			}
-			indigo_printf(handle, "</setSwitchVector>\n");
+			adapter_printf(client_context, "</setSwitchVector>\n");
 			break;
 		case INDIGO_LIGHT_VECTOR:
-			indigo_printf(handle, "<setLightVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			adapter_printf(client_context, "<setLightVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 			for (int i = 0; i < property->count; i++) {
+				if (delta && !dirty[i])
+					continue;
 				indigo_item *item = &property->items[i];
-				indigo_printf(handle, "<oneLight name='%s'>%s</oneLight>\n", indigo_item_name(client->version, property, item), indigo_property_state_text[item->light.value]);
+				adapter_printf(client_context, "<oneLight name='%s'>%s</oneLight>\n", indigo_item_name(client->version, property, item), indigo_property_state_text[item->light.value]);
 			}
-			indigo_printf(handle, "</setLightVector>\n");
+			adapter_printf(client_context, "</setLightVector>\n");
 			break;
 		case INDIGO_BLOB_VECTOR: {
-			indigo_enable_blob_mode mode = INDIGO_ENABLE_BLOB_NEVER;
-			indigo_enable_blob_mode_record *record = client->enable_blob_mode_records;
-			while (record) {
-				if ((*record->device == 0 || !strcmp(property->device, record->device)) && (*record->name == 0 || !strcmp(property->name, record->name))) {
-					mode = record->mode;
-					break;
-				}
-				record = record->next;
-			}
-			if (mode != INDIGO_ENABLE_BLOB_NEVER) {
-				indigo_printf(handle, "<setBLOBVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
+			indigo_enable_blob_mode_record *record = blob_mode_record(client, property);
+			indigo_enable_blob_mode mode = record != NULL ? record->mode : INDIGO_ENABLE_BLOB_NEVER;
+			if (mode == INDIGO_ENABLE_BLOB_ALSO && property->state == INDIGO_OK_STATE && client_context->output_queue != NULL) {
+				queue_blob(client, client_context->output_queue, record, property, message);
+			} else if (mode != INDIGO_ENABLE_BLOB_NEVER) {
+				adapter_printf(client_context, "<setBLOBVector device='%s' name='%s' state='%s'%s>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), indigo_property_state_text[property->state], message_attribute(message));
 				if (property->state == INDIGO_OK_STATE) {
 					for (int i = 0; i < property->count; i++) {
 						indigo_item *item = &property->items[i];
 						long input_length = item->blob.size;
 						unsigned char *data = item->blob.value;
+						uint64_t ring_position;
 						if (mode == INDIGO_ENABLE_BLOB_URL) {
 							if (*item->blob.url == 0)
-								indigo_printf(handle, "<oneBLOB name='%s' path='/blob/%p%s'/>\n", indigo_item_name(client->version, property, item), item, item->blob.format);
+								adapter_printf(client_context, "<oneBLOB name='%s' path='/blob/%p%s'/>\n", indigo_item_name(client->version, property, item), item, item->blob.format);
 							else
-								indigo_printf(handle, "<oneBLOB name='%s' url='%s'/>\n", indigo_item_name(client->version, property, item), item->blob.url);
+								adapter_printf(client_context, "<oneBLOB name='%s' url='%s'/>\n", indigo_item_name(client->version, property, item), item->blob.url);
+						} else if (client_context->blob_ring != NULL && client->version >= INDIGO_VERSION_2_0 && indigo_blob_ring_put(client_context->blob_ring, item->blob.value, item->blob.size, &ring_position)) {
+							adapter_printf(client_context, "<oneBLOB name='%s' format='%s' size='%ld' ring='%llu'/>\n", indigo_item_name(client->version, property, item), item->blob.format, item->blob.size, (unsigned long long)ring_position);
+							indigo_record_blob_reference(handle, item);
 						} else {
-							indigo_printf(handle, "<oneBLOB name='%s' format='%s' size='%ld'>\n", indigo_item_name(client->version, property, item), item->blob.format, item->blob.size);
-							handle2 = dup(handle);
-							fh = fdopen(handle2, "w");
-							if (client->version >= INDIGO_VERSION_2_0) {
-								while (input_length) {
-									char encoded_data[BASE64_BUF_SIZE + 1];
-									long len = (RAW_BUF_SIZE < input_length) ?  RAW_BUF_SIZE : input_length;
-									long enclen = base64_encode((unsigned char*)encoded_data, (unsigned char*)data, len);
-									fwrite(encoded_data, 1, enclen, fh);
-									input_length -= len;
-									data += len;
-								}
-							} else {
-								static char encoded_data[74];
-								while (input_length) {
-									/* 54 raw = 72 encoded */
-									long len = (54 < input_length) ?  54 : input_length;
-									long enclen = base64_encode((unsigned char*)encoded_data, (unsigned char*)data, len);
-									encoded_data[enclen] = '\n';
-									fwrite(encoded_data, 1, enclen, fh);
-									input_length -= len;
-									data += len;
-								}
-							}
-							fflush(fh);
-							fclose(fh);
-							indigo_printf(handle, "</oneBLOB>\n");
+							adapter_printf(client_context, "<oneBLOB name='%s' format='%s' size='%ld'>\n", indigo_item_name(client->version, property, item), item->blob.format, item->blob.size);
+							indigo_record_blob_reference(handle, item);
+							write_blob_data(handle, client->version, data, input_length);
+							adapter_printf(client_context, "</oneBLOB>\n");
 						}
 					}
 				}
-				indigo_printf(handle, "</setBLOBVector>\n");
+				adapter_printf(client_context, "</setBLOBVector>\n");
 			}
 			break;
 		}
 	}
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&write_mutex);
 	return INDIGO_OK;
 }
@@ -249,11 +734,15 @@ static indigo_result xml_device_adapter_delete_property(indigo_client *client, i
 	pthread_mutex_lock(&write_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
-	int handle = client_context->output;
+	indigo_element_begin(client_context);
+	indigo_forget_property_items(&client_context->tracker, property);
+	if (client_context->output_queue != NULL)
+		forget_counters(client_context->output_queue, property);
 	if (*property->name)
-		indigo_printf(handle, "<delProperty device='%s' name='%s'%s/>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), message_attribute(message));
+		adapter_printf(client_context, "<delProperty device='%s' name='%s'%s/>\n", indigo_xml_escape(property->device), indigo_property_name(client->version, property), message_attribute(message));
 	else
-		indigo_printf(handle, "<delProperty device='%s'%s/>\n", device->name, message_attribute(message));
+		adapter_printf(client_context, "<delProperty device='%s'%s/>\n", device->name, message_attribute(message));
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&write_mutex);
 	return INDIGO_OK;
 }
@@ -268,13 +757,18 @@ static indigo_result xml_device_adapter_send_message(indigo_client *client, indi
 	pthread_mutex_lock(&write_mutex);
 	indigo_adapter_context *client_context = (indigo_adapter_context *)client->client_context;
 	assert(client_context != NULL);
-	int handle = client_context->output;
+	indigo_element_begin(client_context);
 	if (message)
-		indigo_printf(handle, "<message%s/>\n", message_attribute(message));
+		adapter_printf(client_context, "<message%s/>\n", message_attribute(message));
+	indigo_element_end(client_context);
 	pthread_mutex_unlock(&write_mutex);
 	return INDIGO_OK;
 }
 
+static double bytes_written_metric(void *data) {
+	return indigo_bytes_written(((indigo_adapter_context *)data)->output);
+}
+
 indigo_client *indigo_xml_device_adapter(int input, int ouput) {
 	static indigo_client client_template = {
 		"", false, NULL, INDIGO_OK, INDIGO_VERSION_NONE, NULL,
@@ -285,6 +779,7 @@ indigo_client *indigo_xml_device_adapter(int input, int ouput) {
 		xml_device_adapter_send_message,
 		NULL
 	};
+	pthread_once(&metrics_once, register_metrics);
 	indigo_client *client = malloc(sizeof(indigo_client));
 	assert(client != NULL);
 	memcpy(client, &client_template, sizeof(indigo_client));
@@ -292,6 +787,23 @@ indigo_client *indigo_xml_device_adapter(int input, int ouput) {
 	assert(client_context != NULL);
 	client_context->input = input;
 	client_context->output = ouput;
+	client_context->tracker = NULL;
+	client_context->delta_updates = false;
+	client_context->metric = NULL;
+	client_context->blob_ring = NULL;
+	client_context->output_queue = NULL;
+	client_context->pending_elements = NULL;
+	if (input != ouput) {
+		/* subprocess driver, parent may offer shared memory ring for BLOBs */
+		client_context->blob_ring = indigo_blob_ring_attach();
+	}
+	if (input == ouput) {
+		char label[INDIGO_NAME_SIZE];
+		snprintf(label, INDIGO_NAME_SIZE, "XML #%d", ouput);
+		indigo_reset_bytes_written(ouput);
+		client_context->metric = indigo_register_metric_provider(INDIGO_METRIC_COUNTER, "indigo_client_sent_bytes_total", "Bytes sent to client", "client", label, bytes_written_metric, client_context);
+		client_context->output_queue = output_queue_start(client, ouput);
+	}
 	client->client_context = client_context;
 	client->is_remote = input == ouput;
 	return client;
@@ -300,6 +812,10 @@ indigo_client *indigo_xml_device_adapter(int input, int ouput) {
 void indigo_release_xml_device_adapter(indigo_client *client) {
 	assert(client != NULL);
 	assert(client->client_context != NULL);
+	indigo_release_property_tracker(&((indigo_adapter_context *)client->client_context)->tracker);
+	indigo_release_metric(((indigo_adapter_context *)client->client_context)->metric);
+	output_queue_stop(((indigo_adapter_context *)client->client_context)->output_queue);
+	indigo_blob_ring_close(((indigo_adapter_context *)client->client_context)->blob_ring);
 	free(client->client_context);
 	free(client);
 }
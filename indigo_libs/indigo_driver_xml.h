@@ -33,6 +33,14 @@
 extern "C" {
 #endif
 
+/** Default BLOB delivery policy for remote clients, INDIGO_BLOB_DELIVERY_ALL unless changed. Frames are skipped only if latest or n-th frame policy is requested by server option or by enableBLOB policy attribute.
+ */
+extern indigo_blob_delivery_policy indigo_blob_delivery;
+
+/** Default n for INDIGO_BLOB_DELIVERY_NTH policy.
+ */
+extern int indigo_blob_delivery_nth;
+
 /** Create initialized instance of XML wire protocol client side adapter.
  */
 extern indigo_client *indigo_xml_device_adapter(int input, int ouput);
@@ -0,0 +1,177 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO flight recorder
+ \file indigo_flight_recorder.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <limits.h>
+#include <stdatomic.h>
+
+#include "indigo_flight_recorder.h"
+
+#define RING_MASK	(INDIGO_FLIGHT_RECORDER_SIZE - 1)
+
+bool indigo_use_flight_recorder = true;
+
+static indigo_flight_event ring[INDIGO_FLIGHT_RECORDER_SIZE] __attribute__((aligned(64)));
+static atomic_uint last_sequence = 0;
+static char crash_path[PATH_MAX] = "";
+
+static inline uint64_t clock_ns(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline indigo_flight_event *begin_event(indigo_flight_event_type type, uint32_t *sequence) {
+	*sequence = atomic_fetch_add_explicit(&last_sequence, 1, memory_order_relaxed) + 1;
+	if (*sequence == 0)
+		*sequence = atomic_fetch_add_explicit(&last_sequence, 1, memory_order_relaxed) + 1;
+	indigo_flight_event *event = ring + (*sequence & RING_MASK);
+	/* slot is marked as incomplete until all fields are written, decoder skips it */
+	event->sequence = 0;
+	atomic_thread_fence(memory_order_release);
+	event->timestamp = clock_ns(CLOCK_MONOTONIC);
+	event->type = type;
+	event->state = 0;
+	event->property_type = 0;
+	event->count = 0;
+	event->duration = 0;
+	event->value = 0;
+	return event;
+}
+
+static inline void end_event(indigo_flight_event *event, uint32_t sequence) {
+	atomic_thread_fence(memory_order_release);
+	event->sequence = sequence;
+}
+
+static inline void copy_names(char *names, const char *device, const char *name) {
+	int size = sizeof(((indigo_flight_event *)0)->names), i = 0;
+	if (device != NULL)
+		while (i < size - 2 && *device)
+			names[i++] = *device++;
+	names[i++] = 0;
+	if (name != NULL)
+		while (i < size - 1 && *name)
+			names[i++] = *name++;
+	names[i] = 0;
+}
+
+void indigo_flight_record(indigo_flight_event_type type, const char *device, const char *name, double value, float duration) {
+	if (!indigo_use_flight_recorder)
+		return;
+	uint32_t sequence;
+	indigo_flight_event *event = begin_event(type, &sequence);
+	event->value = value;
+	event->duration = duration;
+	copy_names(event->names, device, name);
+	end_event(event, sequence);
+}
+
+void indigo_flight_record_property(indigo_flight_event_type type, indigo_property *property) {
+	if (!indigo_use_flight_recorder)
+		return;
+	uint32_t sequence;
+	indigo_flight_event *event = begin_event(type, &sequence);
+	event->state = property->state;
+	event->property_type = property->type;
+	event->count = property->count > 255 ? 255 : property->count;
+	if (property->count > 0 && type != INDIGO_FLIGHT_DELETE) {
+		switch (property->type) {
+			case INDIGO_NUMBER_VECTOR:
+				event->value = property->items[0].number.value;
+				break;
+			case INDIGO_SWITCH_VECTOR:
+				event->value = -1;
+				for (int i = 0; i < property->count; i++) {
+					if (property->items[i].sw.value) {
+						event->value = i;
+						break;
+					}
+				}
+				break;
+			case INDIGO_LIGHT_VECTOR:
+				event->value = property->items[0].light.value;
+				break;
+			case INDIGO_BLOB_VECTOR:
+				event->value = property->items[0].blob.size;
+				break;
+			default:
+				break;
+		}
+	}
+	copy_names(event->names, property->device, property->name);
+	end_event(event, sequence);
+}
+
+static bool write_all(int handle, const void *data, size_t size) {
+	const char *pointer = data;
+	while (size > 0) {
+		ssize_t written = write(handle, pointer, size);
+		if (written <= 0)
+			return false;
+		pointer += written;
+		size -= written;
+	}
+	return true;
+}
+
+bool indigo_flight_recorder_dump(const char *path, int reason) {
+	/* only async-signal-safe calls are used, it is called from crash handler */
+	int handle = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (handle < 0)
+		return false;
+	indigo_flight_recorder_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDIGO_FLIGHT_RECORDER_MAGIC, 8);
+	header.realtime = clock_ns(CLOCK_REALTIME);
+	header.monotonic = clock_ns(CLOCK_MONOTONIC);
+	header.sequence = atomic_load(&last_sequence);
+	header.size = INDIGO_FLIGHT_RECORDER_SIZE;
+	header.event_size = sizeof(indigo_flight_event);
+	header.reason = reason;
+	bool result = write_all(handle, &header, sizeof(header)) && write_all(handle, ring, sizeof(ring));
+	close(handle);
+	return result;
+}
+
+static void crash_handler(int signo) {
+	indigo_flight_recorder_dump(crash_path, signo);
+	/* handler is installed with SA_RESETHAND, default action terminates process */
+	raise(signo);
+}
+
+void indigo_flight_recorder_dump_on_crash(const char *path) {
+	strncpy(crash_path, path, sizeof(crash_path) - 1);
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = crash_handler;
+	action.sa_flags = SA_RESETHAND | SA_NODEFER;
+	sigemptyset(&action.sa_mask);
+	int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+	for (int i = 0; i < sizeof(signals) / sizeof(int); i++)
+		sigaction(signals[i], &action, NULL);
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO flight recorder
+ \file indigo_flight_recorder.h
+ */
+
+#ifndef indigo_flight_recorder_h
+#define indigo_flight_recorder_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Flight recorder dump signature.
+ */
+#define INDIGO_FLIGHT_RECORDER_MAGIC	"INDIFLT1"
+
+/** Number of events kept in memory (power of 2).
+ */
+#define INDIGO_FLIGHT_RECORDER_SIZE		16384
+
+/** Event type.
+ */
+typedef enum {
+	INDIGO_FLIGHT_DEFINE = 1,				///< property defined, value is first item value
+	INDIGO_FLIGHT_UPDATE,						///< property updated, value is first item value
+	INDIGO_FLIGHT_DELETE,						///< property deleted
+	INDIGO_FLIGHT_CHANGE,						///< property change requested, value is first item value
+	INDIGO_FLIGHT_TIMER,						///< timer fired, value is timer id, duration is lateness
+	INDIGO_FLIGHT_EXPOSURE_START,		///< exposure started, value is exposure time
+	INDIGO_FLIGHT_EXPOSURE_END,			///< exposure finished (image processing started), value is frame size in pixels (0 for DSLR)
+	INDIGO_FLIGHT_EXPOSURE_ABORT,		///< exposure aborted
+	INDIGO_FLIGHT_BLOB,							///< BLOB delivered to clients, value is size, duration is time of delivery
+	INDIGO_FLIGHT_CONNECT,					///< client connected, value is socket, names contain peer address and protocol
+	INDIGO_FLIGHT_DISCONNECT				///< client disconnected, value is socket
+} indigo_flight_event_type;
+
+/** Event (64 bytes).
+ */
+typedef struct {
+	uint64_t timestamp;							///< CLOCK_MONOTONIC time in nanoseconds
+	double value;										///< event specific value
+	uint32_t sequence;							///< event sequence number, 0 for empty or incomplete slot
+	uint8_t type;										///< indigo_flight_event_type
+	uint8_t state;									///< property state
+	uint8_t property_type;					///< property type
+	uint8_t count;									///< property item count (saturated to 255)
+	float duration;									///< event specific duration in seconds
+	char names[36];									///< device name and property name separated by 0, truncated to fit
+} indigo_flight_event;
+
+/** Dump file header, followed by INDIGO_FLIGHT_RECORDER_SIZE events in ring order.
+ */
+typedef struct {
+	char magic[8];									///< INDIGO_FLIGHT_RECORDER_MAGIC
+	uint64_t realtime;							///< CLOCK_REALTIME in nanoseconds at time of dump
+	uint64_t monotonic;							///< CLOCK_MONOTONIC in nanoseconds at time of dump
+	uint32_t sequence;							///< sequence number of the last recorded event
+	uint32_t size;									///< number of events
+	uint32_t event_size;						///< sizeof(indigo_flight_event)
+	int32_t reason;									///< signal that triggered dump, 0 if dump was requested
+} indigo_flight_recorder_header;
+
+/** Enable flight recorder (default true).
+ */
+extern bool indigo_use_flight_recorder;
+
+/** Record event with device and property names.
+ */
+extern void indigo_flight_record(indigo_flight_event_type type, const char *device, const char *name, double value, float duration);
+
+/** Record property event with state, type, item count and first item value.
+ */
+extern void indigo_flight_record_property(indigo_flight_event_type type, indigo_property *property);
+
+/** Write events to file (async-signal-safe), reason is signal number or 0.
+ */
+extern bool indigo_flight_recorder_dump(const char *path, int reason);
+
+/** Set path used for dumps on crash (SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT) and install crash handler.
+ */
+extern void indigo_flight_recorder_dump_on_crash(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_flight_recorder_h */
@@ -50,12 +50,14 @@ indigo_result indigo_guider_attach(indigo_device *device, unsigned version) {
 			GUIDER_GUIDE_DEC_PROPERTY = indigo_init_number_property(NULL, device->name, GUIDER_GUIDE_DEC_PROPERTY_NAME, GUIDER_MAIN_GROUP, "DEC guiding", INDIGO_IDLE_STATE, INDIGO_RW_PERM, 2);
 			if (GUIDER_GUIDE_DEC_PROPERTY == NULL)
 				return INDIGO_FAILED;
+			GUIDER_GUIDE_DEC_PROPERTY->priority = true;
 			indigo_init_number_item(GUIDER_GUIDE_NORTH_ITEM, GUIDER_GUIDE_NORTH_ITEM_NAME, "Guide north", 0, 10000, 0, 0);
 			indigo_init_number_item(GUIDER_GUIDE_SOUTH_ITEM, GUIDER_GUIDE_SOUTH_ITEM_NAME, "Guide south", 0, 10000, 0, 0);
 			// -------------------------------------------------------------------------------- GUIDER_GUIDE_RA
 			GUIDER_GUIDE_RA_PROPERTY = indigo_init_number_property(NULL, device->name, GUIDER_GUIDE_RA_PROPERTY_NAME, GUIDER_MAIN_GROUP, "RA guiding", INDIGO_IDLE_STATE, INDIGO_RW_PERM, 2);
 			if (GUIDER_GUIDE_RA_PROPERTY == NULL)
 				return INDIGO_FAILED;
+			GUIDER_GUIDE_RA_PROPERTY->priority = true;
 			indigo_init_number_item(GUIDER_GUIDE_EAST_ITEM, GUIDER_GUIDE_EAST_ITEM_NAME, "Guide east", 0, 10000, 0, 0);
 			indigo_init_number_item(GUIDER_GUIDE_WEST_ITEM, GUIDER_GUIDE_WEST_ITEM_NAME, "Guide west", 0, 10000, 0, 0);
 			// -------------------------------------------------------------------------------- GUIDER_RATE
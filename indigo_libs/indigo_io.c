@@ -33,7 +33,9 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <netdb.h>
+#include <poll.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -41,6 +43,11 @@
 
 #include "indigo_bus.h"
 #include "indigo_io.h"
+#include "indigo_recorder.h"
+
+#define MAX_COUNTED_HANDLES	1024
+
+static atomic_ullong bytes_written[MAX_COUNTED_HANDLES];
 
 int indigo_open_serial(const char *dev_file) {
 	return indigo_open_serial_with_speed(dev_file, 9600);
@@ -78,25 +85,56 @@ int indigo_open_serial_with_speed(const char *dev_file, int speed) {
 }
 
 int indigo_open_tcp(const char *host, int port) {
-	struct sockaddr_in srv_info;
-	struct hostent *he;
+	return indigo_open_tcp_with_timeout(host, port, 5000);
+}
+
+int indigo_open_tcp_with_timeout(const char *host, int port, int timeout_ms) {
+	struct addrinfo hints, *addresses, *address;
+	char service[16];
+	int sock = -1;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", port);
+	if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+		return -1;
+	}
+	for (address = addresses; address != NULL; address = address->ai_next) {
+		if ((sock = indigo_open_tcp_address(address->ai_addr, address->ai_addrlen, timeout_ms)) >= 0)
+			break;
+	}
+	freeaddrinfo(addresses);
+	return sock;
+}
+
+int indigo_open_tcp_address(const struct sockaddr *address, int address_length, int timeout_ms) {
 	int sock;
 	struct timeval timeout;
 	timeout.tv_sec = 5;
 	timeout.tv_usec = 0;
-	if ((he = gethostbyname(host))==NULL) {
-		return -1;
-	}
-	if ((sock = socket(AF_INET, SOCK_STREAM, 0))== -1) {
+	if ((sock = socket(address->sa_family, SOCK_STREAM, 0)) == -1)
 		return -1;
+	int flags = fcntl(sock, F_GETFL, 0);
+	fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+	int result = connect(sock, address, address_length);
+	if (result < 0 && errno == EINPROGRESS) {
+		struct pollfd pfd = { sock, POLLOUT, 0 };
+		int error = 0;
+		socklen_t length = sizeof(error);
+		if (poll(&pfd, 1, timeout_ms) == 1 && getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+			result = 0;
+		else if (error)
+			errno = error;
+		else
+			errno = ETIMEDOUT;
 	}
-	memset(&srv_info, 0, sizeof(srv_info));
-	srv_info.sin_family = AF_INET;
-	srv_info.sin_port = htons(port);
-	srv_info.sin_addr = *((struct in_addr *)he->h_addr);
-	if (connect(sock, (struct sockaddr *)&srv_info, sizeof(struct sockaddr))<0) {
+	if (result != 0) {
+		int error = errno;
+		close(sock);
+		errno = error;
 		return -1;
 	}
+	fcntl(sock, F_SETFL, flags);
 	if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout)) < 0) {
 		close(sock);
 		return -1;
@@ -116,6 +154,7 @@ int indigo_read(int handle, char *buffer, long length) {
 		if (bytes_read <= 0) {
 			return (int)bytes_read;
 		}
+		indigo_record(handle, INDIGO_RECORD_INBOUND, buffer, bytes_read);
 		total_bytes += bytes_read;
 		if (bytes_read == remains) {
 			return (int)total_bytes;
@@ -143,6 +182,8 @@ int indigo_read_line(int handle, char *buffer, int length) {
 			return -1;
 		}
 	}
+	buffer[total_bytes] = '\n';
+	indigo_record(handle, INDIGO_RECORD_INBOUND, buffer, total_bytes + 1);
 	buffer[total_bytes] = '\0';
 	return (int)total_bytes;
 }
@@ -150,16 +191,45 @@ int indigo_read_line(int handle, char *buffer, int length) {
 bool indigo_write(int handle, const char *buffer, long length) {
 	long remains = length;
 	while (true) {
-		long bytes_written = write(handle, buffer, remains);
-		if (bytes_written < 0)
+		long written = write(handle, buffer, remains);
+		if (written < 0)
 			return false;
-		if (bytes_written == remains)
+		if (handle >= 0 && handle < MAX_COUNTED_HANDLES)
+			atomic_fetch_add_explicit(&bytes_written[handle], written, memory_order_relaxed);
+		indigo_record(handle, INDIGO_RECORD_OUTBOUND, buffer, written);
+		if (written == remains)
 			return true;
-		buffer += bytes_written;
-		remains -= bytes_written;
+		buffer += written;
+		remains -= written;
 	}
 }
 
+double indigo_bytes_written(int handle) {
+	if (handle >= 0 && handle < MAX_COUNTED_HANDLES)
+		return atomic_load_explicit(&bytes_written[handle], memory_order_relaxed);
+	return 0;
+}
+
+void indigo_reset_bytes_written(int handle) {
+	if (handle >= 0 && handle < MAX_COUNTED_HANDLES)
+		atomic_store(&bytes_written[handle], 0);
+}
+
+void indigo_count_bytes_written(int handle, long bytes) {
+	if (handle >= 0 && handle < MAX_COUNTED_HANDLES)
+		atomic_fetch_add_explicit(&bytes_written[handle], bytes, memory_order_relaxed);
+}
+
+void indigo_element_begin(indigo_adapter_context *context) {
+	if (context->pending_elements != NULL)
+		atomic_fetch_add((atomic_int *)context->pending_elements, 1);
+}
+
+void indigo_element_end(indigo_adapter_context *context) {
+	if (context->pending_elements != NULL)
+		atomic_fetch_sub((atomic_int *)context->pending_elements, 1);
+}
+
 bool indigo_printf(int handle, const char *format, ...) {
 	char buffer[1024];
 	va_list args;
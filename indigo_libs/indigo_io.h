@@ -30,6 +30,8 @@
 #include <stdio.h>
 #include <stdbool.h>
 
+#include "indigo_bus.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -46,6 +48,16 @@ extern int indigo_open_serial_with_speed(const char *dev_file, int speed);
  */
 extern int indigo_open_tcp(const char *host, int port);
 
+/** Open network connection with connect timeout in milliseconds.
+ */
+extern int indigo_open_tcp_with_timeout(const char *host, int port, int timeout_ms);
+
+struct sockaddr;
+
+/** Open network connection to already resolved address with connect timeout in milliseconds.
+ */
+extern int indigo_open_tcp_address(const struct sockaddr *address, int address_length, int timeout_ms);
+
 /** Read buffer.
  */
 extern int indigo_read(int handle, char *buffer, long length);
@@ -62,6 +74,26 @@ extern bool indigo_write(int handle, const char *buffer, long length);
  */
 	
 extern bool indigo_printf(int handle, const char *format, ...);
+
+/** Bytes written by indigo_write() to handle since last reset.
+ */
+extern double indigo_bytes_written(int handle);
+
+/** Reset bytes written counter of handle.
+ */
+extern void indigo_reset_bytes_written(int handle);
+
+/** Count bytes written to handle other way than by indigo_write().
+ */
+extern void indigo_count_bytes_written(int handle, long bytes);
+
+/** Start protocol element written to adapter output. Elements being written are counted for warm restart, client with partially written element can't be adopted by restarted worker.
+ */
+extern void indigo_element_begin(indigo_adapter_context *context);
+
+/** Finish protocol element started by indigo_element_begin().
+ */
+extern void indigo_element_end(indigo_adapter_context *context);
 	
 /** Read formatted.
  */
@@ -23,6 +23,8 @@
  \file indigo_json.c
  */
 
+#define INDIGO_LOG_SUBSYSTEM INDIGO_LOG_PROTOCOL
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -119,6 +121,9 @@ static void *get_properties_handler(parser_state state, char *name, char *value,
 	INDIGO_TRACE_PARSER(indigo_trace("JSON Parser: %s %s '%s' '%s'", __FUNCTION__, parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == NUMBER_VALUE && !strcmp(name, "version")) {
 		client->version = (int)atol(value);
+	} else if (state == LOGICAL_VALUE && !strcmp(name, "delta")) {
+		/* INDIGO 2.x client can merge updates with changed items only */
+		((indigo_adapter_context *)client->client_context)->delta_updates = !strcmp(value, "true");
 	} else if (state == END_STRUCT) {
 		indigo_enumerate_properties(client, property);
 		return top_level_handler;
@@ -291,7 +296,7 @@ void indigo_json_parse(indigo_device *device, indigo_client *client) {
 			pointer = buffer;
 			buffer_end = buffer + count;
 			buffer[count] = 0;
-			INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, buffer));
+			INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d → %s", handle, buffer));
 		}
 		switch (state) {
 			case ERROR:
@@ -462,5 +467,5 @@ void indigo_json_parse(indigo_device *device, indigo_client *client) {
 	}
 exit_loop:
 	close(handle);
-	indigo_log("JSON Parser: parser finished");
+	INDIGO_CHECKED_LOG("JSON Parser: parser finished");
 }
@@ -0,0 +1,339 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO metrics registry
+ \file indigo_metrics.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef __MACH__
+#include <mach/mach_time.h>
+#endif
+
+#include "indigo_metrics.h"
+
+#define METRIC_BUCKETS	12
+
+static const double bucket_bounds[METRIC_BUCKETS - 1] = { 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10 };
+
+struct indigo_metric {
+	indigo_metric_type type;
+	int references;											/* registered users, slot keeps its name and label after last release */
+	int calls;													/* provider calls in progress */
+	char name[INDIGO_NAME_SIZE];
+	char help[INDIGO_NAME_SIZE];
+	char label_name[INDIGO_NAME_SIZE];
+	char label_value[INDIGO_NAME_SIZE];
+	indigo_metric_provider provider;
+	void *data;
+	_Atomic double value;
+	atomic_ullong count;
+	atomic_ullong buckets[METRIC_BUCKETS];
+};
+
+bool indigo_use_metrics = true;
+
+/* slot is never reused for other metric, so stale pointer held by other thread after release can only update
+   released metric (or the same metric registered again) */
+
+static indigo_metric metrics[INDIGO_MAX_METRICS];
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t metrics_cond = PTHREAD_COND_INITIALIZER;
+
+static void atomic_add_double(_Atomic double *target, double value) {
+	double old = atomic_load_explicit(target, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(target, &old, old + value, memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+indigo_metric *indigo_register_metric_provider(indigo_metric_type type, const char *name, const char *help, const char *label_name, const char *label_value, indigo_metric_provider provider, void *data) {
+	if (name == NULL)
+		return NULL;
+	if (label_name == NULL || label_value == NULL)
+		label_name = label_value = "";
+	indigo_metric *metric = NULL;
+	pthread_mutex_lock(&metrics_mutex);
+	for (int i = 0; i < INDIGO_MAX_METRICS; i++) {
+		indigo_metric *tmp = metrics + i;
+		if (*tmp->name == 0) {
+			if (metric == NULL)
+				metric = tmp;
+		} else if (!strncmp(tmp->name, name, INDIGO_NAME_SIZE - 1) && !strncmp(tmp->label_name, label_name, INDIGO_NAME_SIZE - 1) && !strncmp(tmp->label_value, label_value, INDIGO_NAME_SIZE - 1)) {
+			if (tmp->references++ == 0) {
+				/* registered again after release, values are kept */
+				tmp->type = type;
+				tmp->provider = provider;
+				tmp->data = data;
+			}
+			pthread_mutex_unlock(&metrics_mutex);
+			return tmp;
+		}
+	}
+	if (metric != NULL) {
+		metric->type = type;
+		metric->references = 1;
+		strncpy(metric->name, name, INDIGO_NAME_SIZE - 1);
+		strncpy(metric->help, help ? help : "", INDIGO_NAME_SIZE - 1);
+		strncpy(metric->label_name, label_name, INDIGO_NAME_SIZE - 1);
+		strncpy(metric->label_value, label_value, INDIGO_NAME_SIZE - 1);
+		metric->provider = provider;
+		metric->data = data;
+		atomic_store(&metric->value, 0);
+		atomic_store(&metric->count, 0);
+		for (int i = 0; i < METRIC_BUCKETS; i++)
+			atomic_store(&metric->buckets[i], 0);
+	} else {
+		indigo_error("Metrics: too many metrics, '%s' not registered", name);
+	}
+	pthread_mutex_unlock(&metrics_mutex);
+	return metric;
+}
+
+indigo_metric *indigo_register_metric(indigo_metric_type type, const char *name, const char *help, const char *label_name, const char *label_value) {
+	return indigo_register_metric_provider(type, name, help, label_name, label_value, NULL, NULL);
+}
+
+void indigo_release_metric(indigo_metric *metric) {
+	if (metric == NULL)
+		return;
+	pthread_mutex_lock(&metrics_mutex);
+	if (metric->references > 0 && --metric->references == 0) {
+		/* provider data can be released by caller after return */
+		while (metric->calls > 0)
+			pthread_cond_wait(&metrics_cond, &metrics_mutex);
+		metric->provider = NULL;
+		metric->data = NULL;
+	}
+	pthread_mutex_unlock(&metrics_mutex);
+}
+
+void indigo_metric_add(indigo_metric *metric, double value) {
+	if (metric != NULL && indigo_use_metrics)
+		atomic_add_double(&metric->value, value);
+}
+
+void indigo_metric_set(indigo_metric *metric, double value) {
+	if (metric != NULL && indigo_use_metrics)
+		atomic_store_explicit(&metric->value, value, memory_order_relaxed);
+}
+
+void indigo_metric_observe(indigo_metric *metric, double value) {
+	if (metric == NULL || !indigo_use_metrics)
+		return;
+	int bucket = 0;
+	while (bucket < METRIC_BUCKETS - 1 && value > bucket_bounds[bucket])
+		bucket++;
+	atomic_fetch_add_explicit(&metric->buckets[bucket], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&metric->count, 1, memory_order_relaxed);
+	atomic_add_double(&metric->value, value);
+}
+
+double indigo_metric_time(void) {
+#ifdef __MACH__
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+typedef struct {
+	char *data;
+	long length;
+	long size;
+} text_buffer;
+
+static void append(text_buffer *buffer, const char *format, ...) {
+	while (true) {
+		va_list args;
+		va_start(args, format);
+		long remains = buffer->size - buffer->length;
+		int length = vsnprintf(buffer->data + buffer->length, remains, format, args);
+		va_end(args);
+		if (length < remains) {
+			buffer->length += length;
+			return;
+		}
+		char *data = realloc(buffer->data, buffer->size * 2);
+		if (data == NULL)
+			return;
+		buffer->data = data;
+		buffer->size *= 2;
+	}
+}
+
+static void escape_label(const char *value, char *escaped, int size) {
+	char *end = escaped + size - 2;
+	while (*value && escaped < end) {
+		if (*value == '\\' || *value == '"') {
+			*escaped++ = '\\';
+			*escaped++ = *value;
+		} else if (*value == '\n') {
+			*escaped++ = '\\';
+			*escaped++ = 'n';
+		} else {
+			*escaped++ = *value;
+		}
+		value++;
+	}
+	*escaped = 0;
+}
+
+/* metrics visible at the time of call, with values of counters and gauges and sums of histograms, providers are called
+   without metrics_mutex, release of metric waits until the call is finished */
+
+typedef struct {
+	indigo_metric *metric;
+	indigo_metric_provider provider;
+	void *data;
+	double value;
+} metric_snapshot;
+
+static int metrics_snapshot(metric_snapshot *snapshot, int max_count) {
+	int count = 0;
+	pthread_mutex_lock(&metrics_mutex);
+	for (int i = 0; i < INDIGO_MAX_METRICS && count < max_count; i++) {
+		indigo_metric *metric = metrics + i;
+		if (metric->references == 0)
+			continue;
+		if (metric->provider != NULL)
+			metric->calls++;
+		snapshot[count].metric = metric;
+		snapshot[count].provider = metric->provider;
+		snapshot[count++].data = metric->data;
+	}
+	pthread_mutex_unlock(&metrics_mutex);
+	bool called = false;
+	for (int i = 0; i < count; i++) {
+		if (snapshot[i].provider != NULL) {
+			snapshot[i].value = snapshot[i].provider(snapshot[i].data);
+			called = true;
+		} else {
+			snapshot[i].value = atomic_load_explicit(&snapshot[i].metric->value, memory_order_relaxed);
+		}
+	}
+	if (called) {
+		pthread_mutex_lock(&metrics_mutex);
+		for (int i = 0; i < count; i++)
+			if (snapshot[i].provider != NULL)
+				snapshot[i].metric->calls--;
+		pthread_cond_broadcast(&metrics_cond);
+		pthread_mutex_unlock(&metrics_mutex);
+	}
+	return count;
+}
+
+static void append_metric(text_buffer *buffer, metric_snapshot *snapshot) {
+	indigo_metric *metric = snapshot->metric;
+	char label[3 * INDIGO_NAME_SIZE + 8] = "";
+	char separator[2] = "";
+	if (*metric->label_name) {
+		char value[2 * INDIGO_NAME_SIZE];
+		escape_label(metric->label_value, value, sizeof(value));
+		snprintf(label, sizeof(label), "%s=\"%s\"", metric->label_name, value);
+		strcpy(separator, ",");
+	}
+	if (metric->type == INDIGO_METRIC_HISTOGRAM) {
+		unsigned long long cumulative = 0;
+		for (int i = 0; i < METRIC_BUCKETS - 1; i++) {
+			cumulative += atomic_load_explicit(&metric->buckets[i], memory_order_relaxed);
+			append(buffer, "%s_bucket{%s%sle=\"%g\"} %llu\n", metric->name, label, separator, bucket_bounds[i], cumulative);
+		}
+		cumulative += atomic_load_explicit(&metric->buckets[METRIC_BUCKETS - 1], memory_order_relaxed);
+		append(buffer, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", metric->name, label, separator, cumulative);
+		if (*label) {
+			append(buffer, "%s_sum{%s} %.9g\n", metric->name, label, snapshot->value);
+			append(buffer, "%s_count{%s} %llu\n", metric->name, label, cumulative);
+		} else {
+			append(buffer, "%s_sum %.9g\n", metric->name, snapshot->value);
+			append(buffer, "%s_count %llu\n", metric->name, cumulative);
+		}
+	} else if (*label) {
+		append(buffer, "%s{%s} %.15g\n", metric->name, label, snapshot->value);
+	} else {
+		append(buffer, "%s %.15g\n", metric->name, snapshot->value);
+	}
+}
+
+char *indigo_metrics_text(long *length) {
+	static const char *type_text[] = { "counter", "gauge", "histogram" };
+	text_buffer buffer = { malloc(16 * 1024), 0, 16 * 1024 };
+	metric_snapshot *snapshot = malloc(INDIGO_MAX_METRICS * sizeof(metric_snapshot));
+	if (buffer.data == NULL || snapshot == NULL) {
+		free(buffer.data);
+		free(snapshot);
+		return NULL;
+	}
+	*buffer.data = 0;
+	int count = metrics_snapshot(snapshot, INDIGO_MAX_METRICS);
+	for (int i = 0; i < count; i++) {
+		indigo_metric *metric = snapshot[i].metric;
+		bool exported = false;
+		for (int j = 0; j < i && !exported; j++)
+			exported = !strcmp(snapshot[j].metric->name, metric->name);
+		if (exported)
+			continue;
+		append(&buffer, "# HELP %s %s\n", metric->name, metric->help);
+		append(&buffer, "# TYPE %s %s\n", metric->name, type_text[metric->type]);
+		for (int j = i; j < count; j++)
+			if (!strcmp(snapshot[j].metric->name, metric->name))
+				append_metric(&buffer, snapshot + j);
+	}
+	free(snapshot);
+	if (length)
+		*length = buffer.length;
+	return buffer.data;
+}
+
+indigo_property *indigo_metrics_property(indigo_property *property) {
+	metric_snapshot *snapshot = malloc(INDIGO_MAX_ITEMS * sizeof(metric_snapshot));
+	if (snapshot == NULL)
+		return property;
+	int count = metrics_snapshot(snapshot, INDIGO_MAX_ITEMS);
+	if (property->count != count)
+		property = indigo_resize_property(property, count);
+	for (int i = 0; i < count; i++) {
+		indigo_metric *metric = snapshot[i].metric;
+		char name[INDIGO_NAME_SIZE], value[INDIGO_VALUE_SIZE];
+		if (*metric->label_name)
+			snprintf(name, sizeof(name), "%s{%s}", metric->name, metric->label_value);
+		else
+			snprintf(name, sizeof(name), "%s", metric->name);
+		if (metric->type == INDIGO_METRIC_HISTOGRAM) {
+			unsigned long long samples = atomic_load_explicit(&metric->count, memory_order_relaxed);
+			snprintf(value, sizeof(value), "count %llu, mean %.3gs", samples, samples > 0 ? snapshot[i].value / samples : 0);
+		} else {
+			snprintf(value, sizeof(value), "%.15g", snapshot[i].value);
+		}
+		indigo_init_text_item(property->items + i, name, metric->help, value);
+	}
+	free(snapshot);
+	return property;
+}
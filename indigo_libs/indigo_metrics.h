@@ -0,0 +1,100 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO metrics registry
+ \file indigo_metrics.h
+ */
+
+#ifndef indigo_metrics_h
+#define indigo_metrics_h
+
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Max number of registered metrics.
+ */
+#define INDIGO_MAX_METRICS	256
+
+/** Metric type.
+ */
+typedef enum {
+	INDIGO_METRIC_COUNTER,		///< monotonically increasing value
+	INDIGO_METRIC_GAUGE,			///< value that can go up and down
+	INDIGO_METRIC_HISTOGRAM		///< distribution of durations in seconds
+} indigo_metric_type;
+
+/** Opaque metric handle.
+ */
+typedef struct indigo_metric indigo_metric;
+
+/** Metric value provider, if set, it is called to get value of counter or gauge when metrics are exported.
+ Provider is called without registry lock held, it must not release its own metric.
+ */
+typedef double (*indigo_metric_provider)(void *data);
+
+/** Enable metrics collection (default true).
+ */
+extern bool indigo_use_metrics;
+
+/** Register metric or get already registered one with the same name and label (label_name and label_value can be NULL).
+ */
+extern indigo_metric *indigo_register_metric(indigo_metric_type type, const char *name, const char *help, const char *label_name, const char *label_value);
+
+/** Register counter or gauge with value provider.
+ */
+extern indigo_metric *indigo_register_metric_provider(indigo_metric_type type, const char *name, const char *help, const char *label_name, const char *label_value, indigo_metric_provider provider, void *data);
+
+/** Release metric (hidden from export when released by all users, provider data can be freed after return).
+ Registry slot is never reused for other metric, the same metric registered again continues with previous values.
+ */
+extern void indigo_release_metric(indigo_metric *metric);
+
+/** Add value to counter or gauge.
+ */
+extern void indigo_metric_add(indigo_metric *metric, double value);
+
+/** Set value of gauge.
+ */
+extern void indigo_metric_set(indigo_metric *metric, double value);
+
+/** Add observation (in seconds) to histogram.
+ */
+extern void indigo_metric_observe(indigo_metric *metric, double value);
+
+/** Monotonic time in seconds for latency measurement.
+ */
+extern double indigo_metric_time(void);
+
+/** Export all metrics in Prometheus text format, buffer is allocated and must be released by caller.
+ */
+extern char *indigo_metrics_text(long *length);
+
+/** Fill read-only text property with one item per metric (property is resized if needed and returned).
+ */
+extern indigo_property *indigo_metrics_property(indigo_property *property);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_metrics_h */
@@ -0,0 +1,283 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO client side property cache
+ \file indigo_property_cache.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "indigo_property_cache.h"
+
+#define HASH_SIZE				256
+#define MAX_LISTENERS		32
+
+typedef struct cache_entry {
+	struct cache_entry *next;
+	unsigned long long hash;
+	unsigned long sequence;
+	int capacity;												/* items allocated in property */
+	indigo_property *property;
+} cache_entry;
+
+typedef struct {
+	char device[INDIGO_NAME_SIZE];
+	char name[INDIGO_NAME_SIZE];
+	indigo_property_cache_callback callback;
+	void *data;
+} cache_listener;
+
+static cache_entry *cache[HASH_SIZE];
+static cache_listener listeners[MAX_LISTENERS];
+static unsigned long last_sequence = 0;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cache_cond = PTHREAD_COND_INITIALIZER;
+
+static cache_entry *find_entry(unsigned long long hash, const char *device, const char *name) {
+	for (cache_entry *entry = cache[hash % HASH_SIZE]; entry != NULL; entry = entry->next) {
+		if (entry->hash == hash && !strcmp(entry->property->name, name) && !strcmp(entry->property->device, device))
+			return entry;
+	}
+	return NULL;
+}
+
+/* entry is updated in place, property buffer is reallocated only if the item count grows over its capacity */
+
+static void store_property(indigo_property *property) {
+	unsigned long long h = indigo_property_hash(property->device, property->name);
+	cache_entry *entry = find_entry(h, property->device, property->name);
+	if (entry == NULL || entry->capacity < property->count) {
+		indigo_property *resized = realloc(entry != NULL ? entry->property : NULL, sizeof(indigo_property) + property->count * sizeof(indigo_item));
+		if (resized == NULL)
+			return;
+		if (entry == NULL) {
+			entry = malloc(sizeof(cache_entry));
+			if (entry == NULL) {
+				free(resized);
+				return;
+			}
+			entry->hash = h;
+			entry->next = cache[h % HASH_SIZE];
+			cache[h % HASH_SIZE] = entry;
+		}
+		entry->property = resized;
+		entry->capacity = property->count;
+	}
+	memcpy(entry->property, property, sizeof(indigo_property) + property->count * sizeof(indigo_item));
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		for (int i = 0; i < property->count; i++)
+			entry->property->items[i].blob.value = NULL;
+	}
+	entry->sequence = ++last_sequence;
+}
+
+static void remove_properties(indigo_property *property) {
+	for (int i = 0; i < HASH_SIZE; i++) {
+		cache_entry **link = cache + i;
+		while (*link != NULL) {
+			cache_entry *entry = *link;
+			if ((property == NULL || !strcmp(entry->property->device, property->device)) && (property == NULL || *property->name == 0 || !strcmp(entry->property->name, property->name))) {
+				*link = entry->next;
+				free(entry->property);
+				free(entry);
+			} else {
+				link = &entry->next;
+			}
+		}
+	}
+}
+
+static void notify_listeners(indigo_property *property, bool deleted) {
+	cache_listener active[MAX_LISTENERS];
+	int count = 0;
+	pthread_mutex_lock(&cache_mutex);
+	for (int i = 0; i < MAX_LISTENERS; i++) {
+		cache_listener *listener = listeners + i;
+		if (listener->callback == NULL)
+			continue;
+		if (*listener->device && strcmp(listener->device, property->device))
+			continue;
+		if (*listener->name && *property->name && strcmp(listener->name, property->name))
+			continue;
+		active[count++] = *listener;
+	}
+	pthread_mutex_unlock(&cache_mutex);
+	for (int i = 0; i < count; i++)
+		active[i].callback(property, deleted, active[i].data);
+}
+
+static indigo_result cache_attach(indigo_client *client) {
+	indigo_enumerate_properties(client, &INDIGO_ALL_PROPERTIES);
+	return INDIGO_OK;
+}
+
+static indigo_result cache_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	pthread_mutex_lock(&cache_mutex);
+	store_property(property);
+	pthread_cond_broadcast(&cache_cond);
+	pthread_mutex_unlock(&cache_mutex);
+	notify_listeners(property, false);
+	return INDIGO_OK;
+}
+
+static indigo_result cache_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	pthread_mutex_lock(&cache_mutex);
+	store_property(property);
+	pthread_cond_broadcast(&cache_cond);
+	pthread_mutex_unlock(&cache_mutex);
+	notify_listeners(property, false);
+	return INDIGO_OK;
+}
+
+static indigo_result cache_delete_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	pthread_mutex_lock(&cache_mutex);
+	remove_properties(property);
+	pthread_cond_broadcast(&cache_cond);
+	pthread_mutex_unlock(&cache_mutex);
+	notify_listeners(property, true);
+	return INDIGO_OK;
+}
+
+indigo_client indigo_property_cache_client = {
+	"Property cache", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	cache_attach,
+	cache_define_property,
+	cache_update_property,
+	cache_delete_property,
+	NULL,
+	NULL
+};
+
+indigo_result indigo_start_property_cache(void) {
+	return indigo_attach_client(&indigo_property_cache_client);
+}
+
+indigo_result indigo_stop_property_cache(void) {
+	indigo_result result = indigo_detach_client(&indigo_property_cache_client);
+	pthread_mutex_lock(&cache_mutex);
+	remove_properties(NULL);
+	pthread_cond_broadcast(&cache_cond);
+	pthread_mutex_unlock(&cache_mutex);
+	return result;
+}
+
+indigo_property *indigo_get_cached_property(const char *device, const char *name) {
+	indigo_property *copy = NULL;
+	pthread_mutex_lock(&cache_mutex);
+	cache_entry *entry = find_entry(indigo_property_hash(device, name), device, name);
+	if (entry != NULL)
+		copy = indigo_copy_property(NULL, entry->property);
+	pthread_mutex_unlock(&cache_mutex);
+	return copy;
+}
+
+bool indigo_get_cached_property_state(const char *device, const char *name, indigo_property_state *state) {
+	pthread_mutex_lock(&cache_mutex);
+	cache_entry *entry = find_entry(indigo_property_hash(device, name), device, name);
+	if (entry != NULL && state != NULL)
+		*state = entry->property->state;
+	pthread_mutex_unlock(&cache_mutex);
+	return entry != NULL;
+}
+
+typedef enum {
+	WAIT_DEFINED,
+	WAIT_STATE,
+	WAIT_DONE
+} wait_mode;
+
+static bool wait_for_state(const char *device, const char *name, unsigned long sequence, wait_mode mode, indigo_property_state state, double timeout, indigo_property_state *final_state) {
+	struct timeval now;
+	struct timespec until;
+	gettimeofday(&now, NULL);
+	long long nsec = (long long)now.tv_sec * 1000000000LL + now.tv_usec * 1000LL + (long long)(timeout * 1e9);
+	until.tv_sec = (time_t)(nsec / 1000000000LL);
+	until.tv_nsec = (long)(nsec % 1000000000LL);
+	unsigned long long h = indigo_property_hash(device, name);
+	bool result = false;
+	pthread_mutex_lock(&cache_mutex);
+	while (true) {
+		cache_entry *entry = find_entry(h, device, name);
+		if (entry != NULL && entry->sequence > sequence && (mode == WAIT_DEFINED || (mode == WAIT_DONE ? entry->property->state != INDIGO_BUSY_STATE : entry->property->state == state))) {
+			if (final_state != NULL)
+				*final_state = entry->property->state;
+			result = true;
+			break;
+		}
+		if (pthread_cond_timedwait(&cache_cond, &cache_mutex, &until) == ETIMEDOUT)
+			break;
+	}
+	pthread_mutex_unlock(&cache_mutex);
+	return result;
+}
+
+bool indigo_wait_for_cached_property(const char *device, const char *name, double timeout) {
+	return wait_for_state(device, name, 0, WAIT_DEFINED, INDIGO_IDLE_STATE, timeout, NULL);
+}
+
+bool indigo_wait_for_cached_property_state(const char *device, const char *name, indigo_property_state state, double timeout) {
+	return wait_for_state(device, name, 0, WAIT_STATE, state, timeout, NULL);
+}
+
+unsigned long indigo_get_cached_property_sequence(const char *device, const char *name) {
+	pthread_mutex_lock(&cache_mutex);
+	cache_entry *entry = find_entry(indigo_property_hash(device, name), device, name);
+	unsigned long sequence = entry != NULL ? entry->sequence : 0;
+	pthread_mutex_unlock(&cache_mutex);
+	return sequence;
+}
+
+bool indigo_wait_for_cached_property_done(const char *device, const char *name, unsigned long sequence, double timeout, indigo_property_state *state) {
+	return wait_for_state(device, name, sequence, WAIT_DONE, INDIGO_BUSY_STATE, timeout, state);
+}
+
+indigo_result indigo_add_property_cache_listener(const char *device, const char *name, indigo_property_cache_callback callback, void *data) {
+	indigo_result result = INDIGO_TOO_MANY_ELEMENTS;
+	pthread_mutex_lock(&cache_mutex);
+	for (int i = 0; i < MAX_LISTENERS; i++) {
+		cache_listener *listener = listeners + i;
+		if (listener->callback == NULL) {
+			strncpy(listener->device, device ? device : "", INDIGO_NAME_SIZE - 1);
+			strncpy(listener->name, name ? name : "", INDIGO_NAME_SIZE - 1);
+			listener->callback = callback;
+			listener->data = data;
+			result = INDIGO_OK;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&cache_mutex);
+	return result;
+}
+
+indigo_result indigo_remove_property_cache_listener(indigo_property_cache_callback callback, void *data) {
+	indigo_result result = INDIGO_NOT_FOUND;
+	pthread_mutex_lock(&cache_mutex);
+	for (int i = 0; i < MAX_LISTENERS; i++) {
+		cache_listener *listener = listeners + i;
+		if (listener->callback == callback && listener->data == data) {
+			listener->callback = NULL;
+			result = INDIGO_OK;
+		}
+	}
+	pthread_mutex_unlock(&cache_mutex);
+	return result;
+}
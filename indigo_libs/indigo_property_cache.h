@@ -0,0 +1,88 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO client side property cache
+ \file indigo_property_cache.h
+ */
+
+#ifndef indigo_property_cache_h
+#define indigo_property_cache_h
+
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Property cache change notification callback (called with property as broadcasted on the bus, property->name is empty if all device properties are deleted).
+ */
+typedef void (*indigo_property_cache_callback)(indigo_property *property, bool deleted, void *data);
+
+/** Property cache client (attached to the bus by indigo_start_property_cache()).
+ */
+extern indigo_client indigo_property_cache_client;
+
+/** Attach property cache to the bus and request all properties.
+ */
+extern indigo_result indigo_start_property_cache(void);
+
+/** Detach property cache from the bus and release all cached properties.
+ */
+extern indigo_result indigo_stop_property_cache(void);
+
+/** Get copy of cached property (BLOB data are not copied), returned property must be released by indigo_release_property().
+ Cached properties are never handed out directly, so the copy stays valid after the device redefines or deletes the property.
+ */
+extern indigo_property *indigo_get_cached_property(const char *device, const char *name);
+
+/** Get cached property state, returns false if property is not cached.
+ */
+extern bool indigo_get_cached_property_state(const char *device, const char *name, indigo_property_state *state);
+
+/** Wait up to timeout seconds until property is defined.
+ */
+extern bool indigo_wait_for_cached_property(const char *device, const char *name, double timeout);
+
+/** Wait up to timeout seconds until property is defined and in given state.
+ */
+extern bool indigo_wait_for_cached_property_state(const char *device, const char *name, indigo_property_state state, double timeout);
+
+/** Get sequence number of the last cached definition or update of property, returns 0 if property is not cached.
+ */
+extern unsigned long indigo_get_cached_property_sequence(const char *device, const char *name);
+
+/** Wait up to timeout seconds until property is defined or updated after given sequence number and not busy, returns final state in state (if not NULL).
+ Sequence should be taken by indigo_get_cached_property_sequence() before change request is sent, otherwise Ok or Alert state cached before the device switched to Busy is reported as done.
+ */
+extern bool indigo_wait_for_cached_property_done(const char *device, const char *name, unsigned long sequence, double timeout, indigo_property_state *state);
+
+/** Register change notification for device/property (empty or NULL strings match any).
+ */
+extern indigo_result indigo_add_property_cache_listener(const char *device, const char *name, indigo_property_cache_callback callback, void *data);
+
+/** Unregister change notification.
+ */
+extern indigo_result indigo_remove_property_cache_listener(indigo_property_cache_callback callback, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_property_cache_h */
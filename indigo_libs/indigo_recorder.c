@@ -0,0 +1,183 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO wire protocol session recorder
+ \file indigo_recorder.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+#include "indigo_recorder.h"
+#include "indigo_metrics.h"
+
+#define MAX_RECORDED_HANDLES	1024
+
+static FILE *recording = NULL;
+static double recording_start;
+static uint16_t last_connection = 0;
+static atomic_bool recording_active = false;
+static atomic_ushort connections[MAX_RECORDED_HANDLES];
+static uint8_t protocols[MAX_RECORDED_HANDLES];
+static pthread_mutex_t recording_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void write_record(int handle, indigo_record_type type, const void *data, long length) {
+	indigo_record_header header;
+	header.timestamp = (uint64_t)((indigo_metric_time() - recording_start) * 1e6);
+	header.length = (uint32_t)length;
+	header.connection = atomic_load(&connections[handle]);
+	header.type = type;
+	header.protocol = protocols[handle];
+	fwrite(&header, sizeof(header), 1, recording);
+	if (length > 0)
+		fwrite(data, 1, length, recording);
+}
+
+bool indigo_start_recording(const char *path) {
+	pthread_mutex_lock(&recording_mutex);
+	if (recording != NULL) {
+		pthread_mutex_unlock(&recording_mutex);
+		return false;
+	}
+	recording = fopen(path, "wb");
+	if (recording == NULL) {
+		pthread_mutex_unlock(&recording_mutex);
+		indigo_error("Can't create recording %s", path);
+		return false;
+	}
+	setvbuf(recording, NULL, _IOFBF, 256 * 1024);
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	uint64_t start = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+	fwrite(INDIGO_RECORDING_MAGIC, 1, 8, recording);
+	fwrite(&start, sizeof(start), 1, recording);
+	recording_start = indigo_metric_time();
+	atomic_store(&recording_active, true);
+	pthread_mutex_unlock(&recording_mutex);
+	INDIGO_LOG(indigo_log("Recording to %s", path));
+	return true;
+}
+
+void indigo_stop_recording(void) {
+	pthread_mutex_lock(&recording_mutex);
+	atomic_store(&recording_active, false);
+	if (recording != NULL) {
+		for (int handle = 0; handle < MAX_RECORDED_HANDLES; handle++) {
+			if (atomic_load(&connections[handle])) {
+				write_record(handle, INDIGO_RECORD_CLOSE, NULL, 0);
+				atomic_store(&connections[handle], 0);
+			}
+		}
+		fclose(recording);
+		recording = NULL;
+	}
+	pthread_mutex_unlock(&recording_mutex);
+}
+
+void indigo_record_connection(int handle, indigo_record_protocol protocol) {
+	if (!atomic_load(&recording_active) || handle < 0 || handle >= MAX_RECORDED_HANDLES)
+		return;
+	pthread_mutex_lock(&recording_mutex);
+	if (recording != NULL) {
+		if (++last_connection == 0)
+			last_connection = 1;
+		protocols[handle] = protocol;
+		atomic_store(&connections[handle], last_connection);
+		write_record(handle, INDIGO_RECORD_OPEN, NULL, 0);
+	}
+	pthread_mutex_unlock(&recording_mutex);
+}
+
+void indigo_record_disconnection(int handle) {
+	if (handle < 0 || handle >= MAX_RECORDED_HANDLES || atomic_load(&connections[handle]) == 0)
+		return;
+	pthread_mutex_lock(&recording_mutex);
+	if (recording != NULL && atomic_load(&connections[handle])) {
+		write_record(handle, INDIGO_RECORD_CLOSE, NULL, 0);
+		fflush(recording);
+	}
+	atomic_store(&connections[handle], 0);
+	pthread_mutex_unlock(&recording_mutex);
+}
+
+void indigo_record(int handle, indigo_record_type type, const void *data, long length) {
+	if (!atomic_load_explicit(&recording_active, memory_order_relaxed) || handle < 0 || handle >= MAX_RECORDED_HANDLES || atomic_load_explicit(&connections[handle], memory_order_relaxed) == 0 || length <= 0)
+		return;
+	pthread_mutex_lock(&recording_mutex);
+	if (recording != NULL && atomic_load(&connections[handle]))
+		write_record(handle, type, data, length);
+	pthread_mutex_unlock(&recording_mutex);
+}
+
+static void record_blob(int handle, indigo_record_type type, const unsigned char *data, long size, const char *format, long encoded) {
+	indigo_record_blob blob;
+	memset(&blob, 0, sizeof(blob));
+	/* BLOB is hashed instead of stored, size and format are enough to replay it */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (long i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	blob.hash = hash;
+	blob.size = size;
+	indigo_copy_name(blob.format, format, sizeof(blob.format));
+	blob.encoded = encoded;
+	indigo_record(handle, type, &blob, sizeof(blob));
+}
+
+void indigo_record_blob_reference(int handle, indigo_item *item) {
+	if (!atomic_load_explicit(&recording_active, memory_order_relaxed) || handle < 0 || handle >= MAX_RECORDED_HANDLES || atomic_load_explicit(&connections[handle], memory_order_relaxed) == 0)
+		return;
+	record_blob(handle, INDIGO_RECORD_BLOB, item->blob.value, item->blob.size, item->blob.format, 0);
+}
+
+void indigo_record_inbound_blob_reference(int handle, const void *data, long size, const char *format, long encoded) {
+	if (!atomic_load_explicit(&recording_active, memory_order_relaxed) || handle < 0 || handle >= MAX_RECORDED_HANDLES || atomic_load_explicit(&connections[handle], memory_order_relaxed) == 0)
+		return;
+	record_blob(handle, INDIGO_RECORD_INBOUND_BLOB, data, size, format, encoded);
+}
+
+FILE *indigo_open_recording(const char *path, uint64_t *start) {
+	char magic[8];
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return NULL;
+	if (fread(magic, 1, 8, file) != 8 || memcmp(magic, INDIGO_RECORDING_MAGIC, 8) || fread(start, sizeof(*start), 1, file) != 1) {
+		fclose(file);
+		return NULL;
+	}
+	return file;
+}
+
+bool indigo_read_record(FILE *file, indigo_record_header *header, char **payload, long *size) {
+	if (fread(header, sizeof(*header), 1, file) != 1)
+		return false;
+	if (header->length + 1 > *size) {
+		char *tmp = realloc(*payload, header->length + 1);
+		if (tmp == NULL)
+			return false;
+		*payload = tmp;
+		*size = header->length + 1;
+	}
+	if (header->length > 0 && fread(*payload, 1, header->length, file) != header->length)
+		return false;
+	(*payload)[header->length] = 0;
+	return true;
+}
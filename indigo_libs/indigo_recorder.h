@@ -0,0 +1,118 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** INDIGO wire protocol session recorder
+ \file indigo_recorder.h
+ */
+
+#ifndef indigo_recorder_h
+#define indigo_recorder_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "indigo_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Recording file signature.
+ */
+#define INDIGO_RECORDING_MAGIC	"INDIREC1"
+
+/** Record type.
+ */
+typedef enum {
+	INDIGO_RECORD_OPEN = 1,			///< client connected, protocol is set
+	INDIGO_RECORD_CLOSE,				///< client disconnected
+	INDIGO_RECORD_INBOUND,			///< raw data received from client
+	INDIGO_RECORD_OUTBOUND,			///< raw data sent to client
+	INDIGO_RECORD_BLOB,					///< BLOB sent to client, payload is indigo_record_blob instead of data
+	INDIGO_RECORD_INBOUND_BLOB	///< BLOB received from client, payload is indigo_record_blob instead of encoded data
+} indigo_record_type;
+
+/** Connection protocol.
+ */
+typedef enum {
+	INDIGO_RECORD_XML,
+	INDIGO_RECORD_JSON,
+	INDIGO_RECORD_WEBSOCKET
+} indigo_record_protocol;
+
+/** Record header, followed by length bytes of payload.
+ */
+typedef struct {
+	uint64_t timestamp;					///< microseconds since start of recording
+	uint32_t length;						///< payload length
+	uint16_t connection;				///< connection id (unique within recording)
+	uint8_t type;								///< indigo_record_type
+	uint8_t protocol;						///< indigo_record_protocol
+} indigo_record_header;
+
+/** BLOB reference stored instead of encoded BLOB data.
+ */
+typedef struct {
+	uint64_t hash;							///< FNV-1a hash of raw BLOB data
+	uint64_t size;							///< raw BLOB size
+	char format[16];						///< BLOB format
+	uint64_t encoded;						///< number of encoded bytes left out of inbound data (0 for BLOB sent to client)
+} indigo_record_blob;
+
+/** Start recording of all client connections to file.
+ */
+extern bool indigo_start_recording(const char *path);
+
+/** Stop recording and close file.
+ */
+extern void indigo_stop_recording(void);
+
+/** Mark handle as recorded client connection.
+ */
+extern void indigo_record_connection(int handle, indigo_record_protocol protocol);
+
+/** Unmark handle and record disconnection.
+ */
+extern void indigo_record_disconnection(int handle);
+
+/** Record data sent or received over handle (ignored if handle is not recorded).
+ */
+extern void indigo_record(int handle, indigo_record_type type, const void *data, long length);
+
+/** Record reference to BLOB sent over handle (ignored if handle is not recorded).
+ */
+extern void indigo_record_blob_reference(int handle, indigo_item *item);
+
+/** Record reference to BLOB received over handle, encoded is number of base64 bytes left out of inbound data (ignored if handle is not recorded).
+ */
+extern void indigo_record_inbound_blob_reference(int handle, const void *data, long size, const char *format, long encoded);
+
+/** Open recording and check signature, start time of recording (in microseconds since epoch) is returned in start.
+ */
+extern FILE *indigo_open_recording(const char *path, uint64_t *start);
+
+/** Read next record from recording, payload buffer is reallocated as needed and must be released by caller.
+ */
+extern bool indigo_read_record(FILE *file, indigo_record_header *header, char **payload, long *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* indigo_recorder_h */
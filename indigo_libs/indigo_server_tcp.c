@@ -34,11 +34,13 @@
 #include <signal.h>
 #include <stdarg.h>
 #include <fcntl.h>
+#include <poll.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include "indigo_server_tcp.h"
 #include "indigo_driver_xml.h"
@@ -46,6 +48,9 @@
 #include "indigo_client_xml.h"
 #include "indigo_base64.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
+#include "indigo_recorder.h"
+#include "indigo_flight_recorder.h"
 
 #define SHA1_SIZE 20
 #if _MSC_VER
@@ -56,7 +61,8 @@
 
 void sha1(unsigned char h[static SHA1_SIZE], const void *_sha1_restrict p, size_t n);
 
-static int server_socket;
+static int server_socket = -1;
+static bool server_socket_inherited = false;
 static struct sockaddr_in server_address;
 static bool shutdown_initiated = false;
 static int client_count = 0;
@@ -64,6 +70,7 @@ static indigo_server_tcp_callback server_callback;
 
 int indigo_server_tcp_port = 7624;
 bool indigo_is_ephemeral_port = false;
+indigo_server_tcp_client_callback indigo_server_tcp_client_hook = NULL;
 
 static struct resource {
 	char *path;
@@ -75,6 +82,57 @@ static struct resource {
 
 #define BUFFER_SIZE	1024
 
+static void client_peer(int socket, char *peer, int size) {
+	struct sockaddr_storage address;
+	socklen_t length = sizeof(address);
+	*peer = 0;
+	if (getpeername(socket, (struct sockaddr *)&address, &length) == 0) {
+		if (address.ss_family == AF_INET) {
+			struct sockaddr_in *in = (struct sockaddr_in *)&address;
+			inet_ntop(AF_INET, &in->sin_addr, peer, size);
+			snprintf(peer + strlen(peer), size - strlen(peer), ":%d", ntohs(in->sin_port));
+		} else if (address.ss_family == AF_INET6) {
+			struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&address;
+			inet_ntop(AF_INET6, &in6->sin6_addr, peer, size);
+		}
+	}
+}
+
+static void serve_client(int socket, indigo_record_protocol protocol, indigo_version version, void (*prolog)(indigo_client *client)) {
+	static const char *protocol_names[] = { "xml", "json", "websocket" };
+	char peer[INET6_ADDRSTRLEN + 8];
+	client_peer(socket, peer, sizeof(peer));
+	indigo_record_connection(socket, protocol);
+	indigo_flight_record(INDIGO_FLIGHT_CONNECT, peer, protocol_names[protocol], socket, 0);
+	indigo_client *protocol_adapter;
+	if (protocol == INDIGO_RECORD_XML)
+		protocol_adapter = indigo_xml_device_adapter(socket, socket);
+	else
+		protocol_adapter = indigo_json_device_adapter(socket, socket, protocol == INDIGO_RECORD_WEBSOCKET);
+	assert(protocol_adapter != NULL);
+	if (version != INDIGO_VERSION_NONE)
+		protocol_adapter->version = version;
+	/* hook is called before anything is written to client */
+	if (indigo_server_tcp_client_hook != NULL)
+		indigo_server_tcp_client_hook(socket, protocol_adapter, protocol, true);
+	indigo_attach_client(protocol_adapter);
+	if (prolog != NULL)
+		prolog(protocol_adapter);
+	if (protocol == INDIGO_RECORD_XML)
+		indigo_xml_parse(NULL, protocol_adapter);
+	else
+		indigo_json_parse(NULL, protocol_adapter);
+	if (indigo_server_tcp_client_hook != NULL)
+		indigo_server_tcp_client_hook(socket, protocol_adapter, protocol, false);
+	indigo_detach_client(protocol_adapter);
+	if (protocol == INDIGO_RECORD_XML)
+		indigo_release_xml_device_adapter(protocol_adapter);
+	else
+		indigo_release_json_device_adapter(protocol_adapter);
+	indigo_record_disconnection(socket);
+	indigo_flight_record(INDIGO_FLIGHT_DISCONNECT, peer, protocol_names[protocol], socket, 0);
+}
+
 static void start_worker_thread(int *client_socket) {
 	int socket = *client_socket;
 	INDIGO_LOG(indigo_log("Worker thread started socket = %d", socket));
@@ -84,20 +142,10 @@ static void start_worker_thread(int *client_socket) {
 	if (recv(socket, &c, 1, MSG_PEEK) == 1) {
 		if (c == '<') {
 			INDIGO_LOG(indigo_log("Protocol switched to XML"));
-			indigo_client *protocol_adapter = indigo_xml_device_adapter(socket, socket);
-			assert(protocol_adapter != NULL);
-			indigo_attach_client(protocol_adapter);
-			indigo_xml_parse(NULL, protocol_adapter);
-			indigo_detach_client(protocol_adapter);
-			indigo_release_xml_device_adapter(protocol_adapter);
+			serve_client(socket, INDIGO_RECORD_XML, INDIGO_VERSION_NONE, NULL);
 		} else if (c == '{') {
 			INDIGO_LOG(indigo_log("Protocol switched to JSON"));
-			indigo_client *protocol_adapter = indigo_json_device_adapter(socket, socket, false);
-			assert(protocol_adapter != NULL);
-			indigo_attach_client(protocol_adapter);
-			indigo_json_parse(NULL, protocol_adapter);
-			indigo_detach_client(protocol_adapter);
-			indigo_release_json_device_adapter(protocol_adapter);
+			serve_client(socket, INDIGO_RECORD_JSON, INDIGO_VERSION_NONE, NULL);
 		} else if (c == 'G') {
 			char request[BUFFER_SIZE];
 			char header[BUFFER_SIZE];
@@ -132,11 +180,7 @@ static void start_worker_thread(int *client_socket) {
 							indigo_printf(socket, "Sec-WebSocket-Accept: %s\r\n", websocket_key);
 							indigo_printf(socket, "\r\n");
 							INDIGO_LOG(indigo_log("Protocol switched to JSON-over-WebSockets"));
-							indigo_client *protocol_adapter = indigo_json_device_adapter(socket, socket, true);
-							assert(protocol_adapter != NULL);
-							indigo_attach_client(protocol_adapter);
-							indigo_json_parse(NULL, protocol_adapter);
-							indigo_detach_client(protocol_adapter);
+							serve_client(socket, INDIGO_RECORD_WEBSOCKET, INDIGO_VERSION_NONE, NULL);
 							break;
 						} else {
 							indigo_printf(socket, "HTTP/1.1 301 OK\r\n");
@@ -176,6 +220,21 @@ static void start_worker_thread(int *client_socket) {
 								INDIGO_LOG(indigo_log("%s -> Failed", request));
 								break;
 							}
+						} else if (!strcmp(path, "/metrics")) {
+							long length = 0;
+							char *text = indigo_metrics_text(&length);
+							indigo_printf(socket, "HTTP/1.1 200 OK\r\n");
+							indigo_printf(socket, "Server: INDIGO/%d.%d-%d\r\n", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD);
+							if (keep_alive)
+								indigo_printf(socket, "Connection: keep-alive\r\n");
+							indigo_printf(socket, "Content-Type: text/plain; version=0.0.4\r\n");
+							indigo_printf(socket, "Content-Length: %ld\r\n", length);
+							indigo_printf(socket, "\r\n");
+							if (text != NULL) {
+								indigo_write(socket, text, length);
+								free(text);
+							}
+							INDIGO_LOG(indigo_log("%s -> OK (%ld bytes)", request, length));
 						} else {
 							struct resource *resource = resources;
 							while (resource != NULL)
@@ -233,8 +292,9 @@ static void start_worker_thread(int *client_socket) {
 void indigo_server_shutdown() {
 	if (!shutdown_initiated) {
 		shutdown_initiated = true;
-		shutdown(server_socket, SHUT_RDWR);
-		close(server_socket);
+		/* shutdown() would stop listening in parent process as well, accept loop polls for shutdown_initiated instead */
+		if (!server_socket_inherited)
+			shutdown(server_socket, SHUT_RDWR);
 	}
 }
 
@@ -249,12 +309,10 @@ void indigo_server_add_resource(const char *path, unsigned char *data, unsigned
 	resources = resource;
 }
 
-indigo_result indigo_server_start(indigo_server_tcp_callback callback) {
-	server_callback = callback;
-	int client_socket;
+indigo_result indigo_server_listen(void) {
 	int reuse = 1;
-	struct sockaddr_in client_name;
-	unsigned int name_len = sizeof(client_name);
+	if (server_socket >= 0)
+		return INDIGO_OK;
 	server_socket = socket(PF_INET, SOCK_STREAM, 0);
 	if (server_socket == -1) {
 		indigo_error("Can't open server socket (%s)", strerror(errno));
@@ -265,33 +323,87 @@ indigo_result indigo_server_start(indigo_server_tcp_callback callback) {
 	server_address.sin_addr.s_addr = htonl(INADDR_ANY);
 	if (setsockopt(server_socket, SOL_SOCKET,SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
 		indigo_error("Can't setsockopt for server socket (%s)", strerror(errno));
+		close(server_socket);
+		server_socket = -1;
 		return INDIGO_CANT_START_SERVER;
 	}
 	if (bind(server_socket, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
 		indigo_error("Can't bind server socket (%s)", strerror(errno));
+		close(server_socket);
+		server_socket = -1;
 		return INDIGO_CANT_START_SERVER;
 	}
 	unsigned int length = sizeof(server_address);
 	if (getsockname(server_socket, (struct sockaddr *)&server_address, &length) == -1) {
 		close(server_socket);
+		server_socket = -1;
 		return INDIGO_CANT_START_SERVER;
 	}
 	if (listen(server_socket, 5) < 0) {
 		indigo_error("Can't listen on server socket (%s)", strerror(errno));
 		close(server_socket);
+		server_socket = -1;
 		return INDIGO_CANT_START_SERVER;
 	}
 	indigo_is_ephemeral_port = indigo_server_tcp_port == 0;
 	indigo_server_tcp_port = ntohs(server_address.sin_port);
+	return INDIGO_OK;
+}
+
+static void adopted_client_thread(void **args) {
+	int socket = (int)(intptr_t)args[0];
+	/* client may be adopted before server is started */
+	++client_count;
+	serve_client(socket, (indigo_record_protocol)(intptr_t)args[1], (indigo_version)(intptr_t)args[2], (void (*)(indigo_client *))args[3]);
+	--client_count;
+	if (server_callback != NULL)
+		server_callback(client_count);
+	free(args);
+	INDIGO_LOG(indigo_log("Worker thread finished"));
+}
+
+void indigo_server_adopt_client(int socket, indigo_record_protocol protocol, indigo_version version, void (*prolog)(indigo_client *client)) {
+	INDIGO_LOG(indigo_log("Worker thread started for inherited socket = %d", socket));
+	void **args = malloc(4 * sizeof(void *));
+	args[0] = (void *)(intptr_t)socket;
+	args[1] = (void *)(intptr_t)protocol;
+	args[2] = (void *)(intptr_t)version;
+	args[3] = (void *)prolog;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, (void *(*)(void *))&adopted_client_thread, args) != 0) {
+		indigo_error("Can't create worker thread for connection (%s)", strerror(errno));
+		free(args);
+	} else {
+		pthread_detach(thread);
+	}
+}
+
+indigo_result indigo_server_start(indigo_server_tcp_callback callback) {
+	server_callback = callback;
+	int client_socket;
+	struct sockaddr_in client_name;
+	unsigned int name_len = sizeof(client_name);
+	/* listening socket is opened by parent process if worker process is restarted */
+	server_socket_inherited = server_socket >= 0;
+	indigo_result result = indigo_server_listen();
+	if (result != INDIGO_OK)
+		return result;
 	INDIGO_LOG(indigo_log("Server started on %d", indigo_server_tcp_port));
 	server_callback(client_count);
 	signal(SIGPIPE, SIG_IGN);
 	while (1) {
+		struct pollfd fd = { server_socket, POLLIN, 0 };
+		int rc = poll(&fd, 1, 500);
+		if (shutdown_initiated)
+			break;
+		if (rc <= 0)
+			continue;
 		client_socket = accept(server_socket, (struct sockaddr *)&client_name, &name_len);
 		if (client_socket == -1) {
 			if (shutdown_initiated)
 				break;
-			indigo_error("Can't accept connection (%s)", strerror(errno));
+			if (errno != EAGAIN && errno != EINTR)
+				indigo_error("Can't accept connection (%s)", strerror(errno));
 		} else {
 			pthread_t thread;
 			int *pointer = malloc(sizeof(int));
@@ -300,6 +412,9 @@ indigo_result indigo_server_start(indigo_server_tcp_callback callback) {
 				indigo_error("Can't create worker thread for connection (%s)", strerror(errno));
 		}
 	}
+	close(server_socket);
+	server_socket = -1;
+	server_socket_inherited = false;
 	shutdown_initiated = false;
 	return INDIGO_OK;
 }
@@ -27,6 +27,7 @@
 #define indigo_server_tcp_h
 
 #include "indigo_bus.h"
+#include "indigo_recorder.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +37,10 @@ extern "C" {
  */
 typedef void (*indigo_server_tcp_callback)(int);
 
+/** Prototype of callback function called when connection is switched to INDIGO protocol before client is attached (connected = true) and before it is closed (connected = false).
+ */
+typedef void (*indigo_server_tcp_client_callback)(int socket, indigo_client *client, indigo_record_protocol protocol, bool connected);
+
 /** TCP port to run on.
  */
 extern int indigo_server_tcp_port;
@@ -44,10 +49,22 @@ extern int indigo_server_tcp_port;
  */
 extern bool indigo_is_ephemeral_port;
 
+/** Client connection callback (used to keep client sockets in parent process over worker restart).
+ */
+extern indigo_server_tcp_client_callback indigo_server_tcp_client_hook;
+
 /** Add static document.
  */
 extern void indigo_server_add_resource(const char *path, unsigned char *data, unsigned length, const char *content_type);
 
+/** Open listening socket (if called before indigo_server_start() in parent process, socket is inherited by forked worker).
+ */
+extern indigo_result indigo_server_listen(void);
+
+/** Serve client connection inherited from previous worker process, prolog is called after client is attached, before any request is processed.
+ */
+extern void indigo_server_adopt_client(int socket, indigo_record_protocol protocol, indigo_version version, void (*prolog)(indigo_client *client));
+
 /** Start network server (function will block until server is active).
  */
 extern indigo_result indigo_server_start(indigo_server_tcp_callback callback);
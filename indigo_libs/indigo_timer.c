@@ -32,6 +32,8 @@
 #include "indigo_timer.h"
 
 #include "indigo_driver.h"
+#include "indigo_metrics.h"
+#include "indigo_flight_recorder.h"
 
 
 #ifdef __MACH__ /* Mac OSX prior Sierra is missing clock_gettime() */
@@ -59,10 +61,23 @@ indigo_timer *free_timer;
 pthread_mutex_t free_timer_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t cancel_timer_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static double timer_count_metric(void *data) {
+	return timer_count;
+}
+
+static indigo_metric *lateness_metric = NULL;
+static pthread_once_t metrics_once = PTHREAD_ONCE_INIT;
+
+static void register_metrics(void) {
+	lateness_metric = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_timer_lateness_seconds", "Delay between scheduled and real timer callback execution", NULL, NULL);
+	indigo_register_metric_provider(INDIGO_METRIC_GAUGE, "indigo_timer_threads", "Number of allocated timer threads", NULL, NULL, timer_count_metric, NULL);
+}
+
 static void *timer_func(indigo_timer *timer) {
 	while (true) {
 		while (timer->scheduled) {
 			INDIGO_TRACE(indigo_trace("timer #%d (of %d) used for %gs", timer->timer_id, timer_count, timer->delay));
+			double lateness = 0;
 			if (timer->delay > 0) {
 				struct timespec end;
 				utc_time(&end);
@@ -76,10 +91,17 @@ static void *timer_func(indigo_timer *timer) {
 					if (rc == ETIMEDOUT)
 						break;
 				}
+				if (!timer->canceled) {
+					struct timespec now;
+					utc_time(&now);
+					lateness = (now.tv_sec - end.tv_sec) + (double)(now.tv_nsec - end.tv_nsec) / NANO;
+					indigo_metric_observe(lateness_metric, lateness);
+				}
 			}
 
 			timer->scheduled = false;
 			if (!timer->canceled) {
+				indigo_flight_record(INDIGO_FLIGHT_TIMER, timer->device != NULL ? timer->device->name : NULL, NULL, timer->timer_id, lateness);
 				timer->callback(timer->device);
 			}
 		}
@@ -120,6 +142,7 @@ static void *timer_func(indigo_timer *timer) {
 
 indigo_timer *indigo_set_timer(indigo_device *device, double delay, indigo_timer_callback callback) {
 	indigo_timer *timer = NULL;
+	pthread_once(&metrics_once, register_metrics);
 	pthread_mutex_lock(&free_timer_mutex);
 	if (free_timer != NULL) {
 		timer = free_timer;
@@ -24,6 +24,7 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 
 #include "indigo_version.h"
 #include "indigo_names.h"
@@ -373,16 +374,84 @@ static struct property_mapping legacy[] = {
 	NULL
 };
 
+/* legacy[] is indexed once into open addressing hash tables, keys are names (and owning property for items) */
+
+#define PROPERTY_HASH_SIZE	256
+#define ITEM_HASH_SIZE			1024
+
+struct item_hash_entry {
+	struct property_mapping *property;
+	struct item_mapping *item;
+};
+
+static struct property_mapping *property_by_legacy[PROPERTY_HASH_SIZE];
+static struct property_mapping *property_by_current[PROPERTY_HASH_SIZE];
+static struct item_hash_entry item_by_legacy[ITEM_HASH_SIZE];
+static struct item_hash_entry item_by_current[ITEM_HASH_SIZE];
+static pthread_once_t hash_once = PTHREAD_ONCE_INIT;
+
+static unsigned name_hash(const char *name, unsigned seed) {
+	return (unsigned)indigo_hash(INDIGO_HASH_INIT ^ seed, name, INDIGO_NAME_SIZE);
+}
+
+static void insert_property(struct property_mapping **table, const char *name, struct property_mapping *property_mapping) {
+	unsigned i = name_hash(name, 0) & (PROPERTY_HASH_SIZE - 1);
+	while (table[i])
+		i = (i + 1) & (PROPERTY_HASH_SIZE - 1);
+	table[i] = property_mapping;
+}
+
+static void insert_item(struct item_hash_entry *table, const char *name, struct property_mapping *property_mapping, struct item_mapping *item_mapping) {
+	unsigned i = name_hash(name, (unsigned)(property_mapping - legacy)) & (ITEM_HASH_SIZE - 1);
+	while (table[i].item)
+		i = (i + 1) & (ITEM_HASH_SIZE - 1);
+	table[i].property = property_mapping;
+	table[i].item = item_mapping;
+}
+
+static void build_hash_tables(void) {
+	for (struct property_mapping *property_mapping = legacy; property_mapping->legacy; property_mapping++) {
+		insert_property(property_by_legacy, property_mapping->legacy, property_mapping);
+		insert_property(property_by_current, property_mapping->current, property_mapping);
+		for (struct item_mapping *item_mapping = property_mapping->items; item_mapping->legacy; item_mapping++) {
+			insert_item(item_by_legacy, item_mapping->legacy, property_mapping, item_mapping);
+			insert_item(item_by_current, item_mapping->current, property_mapping, item_mapping);
+		}
+	}
+}
+
+static struct property_mapping *find_property(const char *name, bool by_legacy) {
+	pthread_once(&hash_once, build_hash_tables);
+	struct property_mapping **table = by_legacy ? property_by_legacy : property_by_current;
+	unsigned i = name_hash(name, 0) & (PROPERTY_HASH_SIZE - 1);
+	struct property_mapping *property_mapping;
+	while ((property_mapping = table[i])) {
+		if (!strcmp(name, by_legacy ? property_mapping->legacy : property_mapping->current))
+			return property_mapping;
+		i = (i + 1) & (PROPERTY_HASH_SIZE - 1);
+	}
+	return NULL;
+}
+
+static struct item_mapping *find_item(struct property_mapping *property_mapping, const char *name, bool by_legacy) {
+	struct item_hash_entry *table = by_legacy ? item_by_legacy : item_by_current;
+	unsigned i = name_hash(name, (unsigned)(property_mapping - legacy)) & (ITEM_HASH_SIZE - 1);
+	struct item_hash_entry *entry;
+	while ((entry = table + i)->item) {
+		if (entry->property == property_mapping && !strcmp(name, by_legacy ? entry->item->legacy : entry->item->current))
+			return entry->item;
+		i = (i + 1) & (ITEM_HASH_SIZE - 1);
+	}
+	return NULL;
+}
+
 void indigo_copy_property_name(indigo_version version, indigo_property *property, const char *name) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(name, property_mapping->legacy)) {
-				INDIGO_TRACE(indigo_trace("version: %s -> %s (current)", property_mapping->legacy, property_mapping->current));
-				strcpy(property->name, property_mapping->current);
-				return;
-			}
-			property_mapping++;
+		struct property_mapping *property_mapping = find_property(name, true);
+		if (property_mapping) {
+			INDIGO_TRACE(indigo_trace("version: %s -> %s (current)", property_mapping->legacy, property_mapping->current));
+			strcpy(property->name, property_mapping->current);
+			return;
 		}
 	}
 	strncpy(property->name, name, INDIGO_NAME_SIZE);
@@ -390,22 +459,14 @@ void indigo_copy_property_name(indigo_version version, indigo_property *property
 
 void indigo_copy_item_name(indigo_version version, indigo_property *property, indigo_item *item, const char *name) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(property->name, property_mapping->current)) {
-				struct item_mapping *item_mapping = property_mapping->items;
-				while (item_mapping->legacy) {
-					if (!strcmp(name, item_mapping->legacy)) {
-						INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (current)", property_mapping->legacy, item_mapping->legacy, property_mapping->current, item_mapping->current));
-						strncpy(item->name, item_mapping->current, INDIGO_NAME_SIZE);
-						return;
-					}
-					item_mapping++;
-				}
-				strncpy(item->name, name, INDIGO_NAME_SIZE);
+		struct property_mapping *property_mapping = find_property(property->name, false);
+		if (property_mapping) {
+			struct item_mapping *item_mapping = find_item(property_mapping, name, true);
+			if (item_mapping) {
+				INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (current)", property_mapping->legacy, item_mapping->legacy, property_mapping->current, item_mapping->current));
+				strncpy(item->name, item_mapping->current, INDIGO_NAME_SIZE);
 				return;
 			}
-			property_mapping++;
 		}
 	}
 	strncpy(item->name, name, INDIGO_NAME_SIZE);
@@ -413,13 +474,10 @@ void indigo_copy_item_name(indigo_version version, indigo_property *property, in
 
 const char *indigo_property_name(indigo_version version, indigo_property *property) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(property->name, property_mapping->current)) {
-				INDIGO_TRACE(indigo_trace("version: %s -> %s (legacy)", property_mapping->current, property_mapping->legacy));
-				return property_mapping->legacy;
-			}
-			property_mapping++;
+		struct property_mapping *property_mapping = find_property(property->name, false);
+		if (property_mapping) {
+			INDIGO_TRACE(indigo_trace("version: %s -> %s (legacy)", property_mapping->current, property_mapping->legacy));
+			return property_mapping->legacy;
 		}
 	}
 	return property->name;
@@ -427,20 +485,13 @@ const char *indigo_property_name(indigo_version version, indigo_property *proper
 
 const char *indigo_item_name(indigo_version version, indigo_property *property, indigo_item *item) {
 	if (version == INDIGO_VERSION_LEGACY) {
-		struct property_mapping *property_mapping = legacy;
-		while (property_mapping->legacy) {
-			if (!strcmp(property->name, property_mapping->current)) {
-				struct item_mapping *item_mapping = property_mapping->items;
-				while (item_mapping->legacy) {
-					if (!strcmp(item->name, item_mapping->current)) {
-						INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (legacy)", property_mapping->current, item_mapping->current, property_mapping->legacy, item_mapping->legacy));
-						return item_mapping->legacy;
-					}
-					item_mapping++;
-				}
-				return item->name;
+		struct property_mapping *property_mapping = find_property(property->name, false);
+		if (property_mapping) {
+			struct item_mapping *item_mapping = find_item(property_mapping, item->name, false);
+			if (item_mapping) {
+				INDIGO_TRACE(indigo_trace("version: %s.%s -> %s.%s (legacy)", property_mapping->current, item_mapping->current, property_mapping->legacy, item_mapping->legacy));
+				return item_mapping->legacy;
 			}
-			property_mapping++;
 		}
 	}
 	return item->name;
@@ -23,6 +23,8 @@
  \file indigo_xml.c
  */
 
+#define INDIGO_LOG_SUBSYSTEM INDIGO_LOG_PROTOCOL
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -34,16 +36,23 @@
 #include <pthread.h>
 #include <math.h>
 #include <fcntl.h>
+#include <time.h>
+#include <poll.h>
 
 #include "indigo_base64.h"
+#include "indigo_blob_ring.h"
 #include "indigo_xml.h"
 #include "indigo_io.h"
+#include "indigo_metrics.h"
+#include "indigo_recorder.h"
 #include "indigo_version.h"
 #include "indigo_driver_xml.h"
 
 #define BUFFER_SIZE 524288  /* BUFFER_SIZE % 4 == 0, inportant for base64 */
 
-#define PROPERTY_SIZE sizeof(indigo_property)+INDIGO_MAX_ITEMS*(sizeof(indigo_item))
+#define INITIAL_ITEMS	8  /* property buffer grows on demand up to INDIGO_MAX_ITEMS */
+
+#define RETAINED_PROPERTY_TIMEOUT	2  /* seconds to wait for redefinition of retained properties after reconnect */
 
 typedef enum {
 	ERROR,
@@ -113,17 +122,51 @@ static indigo_rule parse_rule(char *value) {
 }
 
 typedef struct {
-	char property_buffer[PROPERTY_SIZE];
+	indigo_property *property;
+	int capacity;
 	indigo_device *device;
 	indigo_client *client;
 	int count;
 	indigo_property **properties;
+	unsigned long long *hashes;
+	bool *redefined;
+	time_t sweep_time;
+	double blob_start;
+	uint64_t ring_reference;
+	bool ring_pending;
+	uint64_t ring_position;
+	long ring_size;
+	indigo_blob_delivery_policy blob_policy;
+	int blob_nth;
 } parser_context;
 
 bool indigo_use_blob_urls = true;
 
+static void reset_property(parser_context *context) {
+	memset(context->property, 0, sizeof(indigo_property) + context->property->count * sizeof(indigo_item));
+}
+
+static indigo_property *reserve_item(parser_context *context) {
+	indigo_property *property = context->property;
+	if (property->count == context->capacity && context->capacity < INDIGO_MAX_ITEMS) {
+		int capacity = context->capacity * 2 < INDIGO_MAX_ITEMS ? context->capacity * 2 : INDIGO_MAX_ITEMS;
+		property = realloc(property, sizeof(indigo_property) + capacity * sizeof(indigo_item));
+		if (property == NULL)
+			return context->property;
+		memset(property->items + context->capacity, 0, (capacity - context->capacity) * sizeof(indigo_item));
+		context->property = property;
+		context->capacity = capacity;
+	}
+	return property;
+}
+
 typedef void *(* parser_handler)(parser_state state, parser_context *context, char *name, char *value, char *message);
 
+/* locale independent ASCII character classes used by tokenizer */
+
+#define xml_isalpha(c) ((unsigned char)(((c) | 0x20) - 'a') < 26)
+#define xml_isspace(c) ((c) == ' ' || (c) == '\n' || (c) == '\t' || (c) == '\r')
+
 static void *top_level_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
 static void *new_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
 static void *new_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
@@ -140,7 +183,7 @@ static void *set_light_vector_handler(parser_state state, parser_context *contex
 static void *set_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message);
 
 static void *enable_blob_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	assert(client != NULL);
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: enable_blob_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
@@ -149,6 +192,15 @@ static void *enable_blob_handler(parser_state state, parser_context *context, ch
 			strncpy(property->device, value,INDIGO_NAME_SIZE);
 		} else if (!strcmp(name, "name")) {
 			indigo_copy_property_name(client ? client->version : INDIGO_VERSION_CURRENT, property, value);
+		} else if (!strcmp(name, "policy")) {
+			if (!strcmp(value, "all"))
+				context->blob_policy = INDIGO_BLOB_DELIVERY_ALL;
+			else if (!strcmp(value, "latest"))
+				context->blob_policy = INDIGO_BLOB_DELIVERY_LATEST;
+			else if (!strcmp(value, "nth"))
+				context->blob_policy = INDIGO_BLOB_DELIVERY_NTH;
+		} else if (!strcmp(name, "nth")) {
+			context->blob_nth = atoi(value);
 		}
 	} else if (state == TEXT) {
 		indigo_enable_blob_mode_record *record = client->enable_blob_mode_records;
@@ -177,6 +229,8 @@ static void *enable_blob_handler(parser_state state, parser_context *context, ch
 				record->mode = INDIGO_ENABLE_BLOB_URL;
 			else
 				record->mode = INDIGO_ENABLE_BLOB_ALSO;
+			record->policy = context->blob_policy;
+			record->nth = context->blob_nth > 0 ? context->blob_nth : 1;
 			record->next = client->enable_blob_mode_records;
 			client->enable_blob_mode_records = record;
 			indigo_enable_blob(client, property, record->mode);
@@ -184,14 +238,16 @@ static void *enable_blob_handler(parser_state state, parser_context *context, ch
 			indigo_enable_blob(client, property, INDIGO_ENABLE_BLOB_NEVER);
 		}		
 	} else if (state == END_TAG) {
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
+		context->blob_policy = INDIGO_BLOB_DELIVERY_DEFAULT;
+		context->blob_nth = 0;
 		return top_level_handler;
 	}
 	return enable_blob_handler;
 }
 
 static void *get_properties_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	assert(client != NULL);
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: get_properties_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
@@ -215,6 +271,10 @@ static void *get_properties_handler(parser_state state, parser_context *context,
 				indigo_printf(handle, "<switchProtocol version='%d.%d'/>\n", (version >> 8) & 0xFF, version & 0xFF);
 				client->version = version;
 			}
+		} else if (!strcmp(name, "delta")) {
+			/* INDIGO 2.x client can merge updates with changed items only */
+			assert(client->client_context != NULL);
+			((indigo_adapter_context *)(client->client_context))->delta_updates = !strcmp(value, "true");
 		} else if (!strncmp(name, "device",INDIGO_NAME_SIZE)) {
 			strncpy(property->device, value, INDIGO_NAME_SIZE);
 		} else if (!strncmp(name, "name",INDIGO_NAME_SIZE)) {
@@ -222,14 +282,14 @@ static void *get_properties_handler(parser_state state, parser_context *context,
 		}
 	} else if (state == END_TAG) {
 		indigo_enumerate_properties(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return get_properties_handler;
 }
 
 static void *new_one_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_one_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -245,12 +305,12 @@ static void *new_one_text_vector_handler(parser_state state, parser_context *con
 }
 
 static void *new_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneText")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return new_one_text_vector_handler;
 		}
@@ -264,14 +324,14 @@ static void *new_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return new_text_vector_handler;
 }
 
 static void *new_one_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_one_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -287,12 +347,12 @@ static void *new_one_number_vector_handler(parser_state state, parser_context *c
 }
 
 static void *new_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneNumber")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return new_one_number_vector_handler;
 		}
@@ -306,14 +366,14 @@ static void *new_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return new_number_vector_handler;
 }
 
 static void *new_one_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_one_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -329,12 +389,12 @@ static void *new_one_switch_vector_handler(parser_state state, parser_context *c
 }
 
 static void *new_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: new_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneSwitch")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return new_one_switch_vector_handler;
 		}
@@ -349,7 +409,7 @@ static void *new_switch_vector_handler(parser_state state, parser_context *conte
 		return new_switch_vector_handler;
 	} else if (state == END_TAG) {
 		indigo_change_property(client, property);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return new_switch_vector_handler;
@@ -372,9 +432,10 @@ static void *switch_protocol_handler(parser_state state, parser_context *context
 }
 
 static void set_property(parser_context *context, indigo_property *other, char *message) {
+	unsigned long long hash = indigo_property_hash(other->device, other->name);
 	for (int index = 0; index < context->count; index++) {
 		indigo_property *property = context->properties[index];
-		if (property != NULL && !strncmp(property->device, other->device, INDIGO_NAME_SIZE) && !strncmp(property->name, other->name, INDIGO_NAME_SIZE)) {
+		if (property != NULL && context->hashes[index] == hash && !strncmp(property->device, other->device, INDIGO_NAME_SIZE) && !strncmp(property->name, other->name, INDIGO_NAME_SIZE)) {
 			property->state = other->state;
 			if (property->type == INDIGO_SWITCH_VECTOR && property->rule != INDIGO_ANY_OF_MANY_RULE) {
 				for (int j = 0; j < property->count; j++) {
@@ -383,49 +444,47 @@ static void set_property(parser_context *context, indigo_property *other, char *
 			}
 			for (int i = 0; i < other->count; i++) {
 				indigo_item *other_item = &other->items[i];
-				for (int j = 0; j < property->count; j++) {
+				int j = indigo_find_item(property, other_item->name, i);
+				if (j >= 0) {
 					indigo_item *property_item = &property->items[j];
-					if (!strcmp(property_item->name, other_item->name)) {
-						switch (property->type) {
-							case INDIGO_TEXT_VECTOR:
-								strncpy(property_item->text.value, other_item->text.value, INDIGO_VALUE_SIZE);
-								break;
-							case INDIGO_NUMBER_VECTOR:
-								property_item->number.value = other_item->number.value;
-								if (!isnan(other_item->number.min))
-									property_item->number.min = other_item->number.min;
-								if (!isnan(other_item->number.max))
-									property_item->number.max = other_item->number.max;
-								if (!isnan(other_item->number.step))
-									property_item->number.step = other_item->number.step;
-								if (property_item->number.value < property_item->number.min) {
-									//property_item->number.value = property_item->number.min;
-									indigo_debug("%s.%s value out of range", property->name, property_item->name);
-								}
-								if (property_item->number.value > property_item->number.max) {
-									//property_item->number.value = property_item->number.max;
-									indigo_debug("%s.%s value out of range", property->name, property_item->name);
-								}
-								property_item->number.target = other_item->number.target;
-								break;
-							case INDIGO_SWITCH_VECTOR:
-								property_item->sw.value = other_item->sw.value;
-								break;
-							case INDIGO_LIGHT_VECTOR:
-								property_item->light.value = other_item->light.value;
-								break;
-							case INDIGO_BLOB_VECTOR:
-								strncpy(property_item->blob.format, other_item->blob.format, INDIGO_NAME_SIZE);
-								strncpy(property_item->blob.url, other_item->blob.url, INDIGO_VALUE_SIZE);
-								property_item->blob.size = other_item->blob.size;
-								if (property_item->blob.value != NULL)
-									property_item->blob.value = realloc(property_item->blob.value, property_item->blob.size);
-								else
-									property_item->blob.value = malloc(property_item->blob.size);
-								memcpy(property_item->blob.value, other_item->blob.value, property_item->blob.size);
-								break;
-						}
-						break;
+					switch (property->type) {
+						case INDIGO_TEXT_VECTOR:
+							strncpy(property_item->text.value, other_item->text.value, INDIGO_VALUE_SIZE);
+							break;
+						case INDIGO_NUMBER_VECTOR:
+							property_item->number.value = other_item->number.value;
+							if (!isnan(other_item->number.min))
+								property_item->number.min = other_item->number.min;
+							if (!isnan(other_item->number.max))
+								property_item->number.max = other_item->number.max;
+							if (!isnan(other_item->number.step))
+								property_item->number.step = other_item->number.step;
+							if (property_item->number.value < property_item->number.min) {
+								//property_item->number.value = property_item->number.min;
+								INDIGO_CHECKED_DEBUG("%s.%s value out of range", property->name, property_item->name);
+							}
+							if (property_item->number.value > property_item->number.max) {
+								//property_item->number.value = property_item->number.max;
+								INDIGO_CHECKED_DEBUG("%s.%s value out of range", property->name, property_item->name);
+							}
+							property_item->number.target = other_item->number.target;
+							break;
+						case INDIGO_SWITCH_VECTOR:
+							property_item->sw.value = other_item->sw.value;
+							break;
+						case INDIGO_LIGHT_VECTOR:
+							property_item->light.value = other_item->light.value;
+							break;
+						case INDIGO_BLOB_VECTOR:
+							strncpy(property_item->blob.format, other_item->blob.format, INDIGO_NAME_SIZE);
+							strncpy(property_item->blob.url, other_item->blob.url, INDIGO_VALUE_SIZE);
+							property_item->blob.size = other_item->blob.size;
+							if (property_item->blob.value != NULL)
+								property_item->blob.value = realloc(property_item->blob.value, property_item->blob.size);
+							else
+								property_item->blob.value = malloc(property_item->blob.size);
+							memcpy(property_item->blob.value, other_item->blob.value, property_item->blob.size);
+							break;
 					}
 				}
 			}
@@ -437,7 +496,7 @@ static void set_property(parser_context *context, indigo_property *other, char *
 }
 
 static void *set_one_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -453,12 +512,12 @@ static void *set_one_text_vector_handler(parser_state state, parser_context *con
 }
 
 static void *set_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneText")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return set_one_text_vector_handler;
 		}
@@ -477,14 +536,14 @@ static void *set_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_text_vector_handler;
 }
 
 static void *set_one_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -510,12 +569,12 @@ static void *set_one_number_vector_handler(parser_state state, parser_context *c
 }
 
 static void *set_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneNumber")) {
-			if (property->count < INDIGO_MAX_ITEMS) {
+			if ((property = reserve_item(context))->count < context->capacity) {
 				property->items[property->count].number.min = NAN;
 				property->items[property->count].number.max = NAN;
 				property->items[property->count].number.step = NAN;
@@ -538,14 +597,14 @@ static void *set_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_number_vector_handler;
 }
 
 static void *set_one_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -561,12 +620,12 @@ static void *set_one_switch_vector_handler(parser_state state, parser_context *c
 }
 
 static void *set_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneSwitch")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return set_one_switch_vector_handler;
 		}
@@ -585,14 +644,14 @@ static void *set_switch_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_switch_vector_handler;
 }
 
 static void *set_one_light_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_light_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -608,12 +667,12 @@ static void *set_one_light_vector_handler(parser_state state, parser_context *co
 }
 
 static void *set_light_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_light_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneLight")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return set_one_light_vector_handler;
 		}
@@ -632,14 +691,41 @@ static void *set_light_vector_handler(parser_state state, parser_context *contex
 		}
 	} else if (state == END_TAG) {
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_light_vector_handler;
 }
 
+/* BLOB throughput by transport, inline base64 or shared memory ring (subprocess drivers) */
+
+static indigo_metric *blob_metrics[2][2];
+static indigo_metric *base64_metric = NULL;
+static pthread_once_t metrics_once = PTHREAD_ONCE_INIT;
+
+static void register_metrics(void) {
+	for (int transport = 0; transport < 2; transport++) {
+		const char *label = transport ? "ring" : "inline";
+		blob_metrics[transport][0] = indigo_register_metric(INDIGO_METRIC_COUNTER, "indigo_blob_received_bytes_total", "BLOB bytes received from devices", "transport", label);
+		blob_metrics[transport][1] = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_blob_receive_seconds", "Time to receive and process BLOB", "transport", label);
+	}
+	base64_metric = indigo_register_metric(INDIGO_METRIC_HISTOGRAM, "indigo_base64_seconds", "Time spent in base64 encoding or decoding of BLOB", "operation", "decode");
+}
+
+static void blob_received(parser_context *context) {
+	int transport = context->ring_size != 0;
+	long size = 0;
+	for (int i = 0; i < context->property->count; i++)
+		if (context->property->items[i].blob.value != NULL)
+			size += context->property->items[i].blob.size;
+	if (size == 0)
+		return;
+	indigo_metric_add(blob_metrics[transport][0], size);
+	indigo_metric_observe(blob_metrics[transport][1], indigo_metric_time() - context->blob_start);
+}
+
 static void *set_one_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_DEBUG_PROTOCOL(if (state == BLOB))
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_one_blob_vector_handler %s '%s' DATA", parser_state_name[state], name != NULL ? name : ""));
@@ -656,23 +742,43 @@ static void *set_one_blob_vector_handler(parser_state state, parser_context *con
 			snprintf(property->items[property->count-1].blob.url, INDIGO_VALUE_SIZE, "%s%s", ((indigo_adapter_context *)context->device->device_context)->url_prefix, value);
 		} else if (!strcmp(name, "url")) {
 			strncpy(property->items[property->count-1].blob.url, value, INDIGO_VALUE_SIZE);
+		} else if (!strcmp(name, "ring")) {
+			/* BLOB passed by subprocess driver in shared memory, resolved when all attributes (size) are known */
+			context->ring_reference = strtoull(value, NULL, 10);
+			context->ring_pending = true;
 		}
 	} else if (state == BLOB) {
 		property->items[property->count-1].blob.value = value;
 	} else if (state == END_TAG) {
+		if (context->ring_pending) {
+			indigo_item *item = property->items + property->count - 1;
+			indigo_blob_ring *ring = ((indigo_adapter_context *)device->device_context)->blob_ring;
+			if (ring != NULL && item->blob.size > 0 && (item->blob.value = indigo_blob_ring_get(ring, context->ring_reference, item->blob.size)) != NULL) {
+				/* ring space is released up to the last BLOB of vector after property is processed */
+				context->ring_position = context->ring_reference;
+				context->ring_size = item->blob.size;
+			} else {
+				INDIGO_ERROR(indigo_error("XML Parser: invalid BLOB ring reference %llu", (unsigned long long)context->ring_reference));
+				item->blob.value = NULL;
+				item->blob.size = 0;
+			}
+			context->ring_pending = false;
+		}
 		return set_blob_vector_handler;
 	}
 	return set_one_blob_vector_handler;
 }
 
 static void *set_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: set_blob_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "oneBLOB")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
+			if (context->blob_start == 0)
+				context->blob_start = indigo_metric_time();
 			return set_one_blob_vector_handler;
 		}
 	} else if (state == ATTRIBUTE_VALUE) {
@@ -689,28 +795,131 @@ static void *set_blob_vector_handler(parser_state state, parser_context *context
 			strncpy(message, value, INDIGO_VALUE_SIZE);
 		}
 	} else if (state == END_TAG) {
+		/* set_property() copies BLOB data to cached property, the only one seen by bus, so ring space can be released */
 		set_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		if (context->blob_start != 0) {
+			blob_received(context);
+			context->blob_start = 0;
+		}
+		if (context->ring_size != 0) {
+			for (int i = 0; i < property->count; i++)
+				property->items[i].blob.value = NULL;
+			indigo_blob_ring_release(((indigo_adapter_context *)device->device_context)->blob_ring, context->ring_position, context->ring_size);
+			context->ring_size = 0;
+		}
+		reset_property(context);
 		return top_level_handler;
 	}
 	return set_blob_vector_handler;
 }
 
+static void release_property(indigo_property *property) {
+	if (property->type == INDIGO_BLOB_VECTOR) {
+		for (int i = 0; i < property->count; i++) {
+			void *blob = property->items[i].blob.value;
+			if (blob)
+				free(blob);
+		}
+	}
+	indigo_release_property(property);
+}
+
+static void delete_property(indigo_property *property) {
+	indigo_device remote_device;
+	strncpy(remote_device.name, property->device, INDIGO_NAME_SIZE);
+	remote_device.version = property->version;
+	indigo_delete_property(&remote_device, property, NULL);
+	release_property(property);
+}
+
+static bool property_equals(indigo_property *property, indigo_property *other) {
+	if (property->type != other->type || property->state != other->state || property->perm != other->perm || property->rule != other->rule || property->count != other->count)
+		return false;
+	if (strcmp(property->group, other->group) || strcmp(property->label, other->label))
+		return false;
+	for (int i = 0; i < property->count; i++) {
+		indigo_item *item = property->items + i;
+		indigo_item *other_item = other->items + i;
+		if (strcmp(item->name, other_item->name) || strcmp(item->label, other_item->label))
+			return false;
+		switch (property->type) {
+			case INDIGO_TEXT_VECTOR:
+				if (strcmp(item->text.value, other_item->text.value))
+					return false;
+				break;
+			case INDIGO_NUMBER_VECTOR:
+				if (strcmp(item->number.format, other_item->number.format) || item->number.min != other_item->number.min || item->number.max != other_item->number.max || item->number.step != other_item->number.step || item->number.value != other_item->number.value)
+					return false;
+				break;
+			case INDIGO_SWITCH_VECTOR:
+				if (item->sw.value != other_item->sw.value)
+					return false;
+				break;
+			case INDIGO_LIGHT_VECTOR:
+				if (item->light.value != other_item->light.value)
+					return false;
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+static void sweep_properties(parser_context *context) {
+	for (int index = 0; index < context->count; index++) {
+		indigo_property *property = context->properties[index];
+		if (property != NULL && !context->redefined[index]) {
+			INDIGO_TRACE_PARSER(indigo_trace("XML Parser: retained property '%s' '%s' not redefined", property->device, property->name));
+			delete_property(property);
+			context->properties[index] = NULL;
+		}
+	}
+	context->sweep_time = 0;
+}
+
 static void def_property(parser_context *context, indigo_property *other, char *message) {
 	indigo_property *property = NULL;
-	int index;
+	unsigned long long hash = indigo_property_hash(other->device, other->name);
+	int index, empty = -1;
 	for (index = 0; index < context->count; index++) {
 		property = context->properties[index];
-		if (property == NULL)
-			break;
-		if (!strncmp(property->device, other->device, INDIGO_NAME_SIZE) && !strncmp(property->name, other->name, INDIGO_NAME_SIZE))
+		if (property == NULL) {
+			if (empty < 0)
+				empty = index;
+			continue;
+		}
+		if (context->hashes[index] == hash && !strncmp(property->device, other->device, INDIGO_NAME_SIZE) && !strncmp(property->name, other->name, INDIGO_NAME_SIZE))
 			break;
 	}
 	if (index == context->count) {
-		context->properties = realloc(context->properties, context->count * 2 * sizeof(indigo_property *));
-		memset(context->properties + context->count, 0, context->count * sizeof(indigo_property *));
-		context->count *= 2;
 		property = NULL;
+		if (empty >= 0) {
+			index = empty;
+		} else {
+			context->properties = realloc(context->properties, context->count * 2 * sizeof(indigo_property *));
+			memset(context->properties + context->count, 0, context->count * sizeof(indigo_property *));
+			context->hashes = realloc(context->hashes, context->count * 2 * sizeof(unsigned long long));
+			if (context->redefined != NULL) {
+				context->redefined = realloc(context->redefined, context->count * 2 * sizeof(bool));
+				memset(context->redefined + context->count, 0, context->count * sizeof(bool));
+			}
+			context->count *= 2;
+		}
+	}
+	if (context->redefined != NULL) {
+		if (property != NULL && !context->redefined[index]) {
+			/* retained from previous connection, broadcast only if changed, but store it again as detach removed it */
+			context->redefined[index] = true;
+			if (property_equals(property, other)) {
+				INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_property '%s' '%s' %d unchanged", property->device, property->name, index));
+				indigo_store_property(context->device, property);
+				return;
+			}
+			release_property(property);
+			property = NULL;
+		}
+		context->redefined[index] = true;
 	}
 	if (property == NULL) {
 		switch (other->type) {
@@ -744,13 +953,14 @@ static void def_property(parser_context *context, indigo_property *other, char *
 				break;
 		}
 		context->properties[index] = property;
+		context->hashes[index] = hash;
 	}
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_property '%s' '%s' %d", property->device, property->name, index));
 	indigo_define_property(context->device, property, *message ? message : NULL);
 }
 
 static void *def_text_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_text_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -768,12 +978,12 @@ static void *def_text_handler(parser_state state, parser_context *context, char
 }
 
 static void *def_text_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_text_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defText")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return def_text_handler;
 		}
@@ -798,14 +1008,14 @@ static void *def_text_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_text_vector_handler;
 }
 
 static void *def_number_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_number_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -831,12 +1041,12 @@ static void *def_number_handler(parser_state state, parser_context *context, cha
 }
 
 static void *def_number_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_number_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defNumber")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return def_number_handler;
 		}
@@ -861,14 +1071,14 @@ static void *def_number_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_number_vector_handler;
 }
 
 static void *def_switch_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_switch_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -886,12 +1096,12 @@ static void *def_switch_handler(parser_state state, parser_context *context, cha
 }
 
 static void *def_switch_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_switch_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defSwitch")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return def_switch_handler;
 		}
@@ -918,14 +1128,14 @@ static void *def_switch_vector_handler(parser_state state, parser_context *conte
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_switch_vector_handler;
 }
 
 static void *def_light_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_light_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -943,12 +1153,12 @@ static void *def_light_handler(parser_state state, parser_context *context, char
 }
 
 static void *def_light_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_light_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defLight")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return def_light_handler;
 		}
@@ -971,14 +1181,14 @@ static void *def_light_vector_handler(parser_state state, parser_context *contex
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_light_vector_handler;
 }
 
 static void *def_blob_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_blob_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -998,12 +1208,12 @@ static void *def_blob_handler(parser_state state, parser_context *context, char
 }
 
 static void *def_blob_vector_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: def_blob_vector_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		if (!strcmp(name, "defBLOB")) {
-			if (property->count < INDIGO_MAX_ITEMS)
+			if ((property = reserve_item(context))->count < context->capacity)
 				property->count++;
 			return def_blob_handler;
 		}
@@ -1028,14 +1238,14 @@ static void *def_blob_vector_handler(parser_state state, parser_context *context
 		}
 	} else if (state == END_TAG) {
 		def_property(context, property, message);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return def_blob_vector_handler;
 }
 
 static void *del_property_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
+	indigo_property *property = context->property;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: del_property_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -1051,9 +1261,10 @@ static void *del_property_handler(parser_state state, parser_context *context, c
 		}
 	} else if (state == END_TAG) {
 		if (*property->name) {
+			unsigned long long hash = indigo_property_hash(property->device, property->name);
 			for (int i = 0; i < context->count; i++) {
 				indigo_property *tmp = context->properties[i];
-				if (tmp != NULL && !strncmp(tmp->device, property->device, INDIGO_NAME_SIZE) && !strncmp(tmp->name, property->name, INDIGO_NAME_SIZE)) {
+				if (tmp != NULL && context->hashes[i] == hash && !strncmp(tmp->device, property->device, INDIGO_NAME_SIZE) && !strncmp(tmp->name, property->name, INDIGO_NAME_SIZE)) {
 					indigo_delete_property(device, tmp, *message ? message : NULL);
 					indigo_release_property(tmp);
 					context->properties[i] = NULL;
@@ -1070,14 +1281,13 @@ static void *del_property_handler(parser_state state, parser_context *context, c
 				}
 			}
 		}
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return del_property_handler;
 }
 
 static void *message_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
 	indigo_device *device = context->device;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: message_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == ATTRIBUTE_VALUE) {
@@ -1086,85 +1296,109 @@ static void *message_handler(parser_state state, parser_context *context, char *
 		}
 	} else if (state == END_TAG) {
 		indigo_send_message(device, *message ? message : NULL);
-		memset(property, 0, PROPERTY_SIZE);
+		reset_property(context);
 		return top_level_handler;
 	}
 	return message_handler;
 }
 
+/* top level tags are dispatched by perfect hash of first and fourth character */
+
+#define TAG_HASH_SIZE	64
+#define TAG_HASH(name) (((unsigned char)(name)[0] * 2 + ((name)[1] && (name)[2] ? (unsigned char)(name)[3] : 0)) & (TAG_HASH_SIZE - 1))
+
+static struct top_level_tag {
+	const char *name;
+	parser_handler handler;
+	indigo_property_type type;
+	bool client_only;
+} top_level_tags[] = {
+	{ "enableBLOB", enable_blob_handler, 0, false },
+	{ "getProperties", get_properties_handler, 0, true },
+	{ "newTextVector", new_text_vector_handler, INDIGO_TEXT_VECTOR, false },
+	{ "newNumberVector", new_number_vector_handler, INDIGO_NUMBER_VECTOR, false },
+	{ "newSwitchVector", new_switch_vector_handler, INDIGO_SWITCH_VECTOR, false },
+	{ "switchProtocol", switch_protocol_handler, 0, false },
+	{ "setTextVector", set_text_vector_handler, INDIGO_TEXT_VECTOR, false },
+	{ "setNumberVector", set_number_vector_handler, INDIGO_NUMBER_VECTOR, false },
+	{ "setSwitchVector", set_switch_vector_handler, INDIGO_SWITCH_VECTOR, false },
+	{ "setLightVector", set_light_vector_handler, INDIGO_LIGHT_VECTOR, false },
+	{ "setBLOBVector", set_blob_vector_handler, INDIGO_BLOB_VECTOR, false },
+	{ "defTextVector", def_text_vector_handler, INDIGO_TEXT_VECTOR, false },
+	{ "defNumberVector", def_number_vector_handler, INDIGO_NUMBER_VECTOR, false },
+	{ "defSwitchVector", def_switch_vector_handler, INDIGO_SWITCH_VECTOR, false },
+	{ "defLightVector", def_light_vector_handler, INDIGO_LIGHT_VECTOR, false },
+	{ "defBLOBVector", def_blob_vector_handler, INDIGO_BLOB_VECTOR, false },
+	{ "delProperty", del_property_handler, 0, false },
+	{ "message", message_handler, 0, false },
+	{ NULL }
+};
+
+static struct top_level_tag *top_level_hash[TAG_HASH_SIZE];
+static pthread_once_t top_level_hash_once = PTHREAD_ONCE_INIT;
+
+static void build_top_level_hash(void) {
+	for (struct top_level_tag *tag = top_level_tags; tag->name; tag++) {
+		assert(top_level_hash[TAG_HASH(tag->name)] == NULL);
+		top_level_hash[TAG_HASH(tag->name)] = tag;
+	}
+}
+
 static void *top_level_handler(parser_state state, parser_context *context, char *name, char *value, char *message) {
-	indigo_property *property = (indigo_property *)context->property_buffer;
-	indigo_client *client = context->client;
 	INDIGO_TRACE_PARSER(indigo_trace("XML Parser: top_level_handler %s '%s' '%s'", parser_state_name[state], name != NULL ? name : "", value != NULL ? value : ""));
 	if (state == BEGIN_TAG) {
 		*message = 0;
-		if (!strcmp(name, "enableBLOB"))
-			return enable_blob_handler;
-		if (!strcmp(name, "getProperties") && client != NULL)
-			return get_properties_handler;
-		if (!strcmp(name, "newTextVector")) {
-			property->type = INDIGO_TEXT_VECTOR;
-			return new_text_vector_handler;
-		}
-		if (!strcmp(name, "newNumberVector")) {
-			property->type = INDIGO_NUMBER_VECTOR;
-			return new_number_vector_handler;
-		}
-		if (!strcmp(name, "newSwitchVector")) {
-			property->type = INDIGO_SWITCH_VECTOR;
-			return new_switch_vector_handler;
-		}
-		if (!strcmp(name, "switchProtocol"))
-			return switch_protocol_handler;
-		if (!strcmp(name, "setTextVector")) {
-			property->type = INDIGO_TEXT_VECTOR;
-			return set_text_vector_handler;
-		}
-		if (!strcmp(name, "setNumberVector")) {
-			property->type = INDIGO_NUMBER_VECTOR;
-			return set_number_vector_handler;
-		}
-		if (!strcmp(name, "setSwitchVector")) {
-			property->type = INDIGO_SWITCH_VECTOR;
-			return set_switch_vector_handler;
-		}
-		if (!strcmp(name, "setLightVector")) {
-			property->type = INDIGO_LIGHT_VECTOR;
-			return set_light_vector_handler;
-		}
-		if (!strcmp(name, "setBLOBVector")) {
-			property->type = INDIGO_BLOB_VECTOR;
-			return set_blob_vector_handler;
-		}
-		if (!strcmp(name, "defTextVector")) {
-			property->type = INDIGO_TEXT_VECTOR;
-			return def_text_vector_handler;
-		}
-		if (!strcmp(name, "defNumberVector")) {
-			property->type = INDIGO_NUMBER_VECTOR;
-			return def_number_vector_handler;
-		}
-		if (!strcmp(name, "defSwitchVector")) {
-			property->type = INDIGO_SWITCH_VECTOR;
-			return def_switch_vector_handler;
-		}
-		if (!strcmp(name, "defLightVector")) {
-			property->type = INDIGO_LIGHT_VECTOR;
-			return def_light_vector_handler;
-		}
-		if (!strcmp(name, "defBLOBVector")) {
-			property->type = INDIGO_BLOB_VECTOR;
-			return def_blob_vector_handler;
-		}
-		if (!strcmp(name, "delProperty"))
-			return del_property_handler;
-		if (!strcmp(name, "message"))
-			return message_handler;
+		struct top_level_tag *tag = top_level_hash[TAG_HASH(name)];
+		if (tag != NULL && !strcmp(name, tag->name) && (!tag->client_only || context->client != NULL)) {
+			if (tag->type)
+				context->property->type = tag->type;
+			return tag->handler;
+		}
 	}
 	return top_level_handler;
 }
 
+static void release_properties(indigo_property **properties, int count) {
+	while (true) {
+		indigo_property *property = NULL;
+		int index;
+		for (index = 0; index < count; index++) {
+			property = properties[index];
+			if (property != NULL)
+				break;
+		}
+		if (property == NULL)
+			break;
+		indigo_device remote_device;
+		strncpy(remote_device.name, property->device, INDIGO_NAME_SIZE);
+		remote_device.version = property->version;
+		indigo_property *all_properties = indigo_init_text_property(NULL, remote_device.name, "", "", "", INDIGO_OK_STATE, INDIGO_RO_PERM, 0);
+		indigo_delete_property(&remote_device, all_properties, NULL);
+		indigo_release_property(all_properties);
+		for (; index < count; index++) {
+			indigo_property *property = properties[index];
+			if (property != NULL && !strncmp(remote_device.name, property->device, INDIGO_NAME_SIZE)) {
+				release_property(property);
+				properties[index] = NULL;
+			}
+		}
+	}
+	if (properties != NULL)
+		free(properties);
+}
+
+void indigo_xml_release_cache(indigo_xml_property_cache *cache) {
+	release_properties(cache->properties, cache->count);
+	cache->properties = NULL;
+	cache->count = 0;
+}
+
 void indigo_xml_parse(indigo_device *device, indigo_client *client) {
+	indigo_xml_parse_with_cache(device, client, NULL);
+}
+
+void indigo_xml_parse_with_cache(indigo_device *device, indigo_client *client, indigo_xml_property_cache *cache) {
+	pthread_once(&metrics_once, register_metrics);
 	char *buffer = malloc(BUFFER_SIZE+3); /* BUFFER_SIZE % 4 == 0 and keep always +3 for base64 alignmet */
 	assert(buffer != NULL);
 	char *value_buffer = malloc(BUFFER_SIZE+1); /* +1 to accomodate \0" */
@@ -1193,17 +1427,41 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 	parser_context context;
 	context.client = client;
 	context.device = device;
-	if (device != NULL) {
+	context.redefined = NULL;
+	context.sweep_time = 0;
+	context.blob_start = 0;
+	context.ring_size = 0;
+	context.ring_pending = false;
+	context.blob_policy = INDIGO_BLOB_DELIVERY_DEFAULT;
+	context.blob_nth = 0;
+	if (device != NULL && cache != NULL && cache->properties != NULL) {
+		context.count = cache->count;
+		context.properties = cache->properties;
+		cache->properties = NULL;
+		cache->count = 0;
+		context.hashes = malloc(context.count * sizeof(unsigned long long));
+		for (int i = 0; i < context.count; i++) {
+			indigo_property *property = context.properties[i];
+			context.hashes[i] = property != NULL ? indigo_property_hash(property->device, property->name) : 0;
+		}
+		context.redefined = calloc(context.count, sizeof(bool));
+		context.sweep_time = time(NULL) + RETAINED_PROPERTY_TIMEOUT;
+	} else if (device != NULL) {
 		context.count = 32;
 		context.properties = malloc(context.count * sizeof(indigo_property *));
 		memset(context.properties, 0, context.count * sizeof(indigo_property *));
+		context.hashes = malloc(context.count * sizeof(unsigned long long));
+		if (cache != NULL)
+			context.redefined = calloc(context.count, sizeof(bool));
 	} else {
 		context.count = 0;
 		context.properties = NULL;
+		context.hashes = NULL;
 	}
 
-	indigo_property *property = (indigo_property *)&context.property_buffer;
-	memset(context.property_buffer, 0, PROPERTY_SIZE);
+	context.capacity = INITIAL_ITEMS;
+	context.property = calloc(1, sizeof(indigo_property) + context.capacity * sizeof(indigo_item));
+	assert(context.property != NULL);
 
 	int handle = 0;
 	if (device != NULL) {
@@ -1212,24 +1470,59 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 	} else {
 		handle = ((indigo_adapter_context *)client->client_context)->input;
 	}
+	pthread_once(&top_level_hash_once, build_top_level_hash);
 	*pointer = 0;
 	while (true) {
+#ifndef INDIGO_RELEASE
 		assert(pointer - buffer <= BUFFER_SIZE);
 		assert(value_pointer - value_buffer <= BUFFER_SIZE);
 		assert(name_pointer - name_buffer <= INDIGO_NAME_SIZE);
+#endif
 		if (state == ERROR) {
 			indigo_error("XML Parser: syntax error");
 			goto exit_loop;
 		}
+		if ((state == TEXT || state == ATTRIBUTE_VALUE) && entity_pointer == NULL && *pointer) {
+			/* copy run of plain characters at once, stop at delimiter, entity or end of buffer */
+			size_t length = strcspn(pointer, state == TEXT ? "<&" : (q == '"' ? "\"&" : "'&"));
+			if (length > 0) {
+				if (state == ATTRIBUTE_VALUE || depth == 2 || handler == enable_blob_handler) {
+					size_t available = (state == TEXT ? INDIGO_VALUE_SIZE : BUFFER_SIZE) - (value_pointer - value_buffer);
+					size_t count = length < available ? length : available;
+					memcpy(value_pointer, pointer, count);
+					value_pointer += count;
+				}
+				INDIGO_TRACE_PARSER(indigo_trace("XML Parser: %zu characters %d %s", length, depth, parser_state_name[state]));
+				pointer += length;
+				is_escaped = false;
+				continue;
+			}
+		} else if ((state == BEGIN_TAG || state == ATTRIBUTE_NAME) && entity_pointer == NULL) {
+			/* copy tag or attribute name at once */
+			char *start = pointer;
+			while (xml_isalpha(*pointer) && name_pointer - name_buffer < INDIGO_NAME_SIZE)
+				*name_pointer++ = *pointer++;
+			if (pointer > start) {
+				is_escaped = false;
+				continue;
+			}
+		}
 		while ((c = *pointer++) == 0) {
+			if (context.sweep_time) {
+				struct pollfd pfd = { handle, POLLIN, 0 };
+				long timeout = (long)(context.sweep_time - time(NULL)) * 1000;
+				if (timeout <= 0 || poll(&pfd, 1, (int)timeout) == 0)
+					sweep_properties(&context);
+			}
 			ssize_t count = (int)read(handle, (void *)buffer, (ssize_t)BUFFER_SIZE);
 			if (count <= 0) {
 				goto exit_loop;
 			}
+			indigo_record(handle, INDIGO_RECORD_INBOUND, buffer, count);
 			pointer = buffer;
 			buffer_end = buffer + count;
 			buffer[count] = 0;
-			INDIGO_TRACE_PROTOCOL(indigo_trace("%d → %s", handle, buffer));
+			INDIGO_TRACE_PROTOCOL(INDIGO_CHECKED_TRACE("%d → %s", handle, buffer));
 		}
 		if (c == '&') {
 			entity_pointer = entity_buffer;
@@ -1250,7 +1543,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					c = '\'';
 				entity_pointer = NULL;
 				is_escaped = true;
-			} else if (isalpha(c) && entity_pointer - entity_buffer < sizeof(entity_buffer)) {
+			} else if (xml_isalpha(c) && entity_pointer - entity_buffer < sizeof(entity_buffer)) {
 				*entity_pointer++ = c;
 				continue;
 			} else {
@@ -1273,7 +1566,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' BEGIN_TAG1 -> HEADER", c));
 				} else {
 					name_pointer = name_buffer;
-					if (isalpha(c)) {
+					if (xml_isalpha(c)) {
 						*name_pointer++ = c;
 						state = BEGIN_TAG;
 						INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' BEGIN_TAG1 -> BEGIN_TAG", c));
@@ -1299,14 +1592,14 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				}
 				break;
 			case BEGIN_TAG:
-				if (name_pointer - name_buffer <INDIGO_NAME_SIZE && isalpha(c)) {
+				if (name_pointer - name_buffer <INDIGO_NAME_SIZE && xml_isalpha(c)) {
 					*name_pointer++ = c;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' BEGIN_TAG", c));
 				} else {
 					*name_pointer = 0;
 					depth++;
 					handler = handler(BEGIN_TAG, &context, name_buffer, NULL, message);
-					if (isspace(c)) {
+					if (xml_isspace(c)) {
 						state = ATTRIBUTE_NAME1;
 						INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' BEGIN_TAG -> ATTRIBUTE_NAME1", c));
 					} else if (c == '/') {
@@ -1343,7 +1636,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				}
 				break;
 			case END_TAG:
-				if (isalpha(c)) {
+				if (xml_isalpha(c)) {
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' END_TAG", c));
 				} else if (c == '>') {
 					handler = handler(END_TAG, &context, NULL, NULL, message);
@@ -1359,10 +1652,10 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				if (c == '<' && !is_escaped) {
 					if (depth == 2 || handler == enable_blob_handler) {
 						*value_pointer-- = 0;
-						while (value_pointer >= value_buffer && isspace(*value_pointer))
+						while (value_pointer >= value_buffer && xml_isspace(*value_pointer))
 							*value_pointer-- = 0;
 						value_pointer = value_buffer;
-						while (*value_pointer && isspace(*value_pointer))
+						while (*value_pointer && xml_isspace(*value_pointer))
 							value_pointer++;
 						handler = handler(TEXT, &context, NULL, value_pointer, message);
 					}
@@ -1382,7 +1675,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				if (c=='/') {
 					state = END_TAG;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' TEXT -> END_TAG", c));
-				} else if (isalpha(c)) {
+				} else if (xml_isalpha(c)) {
 					name_pointer = name_buffer;
 					*name_pointer++ = c;
 					state = BEGIN_TAG;
@@ -1394,27 +1687,33 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					state = TEXT1;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' BLOB_END -> TEXT1", c));
 				}
-				*name_pointer++ = c;
+				if (name_pointer - name_buffer < INDIGO_NAME_SIZE)
+					*name_pointer++ = c;
 				break;
 			case BLOB:
 				if (device->version >= INDIGO_VERSION_2_0) {
 					ssize_t count;
 					pointer--;
-					while (isspace(*pointer)) pointer++;
+					while (xml_isspace(*pointer)) pointer++;
 					unsigned long blob_len = (blob_size + 2) / 3 * 4;
 					unsigned long len = (long)(buffer_end - pointer);
 					len = (len < blob_len) ? len : blob_len;
 					ssize_t bytes_needed = len % 4;
+					/* data read directly are not recorded, only reference to BLOB with their size */
+					long omitted = 0;
 					if(bytes_needed) bytes_needed = 4 - bytes_needed;
 					while (bytes_needed) {
 						count = (int)read(handle, (void *)buffer_end, bytes_needed);
 						if (count <= 0)
 							goto exit_loop;
+						omitted += count;
 						len += count;
 						bytes_needed -= count;
 						buffer_end += count;
 					}
+					double start = indigo_metric_time(), decode_time;
 					blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)pointer, len);
+					decode_time = indigo_metric_time() - start;
 					pointer += len;
 					blob_len -= len;
 					while(blob_len) {
@@ -1425,12 +1724,17 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 							count = (int)read(handle, (void *)ptr, to_read);
 							if (count <= 0)
 								goto exit_loop;
+							omitted += count;
 							ptr += count;
 							to_read -= count;
 						}
+						start = indigo_metric_time();
 						blob_pointer += base64_decode_fast((unsigned char*)blob_pointer, (unsigned char*)buffer, len);
+						decode_time += indigo_metric_time() - start;
 						blob_len -= len;
 					}
+					indigo_metric_observe(base64_metric, decode_time);
+					indigo_record_inbound_blob_reference(handle, blob_buffer, blob_size, context.property->items[context.property->count - 1].blob.format, omitted);
 
 					handler = handler(BLOB, &context, NULL, (char *)blob_buffer, message);
 					pointer = buffer;
@@ -1464,9 +1768,9 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				}
 				break;
 			case ATTRIBUTE_NAME1:
-				if (isspace(c)) {
+				if (xml_isspace(c)) {
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_NAME1", c));
-				} else if (isalpha(c)) {
+				} else if (xml_isalpha(c)) {
 					name_pointer = name_buffer;
 					*name_pointer++ = c;
 					state = ATTRIBUTE_NAME;
@@ -1476,7 +1780,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				} else if (c == '>') {
 					value_pointer = value_buffer;
 					if (handler == set_one_blob_vector_handler) {
-						blob_size = property->items[property->count-1].blob.size;
+						blob_size = context.property->items[context.property->count-1].blob.size;
 						if (blob_size > 0) {
 							state = BLOB;
 							if (blob_buffer != NULL) {
@@ -1500,7 +1804,7 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 				}
 				break;
 			case ATTRIBUTE_NAME:
-				if (name_pointer - name_buffer <INDIGO_NAME_SIZE && isalpha(c)) {
+				if (name_pointer - name_buffer <INDIGO_NAME_SIZE && xml_isalpha(c)) {
 					*name_pointer++ = c;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_NAME", c));
 				} else {
@@ -1530,7 +1834,8 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 					handler = handler(ATTRIBUTE_VALUE, &context, name_buffer, value_buffer, message);
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_VALUE -> ATTRIBUTE_NAME1", c));
 				} else {
-					*value_pointer++ = c;
+					if (value_pointer - value_buffer < BUFFER_SIZE)
+						*value_pointer++ = c;
 					INDIGO_TRACE_PARSER(indigo_trace("XML Parser: '%c' ATTRIBUTE_VALUE", c));
 				}
 				break;
@@ -1539,43 +1844,23 @@ void indigo_xml_parse(indigo_device *device, indigo_client *client) {
 		}
 	}
 exit_loop:
-	while (true) {
-		indigo_property *property = NULL;
-		int index;
-		for (index = 0; index < context.count; index++) {
-			property = context.properties[index];
-			if (property != NULL)
-				break;
-		}
-		if (property == NULL)
-			break;
-		indigo_device remote_device;
-		strncpy(remote_device.name, property->device, INDIGO_NAME_SIZE);
-		remote_device.version = property->version;
-		indigo_property *all_properties = indigo_init_text_property(NULL, remote_device.name, "", "", "", INDIGO_OK_STATE, INDIGO_RO_PERM, 0);
-		indigo_delete_property(&remote_device, all_properties, NULL);
-		indigo_release_property(all_properties);
-		for (; index < context.count; index++) {
-			indigo_property *property = context.properties[index];
-			if (property != NULL && !strncmp(remote_device.name, property->device, INDIGO_NAME_SIZE)) {
-				if (property->type == INDIGO_BLOB_VECTOR) {
-					for (int i = 0; i < property->count; i++) {
-						void *blob = property->items[i].blob.value;
-						if (blob)
-							free(blob);
-					}
-				}
-				indigo_release_property(property);
-				context.properties[index] = NULL;
-			}
-		}
+	if (cache != NULL && device != NULL) {
+		cache->properties = context.properties;
+		cache->count = context.count;
+	} else {
+		release_properties(context.properties, context.count);
 	}
+	if (context.hashes != NULL)
+		free(context.hashes);
+	if (context.redefined != NULL)
+		free(context.redefined);
 	if (blob_buffer != NULL)
 		free(blob_buffer);
+	free(context.property);
 	free(buffer);
 	free(value_buffer);
 	close(handle);
-	indigo_log("XML Parser: parser finished");
+	INDIGO_CHECKED_LOG("XML Parser: parser finished");
 }
 
 char *indigo_xml_escape(char *string) {
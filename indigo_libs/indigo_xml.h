@@ -38,10 +38,25 @@ extern "C" {
 
 extern bool indigo_use_blob_urls;
 
+/** Remote properties retained by the parser between connections to the same server.
+ */
+typedef struct {
+	indigo_property **properties;				///< retained properties
+	int count;													///< size of properties array
+} indigo_xml_property_cache;
+
 /** XML wire protocol parser.
  */
 extern void indigo_xml_parse(indigo_device *device, indigo_client *client);
 
+/** XML wire protocol parser retaining remote properties in cache on disconnect, after reconnect only changed definitions are broadcast.
+ */
+extern void indigo_xml_parse_with_cache(indigo_device *device, indigo_client *client, indigo_xml_property_cache *cache);
+
+/** Delete and release all properties retained in cache.
+ */
+extern void indigo_xml_release_cache(indigo_xml_property_cache *cache);
+
 /** Escape XML string.
  */
 extern char *indigo_xml_escape(char *string);
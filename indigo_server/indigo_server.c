@@ -29,10 +29,17 @@
 #include <dns_sd.h>
 #include <libgen.h>
 #include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <limits.h>
 
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef INDIGO_LINUX
 #include <sys/prctl.h>
 #endif
@@ -43,8 +50,13 @@
 #include "indigo_bus.h"
 #include "indigo_server_tcp.h"
 #include "indigo_driver.h"
+#include "indigo_usb_utils.h"
 #include "indigo_client.h"
 #include "indigo_xml.h"
+#include "indigo_driver_xml.h"
+#include "indigo_metrics.h"
+#include "indigo_recorder.h"
+#include "indigo_flight_recorder.h"
 
 #include "ccd_simulator/indigo_ccd_simulator.h"
 #include "mount_simulator/indigo_mount_simulator.h"
@@ -160,13 +172,41 @@ driver_entry_point static_drivers[] = {
 	NULL
 };
 
+/* USB vendor IDs of drivers doing nothing but hotplug registration on init, these are initialized when matching device is present */
+static struct {
+	const char *name;
+	int vendor_id;
+} usb_drivers[] = {
+	{ "indigo_ccd_asi", 0x03c3 },
+	{ "indigo_wheel_asi", 0x03c3 },
+	{ "indigo_guider_asi", 0x03c3 },
+	{ "indigo_ccd_fli", 0x0f18 },
+	{ "indigo_wheel_fli", 0x0f18 },
+	{ "indigo_focuser_fli", 0x0f18 },
+	{ "indigo_ccd_sx", 0x1278 },
+	{ "indigo_wheel_sx", 0x1278 },
+	{ "indigo_ccd_atik", 0x20e7 },
+	{ "indigo_ccd_atik", 0x04b4 },
+	{ "indigo_wheel_atik", 0x04d8 },
+	{ "indigo_ccd_dsi", 0x156c },
+	{ "indigo_ccd_mi", 0x1347 },
+	{ "indigo_focuser_fcusb", 0x134a },
+	{ NULL, 0 }
+};
+
 static int first_driver = 4; /* This should be equial to number of simulator drivers */
+static bool use_lazy_drivers = true;
+static bool drivers_waiting[INDIGO_MAX_DRIVERS]; /* enabled drivers waiting for USB device */
+static pthread_mutex_t drivers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static libusb_hotplug_callback_handle lazy_drivers_handle;
 static indigo_property *drivers_property;
 static indigo_property *servers_property;
 static indigo_property *load_property;
 static indigo_property *unload_property;
 static indigo_property *restart_property;
 static indigo_property *log_level_property;
+static indigo_property *metrics_property;
+static indigo_timer *metrics_timer;
 static DNSServiceRef sd_http;
 static DNSServiceRef sd_indigo;
 
@@ -191,6 +231,7 @@ static int server_argc = 1;
 
 static indigo_result attach(indigo_device *device);
 static indigo_result enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property);
+static void define_properties(indigo_device *device);
 static indigo_result change_property(indigo_device *device, indigo_client *client, indigo_property *property);
 static indigo_result detach(indigo_device *device);
 
@@ -250,6 +291,85 @@ static void server_callback(int count) {
 	}
 }
 
+static void metrics_timer_callback(indigo_device *device) {
+	int count = metrics_property->count;
+	metrics_property = indigo_metrics_property(metrics_property);
+	if (metrics_property->count != count) {
+		indigo_delete_property(&server_device, metrics_property, NULL);
+		indigo_define_property(&server_device, metrics_property, NULL);
+	} else {
+		indigo_update_property(&server_device, metrics_property, NULL);
+	}
+	indigo_reschedule_timer(NULL, 5, &metrics_timer);
+}
+
+static bool is_usb_driver(indigo_driver_entry *driver, int vendor_id) {
+	for (int i = 0; usb_drivers[i].name; i++) {
+		if (!strcmp(usb_drivers[i].name, driver->name) && (vendor_id == 0 || usb_drivers[i].vendor_id == vendor_id))
+			return true;
+	}
+	return false;
+}
+
+static bool usb_device_present(indigo_driver_entry *driver) {
+	libusb_device **list;
+	ssize_t count = libusb_get_device_list(NULL, &list);
+	bool present = count < 0; /* can't tell, initialize */
+	for (ssize_t i = 0; i < count && !present; i++) {
+		struct libusb_device_descriptor descriptor;
+		if (libusb_get_device_descriptor(list[i], &descriptor) == 0)
+			present = is_usb_driver(driver, descriptor.idVendor);
+	}
+	if (count >= 0)
+		libusb_free_device_list(list, 1);
+	return present;
+}
+
+static const char *driver_family(indigo_driver_entry *driver) {
+	/* drivers of the same vendor share SDK and are not initialized concurrently */
+	char *family = strrchr(driver->name, '_');
+	return family && strcmp(family, "_simulator") ? family + 1 : driver->name;
+}
+
+static void *init_driver_job(indigo_driver_entry *driver) {
+	indigo_init_driver(driver);
+	return NULL;
+}
+
+static void *lazy_drivers_job(void *vendor_id) {
+	pthread_mutex_lock(&drivers_mutex);
+	bool changed = false;
+	for (int i = 0; i < drivers_property->count; i++) {
+		indigo_driver_entry *driver = indigo_available_drivers + i;
+		if (drivers_waiting[i] && is_usb_driver(driver, (int)(intptr_t)vendor_id)) {
+			drivers_waiting[i] = false;
+			INDIGO_LOG(indigo_log("Device %04x plugged in, initializing driver %s", (int)(intptr_t)vendor_id, driver->name));
+			if (indigo_init_driver(driver) != INDIGO_OK) {
+				drivers_property->items[i].sw.value = false;
+				changed = true;
+			}
+		}
+	}
+	if (changed)
+		indigo_update_property(&server_device, drivers_property, NULL);
+	pthread_mutex_unlock(&drivers_mutex);
+	return NULL;
+}
+
+static int lazy_drivers_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
+	struct libusb_device_descriptor descriptor;
+	if (libusb_get_device_descriptor(dev, &descriptor) == 0) {
+		/* called on USB event thread, drivers register their own hotplug callbacks on init so it can't be done here */
+		for (int i = 0; i < INDIGO_MAX_DRIVERS; i++) {
+			if (drivers_waiting[i] && is_usb_driver(indigo_available_drivers + i, descriptor.idVendor)) {
+				indigo_async_serial(lazy_drivers_job, (void *)(intptr_t)descriptor.idVendor, "lazy drivers");
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
 static indigo_result attach(indigo_device *device) {
 	assert(device != NULL);
 	drivers_property = indigo_init_switch_property(NULL, server_device.name, "DRIVERS", "Main", "Active drivers", INDIGO_IDLE_STATE, INDIGO_RW_PERM, INDIGO_ANY_OF_MANY_RULE, INDIGO_MAX_DRIVERS);
@@ -287,6 +407,9 @@ static indigo_result attach(indigo_device *device) {
 	indigo_init_switch_item(&log_level_property->items[1], "INFO", "Info", false);
 	indigo_init_switch_item(&log_level_property->items[2], "DEBUG", "Debug", false);
 	indigo_init_switch_item(&log_level_property->items[3], "TRACE", "Trace", false);
+	metrics_property = indigo_init_text_property(NULL, device->name, "METRICS", "Metrics", "Metrics", INDIGO_OK_STATE, INDIGO_RO_PERM, 0);
+	metrics_property = indigo_metrics_property(metrics_property);
+	metrics_timer = indigo_set_timer(NULL, 5, metrics_timer_callback);
 
 	indigo_log_levels log_level = indigo_get_log_level();
 	switch (log_level) {
@@ -305,12 +428,13 @@ static indigo_result attach(indigo_device *device) {
 	}
 	if (indigo_load_properties(device, false) == INDIGO_FAILED)
 		change_property(device, NULL, drivers_property);
+	/* getProperties is answered from bus property store, so properties must be defined on attach like in drivers */
+	define_properties(device);
 	INDIGO_LOG(indigo_log("%s attached", device->name));
 	return INDIGO_OK;
 }
 
-static indigo_result enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
-	assert(device != NULL);
+static void define_properties(indigo_device *device) {
 	indigo_define_property(device, drivers_property, NULL);
 	if (servers_property->count > 0)
 		indigo_define_property(device, servers_property, NULL);
@@ -318,6 +442,13 @@ static indigo_result enumerate_properties(indigo_device *device, indigo_client *
 	indigo_define_property(device, unload_property, NULL);
 	indigo_define_property(device, restart_property, NULL);
 	indigo_define_property(device, log_level_property, NULL);
+	indigo_define_property(device, metrics_property, NULL);
+}
+
+static indigo_result enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	assert(device != NULL);
+	/* used only if bus property store is disabled */
+	define_properties(device);
 	return INDIGO_OK;
 }
 
@@ -327,20 +458,43 @@ static indigo_result change_property(indigo_device *device, indigo_client *clien
 	if (indigo_property_match(drivers_property, property)) {
 	// -------------------------------------------------------------------------------- DRIVERS
 		indigo_property_copy_values(drivers_property, property, false);
-		for (int i = 0; i < drivers_property->count; i++)
+		pthread_mutex_lock(&drivers_mutex);
+		const char *families[INDIGO_MAX_DRIVERS];
+		int family_count = 0;
+		for (int i = 0; i < drivers_property->count; i++) {
+			indigo_driver_entry *driver = indigo_available_drivers + i;
 			if (drivers_property->items[i].sw.value) {
-				indigo_available_drivers[i].initialized = indigo_available_drivers[i].driver(INDIGO_DRIVER_INIT, NULL) == INDIGO_OK;
-				if (!indigo_available_drivers[i].initialized)
-					drivers_property->items[i].sw.value = false;
-			} else if (indigo_available_drivers[i].initialized) {
-				indigo_available_drivers[i].driver(INDIGO_DRIVER_SHUTDOWN, NULL);
-				indigo_available_drivers[i].initialized = false;
+				if (driver->initialized || drivers_waiting[i])
+					continue;
+				if (use_lazy_drivers && is_usb_driver(driver, 0) && !usb_device_present(driver)) {
+					INDIGO_LOG(indigo_log("Driver %s initialization postponed until device is plugged in", driver->name));
+					drivers_waiting[i] = true;
+					continue;
+				}
+				const char *family = driver_family(driver);
+				indigo_async_serial((void *(*)(void *))init_driver_job, driver, family);
+				int j = 0;
+				while (j < family_count && strcmp(families[j], family))
+					j++;
+				if (j == family_count)
+					families[family_count++] = family;
+			} else {
+				drivers_waiting[i] = false;
+				indigo_shutdown_driver(driver);
 			}
+		}
+		for (int i = 0; i < family_count; i++)
+			indigo_async_wait(families[i]);
+		for (int i = 0; i < drivers_property->count; i++) {
+			if (drivers_property->items[i].sw.value && !indigo_available_drivers[i].initialized && !drivers_waiting[i])
+				drivers_property->items[i].sw.value = false;
+		}
+		pthread_mutex_unlock(&drivers_mutex);
 		drivers_property->state = INDIGO_OK_STATE;
 		indigo_update_property(device, drivers_property, NULL);
 		int handle = 0;
 		indigo_save_property(device, &handle, drivers_property);
-		close(handle);
+		indigo_commit_properties(device, &handle);
 	} else if (indigo_property_match(load_property, property)) {
 		// -------------------------------------------------------------------------------- LOAD
 		indigo_property_copy_values(load_property, property, false);
@@ -422,10 +576,438 @@ static indigo_result detach(indigo_device *device) {
 	indigo_delete_property(device, load_property, NULL);
 	indigo_delete_property(device, unload_property, NULL);
 	indigo_delete_property(device, log_level_property, NULL);
+	indigo_cancel_timer(NULL, &metrics_timer);
+	indigo_delete_property(device, metrics_property, NULL);
 	INDIGO_LOG(indigo_log("%s detached", device->name));
 	return INDIGO_OK;
 }
 
+/* warm restart: parent process keeps listening socket, client sockets and periodic snapshot of property store,
+   restarted worker adopts client connections and resends cached definitions (as busy) while drivers reconnect */
+
+#define SNAPSHOT_SIZE					(16 * 1024 * 1024)
+#define SNAPSHOT_INTERVAL			2		/* s */
+#define WARM_RESTART_GRACE		30	/* s */
+#define MAX_KEPT_CLIENTS			256
+
+typedef enum {
+	KEPT_CLIENT_ADD,
+	KEPT_CLIENT_REMOVE,
+	KEPT_CLIENT_VERSION
+} kept_client_message_type;
+
+typedef struct {
+	int type;
+	int id;
+	int protocol;
+	int version;
+} kept_client_message;
+
+typedef struct {
+	int id;
+	int socket;
+	int protocol;
+	int version;
+} kept_client;
+
+typedef struct {
+	uint32_t size;
+	uint32_t is_remote;
+} snapshot_record;
+
+typedef struct {
+	atomic_int active;
+	uint32_t length[2];
+	char data[2][SNAPSHOT_SIZE];
+	struct {
+		atomic_int id;
+		atomic_int pending_elements;
+	} clients[MAX_KEPT_CLIENTS];			/* indexed by worker client slot */
+} snapshot_area;
+
+typedef struct {
+	indigo_client *client;
+	int id;
+	int version;
+	bool adopted;
+} worker_client;
+
+static bool use_warm_restart = true;
+static snapshot_area *snapshot = NULL;
+static kept_client kept_clients[MAX_KEPT_CLIENTS];
+static int kept_client_count = 0;
+static int next_client_id = 1;
+static int control_socket = -1;
+static pthread_mutex_t control_mutex = PTHREAD_MUTEX_INITIALIZER;
+static worker_client worker_clients[MAX_KEPT_CLIENTS];
+static pthread_mutex_t worker_clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+static indigo_device *cached_devices = NULL;
+static indigo_property **cached_properties = NULL;
+static bool *cached_restored = NULL;
+static int cached_count = 0;
+static int adoptions_pending = 0;
+static pthread_cond_t adoptions_cond = PTHREAD_COND_INITIALIZER;
+
+static void send_control_message(int type, int id, int protocol, int version, int socket) {
+	kept_client_message message = { type, id, protocol, version };
+	struct iovec iov = { &message, sizeof(message) };
+	struct msghdr header;
+	char control[CMSG_SPACE(sizeof(int))];
+	memset(&header, 0, sizeof(header));
+	header.msg_iov = &iov;
+	header.msg_iovlen = 1;
+	if (socket >= 0) {
+		memset(control, 0, sizeof(control));
+		header.msg_control = control;
+		header.msg_controllen = sizeof(control);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &socket, sizeof(int));
+	}
+	pthread_mutex_lock(&control_mutex);
+	if (sendmsg(control_socket, &header, 0) != sizeof(message))
+		INDIGO_ERROR(indigo_error("Can't send client socket to parent process (%s)", strerror(errno)));
+	pthread_mutex_unlock(&control_mutex);
+}
+
+static void keep_clients(int handle) {
+	while (true) {
+		kept_client_message message;
+		struct iovec iov = { &message, sizeof(message) };
+		struct msghdr header;
+		char control[CMSG_SPACE(sizeof(int))];
+		memset(&header, 0, sizeof(header));
+		header.msg_iov = &iov;
+		header.msg_iovlen = 1;
+		header.msg_control = control;
+		header.msg_controllen = sizeof(control);
+		ssize_t length = recvmsg(handle, &header, MSG_WAITALL);
+		if (length < 0 && errno == EINTR)
+			continue;
+		if (length != sizeof(message))
+			return;
+		int socket = -1;
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+		if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(&socket, CMSG_DATA(cmsg), sizeof(int));
+		switch (message.type) {
+			case KEPT_CLIENT_ADD:
+				if (socket < 0)
+					break;
+				if (kept_client_count == MAX_KEPT_CLIENTS) {
+					close(socket);
+					break;
+				}
+				kept_clients[kept_client_count++] = (kept_client){ message.id, socket, message.protocol, message.version };
+				if (message.id >= next_client_id)
+					next_client_id = message.id + 1;
+				break;
+			case KEPT_CLIENT_REMOVE:
+				for (int i = 0; i < kept_client_count; i++) {
+					if (kept_clients[i].id == message.id) {
+						close(kept_clients[i].socket);
+						kept_clients[i] = kept_clients[--kept_client_count];
+						break;
+					}
+				}
+				break;
+			case KEPT_CLIENT_VERSION:
+				for (int i = 0; i < kept_client_count; i++) {
+					if (kept_clients[i].id == message.id) {
+						kept_clients[i].version = message.version;
+						break;
+					}
+				}
+				break;
+		}
+	}
+}
+
+static void close_broken_clients(void) {
+	/* worker crashed while writing an element, rest of it is lost and client stream can't be continued */
+	for (int i = 0; i < kept_client_count; i++) {
+		for (int j = 0; j < MAX_KEPT_CLIENTS; j++) {
+			if (atomic_load(&snapshot->clients[j].id) == kept_clients[i].id && atomic_load(&snapshot->clients[j].pending_elements) != 0) {
+				INDIGO_LOG(indigo_log("Client #%d was interrupted in the middle of message, connection is closed", kept_clients[i].id));
+				close(kept_clients[i].socket);
+				kept_clients[i--] = kept_clients[--kept_client_count];
+				break;
+			}
+		}
+	}
+	for (int j = 0; j < MAX_KEPT_CLIENTS; j++) {
+		atomic_store(&snapshot->clients[j].id, 0);
+		atomic_store(&snapshot->clients[j].pending_elements, 0);
+	}
+}
+
+static void client_hook(int socket, indigo_client *client, indigo_record_protocol protocol, bool connected) {
+	pthread_mutex_lock(&worker_clients_mutex);
+	int slot = -1;
+	for (int i = 0; i < MAX_KEPT_CLIENTS; i++) {
+		if (worker_clients[i].client == client) {
+			slot = i;
+			break;
+		}
+	}
+	if (connected && slot < 0) {
+		for (int i = 0; i < MAX_KEPT_CLIENTS; i++) {
+			if (worker_clients[i].client == NULL) {
+				/* adopted client keeps its id, parent process knows it already */
+				int kept = 0;
+				while (kept < kept_client_count && kept_clients[kept].socket != socket)
+					kept++;
+				if (kept < kept_client_count) {
+					worker_clients[i] = (worker_client){ client, kept_clients[kept].id, client->version, true };
+					kept_clients[kept].socket = -1;
+				} else {
+					worker_clients[i] = (worker_client){ client, next_client_id++, client->version, false };
+					send_control_message(KEPT_CLIENT_ADD, worker_clients[i].id, protocol, client->version, socket);
+				}
+				atomic_store(&snapshot->clients[i].id, worker_clients[i].id);
+				((indigo_adapter_context *)client->client_context)->pending_elements = &snapshot->clients[i].pending_elements;
+				break;
+			}
+		}
+	} else if (!connected && slot >= 0) {
+		/* pending_elements is kept as is, client adapter can still write until it is detached */
+		atomic_store(&snapshot->clients[slot].id, 0);
+		send_control_message(KEPT_CLIENT_REMOVE, worker_clients[slot].id, protocol, 0, -1);
+		worker_clients[slot].client = NULL;
+	}
+	pthread_mutex_unlock(&worker_clients_mutex);
+}
+
+static void snapshot_property(indigo_device *device, indigo_property *property, void *data) {
+	uint32_t *length = data;
+	if (property->hidden)
+		return;
+	int target = atomic_load(&snapshot->active) == 0 ? 1 : 0;
+	uint32_t size = sizeof(indigo_property) + property->count * sizeof(indigo_item);
+	uint32_t record_size = (sizeof(snapshot_record) + size + 7) & ~7;
+	if (*length + record_size > SNAPSHOT_SIZE)
+		return;
+	snapshot_record *record = (snapshot_record *)(snapshot->data[target] + *length);
+	record->size = record_size;
+	record->is_remote = device->is_remote;
+	indigo_property *copy = (indigo_property *)(record + 1);
+	memcpy(copy, property, size);
+	if (copy->type == INDIGO_BLOB_VECTOR) {
+		for (int i = 0; i < copy->count; i++) {
+			copy->items[i].blob.value = NULL;
+			copy->items[i].blob.size = 0;
+		}
+	}
+	*length += record_size;
+}
+
+static void *snapshot_thread(void *data) {
+	double next_snapshot = indigo_metric_time() + (cached_count > 0 ? WARM_RESTART_GRACE : SNAPSHOT_INTERVAL);
+	while (true) {
+		sleep(SNAPSHOT_INTERVAL);
+		pthread_mutex_lock(&worker_clients_mutex);
+		for (int i = 0; i < MAX_KEPT_CLIENTS; i++) {
+			worker_client *client = worker_clients + i;
+			if (client->client != NULL && client->client->version != client->version) {
+				client->version = client->client->version;
+				send_control_message(KEPT_CLIENT_VERSION, client->id, 0, client->version, -1);
+			}
+		}
+		pthread_mutex_unlock(&worker_clients_mutex);
+		/* snapshot of previous worker is kept until drivers of restarted one are given a chance to define their properties */
+		if (indigo_metric_time() >= next_snapshot) {
+			uint32_t length = 0;
+			indigo_enumerate_defined_properties(snapshot_property, &length);
+			int target = atomic_load(&snapshot->active) == 0 ? 1 : 0;
+			snapshot->length[target] = length;
+			atomic_store(&snapshot->active, target);
+			next_snapshot = indigo_metric_time() + SNAPSHOT_INTERVAL;
+		}
+	}
+	return NULL;
+}
+
+static int validate_snapshot(char *data, uint32_t length) {
+	/* snapshot is written by previous worker, which may have crashed while writing it */
+	if (length > SNAPSHOT_SIZE)
+		return -1;
+	int count = 0;
+	uint32_t offset = 0;
+	while (offset < length) {
+		if (length - offset < sizeof(snapshot_record) + sizeof(indigo_property))
+			return -1;
+		snapshot_record *record = (snapshot_record *)(data + offset);
+		indigo_property *property = (indigo_property *)(record + 1);
+		if (record->size < sizeof(snapshot_record) + sizeof(indigo_property) || record->size > length - offset || (record->size & 7))
+			return -1;
+		if (property->count < 0 || property->count > INDIGO_MAX_ITEMS)
+			return -1;
+		if (sizeof(snapshot_record) + sizeof(indigo_property) + property->count * sizeof(indigo_item) > record->size)
+			return -1;
+		offset += record->size;
+		count++;
+	}
+	return count;
+}
+
+static void load_snapshot(void) {
+	int active = atomic_load(&snapshot->active);
+	if (active != 0 && active != 1)
+		return;
+	char *data = snapshot->data[active];
+	uint32_t length = snapshot->length[active];
+	int count = validate_snapshot(data, length);
+	if (count < 0) {
+		indigo_error("Warm restart, property snapshot is corrupted and discarded");
+		return;
+	}
+	cached_devices = calloc(count, sizeof(indigo_device));
+	cached_properties = calloc(count, sizeof(indigo_property *));
+	cached_restored = calloc(count, sizeof(bool));
+	for (uint32_t offset = 0; offset < length; offset += ((snapshot_record *)(data + offset))->size) {
+		snapshot_record *record = (snapshot_record *)(data + offset);
+		indigo_property *property = (indigo_property *)(record + 1);
+		uint32_t size = sizeof(indigo_property) + property->count * sizeof(indigo_item);
+		indigo_property *copy = malloc(size);
+		memcpy(copy, property, size);
+		copy->device[INDIGO_NAME_SIZE - 1] = 0;
+		copy->name[INDIGO_NAME_SIZE - 1] = 0;
+		copy->state = INDIGO_BUSY_STATE;
+		indigo_device *device = cached_devices + cached_count;
+		indigo_copy_name(device->name, copy->device, INDIGO_NAME_SIZE);
+		device->is_remote = record->is_remote;
+		cached_properties[cached_count++] = copy;
+	}
+	INDIGO_LOG(indigo_log("Warm restart, %d cached properties", cached_count));
+}
+
+static void define_cached_properties(indigo_client *client) {
+	for (int i = 0; i < cached_count; i++)
+		client->define_property(client, cached_devices + i, cached_properties[i], NULL);
+	pthread_mutex_lock(&worker_clients_mutex);
+	adoptions_pending--;
+	pthread_cond_broadcast(&adoptions_cond);
+	pthread_mutex_unlock(&worker_clients_mutex);
+}
+
+static indigo_client restore_client;
+
+static void *restore_connection(void *data) {
+	static const char *items[] = { CONNECTION_CONNECTED_ITEM_NAME };
+	static const bool values[] = { true };
+	indigo_change_switch_property(&restore_client, (char *)data, CONNECTION_PROPERTY_NAME, 1, items, values);
+	free(data);
+	return NULL;
+}
+
+static indigo_result restore_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (strcmp(property->name, CONNECTION_PROPERTY_NAME) || device->is_remote)
+		return INDIGO_OK;
+	indigo_item *connected = indigo_get_item(property, CONNECTION_CONNECTED_ITEM_NAME);
+	if (connected == NULL || connected->sw.value)
+		return INDIGO_OK;
+	for (int i = 0; i < cached_count; i++) {
+		indigo_property *cached = cached_properties[i];
+		if (!cached_restored[i] && !strcmp(cached->name, CONNECTION_PROPERTY_NAME) && !strcmp(cached->device, property->device)) {
+			cached_restored[i] = true;
+			if (indigo_get_switch(cached, CONNECTION_CONNECTED_ITEM_NAME)) {
+				INDIGO_LOG(indigo_log("Reconnecting %s", property->device));
+				indigo_async(restore_connection, strdup(property->device));
+			}
+			break;
+		}
+	}
+	return INDIGO_OK;
+}
+
+static indigo_client restore_client = {
+	"Warm restart", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	NULL,
+	restore_define_property,
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+static void mark_defined(indigo_device *device, indigo_property *property, void *data) {
+	for (int i = 0; i < cached_count; i++) {
+		if (!((bool *)data)[i] && !strcmp(cached_properties[i]->name, property->name) && !strcmp(cached_properties[i]->device, property->device)) {
+			((bool *)data)[i] = true;
+			break;
+		}
+	}
+}
+
+static void *warm_restart_grace_thread(void *data) {
+	sleep(WARM_RESTART_GRACE);
+	indigo_detach_client(&restore_client);
+	bool *defined = calloc(cached_count, sizeof(bool));
+	indigo_enumerate_defined_properties(mark_defined, defined);
+	pthread_mutex_lock(&worker_clients_mutex);
+	for (int i = 0; i < MAX_KEPT_CLIENTS; i++) {
+		indigo_client *client = worker_clients[i].client;
+		if (client != NULL && worker_clients[i].adopted) {
+			for (int j = 0; j < cached_count; j++) {
+				if (!defined[j])
+					client->delete_property(client, cached_devices + j, cached_properties[j], NULL);
+			}
+		}
+	}
+	pthread_mutex_unlock(&worker_clients_mutex);
+	free(defined);
+	return NULL;
+}
+
+static void start_warm_restart_worker(void) {
+	pthread_t thread;
+	load_snapshot();
+	indigo_server_tcp_client_hook = client_hook;
+	adoptions_pending = kept_client_count;
+	for (int i = 0; i < kept_client_count; i++)
+		indigo_server_adopt_client(kept_clients[i].socket, kept_clients[i].protocol, kept_clients[i].version, define_cached_properties);
+	/* cached definitions must reach clients before drivers define real ones */
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 5;
+	pthread_mutex_lock(&worker_clients_mutex);
+	while (adoptions_pending > 0 && pthread_cond_timedwait(&adoptions_cond, &worker_clients_mutex, &deadline) == 0)
+		;
+	pthread_mutex_unlock(&worker_clients_mutex);
+	if (cached_count > 0) {
+		indigo_attach_client(&restore_client);
+		if (pthread_create(&thread, NULL, warm_restart_grace_thread, NULL) == 0)
+			pthread_detach(thread);
+	}
+	if (pthread_create(&thread, NULL, snapshot_thread, NULL) == 0)
+		pthread_detach(thread);
+}
+
+static char flight_recorder_path[PATH_MAX] = "";
+
+static void flight_recorder_handler(int signo) {
+	indigo_flight_recorder_dump(flight_recorder_path, 0);
+}
+
+static void start_flight_recorder(void) {
+	if (!indigo_use_flight_recorder)
+		return;
+	if (*flight_recorder_path == 0) {
+		int length = snprintf(flight_recorder_path, sizeof(flight_recorder_path), "%s/.indigo", getenv("HOME"));
+		mkdir(flight_recorder_path, 0777);
+		if (indigo_server_tcp_port == 7624)
+			snprintf(flight_recorder_path + length, sizeof(flight_recorder_path) - length, "/indigo_server.flight");
+		else
+			snprintf(flight_recorder_path + length, sizeof(flight_recorder_path) - length, "/indigo_server_%d.flight", indigo_server_tcp_port);
+	}
+	/* dumped on crash or on demand by SIGUSR2 */
+	indigo_flight_recorder_dump_on_crash(flight_recorder_path);
+	signal(SIGUSR2, flight_recorder_handler);
+	INDIGO_LOG(indigo_log("Flight recorder dumps to %s", flight_recorder_path));
+}
+
 static void server_main() {
 	indigo_log("INDIGO server %d.%d-%d built on %s", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD, __TIMESTAMP__);
 
@@ -433,9 +1015,14 @@ static void server_main() {
 
 	indigo_start();
 
+	if (control_socket >= 0)
+		start_warm_restart_worker();
+
 	for (int i = 1; i < server_argc; i++) {
 		if ((!strcmp(server_argv[i], "-p") || !strcmp(server_argv[i], "--port")) && i < server_argc - 1) {
-			indigo_server_tcp_port = atoi(server_argv[i + 1]);
+			/* port is already bound by parent process if warm restart is used */
+			if (control_socket < 0)
+				indigo_server_tcp_port = atoi(server_argv[i + 1]);
 			i++;
 		} else if (!strcmp(server_argv[i], "-s") || !strcmp(server_argv[i], "--enable-simulators")) {
 			first_driver = 0;
@@ -464,13 +1051,44 @@ static void server_main() {
 			i++;
 		} else if (!strcmp(server_argv[i], "-c-") || !strcmp(server_argv[i], "--disable-control-panel")) {
 			use_control_panel = false;
+		} else if (!strcmp(server_argv[i], "-z-") || !strcmp(server_argv[i], "--disable-lazy-drivers")) {
+			use_lazy_drivers = false;
+		} else if (!strcmp(server_argv[i], "-w-") || !strcmp(server_argv[i], "--disable-warm-restart")) {
+			/* handled in parent process */
 		} else if (!strcmp(server_argv[i], "-u-") || !strcmp(server_argv[i], "--disable-blob-urls")) {
 			indigo_use_blob_urls = false;
+		} else if ((!strcmp(server_argv[i], "-B") || !strcmp(server_argv[i], "--blob-delivery")) && i < server_argc - 1) {
+			const char *policy = server_argv[i + 1];
+			if (!strcmp(policy, "all")) {
+				indigo_blob_delivery = INDIGO_BLOB_DELIVERY_ALL;
+			} else if (!strcmp(policy, "latest")) {
+				indigo_blob_delivery = INDIGO_BLOB_DELIVERY_LATEST;
+			} else if (atoi(policy) > 0) {
+				indigo_blob_delivery = INDIGO_BLOB_DELIVERY_NTH;
+				indigo_blob_delivery_nth = atoi(policy);
+			} else {
+				INDIGO_ERROR(indigo_error("Invalid BLOB delivery policy '%s'", policy));
+			}
+			i++;
+		} else if ((!strcmp(server_argv[i], "-m") || !strcmp(server_argv[i], "--max-update-rate")) && i < server_argc - 1) {
+			double rate = atof(server_argv[i + 1]);
+			indigo_remote_update_interval = rate > 0 ? 1 / rate : 0;
+			i++;
+		} else if ((!strcmp(server_argv[i], "-R") || !strcmp(server_argv[i], "--record")) && i < server_argc - 1) {
+			indigo_start_recording(server_argv[i + 1]);
+			i++;
+		} else if ((!strcmp(server_argv[i], "-F") || !strcmp(server_argv[i], "--flight-recorder")) && i < server_argc - 1) {
+			strncpy(flight_recorder_path, server_argv[i + 1], sizeof(flight_recorder_path) - 1);
+			i++;
+		} else if (!strcmp(server_argv[i], "-F-") || !strcmp(server_argv[i], "--disable-flight-recorder")) {
+			indigo_use_flight_recorder = false;
 		} else if(server_argv[i][0] != '-') {
 			indigo_load_driver(server_argv[i], false, NULL);
 		}
 	}
 
+	start_flight_recorder();
+
 	if (use_control_panel) {
 		indigo_server_add_resource("/ctrl", ctrl, sizeof(ctrl), "text/html");
 		indigo_server_add_resource("/resource/angular.min.js", angular_js, sizeof(angular_js), "text/javascript");
@@ -485,6 +1103,14 @@ static void server_main() {
 		indigo_add_driver(static_drivers[i], false, NULL);
 	}
 
+	if (use_lazy_drivers) {
+		int rc = libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, lazy_drivers_callback, NULL, &lazy_drivers_handle);
+		if (rc < 0) {
+			INDIGO_ERROR(indigo_error("Can't register hotplug callback (%s), drivers are initialized immediately", libusb_error_name(rc)));
+			use_lazy_drivers = false;
+		}
+	}
+
 	indigo_attach_device(&server_device);
 	
 #ifdef INDIGO_LINUX
@@ -506,6 +1132,9 @@ static void server_main() {
 	DNSServiceRefDeallocate(sd_http);
 #endif
 
+	indigo_stop_recording();
+	if (use_lazy_drivers)
+		libusb_hotplug_deregister_callback(NULL, lazy_drivers_handle);
 	indigo_detach_device(&server_device);
 	indigo_stop();
 	for (int i = 0; i < INDIGO_MAX_DRIVERS; i++) {
@@ -549,6 +1178,11 @@ static void signal_handler(int signo) {
 	}
 }
 
+static void forward_signal_handler(int signo) {
+	if (server_pid > 0)
+		kill(server_pid, signo);
+}
+
 int main(int argc, const char * argv[]) {
 	bool do_fork = true;
 	server_argv[0] = argv[0];
@@ -559,9 +1193,17 @@ int main(int argc, const char * argv[]) {
 			do_fork = false;
 		} else if (!strcmp(argv[i], "-l") || !strcmp(argv[i], "--use-syslog")) {
 			indigo_use_syslog = true;
+		} else if (!strcmp(argv[i], "-x") || !strcmp(argv[i], "--device-executors")) {
+			indigo_use_device_executors = true;
+		} else if (!strcmp(argv[i], "-w-") || !strcmp(argv[i], "--disable-warm-restart")) {
+			use_warm_restart = false;
+		} else if ((!strcmp(argv[i], "-p") || !strcmp(argv[i], "--port")) && i < argc - 1) {
+			indigo_server_tcp_port = atoi(argv[i + 1]);
+			server_argv[server_argc++] = argv[i++];
+			server_argv[server_argc++] = argv[i];
 		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
 			printf("%s [-h|--help]\n", argv[0]);
-			printf("%s [--|--do-not-fork] [-l|--use-syslog] [-s|--enable-simulators] [-p|--port port] [-u-|--disable-blob-urls] [-b|--bonjour name] [-b-|--disable-bonjour] [-c-|--disable-control-panel] [-v|--enable-info] [-vv|--enable-debug] [-vvv|--enable-trace] [-r|--remote-server host:port] [-i|--indi-driver driver_executable] indigo_driver_name indigo_driver_name ...\n", argv[0]);
+			printf("%s [--|--do-not-fork] [-l|--use-syslog] [-x|--device-executors] [-w-|--disable-warm-restart] [-s|--enable-simulators] [-p|--port port] [-u-|--disable-blob-urls] [-B|--blob-delivery all|latest|n (default: all)] [-z-|--disable-lazy-drivers] [-m|--max-update-rate updates_per_second] [-R|--record recording_file] [-F|--flight-recorder dump_file] [-F-|--disable-flight-recorder] [-b|--bonjour name] [-b-|--disable-bonjour] [-c-|--disable-control-panel] [-v|--enable-info] [-vv|--enable-debug] [-vvv|--enable-trace] [-r|--remote-server host:port] [-i|--indi-driver driver_executable] indigo_driver_name indigo_driver_name ...\n", argv[0]);
 			return 0;
 		} else {
 			server_argv[server_argc++] = argv[i];
@@ -570,8 +1212,26 @@ int main(int argc, const char * argv[]) {
 	signal(SIGINT, signal_handler);
 	signal(SIGTERM, signal_handler);
 	signal(SIGHUP, signal_handler);
+	signal(SIGUSR2, forward_signal_handler);
+	if (do_fork && use_warm_restart) {
+		snapshot = mmap(NULL, sizeof(snapshot_area), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (snapshot == MAP_FAILED || indigo_server_listen() != INDIGO_OK) {
+			INDIGO_ERROR(indigo_error("Warm restart is not available"));
+			if (snapshot != MAP_FAILED)
+				munmap(snapshot, sizeof(snapshot_area));
+			snapshot = NULL;
+			use_warm_restart = false;
+		} else {
+			atomic_store(&snapshot->active, -1);
+		}
+	}
 	if (do_fork) {
 		while(keep_server_running) {
+			int control[2] = { -1, -1 };
+			if (use_warm_restart && socketpair(AF_UNIX, SOCK_STREAM, 0, control) < 0) {
+				INDIGO_ERROR(indigo_error("Can't create control socket (%s)", strerror(errno)));
+				control[0] = control[1] = -1;
+			}
 			server_pid = fork();
 			if (server_pid == -1) {
 				INDIGO_ERROR(indigo_error("Server start failed!"));
@@ -595,13 +1255,25 @@ int main(int argc, const char * argv[]) {
 				/* Linux requires additional step to change process name */
 				prctl(PR_SET_NAME, process_name, 0, 0, 0);
 #endif
+				if (control[0] >= 0) {
+					close(control[0]);
+					control_socket = control[1];
+				}
 				server_main();
 				return EXIT_SUCCESS;
 			} else {
+				if (control[0] >= 0) {
+					/* returns when worker exits */
+					close(control[1]);
+					keep_clients(control[0]);
+					close(control[0]);
+				}
 				if (waitpid(server_pid, NULL, 0) == -1 ) {
 					INDIGO_ERROR(indigo_error("waitpid() failed."));
 					return EXIT_FAILURE;
 				}
+				if (control[0] >= 0)
+					close_broken_clients();
 				use_sigkill = false;
 				if (keep_server_running) {
 					INDIGO_LOG(indigo_log("Shutdown complete! Starting up..."));
@@ -0,0 +1,125 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo_bus.h"
+
+#define BENCHMARK_DEVICE		"Benchmark Device"
+#define BENCHMARK_PROPERTY	"BENCHMARK_VALUES"
+#define BENCHMARK_ITEMS			20
+#define BENCHMARK_LOOPS			100000
+
+static indigo_property *values_property;
+static char item_names[BENCHMARK_ITEMS][INDIGO_NAME_SIZE];
+static int updates = 0;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static indigo_result device_attach(indigo_device *device) {
+	values_property = indigo_init_number_property(NULL, BENCHMARK_DEVICE, BENCHMARK_PROPERTY, "Main", "Values", INDIGO_OK_STATE, INDIGO_RW_PERM, BENCHMARK_ITEMS);
+	for (int i = 0; i < BENCHMARK_ITEMS; i++) {
+		snprintf(item_names[i], INDIGO_NAME_SIZE, "VALUE_%02d", i);
+		indigo_init_number_item(values_property->items + i, item_names[i], item_names[i], 0, 1000000, 1, 0);
+	}
+	indigo_define_property(device, values_property, NULL);
+	return INDIGO_OK;
+}
+
+static indigo_result device_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (indigo_property_match(values_property, property))
+		indigo_define_property(device, values_property, NULL);
+	return INDIGO_OK;
+}
+
+static indigo_result device_change_property(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (indigo_property_match(values_property, property)) {
+		indigo_property_copy_values(values_property, property, false);
+		indigo_update_property(device, values_property, NULL);
+	}
+	return INDIGO_OK;
+}
+
+static indigo_result device_detach(indigo_device *device) {
+	indigo_delete_property(device, values_property, NULL);
+	indigo_release_property(values_property);
+	return INDIGO_OK;
+}
+
+static indigo_result client_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	updates++;
+	return INDIGO_OK;
+}
+
+static indigo_device device = INDIGO_DEVICE_INITIALIZER(BENCHMARK_DEVICE, device_attach, device_enumerate_properties, device_change_property, NULL, device_detach);
+
+static indigo_client client = {
+	"Benchmark", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	NULL,
+	NULL,
+	client_update_property,
+	NULL,
+	NULL,
+	NULL
+};
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	int loops = argc > 1 ? atoi(argv[1]) : BENCHMARK_LOOPS;
+	if (loops <= 0)
+		loops = BENCHMARK_LOOPS;
+	indigo_start();
+	indigo_attach_device(&device);
+	indigo_attach_client(&client);
+
+	const char *items[BENCHMARK_ITEMS];
+	double values[BENCHMARK_ITEMS];
+	for (int i = 0; i < BENCHMARK_ITEMS; i++)
+		items[i] = item_names[i];
+
+	double start = now();
+	for (int loop = 0; loop < loops; loop++) {
+		for (int i = 0; i < BENCHMARK_ITEMS; i++)
+			values[i] = loop + i;
+		indigo_change_number_property(&client, BENCHMARK_DEVICE, BENCHMARK_PROPERTY, BENCHMARK_ITEMS, items, values);
+	}
+	double elapsed = now() - start;
+	printf("indigo_change_property: %d changes of %d items in %.3fs, %.0f changes/s, %d updates\n", loops, BENCHMARK_ITEMS, elapsed, loops / elapsed, updates);
+
+	start = now();
+	int found = 0;
+	for (int loop = 0; loop < loops; loop++)
+		for (int i = 0; i < BENCHMARK_ITEMS; i++)
+			if (indigo_get_item(values_property, item_names[i]) != NULL)
+				found++;
+	elapsed = now() - start;
+	printf("indigo_get_item: %d lookups in %.3fs, %.0f lookups/s\n", found, elapsed, found / elapsed);
+
+	indigo_detach_client(&client);
+	indigo_detach_device(&device);
+	indigo_stop();
+	return 0;
+}
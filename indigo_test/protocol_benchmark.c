@@ -0,0 +1,672 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Protocol throughput benchmark - runs server in process and measures it over real TCP connections
+// through XML, JSON and WebSocket adapters. Results are written as JSON (stdout or -o file).
+// BLOBs from subprocess driver (benchmark started again as driver) are measured with and without shared memory ring.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "indigo_bus.h"
+#include "indigo_io.h"
+#include "indigo_xml.h"
+#include "indigo_json.h"
+#include "indigo_client.h"
+#include "indigo_client_xml.h"
+#include "indigo_driver_xml.h"
+#include "indigo_driver_json.h"
+#include "indigo_server_tcp.h"
+
+#include "indigo_benchmark.h"
+
+#define BENCHMARK_DEVICE		"Protocol Benchmark"
+#define SUBPROCESS_DEVICE		"Protocol Benchmark Subprocess"
+#define SUBPROCESS_ENV			"PROTOCOL_BENCHMARK_DRIVER"
+#define VALUES_PROPERTY			"BENCHMARK_VALUES"
+#define BLOB_PROPERTY				"BENCHMARK_BLOB"
+#define VALUES_COUNT				4
+#define BLOB_SIZE						(8 * 1024 * 1024)
+#define WAIT_TIMEOUT				30
+
+typedef struct {
+	indigo_benchmark_protocol protocol;
+	int socket;
+	pthread_t thread;
+	atomic_int definitions;
+	atomic_int updates;
+	atomic_int blobs;
+	atomic_long bytes;
+} benchmark_client;
+
+static indigo_property *values_property;
+static indigo_property *blob_property;
+static unsigned char *blob_data;
+static FILE *output;
+static int result_count = 0;
+static bool quick = false;
+static bool server_started = false;
+static bool subprocess_driver = false;
+static atomic_int subprocess_definitions;
+static char subprocess_device[INDIGO_NAME_SIZE];
+static atomic_int subprocess_blobs;
+static pthread_mutex_t wait_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wait_cond = PTHREAD_COND_INITIALIZER;
+
+// -------------------------------------------------------------------------------- results
+
+static void result(const char *test, const char *protocol, const char *mode, int clients, const char *unit, int count, const char **names, const double *values) {
+	fprintf(output, "%s\n    { \"test\": \"%s\"", result_count++ ? "," : "", test);
+	if (protocol)
+		fprintf(output, ", \"protocol\": \"%s\"", protocol);
+	if (mode)
+		fprintf(output, ", \"mode\": \"%s\"", mode);
+	if (clients)
+		fprintf(output, ", \"clients\": %d", clients);
+	fprintf(output, ", \"unit\": \"%s\"", unit);
+	for (int i = 0; i < count; i++)
+		fprintf(output, ", \"%s\": %.3f", names[i], values[i]);
+	fprintf(output, " }");
+	fflush(output);
+	fprintf(stderr, "%s %s", test, protocol ? protocol : mode ? mode : "");
+	if (clients)
+		fprintf(stderr, " (%d %s)", clients, clients == 1 ? "client" : "clients");
+	fprintf(stderr, ": ");
+	for (int i = 0; i < count; i++)
+		fprintf(stderr, "%s%s %.3f", i ? ", " : "", names[i], values[i]);
+	fprintf(stderr, " %s\n", unit);
+}
+
+// -------------------------------------------------------------------------------- benchmark device
+
+static indigo_result device_attach(indigo_device *device) {
+	values_property = indigo_init_number_property(NULL, device->name, VALUES_PROPERTY, "Main", "Values", INDIGO_OK_STATE, INDIGO_RW_PERM, VALUES_COUNT);
+	for (int i = 0; i < VALUES_COUNT; i++) {
+		char name[INDIGO_NAME_SIZE];
+		snprintf(name, INDIGO_NAME_SIZE, "VALUE_%d", i);
+		indigo_init_number_item(values_property->items + i, name, name, -1e9, 1e9, 1, 0);
+	}
+	blob_property = indigo_init_blob_property(NULL, device->name, BLOB_PROPERTY, "Main", "Image", INDIGO_IDLE_STATE, 1);
+	indigo_init_blob_item(blob_property->items, "IMAGE", "Image");
+	blob_property->items->blob.value = blob_data;
+	blob_property->items->blob.size = BLOB_SIZE;
+	strcpy(blob_property->items->blob.format, ".raw");
+	indigo_define_property(device, values_property, NULL);
+	indigo_define_property(device, blob_property, NULL);
+	return INDIGO_OK;
+}
+
+static indigo_result device_enumerate_properties(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (indigo_property_match(values_property, property))
+		indigo_define_property(device, values_property, NULL);
+	if (indigo_property_match(blob_property, property))
+		indigo_define_property(device, blob_property, NULL);
+	return INDIGO_OK;
+}
+
+static indigo_result device_change_property(indigo_device *device, indigo_client *client, indigo_property *property) {
+	if (indigo_property_match(values_property, property)) {
+		indigo_property_copy_values(values_property, property, false);
+		values_property->state = INDIGO_OK_STATE;
+		indigo_update_property(device, values_property, NULL);
+		if (subprocess_driver) {
+			/* subprocess driver answers each change with BLOB */
+			blob_property->state = INDIGO_OK_STATE;
+			indigo_update_property(device, blob_property, NULL);
+		}
+	}
+	return INDIGO_OK;
+}
+
+static indigo_result device_detach(indigo_device *device) {
+	indigo_delete_property(device, values_property, NULL);
+	indigo_delete_property(device, blob_property, NULL);
+	indigo_release_property(values_property);
+	indigo_release_property(blob_property);
+	return INDIGO_OK;
+}
+
+static indigo_device device = INDIGO_DEVICE_INITIALIZER(BENCHMARK_DEVICE, device_attach, device_enumerate_properties, device_change_property, NULL, device_detach);
+
+// -------------------------------------------------------------------------------- network clients
+
+static void server_callback(int count) {
+	pthread_mutex_lock(&wait_mutex);
+	server_started = true;
+	pthread_cond_broadcast(&wait_cond);
+	pthread_mutex_unlock(&wait_mutex);
+}
+
+static void *server_thread(void *arg) {
+	indigo_server_start(server_callback);
+	return NULL;
+}
+
+static bool wait_for(atomic_int *counter, int value) {
+	double timeout = indigo_benchmark_now() + WAIT_TIMEOUT;
+	pthread_mutex_lock(&wait_mutex);
+	while (atomic_load(counter) < value) {
+		if (indigo_benchmark_now() > timeout) {
+			pthread_mutex_unlock(&wait_mutex);
+			fprintf(stderr, "timeout (%d of %d)\n", atomic_load(counter), value);
+			return false;
+		}
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += 1;
+		pthread_cond_timedwait(&wait_cond, &wait_mutex, &ts);
+	}
+	pthread_mutex_unlock(&wait_mutex);
+	return true;
+}
+
+static int count_pattern(const char *buffer, long length, const char *pattern) {
+	int count = 0;
+	long pattern_length = strlen(pattern);
+	const char *end = buffer + length - pattern_length;
+	for (const char *pointer = buffer; pointer <= end; pointer++) {
+		pointer = memchr(pointer, *pattern, end - pointer + 1);
+		if (pointer == NULL)
+			break;
+		if (!memcmp(pointer, pattern, pattern_length))
+			count++;
+	}
+	return count;
+}
+
+static void *client_reader(benchmark_client *client) {
+	const char *def_pattern = client->protocol == INDIGO_BENCHMARK_XML ? "<defNumberVector" : "\"defNumberVector\"";
+	const char *set_pattern = client->protocol == INDIGO_BENCHMARK_XML ? "<setNumberVector" : "\"setNumberVector\"";
+	const char *blob_pattern = client->protocol == INDIGO_BENCHMARK_XML ? "</setBLOBVector" : "\"setBLOBVector\"";
+	const int carry = 31;
+	char *buffer = malloc(carry + 256 * 1024);
+	long kept = 0;
+	while (true) {
+		long count = read(client->socket, buffer + kept, 256 * 1024);
+		if (count <= 0)
+			break;
+		long length = kept + count;
+		atomic_fetch_add(&client->bytes, count);
+		int definitions = count_pattern(buffer, length, def_pattern);
+		int updates = count_pattern(buffer, length, set_pattern);
+		int blobs = count_pattern(buffer, length, blob_pattern);
+		if (definitions || updates || blobs) {
+			pthread_mutex_lock(&wait_mutex);
+			atomic_fetch_add(&client->definitions, definitions);
+			atomic_fetch_add(&client->updates, updates);
+			atomic_fetch_add(&client->blobs, blobs);
+			pthread_cond_broadcast(&wait_cond);
+			pthread_mutex_unlock(&wait_mutex);
+		}
+		/* keep tail shorter than any pattern so the pattern split between reads is found, but never counted twice */
+		kept = length < carry ? length : carry;
+		memmove(buffer, buffer + length - kept, kept);
+	}
+	free(buffer);
+	return NULL;
+}
+
+static void send_text(benchmark_client *client, const char *text) {
+	long length = strlen(text);
+	if (client->protocol == INDIGO_BENCHMARK_WEBSOCKET) {
+		/* client to server frames are always masked */
+		unsigned char frame[16 + 1024];
+		unsigned char mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+		int header = 2;
+		frame[0] = 0x81;
+		if (length < 126) {
+			frame[1] = 0x80 | length;
+		} else {
+			frame[1] = 0x80 | 126;
+			frame[2] = (length >> 8) & 0xFF;
+			frame[3] = length & 0xFF;
+			header = 4;
+		}
+		memcpy(frame + header, mask, 4);
+		for (int i = 0; i < length && i < 1024; i++)
+			frame[header + 4 + i] = text[i] ^ mask[i % 4];
+		indigo_write(client->socket, (char *)frame, header + 4 + length);
+	} else {
+		indigo_write(client->socket, text, length);
+	}
+}
+
+static int connect_socket(void) {
+	int handle = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(indigo_server_tcp_port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(handle, (struct sockaddr *)&address, sizeof(address)) < 0) {
+		perror("connect");
+		close(handle);
+		return -1;
+	}
+	int one = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return handle;
+}
+
+static benchmark_client *connect_client(indigo_benchmark_protocol protocol) {
+	benchmark_client *client = calloc(1, sizeof(benchmark_client));
+	client->protocol = protocol;
+	client->socket = connect_socket();
+	if (client->socket < 0) {
+		free(client);
+		return NULL;
+	}
+	if (protocol == INDIGO_BENCHMARK_WEBSOCKET)
+		indigo_printf(client->socket, "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+	pthread_create(&client->thread, NULL, (void * (*)(void*))client_reader, client);
+	if (protocol == INDIGO_BENCHMARK_XML)
+		send_text(client, "<getProperties version='2.0'/>\n");
+	else
+		send_text(client, "{ \"getProperties\": { \"version\": 512 } }\n");
+	if (!wait_for(&client->definitions, 1)) {
+		fprintf(stderr, "%s client didn't get definitions\n", indigo_benchmark_protocol_name[protocol]);
+		return client;
+	}
+	return client;
+}
+
+static void disconnect_client(benchmark_client *client) {
+	if (client == NULL)
+		return;
+	shutdown(client->socket, SHUT_RDWR);
+	pthread_join(client->thread, NULL);
+	close(client->socket);
+	free(client);
+}
+
+// -------------------------------------------------------------------------------- tests
+
+static void update_test(indigo_benchmark_protocol protocol, int client_count) {
+	benchmark_client *clients[client_count];
+	for (int i = 0; i < client_count; i++)
+		clients[i] = connect_client(protocol);
+	int loops = (quick ? 2000 : 20000) / client_count;
+	if (loops < 200)
+		loops = 200;
+	int initial[client_count];
+	for (int i = 0; i < client_count; i++)
+		initial[i] = clients[i] ? atomic_load(&clients[i]->updates) : 0;
+	double start = indigo_benchmark_now();
+	for (int loop = 0; loop < loops; loop++) {
+		values_property->items[loop % VALUES_COUNT].number.value = loop;
+		indigo_update_property(&device, values_property, NULL);
+	}
+	bool ok = true;
+	for (int i = 0; i < client_count; i++)
+		ok = ok && clients[i] && wait_for(&clients[i]->updates, initial[i] + loops);
+	double elapsed = indigo_benchmark_now() - start;
+	if (ok) {
+		const char *names[] = { "value", "per_client" };
+		double values[] = { client_count * loops / elapsed, loops / elapsed };
+		result("updates", indigo_benchmark_protocol_name[protocol], NULL, client_count, "updates/s", 2, names, values);
+	}
+	for (int i = 0; i < client_count; i++)
+		disconnect_client(clients[i]);
+}
+
+static void round_trip_test(indigo_benchmark_protocol protocol) {
+	benchmark_client *client = connect_client(protocol);
+	if (client == NULL)
+		return;
+	int loops = quick ? 200 : 2000;
+	double *latencies = malloc(loops * sizeof(double));
+	char text[512];
+	int count = 0;
+	for (int loop = 0; loop < loops; loop++) {
+		int expected = atomic_load(&client->updates) + 1;
+		if (protocol == INDIGO_BENCHMARK_XML)
+			snprintf(text, sizeof(text), "<newNumberVector device='%s' name='%s'><oneNumber name='VALUE_0'>%d</oneNumber></newNumberVector>\n", BENCHMARK_DEVICE, VALUES_PROPERTY, loop + 1000000);
+		else
+			snprintf(text, sizeof(text), "{ \"newNumberVector\": { \"device\": \"%s\", \"name\": \"%s\", \"items\": [ { \"name\": \"VALUE_0\", \"value\": %d } ] } }\n", BENCHMARK_DEVICE, VALUES_PROPERTY, loop + 1000000);
+		double start = indigo_benchmark_now();
+		send_text(client, text);
+		if (!wait_for(&client->updates, expected))
+			break;
+		latencies[count++] = (indigo_benchmark_now() - start) * 1e6;
+	}
+	if (count > 0) {
+		double sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += latencies[i];
+		qsort(latencies, count, sizeof(double), indigo_benchmark_compare_double);
+		const char *names[] = { "mean", "p50", "p99", "max" };
+		double values[] = { sum / count, latencies[count / 2], latencies[count * 99 / 100], latencies[count - 1] };
+		result("round_trip", indigo_benchmark_protocol_name[protocol], NULL, 1, "us", 4, names, values);
+	}
+	free(latencies);
+	disconnect_client(client);
+}
+
+static bool http_get(int handle, const char *path, long *size) {
+	char buffer[64 * 1024];
+	indigo_printf(handle, "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n", path);
+	long length = 0;
+	char *body = NULL;
+	while (body == NULL) {
+		long count = read(handle, buffer + length, sizeof(buffer) - length - 1);
+		if (count <= 0)
+			return false;
+		length += count;
+		buffer[length] = 0;
+		body = strstr(buffer, "\r\n\r\n");
+	}
+	char *content_length = strstr(buffer, "Content-Length: ");
+	if (content_length == NULL || strncmp(buffer, "HTTP/1.1 200", 12))
+		return false;
+	long remains = atol(content_length + 16) - (length - (body + 4 - buffer));
+	*size = atol(content_length + 16);
+	while (remains > 0) {
+		long count = read(handle, buffer, remains < sizeof(buffer) ? remains : sizeof(buffer));
+		if (count <= 0)
+			return false;
+		remains -= count;
+	}
+	return true;
+}
+
+static void blob_test(const char *mode) {
+	int loops = quick ? 5 : 20;
+	benchmark_client *client = NULL;
+	int handle = -1;
+	char path[INDIGO_NAME_SIZE];
+	snprintf(path, sizeof(path), "/blob/%p%s", blob_property->items, blob_property->items->blob.format);
+	if (strcmp(mode, "raw")) {
+		client = connect_client(INDIGO_BENCHMARK_XML);
+		if (client == NULL)
+			return;
+		char text[256];
+		snprintf(text, sizeof(text), "<enableBLOB device='%s' name='%s'>%s</enableBLOB>\n", BENCHMARK_DEVICE, BLOB_PROPERTY, strcmp(mode, "url") ? "Also" : "URL");
+		send_text(client, text);
+		usleep(100000);
+	}
+	if (strcmp(mode, "base64"))
+		handle = connect_socket();
+	bool ok = true;
+	long transferred = 0;
+	double start = indigo_benchmark_now();
+	for (int loop = 0; loop < loops && ok; loop++) {
+		if (client) {
+			int expected = atomic_load(&client->blobs) + 1;
+			blob_property->state = INDIGO_OK_STATE;
+			indigo_update_property(&device, blob_property, NULL);
+			ok = wait_for(&client->blobs, expected);
+		}
+		if (ok && handle >= 0) {
+			long size = 0;
+			ok = http_get(handle, path, &size);
+			if (size != BLOB_SIZE)
+				ok = false;
+		}
+		transferred += BLOB_SIZE;
+	}
+	double elapsed = indigo_benchmark_now() - start;
+	if (ok) {
+		const char *names[] = { "value", "latency" };
+		double values[] = { transferred / elapsed / 1e6, elapsed / loops * 1e3 };
+		result("blob", NULL, mode, 1, "MB/s", 2, names, values);
+	} else {
+		fprintf(stderr, "blob %s failed\n", mode);
+	}
+	if (handle >= 0)
+		close(handle);
+	disconnect_client(client);
+}
+
+static indigo_result subprocess_client_define_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	/* device name has host suffix added by subprocess adapter */
+	if (!strncmp(property->device, SUBPROCESS_DEVICE, strlen(SUBPROCESS_DEVICE))) {
+		strcpy(subprocess_device, property->device);
+		if (!strcmp(property->name, BLOB_PROPERTY))
+			indigo_enable_blob(client, property, INDIGO_ENABLE_BLOB_ALSO);
+		pthread_mutex_lock(&wait_mutex);
+		atomic_fetch_add(&subprocess_definitions, 1);
+		pthread_cond_broadcast(&wait_cond);
+		pthread_mutex_unlock(&wait_mutex);
+	}
+	return INDIGO_OK;
+}
+
+static indigo_result subprocess_client_update_property(indigo_client *client, indigo_device *device, indigo_property *property, const char *message) {
+	if (!strcmp(property->device, subprocess_device) && !strcmp(property->name, BLOB_PROPERTY) && property->state == INDIGO_OK_STATE) {
+		bool ok = property->items->blob.size == BLOB_SIZE && property->items->blob.value != NULL && !memcmp(property->items->blob.value, blob_data, BLOB_SIZE);
+		if (!ok)
+			fprintf(stderr, "subprocess BLOB corrupted\n");
+		pthread_mutex_lock(&wait_mutex);
+		atomic_fetch_add(&subprocess_blobs, 1);
+		pthread_cond_broadcast(&wait_cond);
+		pthread_mutex_unlock(&wait_mutex);
+	}
+	return INDIGO_OK;
+}
+
+static indigo_client subprocess_client = {
+	"Subprocess Benchmark", false, NULL, INDIGO_OK, INDIGO_VERSION_CURRENT, NULL,
+	NULL,
+	subprocess_client_define_property,
+	subprocess_client_update_property,
+	NULL,
+	NULL,
+	NULL
+};
+
+static void subprocess_test(const char *executable, bool use_ring) {
+	int loops = quick ? 5 : 20;
+	indigo_use_blob_ring = use_ring;
+	atomic_store(&subprocess_definitions, 0);
+	atomic_store(&subprocess_blobs, 0);
+	indigo_attach_client(&subprocess_client);
+	indigo_subprocess_entry *subprocess = NULL;
+	setenv(SUBPROCESS_ENV, "1", 1);
+	indigo_start_subprocess(executable, &subprocess);
+	bool ok = wait_for(&subprocess_definitions, 2);
+	usleep(100000);
+	long transferred = 0;
+	double start = indigo_benchmark_now();
+	for (int loop = 0; loop < loops && ok; loop++) {
+		static const char *names[] = { "VALUE_0" };
+		double values[] = { loop };
+		indigo_change_number_property(&subprocess_client, subprocess_device, VALUES_PROPERTY, 1, names, values);
+		ok = wait_for(&subprocess_blobs, loop + 1);
+		transferred += BLOB_SIZE;
+	}
+	double elapsed = indigo_benchmark_now() - start;
+	if (ok) {
+		const char *names[] = { "value", "latency" };
+		double values[] = { transferred / elapsed / 1e6, elapsed / loops * 1e3 };
+		result("blob", NULL, use_ring ? "subprocess-ring" : "subprocess-inline", 1, "MB/s", 2, names, values);
+	} else {
+		fprintf(stderr, "blob %s failed\n", use_ring ? "subprocess-ring" : "subprocess-inline");
+	}
+	if (subprocess != NULL) {
+		pthread_t thread = subprocess->thread;
+		indigo_kill_subprocess(subprocess);
+		pthread_join(thread, NULL);
+	}
+	unsetenv(SUBPROCESS_ENV);
+	indigo_detach_client(&subprocess_client);
+}
+
+static int run_subprocess_driver(void) {
+	subprocess_driver = true;
+	strcpy(device.name, SUBPROCESS_DEVICE);
+	indigo_client *protocol_adapter = indigo_xml_device_adapter(0, 1);
+	indigo_start();
+	indigo_attach_device(&device);
+	indigo_attach_client(protocol_adapter);
+	indigo_xml_parse(NULL, protocol_adapter);
+	indigo_detach_device(&device);
+	indigo_stop();
+	return 0;
+}
+
+/* session similar to what server sends to client: property definitions followed by stream of updates */
+
+static void write_xml_session(FILE *file, int messages) {
+	fprintf(file, "<?xml version='1.0' encoding='UTF-8'?>\n");
+	fprintf(file, "<defTextVector device='Mount Simulator' name='INFO' group='General' label='Info' state='Idle' perm='ro'>\n");
+	fprintf(file, "<defText name='DEVICE_VERSION' label='Version'>2.0-&lt;build&gt;</defText>\n<defText name='DEVICE_DRIVER' label='Driver'>indigo_mount_simulator</defText>\n</defTextVector>\n");
+	fprintf(file, "<defSwitchVector device='Mount Simulator' name='CONNECTION' group='Main' label='Connection' state='Ok' perm='rw' rule='OneOfMany'>\n");
+	fprintf(file, "<defSwitch name='CONNECTED' label='Connected'>On</defSwitch>\n<defSwitch name='DISCONNECTED' label='Disconnected'>Off</defSwitch>\n</defSwitchVector>\n");
+	fprintf(file, "<defNumberVector device='Mount Simulator' name='MOUNT_EQUATORIAL_COORDINATES' group='Mount' label='Coordinates' state='Ok' perm='rw'>\n");
+	fprintf(file, "<defNumber name='RA' label='Right ascension' min='0' max='24' step='0' format='%%12.9m' target='0'>0</defNumber>\n");
+	fprintf(file, "<defNumber name='DEC' label='Declination' min='-90' max='90' step='0' format='%%12.9m' target='90'>90</defNumber>\n</defNumberVector>\n");
+	for (int i = 0; i < messages; i++) {
+		switch (i % 4) {
+			case 0:
+			case 1:
+				fprintf(file, "<setNumberVector device='Mount Simulator' name='MOUNT_EQUATORIAL_COORDINATES' state='Busy'>\n<oneNumber name='RA' target='12.5'>%.9f</oneNumber>\n<oneNumber name='DEC' target='45'>%.9f</oneNumber>\n</setNumberVector>\n", (i % 86400) / 3600.0, 90.0 - (i % 180));
+				break;
+			case 2:
+				fprintf(file, "<setSwitchVector device='Mount Simulator' name='CONNECTION' state='Ok' message='Connected &amp; tracking &quot;%d&quot;'>\n<oneSwitch name='CONNECTED'>On</oneSwitch>\n<oneSwitch name='DISCONNECTED'>Off</oneSwitch>\n</setSwitchVector>\n", i);
+				break;
+			case 3:
+				fprintf(file, "<setTextVector device='Mount Simulator' name='INFO' state='Idle'>\n<oneText name='DEVICE_VERSION'>2.0-%d</oneText>\n<oneText name='DEVICE_DRIVER'>indigo_mount_simulator</oneText>\n</setTextVector>\n", i);
+				break;
+		}
+	}
+}
+
+static void write_json_session(FILE *file, int messages) {
+	for (int i = 0; i < messages; i++)
+		fprintf(file, "{ \"newNumberVector\": { \"device\": \"%s\", \"name\": \"%s\", \"items\": [ { \"name\": \"VALUE_%d\", \"value\": %d } ] } }\n", BENCHMARK_DEVICE, VALUES_PROPERTY, i % VALUES_COUNT, i);
+}
+
+static void parser_test(indigo_benchmark_protocol protocol, const char *session) {
+	char file_name[] = "/tmp/protocol_benchmark_XXXXXX";
+	if (session == NULL) {
+		int handle = mkstemp(file_name);
+		if (handle < 0) {
+			perror("mkstemp");
+			return;
+		}
+		FILE *file = fdopen(handle, "w");
+		if (protocol == INDIGO_BENCHMARK_XML)
+			write_xml_session(file, quick ? 20000 : 200000);
+		else
+			write_json_session(file, quick ? 20000 : 200000);
+		fclose(file);
+	}
+	const char *name = session ? session : file_name;
+	struct stat st;
+	stat(name, &st);
+	int input = open(name, O_RDONLY);
+	int null = open("/dev/null", O_WRONLY);
+	double start = indigo_benchmark_now();
+	if (protocol == INDIGO_BENCHMARK_XML) {
+		indigo_device *adapter = indigo_xml_client_adapter("Benchmark", "", input, null);
+		indigo_xml_parse(adapter, NULL);
+	} else {
+		indigo_client *adapter = indigo_json_device_adapter(input, null, false);
+		indigo_attach_client(adapter);
+		indigo_json_parse(NULL, adapter);
+		indigo_detach_client(adapter);
+		indigo_release_json_device_adapter(adapter);
+		close(input);
+	}
+	double elapsed = indigo_benchmark_now() - start;
+	close(null);
+	const char *names[] = { "value" };
+	double values[] = { st.st_size / elapsed / 1e6 };
+	result("parser", indigo_benchmark_protocol_name[protocol], session ? "recorded" : NULL, 0, "MB/s", 1, names, values);
+	if (session == NULL)
+		unlink(file_name);
+}
+
+int main(int argc, const char * argv[]) {
+	const char *session = NULL;
+	output = stdout;
+	for (int i = 1; i < argc; i++) {
+		if ((!strcmp(argv[i], "-o") || !strcmp(argv[i], "--output")) && i < argc - 1) {
+			output = fopen(argv[++i], "w");
+			if (output == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+		} else if ((!strcmp(argv[i], "-s") || !strcmp(argv[i], "--session")) && i < argc - 1) {
+			session = argv[++i];
+		} else if (!strcmp(argv[i], "-q") || !strcmp(argv[i], "--quick")) {
+			quick = true;
+		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			printf("%s [-o|--output file.json] [-s|--session recorded_session.xml] [-q|--quick]\n", argv[0]);
+			return 0;
+		}
+	}
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	blob_data = malloc(BLOB_SIZE);
+	for (int i = 0; i < BLOB_SIZE; i++)
+		blob_data[i] = (unsigned char)(i * 7 + (i >> 10));
+	if (getenv(SUBPROCESS_ENV))
+		return run_subprocess_driver();
+	char executable[PATH_MAX];
+	if (realpath(argv[0], executable) == NULL)
+		strncpy(executable, argv[0], sizeof(executable) - 1);
+	indigo_start();
+	indigo_attach_device(&device);
+
+	indigo_server_tcp_port = 0;
+	pthread_t thread;
+	pthread_create(&thread, NULL, server_thread, NULL);
+	pthread_mutex_lock(&wait_mutex);
+	while (!server_started)
+		pthread_cond_wait(&wait_cond, &wait_mutex);
+	pthread_mutex_unlock(&wait_mutex);
+
+	fprintf(output, "{\n  \"benchmark\": \"protocol\",\n  \"version\": \"%d.%d-%d\",\n  \"quick\": %s,\n  \"results\": [", (INDIGO_VERSION_CURRENT >> 8) & 0xFF, INDIGO_VERSION_CURRENT & 0xFF, INDIGO_BUILD, quick ? "true" : "false");
+	static const int client_counts[] = { 1, 8, 64 };
+	_Static_assert(64 < INDIGO_MAX_CLIENTS, "bus client limit is too low for benchmark");
+	for (indigo_benchmark_protocol protocol = INDIGO_BENCHMARK_XML; protocol <= INDIGO_BENCHMARK_WEBSOCKET; protocol++)
+		for (int i = 0; i < 3; i++)
+			update_test(protocol, client_counts[i]);
+	for (indigo_benchmark_protocol protocol = INDIGO_BENCHMARK_XML; protocol <= INDIGO_BENCHMARK_WEBSOCKET; protocol++)
+		round_trip_test(protocol);
+	blob_test("base64");
+	blob_test("url");
+	blob_test("raw");
+	subprocess_test(executable, false);
+	subprocess_test(executable, true);
+	parser_test(INDIGO_BENCHMARK_XML, session);
+	parser_test(INDIGO_BENCHMARK_JSON, NULL);
+	fprintf(output, "\n  ]\n}\n");
+	if (output != stdout)
+		fclose(output);
+
+	indigo_server_shutdown();
+	indigo_detach_device(&device);
+	indigo_stop();
+	free(blob_data);
+	return 0;
+}
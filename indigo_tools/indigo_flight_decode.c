@@ -0,0 +1,219 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Decoder of flight recorder dump written by indigo_server on crash or on SIGUSR2.
+// Events are printed oldest first with wall clock time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include "indigo_bus.h"
+#include "indigo_flight_recorder.h"
+
+#define MAX_EXPOSURES	64
+
+static const char *type_text[] = { "?", "define", "update", "delete", "change", "timer", "exp-start", "exp-end", "exp-abort", "blob", "connect", "disconnect" };
+static const char *state_text[] = { "Idle", "Ok", "Busy", "Alert" };
+
+static struct {
+	char device[36];
+	uint64_t timestamp;
+} exposures[MAX_EXPOSURES];
+
+static indigo_flight_event *events;
+static uint32_t last_sequence;
+
+static int compare_events(const void *a, const void *b) {
+	/* sequence numbers wrap, order by distance from the last one */
+	uint32_t age_a = last_sequence - ((indigo_flight_event *)a)->sequence;
+	uint32_t age_b = last_sequence - ((indigo_flight_event *)b)->sequence;
+	return age_a > age_b ? -1 : age_a < age_b ? 1 : 0;
+}
+
+static uint64_t *exposure_start(const char *device) {
+	for (int i = 0; i < MAX_EXPOSURES; i++) {
+		if (*exposures[i].device == 0)
+			indigo_copy_name(exposures[i].device, device, sizeof(exposures[i].device));
+		if (!strcmp(exposures[i].device, device))
+			return &exposures[i].timestamp;
+	}
+	return NULL;
+}
+
+static void pair_exposures(long count) {
+	/* duration of exposure end and abort events is computed from matching start */
+	for (long i = 0; i < count; i++) {
+		indigo_flight_event *event = events + i;
+		uint64_t *start;
+		if (event->type == INDIGO_FLIGHT_EXPOSURE_START && (start = exposure_start(event->names)) != NULL) {
+			*start = event->timestamp;
+		} else if ((event->type == INDIGO_FLIGHT_EXPOSURE_END || event->type == INDIGO_FLIGHT_EXPOSURE_ABORT) && (start = exposure_start(event->names)) != NULL && *start) {
+			event->duration = (event->timestamp - *start) / 1e9;
+			*start = 0;
+		}
+	}
+}
+
+static void print_event(indigo_flight_event *event, uint64_t realtime) {
+	const char *device = event->names;
+	const char *name = event->names + strlen(event->names) + 1;
+	time_t seconds = (time_t)(realtime / 1000000000ULL);
+	struct tm tm;
+	char time_text[32];
+	localtime_r(&seconds, &tm);
+	strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", &tm);
+	printf("%s.%06u %-10s ", time_text, (unsigned)(realtime % 1000000000ULL / 1000), event->type <= INDIGO_FLIGHT_DISCONNECT ? type_text[event->type] : "?");
+	switch (event->type) {
+		case INDIGO_FLIGHT_DEFINE:
+		case INDIGO_FLIGHT_UPDATE:
+		case INDIGO_FLIGHT_DELETE:
+		case INDIGO_FLIGHT_CHANGE:
+			printf("%s.%s %s [%d]", device, name, event->state <= INDIGO_ALERT_STATE ? state_text[event->state] : "?", event->count);
+			if (event->type != INDIGO_FLIGHT_DELETE) {
+				switch (event->property_type) {
+					case INDIGO_NUMBER_VECTOR:
+						printf(" %g", event->value);
+						break;
+					case INDIGO_SWITCH_VECTOR:
+						if (event->value >= 0)
+							printf(" #%d on", (int)event->value);
+						break;
+					case INDIGO_LIGHT_VECTOR:
+						printf(" %s", event->value >= 0 && event->value <= INDIGO_ALERT_STATE ? state_text[(int)event->value] : "?");
+						break;
+					case INDIGO_BLOB_VECTOR:
+						printf(" %.0f bytes", event->value);
+						break;
+				}
+			}
+			printf("\n");
+			break;
+		case INDIGO_FLIGHT_TIMER:
+			printf("%s timer #%d late %.6fs\n", *device ? device : "-", (int)event->value, event->duration);
+			break;
+		case INDIGO_FLIGHT_EXPOSURE_START:
+			printf("%s %gs\n", device, event->value);
+			break;
+		case INDIGO_FLIGHT_EXPOSURE_END:
+		case INDIGO_FLIGHT_EXPOSURE_ABORT:
+			printf("%s", device);
+			if (event->value > 0)
+				printf(" %.0f px", event->value);
+			if (event->duration > 0)
+				printf(" after %.3fs", event->duration);
+			printf("\n");
+			break;
+		case INDIGO_FLIGHT_BLOB:
+			printf("%s.%s %.0f bytes in %.6fs\n", device, name, event->value, event->duration);
+			break;
+		case INDIGO_FLIGHT_CONNECT:
+		case INDIGO_FLIGHT_DISCONNECT:
+			printf("%s %s socket %d\n", *device ? device : "-", name, (int)event->value);
+			break;
+		default:
+			printf("\n");
+			break;
+	}
+}
+
+static void print_help(const char *name) {
+	printf("usage: %s [options] dump_file\n", name);
+	printf("options:\n"
+	       "       -h  | --help\n"
+	       "       -n  | --last count        (print last count events only)\n"
+	       "       -d  | --device name       (print events of device only)\n"
+	);
+}
+
+int main(int argc, const char * argv[]) {
+	const char *path = NULL;
+	const char *device = NULL;
+	long last = 0;
+	for (int i = 1; i < argc; i++) {
+		if ((!strcmp(argv[i], "-n") || !strcmp(argv[i], "--last")) && i < argc - 1) {
+			last = atol(argv[++i]);
+		} else if ((!strcmp(argv[i], "-d") || !strcmp(argv[i], "--device")) && i < argc - 1) {
+			device = argv[++i];
+		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			print_help(argv[0]);
+			return 0;
+		} else if (argv[i][0] != '-') {
+			path = argv[i];
+		}
+	}
+	if (path == NULL) {
+		print_help(argv[0]);
+		return 1;
+	}
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Can't open %s\n", path);
+		return 1;
+	}
+	indigo_flight_recorder_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, INDIGO_FLIGHT_RECORDER_MAGIC, 8) || header.event_size != sizeof(indigo_flight_event) || header.size == 0) {
+		fprintf(stderr, "%s is not a flight recorder dump\n", path);
+		fclose(file);
+		return 1;
+	}
+	events = malloc(header.size * sizeof(indigo_flight_event));
+	if (events == NULL || fread(events, sizeof(indigo_flight_event), header.size, file) != header.size) {
+		fprintf(stderr, "%s is truncated\n", path);
+		fclose(file);
+		return 1;
+	}
+	fclose(file);
+	last_sequence = header.sequence;
+	long count = 0;
+	for (uint32_t i = 0; i < header.size; i++) {
+		/* skip empty and incomplete slots and slots overwritten after dump started */
+		if (events[i].sequence != 0 && last_sequence - events[i].sequence < header.size)
+			events[count++] = events[i];
+	}
+	qsort(events, count, sizeof(indigo_flight_event), compare_events);
+	pair_exposures(count);
+	time_t dumped = (time_t)(header.realtime / 1000000000ULL);
+	printf("dumped %s", ctime(&dumped));
+	if (header.reason)
+		printf("reason %s (signal %d)\n", strsignal(header.reason), header.reason);
+	else
+		printf("reason dump request\n");
+	printf("%ld events\n", count);
+	/* device filter is applied first, last count is taken from events of the device */
+	long matching = 0;
+	for (long i = 0; i < count; i++) {
+		if (device == NULL || !strcmp(events[i].names, device))
+			matching++;
+	}
+	long skip = last > 0 && last < matching ? matching - last : 0;
+	for (long i = 0; i < count; i++) {
+		indigo_flight_event *event = events + i;
+		if (device != NULL && strcmp(event->names, device))
+			continue;
+		if (skip > 0) {
+			skip--;
+			continue;
+		}
+		print_event(event, header.realtime - (header.monotonic - event->timestamp));
+	}
+	free(events);
+	return 0;
+}
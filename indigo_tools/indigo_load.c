@@ -0,0 +1,589 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Load generator - opens many XML, JSON or WebSocket clients against running server (e.g. indigo_server -s),
+// each client changes number item at given rate and waits for updates, client 0 can also run continuous
+// exposures to generate BLOB traffic. Requests are tagged by value (client and sequence number encoded
+// within item range), so every client can match its own requests in updates broadcasted to all clients.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+
+#include "indigo_bus.h"
+#include "indigo_io.h"
+#include "indigo_names.h"
+
+#include "indigo_benchmark.h"
+
+#define INDIGO_DEFAULT_PORT	7624
+#define SEQUENCE_WINDOW			100
+#define MAX_TAG_SIZE				(16 * 1024)
+#define BUFFER_SIZE					(256 * 1024)
+
+typedef enum {
+	BLOB_NEVER,
+	BLOB_ALSO,
+	BLOB_URL
+} blob_mode;
+
+typedef struct {
+	int index;
+	int socket;
+	int http_socket;
+	pthread_t reader_thread;
+	pthread_t sender_thread;
+	pthread_mutex_t write_mutex;
+	atomic_bool defined;
+	atomic_bool running;
+	_Atomic double sent_time[SEQUENCE_WINDOW];
+	long requests;
+	atomic_long responses;
+	atomic_long updates;
+	atomic_long blobs;
+	atomic_long blob_bytes;
+	atomic_long bytes;
+	double *latencies;
+	long latency_count;
+	long latency_size;
+	/* state of currently parsed vector */
+	bool in_target;
+	bool in_exposure;
+	bool in_blob;
+	bool busy;
+} load_client;
+
+static indigo_benchmark_protocol protocol = INDIGO_BENCHMARK_XML;
+static blob_mode blobs = BLOB_NEVER;
+static char hostname[255] = "localhost";
+static int port = INDIGO_DEFAULT_PORT;
+static int client_count = 8;
+static double rate = 10;
+static double duration = 10;
+static char target_device[INDIGO_NAME_SIZE] = "Mount Simulator";
+static char target_property[INDIGO_NAME_SIZE] = "MOUNT_GUIDE_RATE";
+static char target_item[INDIGO_NAME_SIZE] = "RA";
+static char exposure_device[INDIGO_NAME_SIZE] = "";
+static double exposure_time = 0.1;
+static double target_min = NAN, target_max = NAN;
+static atomic_long exposures = 0;
+static load_client *clients;
+
+static const char *blob_text[] = { "Never", "Also", "URL" };
+
+// -------------------------------------------------------------------------------- requests
+
+static void send_text(load_client *client, int handle, const char *text) {
+	long length = strlen(text);
+	pthread_mutex_lock(&client->write_mutex);
+	if (protocol == INDIGO_BENCHMARK_WEBSOCKET && handle == client->socket) {
+		unsigned char header[8] = { 0x81 };
+		unsigned char mask[4] = { 0x5A, 0xA5, 0x3C, 0xC3 };
+		int header_length = 2;
+		if (length < 126) {
+			header[1] = 0x80 | length;
+		} else {
+			header[1] = 0x80 | 126;
+			header[2] = (length >> 8) & 0xFF;
+			header[3] = length & 0xFF;
+			header_length = 4;
+		}
+		memcpy(header + header_length, mask, 4);
+		char *masked = malloc(length);
+		for (long i = 0; i < length; i++)
+			masked[i] = text[i] ^ mask[i % 4];
+		indigo_write(handle, (char *)header, header_length + 4);
+		indigo_write(handle, masked, length);
+		free(masked);
+	} else {
+		indigo_write(handle, text, length);
+	}
+	pthread_mutex_unlock(&client->write_mutex);
+}
+
+static void send_number(load_client *client, const char *device, const char *property, const char *item, double value) {
+	char text[1024];
+	if (protocol == INDIGO_BENCHMARK_XML)
+		snprintf(text, sizeof(text), "<newNumberVector device='%s' name='%s'><oneNumber name='%s'>%.6g</oneNumber></newNumberVector>\n", device, property, item, value);
+	else
+		snprintf(text, sizeof(text), "{ \"newNumberVector\": { \"device\": \"%s\", \"name\": \"%s\", \"items\": [ { \"name\": \"%s\", \"value\": %.6g } ] } }\n", device, property, item, value);
+	send_text(client, client->socket, text);
+}
+
+static void send_connect(load_client *client, const char *device) {
+	char text[1024];
+	if (protocol == INDIGO_BENCHMARK_XML)
+		snprintf(text, sizeof(text), "<newSwitchVector device='%s' name='%s'><oneSwitch name='%s'>On</oneSwitch></newSwitchVector>\n", device, CONNECTION_PROPERTY_NAME, CONNECTION_CONNECTED_ITEM_NAME);
+	else
+		snprintf(text, sizeof(text), "{ \"newSwitchVector\": { \"device\": \"%s\", \"name\": \"%s\", \"items\": [ { \"name\": \"%s\", \"value\": true } ] } }\n", device, CONNECTION_PROPERTY_NAME, CONNECTION_CONNECTED_ITEM_NAME);
+	send_text(client, client->socket, text);
+}
+
+static void start_exposure(load_client *client) {
+	atomic_fetch_add(&exposures, 1);
+	send_number(client, exposure_device, CCD_EXPOSURE_PROPERTY_NAME, CCD_EXPOSURE_ITEM_NAME, exposure_time);
+}
+
+/* request is tagged by value, client index and sequence number are encoded into item range */
+
+static double encode_value(int index, long sequence) {
+	long tag = index * SEQUENCE_WINDOW + sequence % SEQUENCE_WINDOW;
+	return target_min + (target_max - target_min) * tag / (client_count * SEQUENCE_WINDOW);
+}
+
+static long decode_value(double value) {
+	return lround((value - target_min) * client_count * SEQUENCE_WINDOW / (target_max - target_min));
+}
+
+// -------------------------------------------------------------------------------- responses
+
+static bool get_value(const char *start, const char *end, const char *key, char *value, int size) {
+	int key_length = (int)strlen(key);
+	/* quoted values are terminated by quote only, numbers by any delimiter */
+	const char *terminators = key[key_length - 1] == '\'' ? "'" : key[key_length - 1] == '"' ? "\"" : ",} ]<";
+	for (const char *pointer = start; pointer + key_length < end; pointer++) {
+		pointer = memchr(pointer, *key, end - pointer - key_length);
+		if (pointer == NULL)
+			break;
+		if (!strncmp(pointer, key, key_length)) {
+			pointer += key_length;
+			int i = 0;
+			while (pointer < end && i < size - 1 && !strchr(terminators, *pointer))
+				value[i++] = *pointer++;
+			value[i] = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+static long http_get(load_client *client, const char *path) {
+	char buffer[64 * 1024];
+	if (client->http_socket < 0)
+		client->http_socket = indigo_open_tcp(hostname, port);
+	if (client->http_socket < 0)
+		return 0;
+	snprintf(buffer, sizeof(buffer), "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n", path, hostname);
+	send_text(client, client->http_socket, buffer);
+	long length = 0, content_length = -1;
+	char *body = NULL;
+	while (body == NULL) {
+		long count = read(client->http_socket, buffer + length, sizeof(buffer) - length - 1);
+		if (count <= 0)
+			break;
+		length += count;
+		buffer[length] = 0;
+		body = strstr(buffer, "\r\n\r\n");
+	}
+	char *header = body ? strstr(buffer, "Content-Length: ") : NULL;
+	if (header == NULL || header > body) {
+		close(client->http_socket);
+		client->http_socket = -1;
+		return 0;
+	}
+	content_length = atol(header + 16);
+	long remains = content_length - (length - (body + 4 - buffer));
+	while (remains > 0) {
+		long count = read(client->http_socket, buffer, remains < (long)sizeof(buffer) ? remains : (long)sizeof(buffer));
+		if (count <= 0)
+			return 0;
+		remains -= count;
+	}
+	return content_length;
+}
+
+static void vector_begin(load_client *client, const char *tag, const char *start, const char *end, bool json) {
+	char device[INDIGO_NAME_SIZE] = "", name[INDIGO_NAME_SIZE] = "", state[INDIGO_NAME_SIZE] = "";
+	get_value(start, end, json ? "\"device\": \"" : " device='", device, sizeof(device));
+	get_value(start, end, json ? "\"name\": \"" : " name='", name, sizeof(name));
+	get_value(start, end, json ? "\"state\": \"" : " state='", state, sizeof(state));
+	bool set = !strncmp(tag, "set", 3);
+	client->busy = !strcmp(state, "Busy");
+	client->in_target = !strcmp(device, target_device) && !strcmp(name, target_property);
+	client->in_exposure = set && *exposure_device && !strcmp(device, exposure_device) && !strcmp(name, CCD_EXPOSURE_PROPERTY_NAME);
+	client->in_blob = set && !strcmp(tag, "setBLOBVector");
+	if (client->in_target) {
+		if (set)
+			atomic_fetch_add(&client->updates, 1);
+		else
+			client->defined = true;
+	}
+	if (client->in_exposure && client->index == 0 && !client->busy && atomic_load(&client->running))
+		start_exposure(client);
+}
+
+static void target_item_value(load_client *client, bool definition, double value, double min, double max) {
+	if (definition) {
+		if (isnan(target_min) && !isnan(min) && !isnan(max) && max > min) {
+			target_min = min;
+			target_max = max;
+		}
+		return;
+	}
+	if (client->busy || isnan(target_min))
+		return;
+	long tag = decode_value(value);
+	if (tag / SEQUENCE_WINDOW != client->index)
+		return;
+	int slot = tag % SEQUENCE_WINDOW;
+	/* sent_time is written by sender thread, slot is claimed by swapping in 0 */
+	double sent = atomic_exchange(&client->sent_time[slot], 0);
+	if (sent == 0)
+		return;
+	atomic_fetch_add(&client->responses, 1);
+	if (client->latency_count == client->latency_size) {
+		client->latency_size = client->latency_size ? 2 * client->latency_size : 1024;
+		client->latencies = realloc(client->latencies, client->latency_size * sizeof(double));
+	}
+	client->latencies[client->latency_count++] = indigo_benchmark_now() - sent;
+}
+
+static void blob_item(load_client *client, const char *path, long size) {
+	atomic_fetch_add(&client->blobs, 1);
+	if (path && *path && blobs != BLOB_NEVER)
+		size = http_get(client, path);
+	atomic_fetch_add(&client->blob_bytes, size);
+}
+
+/* returns number of processed bytes, unprocessed incomplete tag is kept for next read */
+
+static long scan_xml(load_client *client, const char *buffer, long length) {
+	const char *end = buffer + length, *pointer = buffer;
+	while (pointer < end) {
+		const char *begin = memchr(pointer, '<', end - pointer);
+		if (begin == NULL)
+			return length;
+		const char *close = memchr(begin, '>', end - begin);
+		if (close == NULL)
+			return end - begin > MAX_TAG_SIZE ? length : begin - buffer;
+		pointer = close + 1;
+		const char *tag = begin + 1;
+		if (!strncmp(tag, "setNumberVector ", 16) || !strncmp(tag, "defNumberVector ", 16) || !strncmp(tag, "setBLOBVector ", 14)) {
+			char name[32];
+			sscanf(tag, "%31s", name);
+			vector_begin(client, name, tag, close, false);
+		} else if (client->in_target && (!strncmp(tag, "oneNumber ", 10) || !strncmp(tag, "defNumber ", 10))) {
+			char name[INDIGO_NAME_SIZE], value[64];
+			if (!get_value(tag, close, " name='", name, sizeof(name)) || strcmp(name, target_item))
+				continue;
+			const char *text_end = memchr(close, '<', end - close);
+			if (text_end == NULL)
+				return begin - buffer;
+			double min = NAN, max = NAN;
+			if (get_value(tag, close, " min='", value, sizeof(value)))
+				min = atof(value);
+			if (get_value(tag, close, " max='", value, sizeof(value)))
+				max = atof(value);
+			target_item_value(client, *tag == 'd', atof(close + 1), min, max);
+		} else if (client->in_blob && !strncmp(tag, "oneBLOB ", 8)) {
+			char path[INDIGO_VALUE_SIZE] = "", size[32] = "";
+			get_value(tag, close, " path='", path, sizeof(path));
+			get_value(tag, close, " size='", size, sizeof(size));
+			blob_item(client, path, atol(size));
+		} else if (*tag == '/' && close - tag > 6 && !strncmp(close - 6, "Vector", 6)) {
+			client->in_target = client->in_exposure = client->in_blob = false;
+		}
+	}
+	return length;
+}
+
+static long scan_json(load_client *client, const char *buffer, long length) {
+	const char *end = buffer + length, *pointer = buffer;
+	while (pointer < end) {
+		const char *begin = memchr(pointer, '{', end - pointer);
+		if (begin == NULL)
+			return length;
+		if (end - begin < 20)
+			return begin - buffer;
+		if (strncmp(begin, "{ \"setNumberVector\"", 19) && strncmp(begin, "{ \"defNumberVector\"", 19) && strncmp(begin, "{ \"setBLOBVector\"", 17)) {
+			pointer = begin + 1;
+			continue;
+		}
+		const char *close = NULL;
+		for (const char *tmp = begin; tmp + 6 <= end && close == NULL; tmp++) {
+			tmp = memchr(tmp, ']', end - tmp);
+			if (tmp == NULL)
+				break;
+			if (!strncmp(tmp, "] } }", 5))
+				close = tmp + 5;
+		}
+		if (close == NULL)
+			return end - begin > MAX_TAG_SIZE ? length : begin - buffer;
+		pointer = close;
+		char tag[32];
+		sscanf(begin + 3, "%31[^\"]", tag);
+		const char *items = strstr(begin, "\"items\"");
+		if (items == NULL || items > close)
+			continue;
+		vector_begin(client, tag, begin, items, true);
+		char key[INDIGO_NAME_SIZE + 16];
+		if (client->in_target) {
+			snprintf(key, sizeof(key), "\"name\": \"%s\"", target_item);
+			const char *item = strstr(items, key);
+			if (item != NULL && item < close) {
+				char value[64];
+				double min = NAN, max = NAN;
+				if (get_value(item, close, "\"min\": ", value, sizeof(value)))
+					min = atof(value);
+				if (get_value(item, close, "\"max\": ", value, sizeof(value)))
+					max = atof(value);
+				if (get_value(item, close, "\"value\": ", value, sizeof(value)))
+					target_item_value(client, *tag == 'd', atof(value), min, max);
+			}
+		} else if (client->in_blob) {
+			char path[INDIGO_VALUE_SIZE];
+			for (const char *item = items; item < close && get_value(item, close, "\"value\": \"", path, sizeof(path)); item = strstr(item, "\"value\": \"") + 10)
+				blob_item(client, path, 0);
+		}
+		client->in_target = client->in_exposure = client->in_blob = false;
+	}
+	return length;
+}
+
+static void *reader(load_client *client) {
+	char *buffer = malloc(BUFFER_SIZE + 1);
+	long kept = 0;
+	while (true) {
+		long count = read(client->socket, buffer + kept, BUFFER_SIZE - kept);
+		if (count <= 0)
+			break;
+		atomic_fetch_add(&client->bytes, count);
+		long length = kept + count;
+		buffer[length] = 0;
+		long processed = protocol == INDIGO_BENCHMARK_XML ? scan_xml(client, buffer, length) : scan_json(client, buffer, length);
+		kept = length - processed;
+		if (kept > 0)
+			memmove(buffer, buffer + processed, kept);
+	}
+	free(buffer);
+	return NULL;
+}
+
+static void *sender(load_client *client) {
+	double interval = 1 / rate;
+	/* clients are staggered to spread requests over interval */
+	double next = indigo_benchmark_now() + interval * client->index / client_count;
+	double end = indigo_benchmark_now() + duration;
+	long sequence = 0;
+	while (atomic_load(&client->running)) {
+		double delay = next - indigo_benchmark_now();
+		if (delay > 0)
+			usleep((useconds_t)(delay * 1e6));
+		if (indigo_benchmark_now() > end)
+			break;
+		int slot = sequence % SEQUENCE_WINDOW;
+		atomic_store(&client->sent_time[slot], indigo_benchmark_now());
+		send_number(client, target_device, target_property, target_item, encode_value(client->index, sequence));
+		client->requests++;
+		sequence++;
+		next += interval;
+	}
+	return NULL;
+}
+
+static bool open_client(load_client *client) {
+	client->socket = indigo_open_tcp(hostname, port);
+	client->http_socket = -1;
+	if (client->socket < 0) {
+		fprintf(stderr, "Can't connect to %s:%d\n", hostname, port);
+		return false;
+	}
+	pthread_mutex_init(&client->write_mutex, NULL);
+	if (protocol == INDIGO_BENCHMARK_WEBSOCKET) {
+		char line[1024];
+		indigo_printf(client->socket, "GET / HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", hostname);
+		while (indigo_read_line(client->socket, line, sizeof(line) - 1) > 0)
+			;
+	}
+	atomic_store(&client->running, true);
+	pthread_create(&client->reader_thread, NULL, (void * (*)(void*))reader, client);
+	if (protocol == INDIGO_BENCHMARK_XML) {
+		send_text(client, client->socket, "<getProperties version='2.0'/>\n");
+		if (blobs != BLOB_NEVER && *exposure_device) {
+			char text[256];
+			snprintf(text, sizeof(text), "<enableBLOB device='%s'>%s</enableBLOB>\n", exposure_device, blob_text[blobs]);
+			send_text(client, client->socket, text);
+		}
+	} else {
+		send_text(client, client->socket, "{ \"getProperties\": { \"version\": 512 } }\n");
+	}
+	return true;
+}
+
+// -------------------------------------------------------------------------------- main
+
+static bool parse_target(const char *text) {
+	char device[INDIGO_NAME_SIZE], property[INDIGO_NAME_SIZE], item[INDIGO_NAME_SIZE];
+	if (sscanf(text, "%[^.].%[^.].%s", device, property, item) != 3)
+		return false;
+	strcpy(target_device, device);
+	strcpy(target_property, property);
+	strcpy(target_item, item);
+	return true;
+}
+
+static void print_help(const char *name) {
+	printf("usage: %s [options]\n", name);
+	printf("options:\n"
+	       "       -h  | --help\n"
+	       "       -n  | --clients count                 (default: 8)\n"
+	       "       -P  | --protocol xml|json|websocket    (default: xml)\n"
+	       "       -b  | --blobs never|also|url          (default: never, always url for json and websocket)\n"
+	       "       -c  | --change device.property.item   (default: Mount Simulator.MOUNT_GUIDE_RATE.RA)\n"
+	       "       -f  | --rate requests_per_second      (per client, default: 10)\n"
+	       "       -x  | --expose device                 (continuous exposures, default: none)\n"
+	       "       -e  | --exposure-time seconds         (default: 0.1)\n"
+	       "       -t  | --time seconds                  (default: 10)\n"
+	       "       -r  | --remote-server host[:port]     (default: localhost)\n"
+	       "       -p  | --port port                     (default: 7624)\n"
+	);
+}
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	/* server can close overloaded client connection while request is sent */
+	signal(SIGPIPE, SIG_IGN);
+	for (int i = 1; i < argc; i++) {
+		if ((!strcmp(argv[i], "-n") || !strcmp(argv[i], "--clients")) && i < argc - 1) {
+			client_count = atoi(argv[++i]);
+		} else if ((!strcmp(argv[i], "-P") || !strcmp(argv[i], "--protocol")) && i < argc - 1) {
+			i++;
+			if (!strcmp(argv[i], "json"))
+				protocol = INDIGO_BENCHMARK_JSON;
+			else if (!strcmp(argv[i], "websocket"))
+				protocol = INDIGO_BENCHMARK_WEBSOCKET;
+			else
+				protocol = INDIGO_BENCHMARK_XML;
+		} else if ((!strcmp(argv[i], "-b") || !strcmp(argv[i], "--blobs")) && i < argc - 1) {
+			i++;
+			if (!strcmp(argv[i], "also"))
+				blobs = BLOB_ALSO;
+			else if (!strcmp(argv[i], "url"))
+				blobs = BLOB_URL;
+			else
+				blobs = BLOB_NEVER;
+		} else if ((!strcmp(argv[i], "-c") || !strcmp(argv[i], "--change")) && i < argc - 1) {
+			if (!parse_target(argv[++i])) {
+				fprintf(stderr, "Invalid property %s\n", argv[i]);
+				return 1;
+			}
+		} else if ((!strcmp(argv[i], "-f") || !strcmp(argv[i], "--rate")) && i < argc - 1) {
+			rate = atof(argv[++i]);
+		} else if ((!strcmp(argv[i], "-x") || !strcmp(argv[i], "--expose")) && i < argc - 1) {
+			strncpy(exposure_device, argv[++i], INDIGO_NAME_SIZE - 1);
+		} else if ((!strcmp(argv[i], "-e") || !strcmp(argv[i], "--exposure-time")) && i < argc - 1) {
+			exposure_time = atof(argv[++i]);
+		} else if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--time")) && i < argc - 1) {
+			duration = atof(argv[++i]);
+		} else if ((!strcmp(argv[i], "-r") || !strcmp(argv[i], "--remote-server")) && i < argc - 1) {
+			char port_str[100];
+			if (sscanf(argv[++i], "%[^:]:%s", hostname, port_str) > 1)
+				port = atoi(port_str);
+		} else if ((!strcmp(argv[i], "-p") || !strcmp(argv[i], "--port")) && i < argc - 1) {
+			port = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			print_help(argv[0]);
+			return 0;
+		}
+	}
+	if (client_count <= 0 || rate <= 0 || duration <= 0) {
+		fprintf(stderr, "Invalid client count, rate or time\n");
+		return 1;
+	}
+	clients = calloc(client_count, sizeof(load_client));
+	for (int i = 0; i < client_count; i++) {
+		clients[i].index = i;
+		if (!open_client(clients + i))
+			return 1;
+	}
+	/* first client connects target and exposure devices, everybody waits for target property definition */
+	send_connect(clients, target_device);
+	if (*exposure_device)
+		send_connect(clients, exposure_device);
+	double timeout = indigo_benchmark_now() + 10;
+	for (int i = 0; i < client_count; i++) {
+		while (!clients[i].defined || isnan(target_min)) {
+			if (indigo_benchmark_now() > timeout) {
+				fprintf(stderr, "%s.%s.%s is not defined for client %d\n", target_device, target_property, target_item, i);
+				return 1;
+			}
+			usleep(10000);
+		}
+	}
+	printf("%d %s clients, BLOBs %s, %s.%s.%s changed %g times per second for %gs\n", client_count, indigo_benchmark_protocol_name[protocol], blob_text[blobs], target_device, target_property, target_item, rate, duration);
+	double start = indigo_benchmark_now();
+	for (int i = 0; i < client_count; i++)
+		pthread_create(&clients[i].sender_thread, NULL, (void * (*)(void*))sender, clients + i);
+	if (*exposure_device)
+		start_exposure(clients);
+	for (int i = 0; i < client_count; i++)
+		pthread_join(clients[i].sender_thread, NULL);
+	double elapsed = indigo_benchmark_now() - start;
+	atomic_store(&clients->running, false);
+	/* grace period for outstanding responses */
+	sleep(2);
+	long requests = 0, responses = 0, updates = 0, latency_count = 0;
+	for (int i = 0; i < client_count; i++) {
+		load_client *client = clients + i;
+		shutdown(client->socket, SHUT_RDWR);
+		pthread_join(client->reader_thread, NULL);
+		close(client->socket);
+		if (client->http_socket >= 0)
+			close(client->http_socket);
+		requests += client->requests;
+		responses += client->responses;
+		updates += client->updates;
+		latency_count += client->latency_count;
+	}
+	printf("client  requests responses  dropped   updates   blobs     MB/s   p50 ms   p99 ms\n");
+	double *latencies = malloc((latency_count ? latency_count : 1) * sizeof(double));
+	latency_count = 0;
+	for (int i = 0; i < client_count; i++) {
+		load_client *client = clients + i;
+		double p50 = 0, p99 = 0;
+		if (client->latency_count > 0) {
+			qsort(client->latencies, client->latency_count, sizeof(double), indigo_benchmark_compare_double);
+			p50 = client->latencies[client->latency_count / 2] * 1e3;
+			p99 = client->latencies[client->latency_count * 99 / 100] * 1e3;
+			memcpy(latencies + latency_count, client->latencies, client->latency_count * sizeof(double));
+			latency_count += client->latency_count;
+		}
+		printf("%6d %9ld %9ld %8ld %9ld %7ld %8.2f %8.2f %8.2f\n", i, client->requests, (long)client->responses, client->requests - client->responses, (long)client->updates, (long)client->blobs, (client->bytes + (blobs == BLOB_URL || protocol != INDIGO_BENCHMARK_XML ? client->blob_bytes : 0)) / elapsed / 1e6, p50, p99);
+		free(client->latencies);
+	}
+	printf("total  %9ld %9ld %8ld %9ld\n", requests, responses, requests - responses, updates);
+	/* every client should see updates caused by all clients */
+	printf("requests:  %.1f/s, updates delivered %.1f/s (%.1f%% of broadcast)\n", requests / elapsed, updates / elapsed, requests ? 100.0 * updates / ((double)requests * client_count) : 0);
+	if (latency_count > 0) {
+		qsort(latencies, latency_count, sizeof(double), indigo_benchmark_compare_double);
+		printf("latency:   p50 %.2fms, p90 %.2fms, p99 %.2fms, max %.2fms\n", latencies[latency_count / 2] * 1e3, latencies[latency_count * 9 / 10] * 1e3, latencies[latency_count * 99 / 100] * 1e3, latencies[latency_count - 1] * 1e3);
+	}
+	if (*exposure_device)
+		printf("exposures: %ld\n", (long)exposures);
+	free(latencies);
+	free(clients);
+	return 0;
+}
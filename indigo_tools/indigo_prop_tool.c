@@ -28,6 +28,7 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -35,9 +36,13 @@
 #include "indigo_bus.h"
 #include "indigo_client.h"
 #include "indigo_xml.h"
+#include "indigo_property_cache.h"
 
 #define INDIGO_DEFAULT_PORT 7624
 #define REMINDER_MAX_SIZE 2048
+#define BATCH_LINE_SIZE (REMINDER_MAX_SIZE + 256)
+#define BATCH_MAX_PENDING 256
+#define BATCH_TIME_TO_WAIT 10
 
 static bool change_requested = false;
 static bool print_verbose = false;
@@ -57,8 +62,21 @@ typedef struct {
 } property_list_request;
 
 
+typedef struct {
+	char device_name[INDIGO_NAME_SIZE];
+	char property_name[INDIGO_NAME_SIZE];
+	unsigned long sequence;
+	double deadline;
+} pending_request;
+
+
 static property_change_request change_request;
 static property_list_request list_request;
+static pending_request pending[BATCH_MAX_PENDING];
+static int pending_count = 0;
+static pending_request issued[BATCH_MAX_PENDING];
+static int issued_count = 0;
+static int batch_failures = 0;
 
 
 void trim_ending_spaces(char * str) {
@@ -306,6 +324,50 @@ static void print_property_string_filtered(indigo_property *property, const char
 }
 
 
+static void send_change_request(indigo_client *client, indigo_property_type type, property_change_request *request) {
+	const char *items[INDIGO_MAX_ITEMS];
+	const char *txt_values[INDIGO_MAX_ITEMS];
+	double dbl_values[INDIGO_MAX_ITEMS];
+	bool bool_values[INDIGO_MAX_ITEMS];
+	int i;
+
+	for (i = 0; i < request->item_count; i++) {
+		items[i] = request->item_name[i];
+		request->value_string[i][INDIGO_VALUE_SIZE-1] = 0;
+	}
+
+	switch (type) {
+	case INDIGO_TEXT_VECTOR:
+		for (i = 0; i < request->item_count; i++) {
+			txt_values[i] = request->value_string[i];
+		}
+		indigo_change_text_property(client, request->device_name, request->property_name, request->item_count, items, txt_values);
+		break;
+	case INDIGO_NUMBER_VECTOR:
+		for (i = 0; i < request->item_count; i++) {
+			dbl_values[i] = strtod(request->value_string[i], NULL);
+		}
+		indigo_change_number_property(client, request->device_name, request->property_name, request->item_count, items, dbl_values);
+		break;
+	case INDIGO_SWITCH_VECTOR:
+		for (i = 0; i < request->item_count; i++) {
+			if (!strcmp("ON", str_upper_case(request->value_string[i])))
+				bool_values[i] = true;
+			else if (!strcmp("OFF", str_upper_case(request->value_string[i])))
+				bool_values[i] = false;
+			else {
+				/* should indicate error */
+				bool_values[i] = false;
+			}
+		}
+		indigo_change_switch_property(client, request->device_name, request->property_name, request->item_count, items, bool_values);
+		break;
+	default:
+		break;
+	}
+}
+
+
 static indigo_result client_attach(indigo_client *client) {
 	indigo_enumerate_properties(client, &INDIGO_ALL_PROPERTIES);
 	return INDIGO_OK;
@@ -314,7 +376,6 @@ static indigo_result client_attach(indigo_client *client) {
 
 static indigo_result client_define_property(struct indigo_client *client, struct indigo_device *device, indigo_property *property, const char *message) {
 	indigo_item *item;
-	int i;
 	static bool called = false;
 
 	if (!called && print_verbose) {
@@ -324,47 +385,11 @@ static indigo_result client_define_property(struct indigo_client *client, struct
 
 	if (change_requested) {
 		if (!strcmp(property->device, change_request.device_name) && !strcmp(property->name, change_request.property_name)) {
-			static char *items[INDIGO_MAX_ITEMS];
-			static char *txt_values[INDIGO_MAX_ITEMS];
-			static bool bool_values[INDIGO_MAX_ITEMS];
-			double dbl_values[INDIGO_MAX_ITEMS];
-
-			for (i = 0; i< change_request.item_count; i++) {
-				items[i] = (char *)malloc(INDIGO_NAME_SIZE);
-				strncpy(items[i], change_request.item_name[i], INDIGO_NAME_SIZE);
-			}
-
 			switch (property->type) {
 			case INDIGO_TEXT_VECTOR:
-				for (i = 0; i< change_request.item_count; i++) {
-					txt_values[i] = (char *)malloc(INDIGO_VALUE_SIZE);
-					strncpy(txt_values[i], change_request.value_string[i], INDIGO_VALUE_SIZE);
-					txt_values[i][INDIGO_VALUE_SIZE-1] = 0;
-				}
-
-				indigo_change_text_property(client, property->device, property->name, change_request.item_count, (const char **)items, (const char **)txt_values);
-
-				for (i = 0; i< change_request.item_count; i++) {
-					free(txt_values[i]);
-				}
-				break;
 			case INDIGO_NUMBER_VECTOR:
-				for (i = 0; i< change_request.item_count; i++) {
-					dbl_values[i] = strtod(change_request.value_string[i], NULL);
-				}
-				indigo_change_number_property(client, property->device, property->name, change_request.item_count, (const char **)items, (const double *)dbl_values);
-				break;
 			case INDIGO_SWITCH_VECTOR:
-				for (i = 0; i< change_request.item_count; i++) {
-					if (!strcmp("ON", str_upper_case(change_request.value_string[i])))
-						bool_values[i] = true;
-					else if (!strcmp("OFF", str_upper_case(change_request.value_string[i])))
-						bool_values[i] = false;
-					else {
-						/* should indicate error */
-					}
-				}
-				indigo_change_switch_property(client, property->device, property->name, change_request.item_count, (const char **)items, (const bool *)bool_values);
+				send_change_request(client, property->type, &change_request);
 				break;
 			case INDIGO_LIGHT_VECTOR:
 				printf("%s.%s.%s = %d\n", property->device, property->name, item->name, item->light.value);
@@ -416,10 +441,206 @@ static indigo_client client = {
 };
 
 
+/* batch mode - commands are read from file over one connection, consecutive set commands are pipelined
+   and property cache is used to wait until each property is updated to Ok or Alert state */
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void report_failure(const char *device, const char *name, const char *reason) {
+	fprintf(stderr, "%s.%s: %s\n", device, name, reason);
+	batch_failures++;
+}
+
+
+static void print_cached_property(const char *device, const char *name) {
+	indigo_property *property = indigo_get_cached_property(device, name);
+	if (property != NULL) {
+		print_property_string(property, NULL);
+		indigo_release_property(property);
+	}
+}
+
+
+static void finish_pending_requests(void) {
+	for (int i = 0; i < pending_count; i++) {
+		pending_request *request = &pending[i];
+		indigo_property_state state = INDIGO_IDLE_STATE;
+		double timeout = request->deadline - now();
+		if (!indigo_wait_for_cached_property_done(request->device_name, request->property_name, request->sequence, timeout > 0 ? timeout : 0, &state)) {
+			report_failure(request->device_name, request->property_name, "timeout");
+		} else if (state == INDIGO_ALERT_STATE) {
+			report_failure(request->device_name, request->property_name, "alert");
+		}
+		print_cached_property(request->device_name, request->property_name);
+	}
+	pending_count = 0;
+}
+
+
+/* sequence of property cache when the last set of property was issued, wait command waits for newer update */
+
+static void remember_issued_request(pending_request *request) {
+	int index = 0;
+	while (index < issued_count && (strcmp(issued[index].device_name, request->device_name) || strcmp(issued[index].property_name, request->property_name)))
+		index++;
+	if (index == BATCH_MAX_PENDING) {
+		memmove(issued, issued + 1, (BATCH_MAX_PENDING - 1) * sizeof(pending_request));
+		index--;
+	} else if (index == issued_count) {
+		issued_count++;
+	}
+	issued[index] = *request;
+}
+
+
+static unsigned long issued_sequence(const char *device, const char *name) {
+	for (int i = 0; i < issued_count; i++) {
+		if (!strcmp(issued[i].device_name, device) && !strcmp(issued[i].property_name, name))
+			return issued[i].sequence;
+	}
+	return 0;
+}
+
+
+static void batch_set(char *text, double timeout) {
+	if (parse_set_property_string(text, &change_request) < 0) {
+		fprintf(stderr, "Invalid property string format: %s\n", text);
+		batch_failures++;
+		return;
+	}
+	/* the same property can't be changed again until previous request is finished */
+	for (int i = 0; i < pending_count; i++) {
+		if (!strcmp(pending[i].device_name, change_request.device_name) && !strcmp(pending[i].property_name, change_request.property_name)) {
+			finish_pending_requests();
+			break;
+		}
+	}
+	if (pending_count == BATCH_MAX_PENDING) {
+		finish_pending_requests();
+	}
+	if (!indigo_wait_for_cached_property(change_request.device_name, change_request.property_name, timeout)) {
+		report_failure(change_request.device_name, change_request.property_name, "not defined");
+		return;
+	}
+	indigo_property *property = indigo_get_cached_property(change_request.device_name, change_request.property_name);
+	if (property == NULL) {
+		report_failure(change_request.device_name, change_request.property_name, "not defined");
+		return;
+	}
+	indigo_property_type type = property->type;
+	indigo_property_perm perm = property->perm;
+	indigo_release_property(property);
+	if (perm == INDIGO_RO_PERM || type == INDIGO_LIGHT_VECTOR || type == INDIGO_BLOB_VECTOR) {
+		report_failure(change_request.device_name, change_request.property_name, "read only");
+		return;
+	}
+	pending_request *request = &pending[pending_count++];
+	strncpy(request->device_name, change_request.device_name, INDIGO_NAME_SIZE);
+	strncpy(request->property_name, change_request.property_name, INDIGO_NAME_SIZE);
+	request->sequence = indigo_get_cached_property_sequence(request->device_name, request->property_name);
+	request->deadline = now() + timeout;
+	remember_issued_request(request);
+	send_change_request(&indigo_property_cache_client, type, &change_request);
+}
+
+
+static void batch_get(char *text, double timeout) {
+	property_list_request request;
+	finish_pending_requests();
+	if (parse_list_property_string(text, &request) != 2) {
+		fprintf(stderr, "Invalid property string format: %s\n", text);
+		batch_failures++;
+		return;
+	}
+	if (!indigo_wait_for_cached_property(request.device_name, request.property_name, timeout)) {
+		report_failure(request.device_name, request.property_name, "not defined");
+		return;
+	}
+	print_cached_property(request.device_name, request.property_name);
+}
+
+
+static void batch_wait(char *text, double timeout) {
+	static const char *state_names[] = { "IDLE", "OK", "BUSY", "ALERT" };
+	static const indigo_property_state states[] = { INDIGO_IDLE_STATE, INDIGO_OK_STATE, INDIGO_BUSY_STATE, INDIGO_ALERT_STATE };
+	property_list_request request;
+	int state = -1;
+	finish_pending_requests();
+	/* optional state is the last word, device names can contain spaces */
+	char *last = strrchr(text, ' ');
+	if (last != NULL) {
+		for (int i = 0; i < 4; i++) {
+			if (!strcasecmp(last + 1, state_names[i])) {
+				state = i;
+				*last = '\0';
+				trim_ending_spaces(text);
+				break;
+			}
+		}
+	}
+	if (parse_list_property_string(text, &request) != 2) {
+		fprintf(stderr, "Invalid property string format: %s\n", text);
+		batch_failures++;
+		return;
+	}
+	indigo_property_state final_state = INDIGO_IDLE_STATE;
+	bool done;
+	if (state >= 0) {
+		done = indigo_wait_for_cached_property_state(request.device_name, request.property_name, states[state], timeout);
+	} else {
+		done = indigo_wait_for_cached_property_done(request.device_name, request.property_name, issued_sequence(request.device_name, request.property_name), timeout, &final_state);
+	}
+	if (!done) {
+		report_failure(request.device_name, request.property_name, "timeout");
+	} else if (state < 0 && final_state == INDIGO_ALERT_STATE) {
+		report_failure(request.device_name, request.property_name, "alert");
+	}
+}
+
+
+static int run_batch(FILE *input, double timeout) {
+	char line[BATCH_LINE_SIZE];
+	while (fgets(line, sizeof(line), input) != NULL) {
+		trim_spaces(line);
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+		if (!strncmp(line, "set ", 4)) {
+			batch_set(line + 4, timeout);
+		} else if (!strncmp(line, "get ", 4)) {
+			batch_get(line + 4, timeout);
+		} else if (!strncmp(line, "wait ", 5)) {
+			batch_wait(line + 5, timeout);
+		} else if (!strncmp(line, "timeout ", 8)) {
+			timeout = atof(line + 8);
+		} else if (strchr(line, '=') != NULL) {
+			batch_set(line, timeout);
+		} else {
+			fprintf(stderr, "Unknown command: %s\n", line);
+			batch_failures++;
+		}
+	}
+	finish_pending_requests();
+	return batch_failures;
+}
+
+
 static void print_help(const char *name) {
 	printf("usage: %s [options] device.property.item=value[;item=value;..]\n", name);
 	printf("       %s set [options] device.property.item=value[;item=value;..]\n", name);
 	printf("       %s list [options] [device[.property]]\n", name);
+	printf("       %s batch [options] [file]                (commands are read from stdin if file is not specified)\n", name);
+	printf("batch commands:\n"
+	       "       [set] device.property.item=value[;item=value;..]  (consecutive sets are pipelined and wait for Ok or Alert state)\n"
+	       "       get device.property\n"
+	       "       wait device.property [ok|alert|busy|idle]        (default: until property is updated after last set and not busy)\n"
+	       "       timeout seconds                                   (deadline for following commands)\n"
+	);
 	printf("options:\n"
 	       "       -h  | --help\n"
 	       "       -b  | --save-blobs\n"
@@ -430,7 +651,7 @@ static void print_help(const char *name) {
 	       "       -vvv| --enable-trace\n"
 	       "       -r  | --remote-server host[:port]   (default: localhost)\n"
 	       "       -p  | --port port                   (default: 7624)\n"
-	       "       -t  | --time-to-wait seconds        (default: 2)\n"
+	       "       -t  | --time-to-wait seconds        (default: 2, in batch mode deadline for each command, default: 10)\n"
 	);
 }
 
@@ -445,10 +666,11 @@ int main(int argc, const char * argv[]) {
 		return 0;
 	}
 
-	int time_to_wait = 2;
+	int time_to_wait = 0;
 	int port = INDIGO_DEFAULT_PORT;
 	char hostname[255] = "localhost";
 	bool action_set = true;
+	bool action_batch = false;
 	char const *prop_string = NULL;
 	int arg_base = 1;
 
@@ -458,6 +680,10 @@ int main(int argc, const char * argv[]) {
 	} else if (!strcmp(argv[1], "list")) {
 		action_set = false;
 		arg_base = 2;
+	} else if (!strcmp(argv[1], "batch")) {
+		action_set = false;
+		action_batch = true;
+		arg_base = 2;
 	}
 
 	for (int i = arg_base; i < argc; i++) {
@@ -490,6 +716,10 @@ int main(int argc, const char * argv[]) {
 			if (argc > i+1) {
 				i++;
 				time_to_wait = atoi(argv[i]);
+				if (time_to_wait <= 0) {
+					fprintf(stderr, "Invalid time to wait specified\n");
+					return 1;
+				}
 			} else {
 				fprintf(stderr, "No time to wait specified\n");
 				return 1;
@@ -510,8 +740,30 @@ int main(int argc, const char * argv[]) {
 	}
 
 	if (time_to_wait <= 0) {
-		fprintf(stderr, "Invalid time to wait specified\n");
-		return 1;
+		time_to_wait = action_batch ? BATCH_TIME_TO_WAIT : 2;
+	}
+
+	if (action_batch) {
+		FILE *input = stdin;
+		if (prop_string != NULL && strcmp(prop_string, "-")) {
+			input = fopen(prop_string, "r");
+			if (input == NULL) {
+				fprintf(stderr, "Can't open %s: %s\n", prop_string, strerror(errno));
+				return 1;
+			}
+		}
+		indigo_start();
+		indigo_start_property_cache();
+		indigo_server_entry *server;
+		indigo_connect_server(hostname, hostname, port, &server);
+		int failures = run_batch(input, time_to_wait);
+		if (input != stdin) {
+			fclose(input);
+		}
+		indigo_disconnect_server(server);
+		indigo_stop_property_cache();
+		indigo_stop();
+		return failures ? 1 : 0;
 	}
 
 	if (action_set) {
@@ -0,0 +1,272 @@
+// Copyright (c) 2026 CloudMakers, s. r. o.
+// All rights reserved.
+//
+// You can use this software under the terms of 'INDIGO Astronomy
+// open-source license' (see LICENSE.md).
+//
+// THIS SOFTWARE IS PROVIDED BY THE AUTHORS 'AS IS' AND ANY EXPRESS
+// OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Replay of session recorded by indigo_server -R|--record against running server.
+// Client connections are reopened and recorded client requests are sent at recorded time (scaled by speed)
+// or as fast as possible, server output is drained and compared in size with recorded one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+
+#include "indigo_bus.h"
+#include "indigo_io.h"
+#include "indigo_recorder.h"
+
+#define INDIGO_DEFAULT_PORT 7624
+#define MAX_CONNECTIONS			65536
+
+typedef struct {
+	int socket;
+	uint8_t protocol;
+	pthread_t thread;
+	atomic_long received;
+	long sent;
+	long recorded;
+} replay_connection;
+
+static const char *type_text[] = { "?", "open", "close", "in", "out", "blob", "in-blob" };
+static const char *protocol_text[] = { "xml", "json", "websocket" };
+
+static replay_connection *connections[MAX_CONNECTIONS];
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *reader(replay_connection *connection) {
+	char buffer[64 * 1024];
+	long count;
+	while ((count = read(connection->socket, buffer, sizeof(buffer))) > 0)
+		atomic_fetch_add(&connection->received, count);
+	return NULL;
+}
+
+static replay_connection *open_connection(const char *hostname, int port, uint8_t protocol) {
+	int handle = indigo_open_tcp(hostname, port);
+	if (handle < 0) {
+		fprintf(stderr, "Can't connect to %s:%d\n", hostname, port);
+		return NULL;
+	}
+	if (protocol == INDIGO_RECORD_WEBSOCKET) {
+		/* handshake is not recorded, frames are sent as recorded (masked by original client) */
+		char line[1024];
+		indigo_printf(handle, "GET / HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", hostname);
+		while (indigo_read_line(handle, line, sizeof(line) - 1) > 0)
+			;
+	}
+	replay_connection *connection = calloc(1, sizeof(replay_connection));
+	connection->socket = handle;
+	connection->protocol = protocol;
+	pthread_create(&connection->thread, NULL, (void * (*)(void*))reader, connection);
+	return connection;
+}
+
+static void close_connection(replay_connection *connection) {
+	shutdown(connection->socket, SHUT_WR);
+	pthread_join(connection->thread, NULL);
+	close(connection->socket);
+}
+
+static void dump_record(indigo_record_header *header, char *payload) {
+	printf("%12.6f #%-4u %-5s", header->timestamp / 1e6, header->connection, header->type <= INDIGO_RECORD_INBOUND_BLOB ? type_text[header->type] : "?");
+	switch (header->type) {
+		case INDIGO_RECORD_OPEN:
+			printf(" %s\n", header->protocol <= INDIGO_RECORD_WEBSOCKET ? protocol_text[header->protocol] : "?");
+			break;
+		case INDIGO_RECORD_INBOUND:
+		case INDIGO_RECORD_OUTBOUND:
+			if (header->protocol == INDIGO_RECORD_WEBSOCKET) {
+				printf(" %u bytes\n", header->length);
+			} else {
+				while (header->length > 0 && payload[header->length - 1] == '\n')
+					payload[--header->length] = 0;
+				printf(" %s\n", payload);
+			}
+			break;
+		case INDIGO_RECORD_BLOB: {
+			indigo_record_blob *blob = (indigo_record_blob *)payload;
+			printf(" %llu bytes %s hash %016llx\n", (unsigned long long)blob->size, blob->format, (unsigned long long)blob->hash);
+			break;
+		}
+		case INDIGO_RECORD_INBOUND_BLOB: {
+			indigo_record_blob *blob = (indigo_record_blob *)payload;
+			printf(" %llu bytes %s hash %016llx, %llu encoded bytes not recorded\n", (unsigned long long)blob->size, blob->format, (unsigned long long)blob->hash, (unsigned long long)blob->encoded);
+			break;
+		}
+		default:
+			printf("\n");
+			break;
+	}
+}
+
+static void print_help(const char *name) {
+	printf("usage: %s [options] recording_file\n", name);
+	printf("options:\n"
+	       "       -h  | --help\n"
+	       "       -d  | --dump                      (print recording, don't replay)\n"
+	       "       -s  | --speed factor              (default: 1)\n"
+	       "       -m  | --max-speed\n"
+	       "       -r  | --remote-server host[:port] (default: localhost)\n"
+	       "       -p  | --port port                 (default: 7624)\n"
+	);
+}
+
+int main(int argc, const char * argv[]) {
+	indigo_main_argc = argc;
+	indigo_main_argv = argv;
+	/* server can close connection while recorded traffic is sent */
+	signal(SIGPIPE, SIG_IGN);
+	int port = INDIGO_DEFAULT_PORT;
+	char hostname[255] = "localhost";
+	double speed = 1;
+	bool dump = false;
+	const char *path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--dump")) {
+			dump = true;
+		} else if (!strcmp(argv[i], "-m") || !strcmp(argv[i], "--max-speed")) {
+			speed = 0;
+		} else if ((!strcmp(argv[i], "-s") || !strcmp(argv[i], "--speed")) && i < argc - 1) {
+			speed = atof(argv[++i]);
+			if (speed < 0)
+				speed = 0;
+		} else if ((!strcmp(argv[i], "-r") || !strcmp(argv[i], "--remote-server")) && i < argc - 1) {
+			char port_str[100];
+			if (sscanf(argv[++i], "%[^:]:%s", hostname, port_str) > 1)
+				port = atoi(port_str);
+		} else if ((!strcmp(argv[i], "-p") || !strcmp(argv[i], "--port")) && i < argc - 1) {
+			port = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			print_help(argv[0]);
+			return 0;
+		} else if (argv[i][0] != '-') {
+			path = argv[i];
+		}
+	}
+	if (path == NULL) {
+		print_help(argv[0]);
+		return 1;
+	}
+	uint64_t recording_start;
+	FILE *file = indigo_open_recording(path, &recording_start);
+	if (file == NULL) {
+		fprintf(stderr, "Can't open recording %s\n", path);
+		return 1;
+	}
+	indigo_record_header header;
+	char *payload = NULL;
+	long size = 0;
+	if (dump) {
+		time_t start = (time_t)(recording_start / 1000000);
+		printf("recording started %s", ctime(&start));
+		while (indigo_read_record(file, &header, &payload, &size))
+			dump_record(&header, payload);
+		free(payload);
+		fclose(file);
+		return 0;
+	}
+
+	long opened = 0, messages = 0, sent = 0, recorded = 0, blobs = 0;
+	double recorded_time = 0;
+	double start = now();
+	while (indigo_read_record(file, &header, &payload, &size)) {
+		recorded_time = header.timestamp / 1e6;
+		if (speed > 0) {
+			double delay = start + recorded_time / speed - now();
+			if (delay > 0)
+				usleep((useconds_t)(delay * 1e6));
+		}
+		replay_connection *connection = connections[header.connection];
+		switch (header.type) {
+			case INDIGO_RECORD_OPEN:
+				if (connection == NULL) {
+					connection = connections[header.connection] = open_connection(hostname, port, header.protocol);
+					if (connection == NULL)
+						return 1;
+					opened++;
+				}
+				break;
+			case INDIGO_RECORD_INBOUND:
+				if (connection && connection->socket >= 0) {
+					indigo_write(connection->socket, payload, header.length);
+					connection->sent += header.length;
+					sent += header.length;
+					messages++;
+				}
+				break;
+			case INDIGO_RECORD_OUTBOUND:
+				if (connection) {
+					connection->recorded += header.length;
+					recorded += header.length;
+				}
+				break;
+			case INDIGO_RECORD_BLOB:
+				if (connection) {
+					/* BLOB data are not stored, count base64 encoded size */
+					long length = (long)(((indigo_record_blob *)payload)->size + 2) / 3 * 4;
+					connection->recorded += length;
+					recorded += length;
+					blobs++;
+				}
+				break;
+			case INDIGO_RECORD_INBOUND_BLOB:
+				if (connection && connection->socket >= 0) {
+					/* BLOB data are not stored, send the same amount of base64 encoded zeros */
+					static char zeros[16 * 1024];
+					if (*zeros == 0)
+						memset(zeros, 'A', sizeof(zeros));
+					long length = (long)((indigo_record_blob *)payload)->encoded;
+					for (long remaining = length; remaining > 0; remaining -= sizeof(zeros))
+						indigo_write(connection->socket, zeros, remaining < sizeof(zeros) ? remaining : sizeof(zeros));
+					connection->sent += length;
+					sent += length;
+				}
+				break;
+			case INDIGO_RECORD_CLOSE:
+				if (connection && connection->socket >= 0)
+					shutdown(connection->socket, SHUT_WR);
+				break;
+		}
+	}
+	double send_time = now() - start;
+	long received = 0;
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		replay_connection *connection = connections[i];
+		if (connection) {
+			close_connection(connection);
+			received += atomic_load(&connection->received);
+			free(connection);
+		}
+	}
+	double elapsed = now() - start;
+	free(payload);
+	fclose(file);
+	printf("recording:   %.3fs, %ld connections, %ld client writes (%ld bytes), %ld bytes sent to clients, %ld BLOBs\n", recorded_time, opened, messages, sent, recorded, blobs);
+	printf("replay:      %.3fs (requests sent in %.3fs, %.1f writes/s), %ld bytes received\n", elapsed, send_time, send_time > 0 ? messages / send_time : 0, received);
+	return 0;
+}